@@ -20,6 +20,40 @@
 #ifndef WMMHEADER_H
 #define WMMHEADER_H
 
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef WMM_THREADS
+#if defined(__unix__) || defined(__APPLE__)
+#define WMM_THREADS	1	/* WMM_GridParallel runs on POSIX threads; define as 0 for single threaded targets */
+#else
+#define WMM_THREADS	0
+#endif
+#endif
+
+#if WMM_THREADS
+#include <pthread.h>
+#endif
+
+#ifndef WMM_MMAP
+#if defined(__unix__) || defined(__APPLE__)
+#define WMM_MMAP	1	/* WMM_InitializeGeoidMapped maps the geoid file; define as 0 where mmap is not available */
+#else
+#define WMM_MMAP	0
+#endif
+#endif
+
+#ifndef WMM_EMBED_DATA
+#define WMM_EMBED_DATA	0	/* 1 links WMM.COF and EGM9615.BIN into the library (make EMBED=1); they are then used
+							   whenever WMM_COF_FILE or WMM_GEOID_FILE is asked for, without file access */
+#endif
+
+#ifndef WMM_STATS
+#define WMM_STATS	0	/* 1 compiles call counters and timers into the stages of the library (make STATS=1),
+						   see WMM_GetStats; with 0 the instrumentation compiles to nothing */
+#endif
+
 #ifndef M_PI
 #define M_PI    ((2)*(acos(0.0)))
 #endif
@@ -43,6 +77,101 @@
 
 #define WMM_GEO_POLE_TOLERANCE  1e-5
 #define WMM_USE_GEOID	1    /* 1 Geoid - Ellipsoid difference should be corrected, 0 otherwise */
+#define WMM_COF_FILE	"WMM.COF"	/* Default coefficient file */
+#define WMM_GEOID_FILE	"EGM9615.BIN"	/* Default geoid file, see WMMtype_Geoid.GeoidFileName */
+#define WMM_COF_BUFFER_SIZE	65536	/* Largest coefficient file read by WMM_readMagneticModel */
+#define WMM_ERR_NONE	0	/* Error codes of the context API; values shared with WMM_Error where it has one */
+#define WMM_ERR_ALLOCATION	2
+#define WMM_ERR_GEOID_NOT_INITIALIZED	5
+#define WMM_ERR_MODEL	8
+#define WMM_ERR_GEOID_RANGE	17
+#define WMM_ERR_ARGUMENT	26	/* 23 and 24 are passed by WMM_GetTransverseMercator */
+#define WMM_ERR_RANGE	27
+#define WMM_GEOID_FLOAT32	0	/* Geoid heights stored as float meters, as in EGM9615.BIN */
+#define WMM_GEOID_INT16	1	/* Geoid heights stored as int16 centimeters, max error 0.5 cm */
+#define WMM_GEOID_TILE_SHIFT	4	/* Log2 of WMM_GEOID_TILE_SIZE, tile coordinates are shifts and masks */
+#define WMM_GEOID_TILE_SIZE	(1 << WMM_GEOID_TILE_SHIFT)	/* Cells per side of a geoid tile, see WMM_GeoidBuildTiles */
+#define WMM_GEOID_TILE_POSTS	((WMM_GEOID_TILE_SIZE + 1) * (WMM_GEOID_TILE_SIZE + 1))	/* Posts per tile, halo included */
+#define WMM_TABLE_MAX_DEGREE	16	/* Highest degree summed from the Gauss-normalized tables, beyond it the Gauss functions lose precision as WMM_PcupLow does */
+#define WMM_BATCH_BLOCK_SIZE	64  /* Points evaluated together by WMM_GeomagBatch, sized so a block stays in L1 cache */
+#define WMM_TIMED_CACHE_SIZE	8	/* Time modified models a workspace keeps, see WMM_SetWorkspaceDate */
+
+#define WMM_SIMD_LANES	8	/* Points per lane group of the block summation kernels */
+#define WMM_SIMD_AUTO	-1	/* Select the best summation kernel supported by the CPU */
+#define WMM_SIMD_NONE	0	/* Portable scalar summation kernel */
+#define WMM_SIMD_SSE2	1	/* SSE2 kernel, 2 points per instruction */
+#define WMM_SIMD_AVX2	2	/* AVX2/FMA kernel, 4 points per instruction */
+#define WMM_SIMD_AVX512	3	/* AVX-512F kernel, 8 points per instruction */
+#define WMM_FLOAT_LANES	16	/* Points per lane group of the single precision kernels, see WMM_ContextGeomagBatchFloat */
+
+#define WMM_FIXED_NMAX	12	/* Largest degree of the fixed point engine (WMM_FixedSummation), sizes WMMtype_FixedModel */
+#define WMM_FIXED_NUM_TERMS	((WMM_FIXED_NMAX + 1) * (WMM_FIXED_NMAX + 2) / 2)
+#define WMM_FIXED_UNIT_BITS	30	/* Q30: sines, cosines and a/r of the fixed point engine */
+#define WMM_FIXED_RECURSION_BITS	28	/* Q28: Legendre recursion coefficients, up to sqrt(2 nMax - 1) */
+#define WMM_FIXED_LEGENDRE_BITS	25	/* Q25: Legendre functions and their derivatives, below 64 in magnitude */
+#define WMM_FIXED_COEFF_BITS	15	/* Q15: Gauss coefficients, also combined with cos and sin(m lambda), nT, range +-65536 */
+#define WMM_FIXED_RATE_BITS	20	/* Q20: secular variation coefficients, nT/yr, range +-2048 */
+#define WMM_FIXED_FIELD_BITS	13	/* Q13: field components, nT or nT/yr, range +-262144 */
+#define WMM_FIXED_YEAR_BITS	24	/* Q24: years from the model epoch, range +-128 */
+#define WMM_FIXED_FROM_DOUBLE(Value, Bits)	((WMMtype_Fixed) floor((Value) * (double) (1L << (Bits)) + 0.5))
+#define WMM_FIXED_TO_DOUBLE(Value, Bits)	((double) (Value) / (double) (1L << (Bits)))
+
+#define WMM_STAT_GEOMAG	0	/* Stages counted with WMM_STATS, see WMM_StatName for the functions of each */
+#define WMM_STAT_BATCH	1
+#define WMM_STAT_TIME_SERIES	2
+#define WMM_STAT_GRID_ROW	3
+#define WMM_STAT_TIMELY_MODIFY	4
+#define WMM_STAT_GEODETIC	5
+#define WMM_STAT_GEOID	6
+#define WMM_STAT_HARMONIC	7
+#define WMM_STAT_LEGENDRE	8
+#define WMM_STAT_SUMMATION	9
+#define WMM_STAT_ROTATION	10
+#define WMM_STAT_ELEMENTS	11
+#define WMM_STAT_TRANSVERSE_MERCATOR	12
+#define WMM_NUM_STATS	13
+#define WMM_STATS_CLOCK_NONE	0	/* Built without WMM_STATS */
+#define WMM_STATS_CLOCK_TSC	1	/* Ticks are time stamp counter cycles */
+#define WMM_STATS_CLOCK_NS	2	/* Ticks are nanoseconds of CLOCK_MONOTONIC */
+
+#define WMM_GRID_ROWS_PER_THREAD	4	/* Grid rows a worker may compute ahead of the writer */
+#define WMM_GRID_LINE_LENGTH	64	/* Buffer size of the coordinates of one line of WMM_Grid output */
+#define WMM_GRID_COLUMN_LENGTH	16	/* Buffer size of each element column of a line */
+#define WMM_GRID_WRITE_BUFFER	(1 << 20)	/* Bytes buffered before a grid output file is written */
+
+#define WMM_GRID_TEXT		0	/* Output formats of WMM_GridParallel: text lines as WMM_Grid */
+#define WMM_GRID_FLOAT32	1	/* Binary file of float32 values */
+#define WMM_GRID_FLOAT64	2	/* Binary file of float64 values */
+
+#define WMM_GRID_FILE_MAGIC		"WMMGRID"	/* First 8 bytes of a binary grid file, with the trailing 0 */
+#define WMM_GRID_FILE_VERSION	1
+#define WMM_GRID_FILE_BYTE_ORDER	0x01020304	/* Written in the native byte order of the writer */
+#define WMM_GRID_FILE_ALIGNMENT	64	/* The values start at a multiple of this offset */
+#define WMM_GRID_MAX_ELEMENTS	16	/* Elements 1 to 16 of WMM_Grid */
+
+#define WMM_GRID_ELEMENT(n)	(1u << ((n) - 1))	/* Bit of element n (ElementOption of WMM_Grid) in a WMM_GridParallel mask */
+#define WMM_GRID_DECL		WMM_GRID_ELEMENT(1)
+#define WMM_GRID_INCL		WMM_GRID_ELEMENT(2)
+#define WMM_GRID_F			WMM_GRID_ELEMENT(3)
+#define WMM_GRID_H			WMM_GRID_ELEMENT(4)
+#define WMM_GRID_X			WMM_GRID_ELEMENT(5)
+#define WMM_GRID_Y			WMM_GRID_ELEMENT(6)
+#define WMM_GRID_Z			WMM_GRID_ELEMENT(7)
+#define WMM_GRID_GV			WMM_GRID_ELEMENT(8)
+#define WMM_GRID_DECLDOT	WMM_GRID_ELEMENT(9)
+#define WMM_GRID_INCLDOT	WMM_GRID_ELEMENT(10)
+#define WMM_GRID_FDOT		WMM_GRID_ELEMENT(11)
+#define WMM_GRID_HDOT		WMM_GRID_ELEMENT(12)
+#define WMM_GRID_XDOT		WMM_GRID_ELEMENT(13)
+#define WMM_GRID_YDOT		WMM_GRID_ELEMENT(14)
+#define WMM_GRID_ZDOT		WMM_GRID_ELEMENT(15)
+#define WMM_GRID_GVDOT		WMM_GRID_ELEMENT(16)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define WMM_SIMD_X86	1	/* x86 kernels are compiled in and selected at run time with CPUID */
+#else
+#define WMM_SIMD_X86	0
+#endif
 
 /*
 Data types and prototype declaration for
@@ -64,6 +193,13 @@ typedef struct {
 			int nMax; // Maximum degree of spherical harmonic model
 			int nMaxSecVar;//Maxumum degree of spherical harmonic secular model
 			int SecularVariationUsed; //Whether or not the magnetic secular variation vector will be needed by program
+			double *Main_Field_Coeff_GS; // C multiplied by the Schmidt quasi-normalization factors (nT)
+			double *Main_Field_Coeff_HS; // C multiplied by the Schmidt quasi-normalization factors (nT)
+			double *Secular_Var_Coeff_GS; // CD multiplied by the Schmidt quasi-normalization factors (nT/yr)
+			double *Secular_Var_Coeff_HS; // CD multiplied by the Schmidt quasi-normalization factors (nT/yr)
+			double *SchmidtQuasiNorm; // Gauss to Schmidt quasi-normalization ratios up to nMax
+			double *RecursionCoeff; // k(n,m) of the Gauss-normalized Legendre recursion up to nMax
+			int CoefficientTablesNMax; // Degree the coefficient tables were built for, 0 if not built
 			} WMMtype_MagneticModel;
 
 typedef struct {
@@ -150,6 +286,16 @@ typedef struct {
 			int NumbGeoidElevs;
 			int  Geoid_Initialized ;  /* indicates successful initialization */
 			int UseGeoid; /*Is the Geoid being used?*/
+			const char *GeoidFileName; /* Geoid file read at initialization, WMM_GEOID_FILE by default */
+			int External; /* GeoidHeightBuffer is the caller's memory, see WMM_InitializeGeoidFromBuffer */
+			int Storage; /* WMM_GEOID_FLOAT32 (GeoidHeightBuffer) or WMM_GEOID_INT16 (GeoidHeightBufferCm) */
+			int16_t *GeoidHeightBufferCm; /* Geoid heights in centimeters, see WMM_InitializeGeoidQuantized */
+			int Tiled; /* Build the cache-blocked tiles at initialization, see WMM_GeoidBuildTiles */
+			float *GeoidTiles; /* Tiled copy of GeoidHeightBuffer */
+			int16_t *GeoidTilesCm; /* Tiled copy of GeoidHeightBufferCm */
+			int NumbTileCols; /* Tiles per row of tiles */
+			int Mapped; /* GeoidHeightBuffer is a read-only mapping of the file, see WMM_InitializeGeoidMapped */
+			size_t MappedSize; /* Length of the mapping */
 			} WMMtype_Geoid;
 typedef struct {
 			char Longitude[40];
@@ -166,6 +312,171 @@ typedef struct {
 			double PointScale;
 			}WMMtype_UTMParameters;
 
+typedef float WMMtype_Float;	/* Precision of the single precision engine (WMM_ContextGeomagBatchFloat); its SIMD kernels expect float */
+
+typedef int32_t WMMtype_Fixed;	/* Fixed point value of the integer engine; the WMM_FIXED_*_BITS of each quantity give its format */
+
+typedef struct {
+			int nMax;
+			int nMaxSecVar;
+			WMMtype_Fixed G[WMM_FIXED_NUM_TERMS]; /* Main field Gauss coefficients at the epoch, Schmidt quasi-normalized, Q15 nT */
+			WMMtype_Fixed H[WMM_FIXED_NUM_TERMS];
+			WMMtype_Fixed dG[WMM_FIXED_NUM_TERMS]; /* Secular variation coefficients, Q20 nT/yr, 0 above nMaxSecVar */
+			WMMtype_Fixed dH[WMM_FIXED_NUM_TERMS];
+			WMMtype_Fixed A[WMM_FIXED_NUM_TERMS]; /* Schmidt recursion: P(n,m) = A x P(n-1,m) - B P(n-2,m), and P(n,n) = A z P(n-1,n-1); Q28 */
+			WMMtype_Fixed B[WMM_FIXED_NUM_TERMS];
+			} WMMtype_FixedModel; /* Model of the fixed point engine, built by WMM_FixedModelFromModel; constant, may be placed in ROM */
+
+typedef struct {
+			WMMtype_Fixed SinPhi; /* sin and cos of the geocentric latitude, Q30 */
+			WMMtype_Fixed CosPhi;
+			WMMtype_Fixed SinLambda; /* sin and cos of the longitude, Q30 */
+			WMMtype_Fixed CosLambda;
+			WMMtype_Fixed RadiusRatio; /* Ellip.re / r, Q30 */
+			} WMMtype_CoordSphericalFixed;
+
+typedef struct {
+			WMMtype_Fixed Bx;    /* North, Q13 */
+			WMMtype_Fixed By;	  /* East */
+			WMMtype_Fixed Bz;    /* Down */
+			} WMMtype_MagneticResultsFixed;
+
+typedef struct {
+			int nMax; /* Maximum degree the workspace was sized for */
+			int NumTerms; /* Number of spherical harmonic terms up to nMax */
+			WMMtype_LegendreFunction LegendreFunction; /* Legendre function buffers owned by the workspace */
+			double *SchmidtQuasiNorm; /* Gauss to Schmidt quasi-normalization ratios, computed once for nMax */
+			double *PreSqr; /* sqrt(n) table used by WMM_PcupHigh */
+			double *f1; /* Recursion coefficients used by WMM_PcupHigh */
+			double *f2; /* Recursion coefficients used by WMM_PcupHigh */
+			double *PcupS; /* Scratch space for the By summation at the geographic poles */
+			double *PcupBlock; /* Legendre functions of WMM_SIMD_LANES points, element [index * WMM_SIMD_LANES + lane] */
+			double *dPcupBlock; /* Derivatives of the Legendre functions, same layout as PcupBlock */
+			double *RelativeRadiusPowerBlock; /* (a/r)^(n+2) of WMM_SIMD_LANES points, element [n * WMM_SIMD_LANES + lane] */
+			double *cos_mlambdaBlock; /* cos(m lambda) of WMM_SIMD_LANES points, element [m * WMM_SIMD_LANES + lane] */
+			double *sin_mlambdaBlock; /* sin(m lambda) of WMM_SIMD_LANES points, element [m * WMM_SIMD_LANES + lane] */
+			WMMtype_MagneticModel *TimedMagneticModel; /* Time modified model used by the batch functions, one of TimedCache */
+			WMMtype_MagneticModel *TimedSource; /* Model TimedMagneticModel was derived from, NULL if none */
+			double TimedDecimalYear; /* Date TimedMagneticModel was derived for */
+			double DateResolution; /* Dates are rounded to multiples of this many years, 0 for exact dates */
+			WMMtype_MagneticModel *TimedCache[WMM_TIMED_CACHE_SIZE]; /* Time modified models, allocated on first use */
+			WMMtype_MagneticModel *TimedCacheSource[WMM_TIMED_CACHE_SIZE]; /* Model of each entry, NULL if unused */
+			double TimedCacheYear[WMM_TIMED_CACHE_SIZE]; /* Date of each entry */
+			unsigned long TimedCacheUse[WMM_TIMED_CACHE_SIZE]; /* Value of TimedCacheClock at the last use of each entry */
+			unsigned long TimedCacheClock;
+			WMMtype_Float *FloatCoeff; /* G, H, dG and dH of TimedMagneticModel, Schmidt scaled, then k(n,m), NumTerms each; see WMM_SetWorkspaceFloatCoeff */
+			WMMtype_MagneticModel *FloatSource; /* Model FloatCoeff was converted for, NULL if none */
+			double FloatDecimalYear; /* Date FloatCoeff was converted for */
+			WMMtype_Float *PcupFloat; /* Legendre functions of WMM_FLOAT_LANES points, element [index * WMM_FLOAT_LANES + lane] */
+			WMMtype_Float *dPcupFloat; /* Derivatives of the Legendre functions, same layout as PcupFloat */
+			WMMtype_Float *RelativeRadiusPowerFloat; /* (a/r)^(n+2) of WMM_FLOAT_LANES points, element [n * WMM_FLOAT_LANES + lane] */
+			WMMtype_Float *cos_mlambdaFloat; /* cos(m lambda) of WMM_FLOAT_LANES points, element [m * WMM_FLOAT_LANES + lane] */
+			WMMtype_Float *sin_mlambdaFloat; /* sin(m lambda) of WMM_FLOAT_LANES points, element [m * WMM_FLOAT_LANES + lane] */
+			} WMMtype_Workspace;
+
+typedef struct {
+			double *Heights;		/* Grid axes, in the order of the output */
+			double *Latitudes;
+			double *Longitudes;
+			double *Years;
+			int NumHeights, NumLatitudes, NumLongitudes, NumYears;
+			WMMtype_MagneticModel *MagneticModel;
+			WMMtype_MagneticModel *EpochMagneticModel;	/* Copy of MagneticModel for the time series of each point, see WMM_TimeSeriesElements */
+			double *cos_mlambda;	/* cos(m lambda), m = 0..nMax, of each of Longitudes */
+			double *sin_mlambda;	/* sin(m lambda), m = 0..nMax, of each of Longitudes */
+			WMMtype_Geoid *Geoid;
+			WMMtype_Ellipsoid Ellip;
+			int NumElements;		/* Elements to output, in increasing order */
+			int Elements[WMM_GRID_MAX_ELEMENTS];
+			int OutputFormat;		/* WMM_GRID_TEXT, WMM_GRID_FLOAT32 or WMM_GRID_FLOAT64 */
+			int NumRows;			/* Heights x Latitudes, one output row per pair */
+			int NextRow;			/* Next row to be computed */
+			int RowsWritten;		/* Rows already written out */
+			int Window;				/* Rows that may be computed ahead of RowsWritten */
+			char **RowData;			/* Formatted rows (text or binary) waiting to be written, NULL until computed */
+			size_t *RowSize;
+			int Status;				/* FALSE once a worker failed */
+			uint64_t DataOffset;	/* Binary formats: offset of the first plane in the file */
+			char *PlaneBuffer;		/* Binary formats: rows staged per plane by WMM_GridWriteRow */
+			size_t PlaneRowSize;	/* Bytes of one row in one plane */
+			int PlaneRows, PlaneStagedRows, PlaneFirstRow;
+#if WMM_THREADS
+			pthread_mutex_t Lock;
+			pthread_cond_t RowReady;	/* Signalled when a row has been computed */
+			pthread_cond_t RowWritten;	/* Signalled when the writer frees a row */
+#endif
+			} WMMtype_GridJob;
+
+/* Binary grid file written by WMM_GridParallel. All fields are in the byte order of the writer, which
+ByteOrder identifies. The header is followed by the axes as float64 arrays, in this order: Heights
+(km), Latitudes (degrees), Longitudes (degrees) and Years (decimal years). From DataOffset, a multiple
+of WMM_GRID_FILE_ALIGNMENT, come NumElements planes of ValueSize byte floats, one per entry of
+Elements. Each plane is an array [NumHeights][NumLatitudes][NumLongitudes][NumYears], the order of the
+text output, so the file can be mapped into memory and indexed directly. */
+typedef struct {
+			char Magic[8];			/* WMM_GRID_FILE_MAGIC */
+			int32_t Version;		/* WMM_GRID_FILE_VERSION */
+			int32_t ByteOrder;		/* WMM_GRID_FILE_BYTE_ORDER */
+			int32_t ValueSize;		/* 4 for float32 values, 8 for float64 */
+			int32_t NumElements;	/* Number of planes */
+			int32_t NumHeights, NumLatitudes, NumLongitudes, NumYears;
+			int32_t Elements[WMM_GRID_MAX_ELEMENTS];	/* Element (ElementOption of WMM_Grid) of each plane */
+			int32_t HeightAboveGeoid;	/* 1 if the heights are above MSL, 0 if above the ellipsoid */
+			int32_t Padding;		/* Always 0; keeps Epoch at a multiple of 8 on every ABI */
+			char ModelName[32];
+			double Epoch;			/* Base epoch of the model */
+			double EditionDate;
+			uint64_t DataOffset;	/* Byte offset of the first plane */
+			} WMMtype_GridFileHeader;
+
+/* The layout of WMMtype_GridFileHeader is the file format: it must not depend on the alignment of
+double and uint64_t, which is 4 bytes on i386 and 8 on x86_64 */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+_Static_assert(offsetof(WMMtype_GridFileHeader, Epoch) == 144, "WMMtype_GridFileHeader.Epoch must be at byte 144");
+_Static_assert(offsetof(WMMtype_GridFileHeader, DataOffset) == 160, "WMMtype_GridFileHeader.DataOffset must be at byte 160");
+_Static_assert(sizeof(WMMtype_GridFileHeader) == 168, "WMMtype_GridFileHeader must be 168 bytes");
+#endif
+
+typedef struct {
+			double *X; 		/* Northern component of the magnetic field vector */
+			double *Y; 		/* Eastern component of the magnetic field vector */
+			double *Z; 		/* Downward component of the magnetic field vector */
+			double *F; 		/* Magnetic Field Strength */
+			double *H; 		/* Horizontal Magnetic Field Strength */
+			double *Decl; 	/* Declination */
+			double *Incl; 	/* Inclination */
+			double *Xdot; 	/* Yearly rate of change in the northern component */
+			double *Ydot; 	/* Yearly rate of change in the eastern component */
+			double *Zdot; 	/* Yearly rate of change in the downward component */
+			double *Fdot; 	/* Yearly rate of change in Magnetic field strength */
+			double *Hdot; 	/* Yearly rate of change in horizontal field strength */
+			double *Decldot; /* Yearly Rate of change in declination */
+			double *Incldot; /* Yearly Rate of change in inclination */
+			} WMMtype_GeoMagneticElementsBatch; /* Caller owned output arrays of n elements each, NULL arrays are skipped */
+
+typedef struct {
+			WMMtype_Float *X, *Y, *Z, *F, *H, *Decl, *Incl;
+			WMMtype_Float *Xdot, *Ydot, *Zdot, *Fdot, *Hdot, *Decldot, *Incldot;
+			} WMMtype_GeoMagneticElementsBatchFloat; /* WMMtype_GeoMagneticElementsBatch in single precision */
+
+typedef struct {
+			WMMtype_Ellipsoid Ellip;
+			WMMtype_MagneticModel *MagneticModel;	/* Shared between contexts, only read */
+			WMMtype_Geoid *Geoid;	/* Shared between contexts, only read; NULL for heights above the ellipsoid */
+			WMMtype_Workspace *Workspace;	/* Owned by the context */
+			int OwnsWorkspace;	/* Workspace is freed by WMM_FreeContext */
+			int Error;		/* WMM_ERR_* of the first failure since WMM_ContextClearError */
+			size_t ErrorIndex;	/* Point of Error in the batch that failed */
+			size_t NumErrors;	/* Points that failed since WMM_ContextClearError */
+			} WMMtype_Context; /* State of one caller of the reentrant API; one context per thread */
+
+typedef struct {
+			unsigned long long Calls[WMM_NUM_STATS];	/* Calls of the functions of each stage, WMM_STAT_* */
+			unsigned long long Ticks[WMM_NUM_STATS];	/* Time spent in them, in units of Clock */
+			int Clock;		/* WMM_STATS_CLOCK_* */
+			int NumThreads;	/* Threads that have counted a call, ended ones included */
+			} WMMtype_Stats; /* Instrumentation counters of all threads, see WMM_GetStats */
+
 /*Prototypes */
 
 
@@ -173,8 +484,12 @@ typedef struct {
 
 	WMMtype_MagneticModel *WMM_AllocateModelMemory(int NumTerms);
 
+	WMMtype_Workspace *WMM_AllocateWorkspace(int nMax);
+
 	int WMM_AssociatedLegendreFunction(	WMMtype_CoordSpherical CoordSpherical, int nMax, WMMtype_LegendreFunction *LegendreFunction);
 
+	int WMM_AssociatedLegendreFunctionWithWorkspace(WMMtype_CoordSpherical CoordSpherical, int nMax, WMMtype_Workspace *Workspace);
+
 	int WMM_CalculateGeoMagneticElements(WMMtype_MagneticResults *MagneticResultsGeo, WMMtype_GeoMagneticElements *GeoMagneticElements);
 
 	int WMM_CalculateGridVariation(WMMtype_CoordGeodetic location, WMMtype_GeoMagneticElements *elements);
@@ -183,6 +498,8 @@ typedef struct {
 
 	int WMM_CheckGeographicPole(WMMtype_CoordGeodetic *CoordGeodetic);
 
+	int WMM_ComputeCoefficientTables(WMMtype_MagneticModel *MagneticModel);
+
 	int WMM_ComputeSphericalHarmonicVariables(	WMMtype_Ellipsoid  Ellip,
 							WMMtype_CoordSpherical  CoordSpherical,
 							int nMax,
@@ -196,12 +513,28 @@ typedef struct {
 
 	void WMM_Error (int control);
 
+	const char *WMM_ErrorMessage(int Code);
+
+	int WMM_FixedFromSpherical(WMMtype_Ellipsoid Ellip, WMMtype_CoordSpherical CoordSpherical, WMMtype_CoordSphericalFixed *CoordFixed);
+
+	int WMM_FixedModelFromModel(WMMtype_MagneticModel *MagneticModel, WMMtype_FixedModel *FixedModel);
+
+	int WMM_FixedSummation(const WMMtype_FixedModel *FixedModel,
+					WMMtype_Fixed YearOffset,
+					const WMMtype_CoordSphericalFixed *CoordFixed,
+					WMMtype_MagneticResultsFixed *MagneticResultsSph,
+					WMMtype_MagneticResultsFixed *MagneticResultsSphVar);
+
 	int WMM_FreeMemory(WMMtype_MagneticModel *MagneticModel, WMMtype_MagneticModel *TimedMagneticModel, WMMtype_LegendreFunction *LegendreFunction);
 
+	int WMM_FreeGeoid(WMMtype_Geoid *Geoid);
+
 	int WMM_FreeLegendreMemory(WMMtype_LegendreFunction *LegendreFunction);
 
 	int WMM_FreeMagneticModelMemory(WMMtype_MagneticModel *MagneticModel);
 
+	int WMM_FreeWorkspace(WMMtype_Workspace *Workspace);
+
 	int WMM_GeodeticToSpherical(WMMtype_Ellipsoid Ellip, WMMtype_CoordGeodetic CoordGeodetic, WMMtype_CoordSpherical *CoordSpherical);
 
 	int WMM_Geomag(WMMtype_Ellipsoid Ellip,
@@ -210,9 +543,67 @@ typedef struct {
 					WMMtype_MagneticModel *TimedMagneticModel,
 					WMMtype_GeoMagneticElements  *GeoMagneticElements);
 
+	int WMM_GeomagWithWorkspace(WMMtype_Ellipsoid Ellip,
+					WMMtype_CoordSpherical CoordSpherical,
+					WMMtype_CoordGeodetic CoordGeodetic,
+					WMMtype_MagneticModel *TimedMagneticModel,
+					WMMtype_GeoMagneticElements  *GeoMagneticElements,
+					WMMtype_Workspace *Workspace);
+
+	int WMM_GeomagBatch(const double *Latitude,
+					const double *Longitude,
+					const double *Height,
+					double DecimalYear,
+					size_t NumPoints,
+					WMMtype_Ellipsoid Ellip,
+					WMMtype_MagneticModel *MagneticModel,
+					WMMtype_Geoid *Geoid,
+					WMMtype_Workspace *Workspace,
+					WMMtype_GeoMagneticElementsBatch *Results);
+
+	WMMtype_Context *WMM_CreateContext(WMMtype_Ellipsoid Ellip, WMMtype_MagneticModel *MagneticModel, WMMtype_Geoid *Geoid);
+
+	void WMM_FreeContext(WMMtype_Context *Context);
+
+	void WMM_ContextClearError(WMMtype_Context *Context);
+
+	int WMM_ContextGeomagBatch(WMMtype_Context *Context,
+					const double *Latitude,
+					const double *Longitude,
+					const double *Height,
+					double DecimalYear,
+					size_t NumPoints,
+					WMMtype_GeoMagneticElementsBatch *Results);
+
+	int WMM_ContextGeomagBatchFloat(WMMtype_Context *Context,
+					const WMMtype_Float *Latitude,
+					const WMMtype_Float *Longitude,
+					const WMMtype_Float *Height,
+					double DecimalYear,
+					size_t NumPoints,
+					WMMtype_GeoMagneticElementsBatchFloat *Results);
+
+	int WMM_ContextGeomag(WMMtype_Context *Context,
+					double Latitude,
+					double Longitude,
+					double Height,
+					double DecimalYear,
+					WMMtype_GeoMagneticElements *GeoMagneticElements);
+
+	int WMM_ContextGeomagTimeSeries(WMMtype_Context *Context,
+					double Latitude,
+					double Longitude,
+					double Height,
+					const double *DecimalYear,
+					size_t NumDates,
+					WMMtype_GeoMagneticElementsBatch *Results);
 
 	char WMM_GeomagIntroduction(WMMtype_MagneticModel *MagneticModel);
 
+	int WMM_GetSimdLevel(void);
+
+	int WMM_GetStats(WMMtype_Stats *Stats);
+
 	int WMM_GetUserGrid(WMMtype_CoordGeodetic *minimum, 
 						WMMtype_CoordGeodetic *maximum, 
 						double *step_size, 
@@ -244,10 +635,58 @@ typedef struct {
 						int PrintOption,
 						char *OutputFile);
 
+	int WMM_GridAxis(double Start, double End, double Step, double **Axis);
+
+	void WMM_GridFreeJob(WMMtype_GridJob *Job);
+
+	size_t WMM_GridFormatRow(WMMtype_GridJob *Job, int Row, double *Values, char *Data);
+
+	double WMM_GridElement(WMMtype_GeoMagneticElements *GeoMagneticElements, int ElementOption);
+
+	int WMM_GridParallel(WMMtype_CoordGeodetic minimum,
+						WMMtype_CoordGeodetic maximum,
+						double step_size,
+						double altitude_step_size,
+						double time_step,
+						WMMtype_MagneticModel *MagneticModel,
+						WMMtype_Geoid *geoid,
+						WMMtype_Ellipsoid Ellip,
+						WMMtype_Date StartDate,
+						WMMtype_Date EndDate,
+						unsigned int ElementMask,
+						int PrintOption,
+						char *OutputFile,
+						int OutputFormat,
+						int NumThreads);
+
+	int WMM_GridRow(WMMtype_GridJob *Job, int Row, WMMtype_Workspace *Workspace, double *Values);
+
+	size_t WMM_GridRowBufferSize(WMMtype_GridJob *Job);
+
+	int WMM_GridRowSeparable(WMMtype_GridJob *Job, int Row, WMMtype_Workspace *Workspace, double *Values);
+
+	void *WMM_GridWorker(void *Job);
+
+	int WMM_GridWriteHeader(WMMtype_GridJob *Job, FILE *fileout);
+
+	int WMM_GridWriteRow(WMMtype_GridJob *Job, FILE *fileout, char *Data, size_t Size);
+
 	int WMM_PcupLow( double *Pcup, double *dPcup, double x, int nMax);
 
+	int WMM_PcupLowWithNorm( double *Pcup, double *dPcup, double x, int nMax, double *schmidtQuasiNorm);
+
+	int WMM_PcupLowWithTables( double *Pcup, double *dPcup, double x, int nMax, double *RecursionCoeff);
+
+	int WMM_PcupLowWithTablesBlock( double *Pcup, double *dPcup, double *x, int nMax, double *RecursionCoeff);
+
+	int WMM_PcupLowWithTablesFloatBlock( WMMtype_Float *Pcup, WMMtype_Float *dPcup, const WMMtype_Float *x, const WMMtype_Float *z, int nMax, const WMMtype_Float *RecursionCoeff);
+
 	int WMM_PcupHigh( double *Pcup, double *dPcup, double x, int nMax);
 
+	int WMM_PcupHighFactors(double *PreSqr, double *f1, double *f2, int nMax);
+
+	int WMM_PcupHighWithFactors( double *Pcup, double *dPcup, double x, int nMax, double *PreSqr, double *f1, double *f2);
+
 
 	void WMM_PrintUserData(WMMtype_GeoMagneticElements GeomagElements,
 								WMMtype_CoordGeodetic SpaceInput,
@@ -255,15 +694,35 @@ typedef struct {
 								WMMtype_MagneticModel *MagneticModel,
 								WMMtype_Geoid *Geoid);
 
+	void WMM_PrintStats(FILE *Stream);
+
 	int WMM_readMagneticModel(char *filename, WMMtype_MagneticModel *MagneticModel);
 
+	int WMM_readMagneticModelFromBuffer(const char *Buffer, size_t Size, WMMtype_MagneticModel *MagneticModel);
+
+	size_t WMM_BufferLine(const char *Buffer, size_t Size, size_t *Position, char *Line, size_t LineSize);
+
 	int WMM_readMagneticModel_Large(char *filename, char *filenameSV, WMMtype_MagneticModel *MagneticModel);
 
+	void WMM_ResetStats(void);
+
 	int WMM_RotateMagneticVector(WMMtype_CoordSpherical ,
 								 WMMtype_CoordGeodetic CoordGeodetic,
 								 WMMtype_MagneticResults MagneticResultsSph,
 								 WMMtype_MagneticResults *MagneticResultsGeo);
 
+	void WMM_DetectSimdLevel(void);
+
+	int WMM_SetSimdLevel(int Level);
+
+	int WMM_SetWorkspaceDate(WMMtype_Workspace *Workspace, WMMtype_MagneticModel *MagneticModel, double DecimalYear);
+
+	int WMM_SetWorkspaceFloatCoeff(WMMtype_Workspace *Workspace);
+
+	int WMM_SetDateResolution(WMMtype_Workspace *Workspace, double Resolution);
+
+	void WMM_ClearTimedModels(WMMtype_Workspace *Workspace);
+
 	int WMM_SetDefaults(WMMtype_Ellipsoid *Ellip, WMMtype_MagneticModel *MagneticModel, WMMtype_Geoid *Geoid);
 
 	int WMM_SecVarSummation(WMMtype_LegendreFunction *LegendreFunction,
@@ -277,19 +736,105 @@ typedef struct {
 								WMMtype_CoordSpherical CoordSpherical,
 								WMMtype_MagneticResults *MagneticResults);
 
+	int WMM_SecVarSummationWithScratch(WMMtype_LegendreFunction *LegendreFunction,
+							WMMtype_MagneticModel *MagneticModel,
+							WMMtype_SphericalHarmonicVariables SphVariables,
+							WMMtype_CoordSpherical CoordSpherical,
+							WMMtype_MagneticResults *MagneticResults,
+							double *PcupS);
+
+	int WMM_SecVarSummationSpecialWithScratch(WMMtype_MagneticModel *MagneticModel,
+								WMMtype_SphericalHarmonicVariables SphVariables,
+								WMMtype_CoordSpherical CoordSpherical,
+								WMMtype_MagneticResults *MagneticResults,
+								double *PcupS);
+
+	int WMM_SchmidtQuasiNormFactors(double *schmidtQuasiNorm, int nMax);
+
 	int WMM_Summation(	WMMtype_LegendreFunction *LegendreFunction,
 						WMMtype_MagneticModel *MagneticModel,
 						WMMtype_SphericalHarmonicVariables SphVariables,
 						WMMtype_CoordSpherical CoordSpherical,
 						WMMtype_MagneticResults *MagneticResults);
 
+	const char *WMM_StatName(int Stat);
+
+	int WMM_SphericalSummationBlock(WMMtype_Ellipsoid Ellip,
+									WMMtype_CoordSpherical *CoordSpherical,
+									int NumPoints,
+									WMMtype_MagneticModel *TimedMagneticModel,
+									WMMtype_Workspace *Workspace,
+									WMMtype_MagneticResults *MagneticResultsSph,
+									WMMtype_MagneticResults *MagneticResultsSphVar);
+
+	int WMM_SphericalSummationFloatBlock(WMMtype_Ellipsoid Ellip,
+										WMMtype_CoordSpherical *CoordSpherical,
+										int NumPoints,
+										WMMtype_Workspace *Workspace,
+										WMMtype_Float *Results);
+
+	int WMM_SphericalSummationWithWorkspace(WMMtype_Ellipsoid Ellip,
+											WMMtype_CoordSpherical CoordSpherical,
+											WMMtype_MagneticModel *TimedMagneticModel,
+											WMMtype_Workspace *Workspace,
+											WMMtype_MagneticResults *MagneticResultsSph,
+											WMMtype_MagneticResults *MagneticResultsSphVar);
+
+	void WMM_SummationBlock(WMMtype_Workspace *Workspace, double *G, double *H, double *dG, double *dH, int nMax, int nMaxSecVar, double *Results);
+
+	void WMM_SummationBlockScalar(WMMtype_Workspace *Workspace, double *G, double *H, double *dG, double *dH, int nMax, int nMaxSecVar, double *Results);
+
+#if WMM_SIMD_X86
+	void WMM_SummationBlockSSE2(WMMtype_Workspace *Workspace, double *G, double *H, double *dG, double *dH, int nMax, int nMaxSecVar, double *Results);
+
+	void WMM_SummationBlockAVX2(WMMtype_Workspace *Workspace, double *G, double *H, double *dG, double *dH, int nMax, int nMaxSecVar, double *Results);
+
+	void WMM_SummationBlockAVX512(WMMtype_Workspace *Workspace, double *G, double *H, double *dG, double *dH, int nMax, int nMaxSecVar, double *Results);
+#endif
+
+	void WMM_SummationFloatBlock(WMMtype_Workspace *Workspace, const WMMtype_Float *G, const WMMtype_Float *H, const WMMtype_Float *dG, const WMMtype_Float *dH, int nMax, int nMaxSecVar, WMMtype_Float *Results);
+
+	void WMM_SummationFloatBlockScalar(WMMtype_Workspace *Workspace, const WMMtype_Float *G, const WMMtype_Float *H, const WMMtype_Float *dG, const WMMtype_Float *dH, int nMax, int nMaxSecVar, WMMtype_Float *Results);
+
+#if WMM_SIMD_X86
+	void WMM_SummationFloatBlockSSE2(WMMtype_Workspace *Workspace, const WMMtype_Float *G, const WMMtype_Float *H, const WMMtype_Float *dG, const WMMtype_Float *dH, int nMax, int nMaxSecVar, WMMtype_Float *Results);
+
+	void WMM_SummationFloatBlockAVX2(WMMtype_Workspace *Workspace, const WMMtype_Float *G, const WMMtype_Float *H, const WMMtype_Float *dG, const WMMtype_Float *dH, int nMax, int nMaxSecVar, WMMtype_Float *Results);
+
+	void WMM_SummationFloatBlockAVX512(WMMtype_Workspace *Workspace, const WMMtype_Float *G, const WMMtype_Float *H, const WMMtype_Float *dG, const WMMtype_Float *dH, int nMax, int nMaxSecVar, WMMtype_Float *Results);
+#endif
+
 	int WMM_SummationSpecial(WMMtype_MagneticModel *MagneticModel,
 						WMMtype_SphericalHarmonicVariables SphVariables,
 						WMMtype_CoordSpherical CoordSpherical,
 						WMMtype_MagneticResults *MagneticResults);
 
+	int WMM_SummationSpecialWithScratch(WMMtype_MagneticModel *MagneticModel,
+						WMMtype_SphericalHarmonicVariables SphVariables,
+						WMMtype_CoordSpherical CoordSpherical,
+						WMMtype_MagneticResults *MagneticResults,
+						double *PcupS);
+
+	int WMM_SummationWithScratch(	WMMtype_LegendreFunction *LegendreFunction,
+						WMMtype_MagneticModel *MagneticModel,
+						WMMtype_SphericalHarmonicVariables SphVariables,
+						WMMtype_CoordSpherical CoordSpherical,
+						WMMtype_MagneticResults *MagneticResults,
+						double *PcupS);
+
+	int WMM_SummationWithSecVar(	WMMtype_LegendreFunction *LegendreFunction,
+						WMMtype_MagneticModel *MagneticModel,
+						WMMtype_SphericalHarmonicVariables SphVariables,
+						WMMtype_CoordSpherical CoordSpherical,
+						WMMtype_MagneticResults *MagneticResults,
+						WMMtype_MagneticResults *MagneticResultsSV,
+						double *PcupS);
+
 	int WMM_TimelyModifyMagneticModel(WMMtype_Date UserDate, WMMtype_MagneticModel *MagneticModel,  WMMtype_MagneticModel *TimedMagneticModel);
 
+	int WMM_TimeSeriesElements(WMMtype_MagneticResults MagneticResultsGeo, WMMtype_MagneticResults MagneticResultsGeoVar, double dt,
+					WMMtype_GeoMagneticElements *GeoMagneticElements);
+
 	int WMM_ValidateDMSstringlat (char *input, char *Error);
 
 	int WMM_ValidateDMSstringlong (char *input, char *Error);
@@ -311,6 +856,14 @@ typedef struct {
 /*Prototypes for Geoid Functions*/
 
 	int WMM_InitializeGeoid (WMMtype_Geoid *Geoid);
+
+	int WMM_InitializeGeoidMapped (WMMtype_Geoid *Geoid);
+
+	int WMM_InitializeGeoidQuantized (WMMtype_Geoid *Geoid);
+
+	int16_t WMM_GeoidQuantize (double Height);
+
+	int WMM_InitializeGeoidFromBuffer (WMMtype_Geoid *Geoid, const void *Buffer, size_t Size);
 /*
  * The function Initialize_Geoid reads geoid separation data from a file in
  * the current directory and builds the geoid separation table from it.  If an
@@ -331,6 +884,10 @@ typedef struct {
  *
  */
 
+ double WMM_GeoidPost(WMMtype_Geoid *Geoid, long Index);
+
+ int WMM_GeoidBuildTiles(WMMtype_Geoid *Geoid);
+
  int WMM_GetGeoidHeight (double Latitude, double Longitude, 	double *DeltaHeight, WMMtype_Geoid *Geoid);
 /*
  * The private function Get_Geoid_Height returns the height of the
@@ -344,6 +901,14 @@ typedef struct {
  *
  */
 
+ int WMM_GeoidHeightCode (double Latitude, double Longitude, double *DeltaHeight, WMMtype_Geoid *Geoid);
+
+ int WMM_GetGeoidHeightBatch (const double *Latitude, const double *Longitude, size_t NumPoints, double *DeltaHeight, WMMtype_Geoid *Geoid);
+
+#if WMM_SIMD_X86
+ int WMM_GetGeoidHeightBatchAVX2 (const double *Latitude, const double *Longitude, size_t NumPoints, double *DeltaHeight, WMMtype_Geoid *Geoid);
+#endif
+
 
 int WMM_swab_type();
 float WMM_FloatSwap( float f );
@@ -6,6 +6,157 @@
 
 #include "WMMHeader.h"
 
+#if WMM_THREADS || WMM_MMAP
+#include <unistd.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#endif
+
+#if WMM_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#if WMM_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#if WMM_STATS
+#include <time.h>
+#endif
+
+#if WMM_EMBED_DATA
+#ifndef __ELF__
+#error WMM_EMBED_DATA needs an ELF toolchain (.incbin)
+#endif
+/* WMM.COF and EGM9615.BIN linked in as read-only data, found by the assembler in the
+build directory. Used in place of the files of the default names, see WMM_EMBED_DATA. */
+__asm__(".pushsection .rodata\n"
+	".balign 64\n"
+	"WMM_EmbeddedCOF:\n"
+	".incbin \"" WMM_COF_FILE "\"\n"
+	"WMM_EmbeddedCOFEnd:\n"
+	".balign 64\n"
+	"WMM_EmbeddedGeoid:\n"
+	".incbin \"" WMM_GEOID_FILE "\"\n"
+	"WMM_EmbeddedGeoidEnd:\n"
+	".popsection\n");
+extern const char WMM_EmbeddedCOF[], WMM_EmbeddedCOFEnd[], WMM_EmbeddedGeoid[], WMM_EmbeddedGeoidEnd[];
+#endif
+
+/* Summation kernel used by WMM_SummationBlock, see WMM_SetSimdLevel. With the counters of
+WMM_STATS, the only process wide state of the library; accessed atomically so that contexts
+may run concurrently. */
+static int WMM_SimdLevel = WMM_SIMD_AUTO;
+#if WMM_THREADS
+static pthread_once_t WMM_SimdLevelOnce = PTHREAD_ONCE_INIT;
+#endif
+#if defined(__GNUC__)
+#define WMM_ATOMIC_LOAD(Variable)	__atomic_load_n(&(Variable), __ATOMIC_ACQUIRE)
+#define WMM_ATOMIC_STORE(Variable, Value)	__atomic_store_n(&(Variable), (Value), __ATOMIC_RELEASE)
+#else
+#define WMM_ATOMIC_LOAD(Variable)	(Variable)
+#define WMM_ATOMIC_STORE(Variable, Value)	((Variable) = (Value))
+#endif
+/* Lane loops of the single precision block routines read and write different rows of one
+table; the hint lets GCC vectorize them without a run time overlap check. */
+#if defined(__GNUC__) && !defined(__clang__)
+#define WMM_IVDEP	_Pragma("GCC ivdep")
+#else
+#define WMM_IVDEP
+#endif
+/* Seeks the binary grid file to an absolute 64 bit offset, which long cannot hold where it has 32
+bits. off_t has 64 bits when built with _FILE_OFFSET_BITS 64, as the Makefile does; an offset off_t
+cannot hold fails instead of wrapping. */
+#if defined(__unix__) || defined(__APPLE__)
+#define WMM_FSEEK(File, Offset)	((uint64_t) (off_t) (Offset) != (uint64_t) (Offset) ? -1 : fseeko((File), (off_t) (Offset), SEEK_SET))
+#elif defined(_WIN32)
+#define WMM_FSEEK(File, Offset)	_fseeki64((File), (__int64) (Offset), SEEK_SET)
+#else
+#define WMM_FSEEK(File, Offset)	((uint64_t) (long) (Offset) != (uint64_t) (Offset) ? -1 : fseek((File), (long) (Offset), SEEK_SET))
+#endif
+/* Products of the fixed point engine: 32 x 32 bit multiplies with a 64 bit result, rounded and
+shifted back to 32 bits. WMM_FIXED_MUL2 adds two products before the single rounding. */
+#define WMM_FIXED_MUL(a, b, Shift)	((WMMtype_Fixed) (((int64_t) (a) * (b) + ((int64_t) 1 << ((Shift) - 1))) >> (Shift)))
+#define WMM_FIXED_MUL2(a, b, c, d, Shift)	((WMMtype_Fixed) (((int64_t) (a) * (b) + (int64_t) (c) * (d) + ((int64_t) 1 << ((Shift) - 1))) >> (Shift)))
+#define WMM_FIXED_UPDATE_SHIFT	(WMM_FIXED_RATE_BITS + WMM_FIXED_YEAR_BITS - WMM_FIXED_COEFF_BITS)	/* Q20 x Q24 to Q15 */
+#define WMM_FIXED_FIELD_SHIFT	(WMM_FIXED_COEFF_BITS + WMM_FIXED_LEGENDRE_BITS - WMM_FIXED_FIELD_BITS)	/* Q15 x Q25 to Q13 */
+#define WMM_FIXED_RATE_SHIFT	(WMM_FIXED_RATE_BITS + WMM_FIXED_LEGENDRE_BITS - WMM_FIXED_FIELD_BITS)	/* Q20 x Q25 to Q13 */
+
+#if WMM_STATS
+#if WMM_THREADS && !defined(__GNUC__)
+#error WMM_STATS with WMM_THREADS needs GCC thread local storage
+#endif
+/* Counters of one thread. A thread creates its block on its first counted call and only it
+writes the block; WMM_GetStats and WMM_ResetStats reach every block through WMM_StatsBlocks,
+which keeps them after the thread ends. */
+typedef struct WMMtype_StatsBlock {
+	unsigned long long Calls[WMM_NUM_STATS];
+	unsigned long long Ticks[WMM_NUM_STATS];
+	unsigned long long Start[WMM_NUM_STATS];	/* Clock at WMM_STATS_BEGIN, private to the thread */
+	struct WMMtype_StatsBlock *Next;
+} WMMtype_StatsBlock;
+static WMMtype_StatsBlock *WMM_StatsBlocks;
+#if WMM_THREADS
+static __thread WMMtype_StatsBlock *WMM_ThreadStats __attribute__((tls_model("initial-exec")));
+static pthread_mutex_t WMM_StatsLock = PTHREAD_MUTEX_INITIALIZER;
+#else
+static WMMtype_StatsBlock *WMM_ThreadStats;
+#endif
+/* Relaxed atomic accesses: plain loads and stores on the owning thread, no locked instruction */
+#if defined(__GNUC__)
+#define WMM_STATS_LOAD(Variable)	__atomic_load_n(&(Variable), __ATOMIC_RELAXED)
+#define WMM_STATS_STORE(Variable, Value)	__atomic_store_n(&(Variable), (Value), __ATOMIC_RELAXED)
+#else
+#define WMM_STATS_LOAD(Variable)	(Variable)
+#define WMM_STATS_STORE(Variable, Value)	((Variable) = (Value))
+#endif
+#define WMM_STATS_ADD(Variable, Value)	WMM_STATS_STORE(Variable, WMM_STATS_LOAD(Variable) + (Value))
+
+static WMMtype_StatsBlock *WMM_StatsNewBlock(void);
+
+static inline unsigned long long WMM_StatsClock(void)
+{
+#if WMM_SIMD_X86
+	return __rdtsc();
+#else
+	struct timespec Now;
+
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (unsigned long long) Now.tv_sec * 1000000000ULL + Now.tv_nsec;
+#endif
+}
+
+static inline void WMM_StatsBegin(int Stat)
+{
+	WMMtype_StatsBlock *Block = WMM_ThreadStats ? WMM_ThreadStats : WMM_StatsNewBlock();
+
+	if (Block)
+		Block->Start[Stat] = WMM_StatsClock();
+}
+
+static inline void WMM_StatsEnd(int Stat)
+{
+	WMMtype_StatsBlock *Block = WMM_ThreadStats;
+
+	if (Block)
+	{
+		WMM_STATS_ADD(Block->Ticks[Stat], WMM_StatsClock() - Block->Start[Stat]);
+		WMM_STATS_ADD(Block->Calls[Stat], 1);
+	}
+}
+
+/* Brackets the body of a counted function. A stage must not be nested in itself. */
+#define WMM_STATS_BEGIN(Stat)	WMM_StatsBegin(Stat)
+#define WMM_STATS_END(Stat)	WMM_StatsEnd(Stat)
+#else
+#define WMM_STATS_BEGIN(Stat)	((void) 0)
+#define WMM_STATS_END(Stat)	((void) 0)
+#endif
+
 /*
  * ABSTRACT
  *
@@ -118,11 +269,13 @@ int WMM_AssociatedLegendreFunction(WMMtype_CoordSpherical CoordSpherical, int nM
 	double sin_phi;
 	int FLAG = 1;
 
+	WMM_STATS_BEGIN(WMM_STAT_LEGENDRE);
 	sin_phi =  sin ( DEG2RAD ( CoordSpherical.phig ) );       /* sin  (geocentric latitude) */
 
 	if (nMax <= 16 || (1 - fabs(sin_phi)) < 1.0e-10 ) 	/* If nMax is less tha 16 or at the poles */
 		FLAG = WMM_PcupLow(LegendreFunction->Pcup,LegendreFunction->dPcup,sin_phi, nMax);
 	else FLAG = WMM_PcupHigh(LegendreFunction->Pcup,LegendreFunction->dPcup,sin_phi, nMax);
+	WMM_STATS_END(WMM_STAT_LEGENDRE);
 	if (FLAG == 0) /* Error while computing  Legendre variables*/
 			return FALSE;
 
@@ -130,6 +283,43 @@ int WMM_AssociatedLegendreFunction(WMMtype_CoordSpherical CoordSpherical, int nM
 	return TRUE;
 	} /*WMM_AssociatedLegendreFunction */
 
+int WMM_AssociatedLegendreFunctionWithWorkspace(WMMtype_CoordSpherical CoordSpherical, int nMax, WMMtype_Workspace *Workspace)
+
+	/* Same as WMM_AssociatedLegendreFunction, but the Legendre functions are stored in the
+	buffers of the workspace and the normalization and recursion tables precomputed by
+	WMM_AllocateWorkspace are used, so no memory is allocated.
+	INPUT  CoordSpherical 	A data structure with the following elements
+							double lambda; ( longitude)
+							double phig; ( geocentric latitude )
+							double r;  	  ( distance from the center of the ellipsoid)
+			nMax        	integer 	 ( Maxumum degree of spherical harmonic secular model)
+			Workspace		Pointer to a workspace allocated with WMM_AllocateWorkspace for at least nMax
+
+	OUTPUT  Workspace->LegendreFunction  Calculated Legendre variables
+
+	CALLS : WMM_PcupLowWithNorm, WMM_PcupHighWithFactors
+	 */
+
+	{
+	double sin_phi;
+	int FLAG = 1;
+
+	if (nMax > Workspace->nMax)
+		return FALSE;
+
+	WMM_STATS_BEGIN(WMM_STAT_LEGENDRE);
+	sin_phi =  sin ( DEG2RAD ( CoordSpherical.phig ) );       /* sin  (geocentric latitude) */
+
+	if (nMax <= 16 || (1 - fabs(sin_phi)) < 1.0e-10 ) 	/* If nMax is less tha 16 or at the poles */
+		FLAG = WMM_PcupLowWithNorm(Workspace->LegendreFunction.Pcup, Workspace->LegendreFunction.dPcup, sin_phi, nMax, Workspace->SchmidtQuasiNorm);
+	else FLAG = WMM_PcupHighWithFactors(Workspace->LegendreFunction.Pcup, Workspace->LegendreFunction.dPcup, sin_phi, nMax, Workspace->PreSqr, Workspace->f1, Workspace->f2);
+	WMM_STATS_END(WMM_STAT_LEGENDRE);
+	if (FLAG == 0) /* Error while computing  Legendre variables*/
+			return FALSE;
+
+	return TRUE;
+	} /*WMM_AssociatedLegendreFunctionWithWorkspace */
+
 int WMM_CalculateGeoMagneticElements(WMMtype_MagneticResults *MagneticResultsGeo, WMMtype_GeoMagneticElements *GeoMagneticElements)
 
 	/* Calculate all the Geomagnetic elements from X,Y and Z components
@@ -148,6 +338,7 @@ int WMM_CalculateGeoMagneticElements(WMMtype_MagneticResults *MagneticResultsGeo
 	CALLS : none
 	*/
 	{
+	WMM_STATS_BEGIN(WMM_STAT_ELEMENTS);
 	GeoMagneticElements->X = MagneticResultsGeo->Bx;
 	GeoMagneticElements->Y = MagneticResultsGeo->By;
 	GeoMagneticElements->Z = MagneticResultsGeo->Bz;
@@ -157,6 +348,7 @@ int WMM_CalculateGeoMagneticElements(WMMtype_MagneticResults *MagneticResultsGeo
 	GeoMagneticElements->Decl = RAD2DEG(atan2 (GeoMagneticElements->Y , GeoMagneticElements->X));
 	GeoMagneticElements->Incl = RAD2DEG(atan2 (GeoMagneticElements->Z , GeoMagneticElements->H));
 
+	WMM_STATS_END(WMM_STAT_ELEMENTS);
 	return TRUE;
 	}  /*WMM_CalculateGeoMagneticElements */
 
@@ -221,6 +413,7 @@ int WMM_CalculateSecularVariation(WMMtype_MagneticResults MagneticVariation, WMM
 
 */
 {
+	WMM_STATS_BEGIN(WMM_STAT_ELEMENTS);
 	MagneticElements->Xdot = MagneticVariation.Bx;
 	MagneticElements->Ydot = MagneticVariation.By;
 	MagneticElements->Zdot = MagneticVariation.Bz;
@@ -229,6 +422,7 @@ int WMM_CalculateSecularVariation(WMMtype_MagneticResults MagneticVariation, WMM
 	MagneticElements->Decldot = 180.0 / M_PI * (MagneticElements->X * MagneticElements->Ydot - MagneticElements->Y * MagneticElements->Xdot) / (MagneticElements->H * MagneticElements->H);
 	MagneticElements->Incldot = 180.0 / M_PI * (MagneticElements->H * MagneticElements->Zdot - MagneticElements->Z * MagneticElements->Hdot) / (MagneticElements->F * MagneticElements->F);
 	MagneticElements->GVdot = MagneticElements->Decldot;
+	WMM_STATS_END(WMM_STAT_ELEMENTS);
 	return TRUE;
 } /*WMM_CalculateSecularVariation*/
 
@@ -257,6 +451,63 @@ int WMM_CheckGeographicPole(WMMtype_CoordGeodetic *CoordGeodetic)
 	} /*WMM_CheckGeographicPole*/
 
 
+int WMM_ComputeCoefficientTables(WMMtype_MagneticModel *MagneticModel)
+
+	/* Builds the coefficient tables attached to the model. They depend only on the model
+	and are computed once, when the coefficient file is read:
+		SchmidtQuasiNorm	ratios between the Gauss-normalized and the Schmidt quasi-normalized
+							associated Legendre functions
+		RecursionCoeff		k(n,m) = ((n-1)^2 - m^2) / ((2n-1)(2n-3)) of the Gauss-normalized
+							Legendre recursion, 0 where the recursion has no P(n-2,m) term
+		*_Coeff_GS, *_Coeff_HS	Gauss coefficients multiplied by SchmidtQuasiNorm, so that they
+							can be combined directly with the Gauss-normalized functions
+							computed by WMM_PcupLowWithTables
+	WMM_TimelyModifyMagneticModel carries the tables over to the time modified model.
+
+	INPUT  MagneticModel	Pointer to a model allocated by WMM_AllocateModelMemory, with nMax,
+							nMaxSecVar and the Gauss coefficients set
+	OUTPUT MagneticModel	Coefficient tables and CoefficientTablesNMax updated
+	CALLS : WMM_SchmidtQuasiNormFactors
+	*/
+
+	{
+	int n, m, index, b;
+
+	if (!MagneticModel->SchmidtQuasiNorm || !MagneticModel->RecursionCoeff || !MagneticModel->Main_Field_Coeff_GS ||
+		!MagneticModel->Main_Field_Coeff_HS || !MagneticModel->Secular_Var_Coeff_GS || !MagneticModel->Secular_Var_Coeff_HS)
+		return FALSE;
+
+	WMM_SchmidtQuasiNormFactors(MagneticModel->SchmidtQuasiNorm, MagneticModel->nMax);
+
+	b = (MagneticModel->nMaxSecVar * (MagneticModel->nMaxSecVar + 1) / 2 + MagneticModel->nMaxSecVar);
+	MagneticModel->RecursionCoeff[0] = 0.0;
+	MagneticModel->Main_Field_Coeff_GS[0] = 0.0;
+	MagneticModel->Main_Field_Coeff_HS[0] = 0.0;
+	MagneticModel->Secular_Var_Coeff_GS[0] = 0.0;
+	MagneticModel->Secular_Var_Coeff_HS[0] = 0.0;
+	for (n = 1; n <= MagneticModel->nMax; n++)
+	{
+		for (m = 0; m <= n; m++)
+		{
+			index = (n * (n + 1) / 2 + m);
+			if (m <= n - 2)
+				MagneticModel->RecursionCoeff[index] = (double)( ( ( n - 1 ) * ( n - 1 ) ) - ( m * m ) ) / ( double ) ( ( 2 * n - 1 ) * ( 2 * n - 3 ) );
+			else
+				MagneticModel->RecursionCoeff[index] = 0.0;
+			MagneticModel->Main_Field_Coeff_GS[index] = MagneticModel->Main_Field_Coeff_G[index] * MagneticModel->SchmidtQuasiNorm[index];
+			MagneticModel->Main_Field_Coeff_HS[index] = MagneticModel->Main_Field_Coeff_H[index] * MagneticModel->SchmidtQuasiNorm[index];
+			if (index <= b)
+			{
+				MagneticModel->Secular_Var_Coeff_GS[index] = MagneticModel->Secular_Var_Coeff_G[index] * MagneticModel->SchmidtQuasiNorm[index];
+				MagneticModel->Secular_Var_Coeff_HS[index] = MagneticModel->Secular_Var_Coeff_H[index] * MagneticModel->SchmidtQuasiNorm[index];
+			}
+		}
+	}
+	MagneticModel->CoefficientTablesNMax = MagneticModel->nMax;
+	return TRUE;
+	} /*WMM_ComputeCoefficientTables*/
+
+
 int WMM_ComputeSphericalHarmonicVariables(	 WMMtype_Ellipsoid  Ellip, WMMtype_CoordSpherical CoordSpherical, int nMax, WMMtype_SphericalHarmonicVariables *SphVariables)
 
    /* Computes Spherical variables
@@ -285,6 +536,8 @@ int WMM_ComputeSphericalHarmonicVariables(	 WMMtype_Ellipsoid  Ellip, WMMtype_Co
 	{
 	double cos_lambda, sin_lambda;
 	int m, n;
+
+	WMM_STATS_BEGIN(WMM_STAT_HARMONIC);
 	cos_lambda = cos(DEG2RAD(CoordSpherical.lambda));
 	sin_lambda = sin(DEG2RAD(CoordSpherical.lambda));
 	/* for n = 0 ... model_order, compute (Radius of Earth / Spherica radius r)^(n+2)
@@ -310,6 +563,7 @@ int WMM_ComputeSphericalHarmonicVariables(	 WMMtype_Ellipsoid  Ellip, WMMtype_Co
 		SphVariables->cos_mlambda[m] = SphVariables->cos_mlambda[m-1]*cos_lambda - SphVariables->sin_mlambda[m-1]*sin_lambda;
 		SphVariables->sin_mlambda[m] = SphVariables->cos_mlambda[m-1]*sin_lambda + SphVariables->sin_mlambda[m-1]*cos_lambda;
 	}
+	WMM_STATS_END(WMM_STAT_HARMONIC);
 	return TRUE;
 	}  /*WMM_ComputeSphericalHarmonicVariables*/
 
@@ -478,7 +732,7 @@ void WMM_Error(int control)
 			printf("\nError allocating in WMM_SecVarSummationSpecial\n");
 			break;
 		case 16:
-			printf("\nError in opening EGM9615.BIN file\n");
+			printf("\nError in opening the geoid file\n");
 			break;
 		case 17:
 			printf("\nError: Latitude OR Longitude out of range in WMM_GetGeoidHeight\n");
@@ -500,9 +754,281 @@ void WMM_Error(int control)
 			printf("Please download this file from http://www.ngdc.noaa.gov/geomag/WMM/DoDWMM.shtml.  \n");
 			printf("Replace the existing EGM9615.BIN file with the downloaded one\n");
 			break;
+		/* 23 and 24 are passed by WMM_GetTransverseMercator and print nothing */
+		case 25:
+			printf("\nError allocating in WMM_AllocateWorkspace\n");
+			break;
+		default:
+			if (control >= WMM_ERR_ARGUMENT)
+				printf("\nError: %s\n", WMM_ErrorMessage(control));
+			break;
 	}
 	} /*WMM_Error*/
 
+const char *WMM_ErrorMessage(int Code)
+
+	/*Returns a constant description of a WMM_ERR_* code, as reported by the context API.
+	Does not print; safe to call from any thread.
+	INPUT     Code     WMM_ERR_* value
+	CALLS : none
+
+	*/
+
+	{
+	switch(Code)
+	{
+		case WMM_ERR_NONE:
+			return "No error";
+		case WMM_ERR_ALLOCATION:
+			return "Memory allocation failed";
+		case WMM_ERR_GEOID_NOT_INITIALIZED:
+			return "Geoid not initialized";
+		case WMM_ERR_MODEL:
+			return "Magnetic model missing or larger than the workspace";
+		case WMM_ERR_GEOID_RANGE:
+			return "Latitude or longitude out of range for the geoid";
+		case WMM_ERR_ARGUMENT:
+			return "Invalid argument";
+		case WMM_ERR_RANGE:
+			return "Latitude, longitude or height out of range";
+		default:
+			return "Unknown error";
+	}
+	} /*WMM_ErrorMessage*/
+
+int WMM_FixedFromSpherical(WMMtype_Ellipsoid Ellip, WMMtype_CoordSpherical CoordSpherical, WMMtype_CoordSphericalFixed *CoordFixed)
+
+	/* Converts spherical coordinates to the input of WMM_FixedSummation. Uses floating point; on a
+	target without an FPU the caller computes the same Q30 values by its own means.
+
+	INPUT  Ellip
+		   CoordSpherical
+	OUTPUT CoordFixed
+	CALLS : none
+	*/
+	{
+	if (!CoordFixed || !(CoordSpherical.r > 0.0) || Ellip.re / CoordSpherical.r >= 2.0)
+		return FALSE;
+	CoordFixed->SinPhi = WMM_FIXED_FROM_DOUBLE(sin(DEG2RAD(CoordSpherical.phig)), WMM_FIXED_UNIT_BITS);
+	CoordFixed->CosPhi = WMM_FIXED_FROM_DOUBLE(cos(DEG2RAD(CoordSpherical.phig)), WMM_FIXED_UNIT_BITS);
+	CoordFixed->SinLambda = WMM_FIXED_FROM_DOUBLE(sin(DEG2RAD(CoordSpherical.lambda)), WMM_FIXED_UNIT_BITS);
+	CoordFixed->CosLambda = WMM_FIXED_FROM_DOUBLE(cos(DEG2RAD(CoordSpherical.lambda)), WMM_FIXED_UNIT_BITS);
+	CoordFixed->RadiusRatio = WMM_FIXED_FROM_DOUBLE(Ellip.re / CoordSpherical.r, WMM_FIXED_UNIT_BITS);
+	return TRUE;
+	} /*WMM_FixedFromSpherical*/
+
+int WMM_FixedModelFromModel(WMMtype_MagneticModel *MagneticModel, WMMtype_FixedModel *FixedModel)
+
+	/* Builds the scaled tables of the fixed point engine from a model read by WMM_readMagneticModel.
+	Runs once, on the host: the result holds no pointers and may be written out as a constant
+	initializer for the target.
+	The engine evaluates the Schmidt quasi-normalized Legendre functions, which are bounded by 1,
+	so the Gauss coefficients are used as they are read. Their recursion coefficients are the
+	Gauss-normalized k(n,m) of WMM_ComputeCoefficientTables rescaled with the ratios of
+	WMM_SchmidtQuasiNormFactors:
+		A(n,m) = S(n,m) / S(n-1,m)				m < n
+		B(n,m) = k(n,m) S(n,m) / S(n-2,m)		m <= n-2, 0 otherwise
+		A(n,n) = S(n,n) / S(n-1,n-1)
+
+	INPUT  MagneticModel	Model at its epoch (not time modified)
+	OUTPUT FixedModel
+	Returns FALSE if nMax is above WMM_FIXED_NMAX or a coefficient does not fit in its format at
+	every date YearOffset can express.
+	CALLS : WMM_SchmidtQuasiNormFactors
+	*/
+	{
+	double SchmidtQuasiNorm[WMM_FIXED_NUM_TERMS], k, CoeffLimit, RateLimit;
+	int n, m, index, index1, index2;
+
+	if (!MagneticModel || !FixedModel || MagneticModel->nMax < 1 || MagneticModel->nMax > WMM_FIXED_NMAX ||
+		MagneticModel->nMaxSecVar > MagneticModel->nMax)
+		return FALSE;
+
+	memset(FixedModel, 0, sizeof(WMMtype_FixedModel));
+	FixedModel->nMax = MagneticModel->nMax;
+	FixedModel->nMaxSecVar = MagneticModel->nMaxSecVar;
+	WMM_SchmidtQuasiNormFactors(SchmidtQuasiNorm, MagneticModel->nMax);
+	CoeffLimit = (double) (1L << (31 - WMM_FIXED_COEFF_BITS)) - 1.0;
+	RateLimit = (double) (1L << (31 - WMM_FIXED_RATE_BITS)) - 1.0;
+
+	for (n = 1; n <= MagneticModel->nMax; n++)
+	{
+		for (m = 0; m <= n; m++)
+		{
+			index = (n * (n + 1) / 2 + m);
+			if (n <= MagneticModel->nMaxSecVar)
+			{
+				if (fabs(MagneticModel->Secular_Var_Coeff_G[index]) + fabs(MagneticModel->Secular_Var_Coeff_H[index]) > RateLimit)
+					return FALSE;
+				FixedModel->dG[index] = WMM_FIXED_FROM_DOUBLE(MagneticModel->Secular_Var_Coeff_G[index], WMM_FIXED_RATE_BITS);
+				FixedModel->dH[index] = WMM_FIXED_FROM_DOUBLE(MagneticModel->Secular_Var_Coeff_H[index], WMM_FIXED_RATE_BITS);
+			}
+			/* g and h, and g cos(m lambda) + h sin(m lambda), must fit in Q15 at any date YearOffset can express */
+			if (fabs(MagneticModel->Main_Field_Coeff_G[index]) + fabs(MagneticModel->Main_Field_Coeff_H[index]) +
+				(fabs(WMM_FIXED_TO_DOUBLE(FixedModel->dG[index], WMM_FIXED_RATE_BITS)) + fabs(WMM_FIXED_TO_DOUBLE(FixedModel->dH[index], WMM_FIXED_RATE_BITS))) *
+				(double) (1L << (31 - WMM_FIXED_YEAR_BITS)) > CoeffLimit)
+				return FALSE;
+			FixedModel->G[index] = WMM_FIXED_FROM_DOUBLE(MagneticModel->Main_Field_Coeff_G[index], WMM_FIXED_COEFF_BITS);
+			FixedModel->H[index] = WMM_FIXED_FROM_DOUBLE(MagneticModel->Main_Field_Coeff_H[index], WMM_FIXED_COEFF_BITS);
+
+			index1 = ( n - 1 ) * n / 2 + (m < n ? m : n - 1);
+			FixedModel->A[index] = WMM_FIXED_FROM_DOUBLE(SchmidtQuasiNorm[index] / SchmidtQuasiNorm[index1], WMM_FIXED_RECURSION_BITS);
+			if (m <= n - 2)
+			{
+				index2 = ( n - 2 ) * ( n - 1 ) / 2 + m;
+				k = (double)( ( ( n - 1 ) * ( n - 1 ) ) - ( m * m ) ) / ( double ) ( ( 2 * n - 1 ) * ( 2 * n - 3 ) );
+				FixedModel->B[index] = WMM_FIXED_FROM_DOUBLE(k * SchmidtQuasiNorm[index] / SchmidtQuasiNorm[index2], WMM_FIXED_RECURSION_BITS);
+			}
+		}
+	}
+	return TRUE;
+	} /*WMM_FixedModelFromModel*/
+
+int WMM_FixedSummation(const WMMtype_FixedModel *FixedModel, WMMtype_Fixed YearOffset, const WMMtype_CoordSphericalFixed *CoordFixed,
+	WMMtype_MagneticResultsFixed *MagneticResultsSph, WMMtype_MagneticResultsFixed *MagneticResultsSphVar)
+
+	/* Integer only counterpart of WMM_TimelyModifyMagneticModel, WMM_PcupLowWithTables and
+	WMM_SummationWithSecVar, for targets without a floating point unit. Evaluates the field and its
+	secular variation in spherical coordinates at one point, with no allocation and no tables in
+	RAM: the columns m of the Legendre triangle are walked from the diagonal down, keeping the two
+	previous degrees, and each coefficient is advanced to the date as it is used. Every value is a
+	32 bit WMMtype_Fixed in the format of its WMM_FIXED_*_BITS, and right shifts of negative
+	values are assumed arithmetic. Products go through a 64 bit intermediate (WMM_FIXED_MUL): the
+	product of two 32 bit Q operands has up to 62 significant bits, of which the result keeps the
+	32 above a shift of 27 to 32 bits, so it cannot be formed in 32 bits. Operands narrow enough for a 32 bit
+	product would be 16 bits, too coarse for the coefficients and Legendre functions.
+	The m > 0 columns recurse on Q(n,m) = P(n,m) / cos(phi), which has the same recursion as P.
+	By is summed from Q, so it needs no division and the geographic poles need no special case.
+
+	Operations per point for nMax = 12: 2359 multiplies of 32 x 32 bits (1765 without the secular
+	variation) and 168 multiplies by the small integers n+1 and m, besides additions and shifts.
+	On 8 bit AVR these 64 bit products dominate: avr-gcc forms each one from 16 hardware 8 x 8
+	multiplies and their carries in the __mulsidi3 helper, roughly 100 cycles with the rounding
+	and shift, so about 0.25 million cycles (15 ms at 16 MHz) per point. Cores without a hardware
+	multiplier (ATtiny) do them in software, several times slower.
+	Against the double engine the field components are within 0.004 nT and the secular variation
+	within 0.002 nT/yr, poles included; see the WMM_FixedSummation path of wmm_accuracy.
+
+	INPUT  FixedModel		Tables of WMM_FixedModelFromModel
+		   YearOffset		Date minus the epoch of the model, Q24 years
+		   CoordFixed		Point, see WMM_FixedFromSpherical
+	OUTPUT MagneticResultsSph		Bx, By, Bz in spherical coordinates, Q13 nT
+		   MagneticResultsSphVar	Their rates of change, Q13 nT/yr; may be NULL
+	CALLS : none
+	*/
+	{
+	WMMtype_Fixed RelativeRadiusPower[WMM_FIXED_NMAX + 1];
+	WMMtype_Fixed x, z, cos_m, sin_m, t, A, B, g, h, gc, gs, R, RP, RdP, RQ;
+	WMMtype_Fixed P, P1, P2, dP, dP1, dP2, Q, Q1, Q2, PDiag, dPDiag, QDiag;
+	WMMtype_Fixed Bx, By, Bz, BxSV, BySV, BzSV;
+	int n, m, index, nMax, nMaxSecVar;
+
+	if (!FixedModel || !CoordFixed || !MagneticResultsSph || FixedModel->nMax < 1 || FixedModel->nMax > WMM_FIXED_NMAX)
+		return FALSE;
+
+	WMM_STATS_BEGIN(WMM_STAT_SUMMATION);
+	nMax = FixedModel->nMax;
+	nMaxSecVar = MagneticResultsSphVar ? FixedModel->nMaxSecVar : 0;
+	x = CoordFixed->SinPhi;
+	z = CoordFixed->CosPhi;
+
+	/* (a/r)^(n+2), Q30 */
+	RelativeRadiusPower[0] = WMM_FIXED_MUL(CoordFixed->RadiusRatio, CoordFixed->RadiusRatio, WMM_FIXED_UNIT_BITS);
+	for (n = 1; n <= nMax; n++)
+		RelativeRadiusPower[n] = WMM_FIXED_MUL(RelativeRadiusPower[n - 1], CoordFixed->RadiusRatio, WMM_FIXED_UNIT_BITS);
+
+	Bx = By = Bz = BxSV = BySV = BzSV = 0;
+	cos_m = (WMMtype_Fixed) 1 << WMM_FIXED_UNIT_BITS;
+	sin_m = 0;
+	PDiag = (WMMtype_Fixed) 1 << WMM_FIXED_LEGENDRE_BITS;
+	dPDiag = QDiag = 0;
+	for (m = 0; m <= nMax; m++)
+	{
+		if (m > 0)
+		{
+			/* cos(m lambda) and sin(m lambda) from those of (m-1) lambda */
+			t = WMM_FIXED_MUL2(cos_m, CoordFixed->CosLambda, -sin_m, CoordFixed->SinLambda, WMM_FIXED_UNIT_BITS);
+			sin_m = WMM_FIXED_MUL2(sin_m, CoordFixed->CosLambda, cos_m, CoordFixed->SinLambda, WMM_FIXED_UNIT_BITS);
+			cos_m = t;
+			/* P(m,m) = A z P(m-1,m-1), so Q(m,m) = A P(m-1,m-1) */
+			A = FixedModel->A[m * (m + 1) / 2 + m];
+			QDiag = WMM_FIXED_MUL(A, PDiag, WMM_FIXED_RECURSION_BITS);
+			dPDiag = WMM_FIXED_MUL(A, WMM_FIXED_MUL2(z, dPDiag, -x, PDiag, WMM_FIXED_UNIT_BITS), WMM_FIXED_RECURSION_BITS);
+			PDiag = WMM_FIXED_MUL(z, QDiag, WMM_FIXED_UNIT_BITS);
+		}
+		P = PDiag;
+		dP = dPDiag;
+		Q = QDiag;
+		P1 = dP1 = Q1 = 0;
+		for (n = m; n <= nMax; n++)
+		{
+			index = (n * (n + 1) / 2 + m);
+			if (n > m)
+			{
+				/* P(n,m) = A x P(n-1,m) - B P(n-2,m), and its derivative with respect to latitude */
+				A = FixedModel->A[index];
+				B = FixedModel->B[index];
+				P2 = P1;
+				P1 = P;
+				dP2 = dP1;
+				dP1 = dP;
+				if (m == 0)
+					P = WMM_FIXED_MUL2(A, WMM_FIXED_MUL(x, P1, WMM_FIXED_UNIT_BITS), -B, P2, WMM_FIXED_RECURSION_BITS);
+				else
+				{
+					Q2 = Q1;
+					Q1 = Q;
+					Q = WMM_FIXED_MUL2(A, WMM_FIXED_MUL(x, Q1, WMM_FIXED_UNIT_BITS), -B, Q2, WMM_FIXED_RECURSION_BITS);
+					P = WMM_FIXED_MUL(z, Q, WMM_FIXED_UNIT_BITS);
+				}
+				dP = WMM_FIXED_MUL2(A, WMM_FIXED_MUL2(x, dP1, z, P1, WMM_FIXED_UNIT_BITS), -B, dP2, WMM_FIXED_RECURSION_BITS);
+			}
+			if (n == 0)
+				continue;
+
+			/* Terms of WMM_Summation, with g and h advanced from the epoch. The factors n+1 and m
+			are applied to the Q25 functions, exactly, so that they do not scale rounding errors */
+			R = RelativeRadiusPower[n];
+			RP = (n + 1) * WMM_FIXED_MUL(R, P, WMM_FIXED_UNIT_BITS);
+			RdP = WMM_FIXED_MUL(R, dP, WMM_FIXED_UNIT_BITS);
+			RQ = m > 0 ? m * WMM_FIXED_MUL(R, Q, WMM_FIXED_UNIT_BITS) : 0;
+			g = FixedModel->G[index] + WMM_FIXED_MUL(FixedModel->dG[index], YearOffset, WMM_FIXED_UPDATE_SHIFT);
+			h = FixedModel->H[index] + WMM_FIXED_MUL(FixedModel->dH[index], YearOffset, WMM_FIXED_UPDATE_SHIFT);
+			gc = WMM_FIXED_MUL2(g, cos_m, h, sin_m, WMM_FIXED_UNIT_BITS);
+			Bz -= WMM_FIXED_MUL(gc, RP, WMM_FIXED_FIELD_SHIFT);
+			Bx -= WMM_FIXED_MUL(gc, RdP, WMM_FIXED_FIELD_SHIFT);
+			if (m > 0)
+			{
+				gs = WMM_FIXED_MUL2(g, sin_m, -h, cos_m, WMM_FIXED_UNIT_BITS);
+				By += WMM_FIXED_MUL(gs, RQ, WMM_FIXED_FIELD_SHIFT);
+			}
+			if (n <= nMaxSecVar)
+			{
+				gc = WMM_FIXED_MUL2(FixedModel->dG[index], cos_m, FixedModel->dH[index], sin_m, WMM_FIXED_UNIT_BITS);
+				BzSV -= WMM_FIXED_MUL(gc, RP, WMM_FIXED_RATE_SHIFT);
+				BxSV -= WMM_FIXED_MUL(gc, RdP, WMM_FIXED_RATE_SHIFT);
+				if (m > 0)
+				{
+					gs = WMM_FIXED_MUL2(FixedModel->dG[index], sin_m, -FixedModel->dH[index], cos_m, WMM_FIXED_UNIT_BITS);
+					BySV += WMM_FIXED_MUL(gs, RQ, WMM_FIXED_RATE_SHIFT);
+				}
+			}
+		}
+	}
+
+	MagneticResultsSph->Bx = Bx;
+	MagneticResultsSph->By = By;
+	MagneticResultsSph->Bz = Bz;
+	if (MagneticResultsSphVar)
+	{
+		MagneticResultsSphVar->Bx = BxSV;
+		MagneticResultsSphVar->By = BySV;
+		MagneticResultsSphVar->Bz = BzSV;
+	}
+	WMM_STATS_END(WMM_STAT_SUMMATION);
+	return TRUE;
+	} /*WMM_FixedSummation*/
+
 int WMM_FreeMemory(WMMtype_MagneticModel *MagneticModel, WMMtype_MagneticModel *TimedMagneticModel, WMMtype_LegendreFunction *LegendreFunction)
 
 	/* Free memory used by WMM functions. Only to be called at the end of the main function.
@@ -525,79 +1051,14 @@ int WMM_FreeMemory(WMMtype_MagneticModel *MagneticModel, WMMtype_MagneticModel *
 							double *dPcup; ( pointer to store  Derivative of Lagendre function )
 
 	OUTPUT  none
-	CALLS : none
+	CALLS : WMM_FreeMagneticModelMemory, WMM_FreeLegendreMemory
 
 	*/
 
 	{
-		if (MagneticModel->Main_Field_Coeff_G)
-		{
-			free(MagneticModel->Main_Field_Coeff_G);
-			MagneticModel->Main_Field_Coeff_G = NULL;
-		}
-		if (MagneticModel->Main_Field_Coeff_H)
-		{
-			free(MagneticModel->Main_Field_Coeff_H);
-			MagneticModel->Main_Field_Coeff_H = NULL;
-		}
-		if (MagneticModel->Secular_Var_Coeff_G)
-		{
-			free(MagneticModel->Secular_Var_Coeff_G);
-			MagneticModel->Secular_Var_Coeff_G = NULL;
-		}
-		if (MagneticModel->Secular_Var_Coeff_H)
-		{
-			free(MagneticModel->Secular_Var_Coeff_H);
-			MagneticModel->Secular_Var_Coeff_H = NULL;
-		}
-	 if (MagneticModel)
-		{
-			free(MagneticModel);
-			MagneticModel = NULL;
-		}
-
-		if (TimedMagneticModel->Main_Field_Coeff_G)
-		{
-			free(TimedMagneticModel->Main_Field_Coeff_G);
-			TimedMagneticModel->Main_Field_Coeff_G = NULL;
-		}
-		if (TimedMagneticModel->Main_Field_Coeff_H)
-		{
-			free(TimedMagneticModel->Main_Field_Coeff_H);
-			TimedMagneticModel->Main_Field_Coeff_H = NULL;
-		}
-		if (TimedMagneticModel->Secular_Var_Coeff_G)
-		{
-			free(TimedMagneticModel->Secular_Var_Coeff_G);
-			TimedMagneticModel->Secular_Var_Coeff_G = NULL;
-		}
-		if (TimedMagneticModel->Secular_Var_Coeff_H)
-		{
-			free(TimedMagneticModel->Secular_Var_Coeff_H);
-			TimedMagneticModel->Secular_Var_Coeff_H = NULL;
-		}
-
-		if (TimedMagneticModel)
-		{
-			free(TimedMagneticModel);
-			TimedMagneticModel = NULL;
-		}
-
-		if(LegendreFunction->Pcup)
-		{
-			free(LegendreFunction->Pcup);
-			LegendreFunction->Pcup = NULL;
-		}
-		if(LegendreFunction->dPcup)
-		{
-			free(LegendreFunction->dPcup);
-			LegendreFunction->dPcup = NULL;
-		}
-		if(LegendreFunction)
-		{
-			free(LegendreFunction);
-			LegendreFunction = NULL;
-		}
+		WMM_FreeMagneticModelMemory(MagneticModel);
+		WMM_FreeMagneticModelMemory(TimedMagneticModel);
+		WMM_FreeLegendreMemory(LegendreFunction);
 
 	 return TRUE;
 	} /*WMM_FreeMemory */
@@ -645,6 +1106,18 @@ int WMM_FreeMagneticModelMemory(WMMtype_MagneticModel *MagneticModel)
 			free(MagneticModel->Secular_Var_Coeff_H);
 			MagneticModel->Secular_Var_Coeff_H = NULL;
 		}
+		if (MagneticModel->Main_Field_Coeff_GS)
+			free(MagneticModel->Main_Field_Coeff_GS);
+		if (MagneticModel->Main_Field_Coeff_HS)
+			free(MagneticModel->Main_Field_Coeff_HS);
+		if (MagneticModel->Secular_Var_Coeff_GS)
+			free(MagneticModel->Secular_Var_Coeff_GS);
+		if (MagneticModel->Secular_Var_Coeff_HS)
+			free(MagneticModel->Secular_Var_Coeff_HS);
+		if (MagneticModel->SchmidtQuasiNorm)
+			free(MagneticModel->SchmidtQuasiNorm);
+		if (MagneticModel->RecursionCoeff)
+			free(MagneticModel->RecursionCoeff);
 	 if (MagneticModel)
 		{
 			free(MagneticModel);
@@ -688,6 +1161,67 @@ int WMM_FreeLegendreMemory(WMMtype_LegendreFunction *LegendreFunction)
 	} /*WMM_FreeLegendreMemory */
 
 
+int WMM_FreeWorkspace(WMMtype_Workspace *Workspace)
+
+	/* Free a workspace allocated with WMM_AllocateWorkspace, including the Legendre
+	function buffers it owns.
+	INPUT : Workspace Pointer to the workspace, may be partially allocated
+
+	OUTPUT  none
+	CALLS : none
+
+	*/
+
+	{
+		int i;
+
+		if (!Workspace)
+			return TRUE;
+		if (Workspace->LegendreFunction.Pcup)
+			free(Workspace->LegendreFunction.Pcup);
+		if (Workspace->LegendreFunction.dPcup)
+			free(Workspace->LegendreFunction.dPcup);
+		if (Workspace->SchmidtQuasiNorm)
+			free(Workspace->SchmidtQuasiNorm);
+		if (Workspace->PreSqr)
+			free(Workspace->PreSqr);
+		if (Workspace->f1)
+			free(Workspace->f1);
+		if (Workspace->f2)
+			free(Workspace->f2);
+		if (Workspace->PcupS)
+			free(Workspace->PcupS);
+		if (Workspace->PcupBlock)
+			free(Workspace->PcupBlock);
+		if (Workspace->dPcupBlock)
+			free(Workspace->dPcupBlock);
+		if (Workspace->RelativeRadiusPowerBlock)
+			free(Workspace->RelativeRadiusPowerBlock);
+		if (Workspace->cos_mlambdaBlock)
+			free(Workspace->cos_mlambdaBlock);
+		if (Workspace->sin_mlambdaBlock)
+			free(Workspace->sin_mlambdaBlock);
+		if (Workspace->FloatCoeff)
+			free(Workspace->FloatCoeff);
+		if (Workspace->PcupFloat)
+			free(Workspace->PcupFloat);
+		if (Workspace->dPcupFloat)
+			free(Workspace->dPcupFloat);
+		if (Workspace->RelativeRadiusPowerFloat)
+			free(Workspace->RelativeRadiusPowerFloat);
+		if (Workspace->cos_mlambdaFloat)
+			free(Workspace->cos_mlambdaFloat);
+		if (Workspace->sin_mlambdaFloat)
+			free(Workspace->sin_mlambdaFloat);
+		for (i = 0; i < WMM_TIMED_CACHE_SIZE; i++)
+			if (Workspace->TimedCache[i])
+				WMM_FreeMagneticModelMemory(Workspace->TimedCache[i]);
+		free(Workspace);
+
+	 return TRUE;
+	} /*WMM_FreeWorkspace */
+
+
 int WMM_GeodeticToSpherical(WMMtype_Ellipsoid Ellip, WMMtype_CoordGeodetic CoordGeodetic, WMMtype_CoordSpherical *CoordSpherical)
 
 	/* Converts Geodetic coordinates to Spherical coordinates
@@ -723,6 +1257,7 @@ int WMM_GeodeticToSpherical(WMMtype_Ellipsoid Ellip, WMMtype_CoordGeodetic Coord
 	** coordinates, and then to spherical coordinates.
 	*/
 
+	WMM_STATS_BEGIN(WMM_STAT_GEODETIC);
 	CosLat = cos(DEG2RAD(CoordGeodetic.phi));
 	SinLat = sin(DEG2RAD(CoordGeodetic.phi));
 
@@ -741,6 +1276,7 @@ int WMM_GeodeticToSpherical(WMMtype_Ellipsoid Ellip, WMMtype_CoordGeodetic Coord
 	CoordSpherical->phig = RAD2DEG(asin(zp / CoordSpherical->r));     /* geocentric latitude */
 	CoordSpherical->lambda = CoordGeodetic.lambda;                   /* longitude */
 
+	WMM_STATS_END(WMM_STAT_GEODETIC);
 	return TRUE;
 	}/*WMM_GeodeticToSpherical*/
 
@@ -753,6 +1289,9 @@ int WMM_InitializeGeoid(WMMtype_Geoid *Geoid)
 	 * and function returns false code. If the file is incomplete
 	 * or improperly formatted, an error is printed
 	 * and function returns false code.
+	 * The file is Geoid->GeoidFileName, WMM_GEOID_FILE unless changed after WMM_SetDefaults.
+	 * If Geoid->Storage is WMM_GEOID_INT16 the heights are stored in
+	 * centimetres instead, see WMM_InitializeGeoidQuantized.
 
 	 INPUT  Pointer to data structure Geoid with the following elements
 			int NumbGeoidCols ;   ( 360 degrees of longitude at 15 minute spacing )
@@ -770,7 +1309,7 @@ int WMM_InitializeGeoid(WMMtype_Geoid *Geoid)
 			int	ScaleFactor;    ( 4 grid cells per degree at 15 minute spacing  )
 			float *GeoidHeightBuffer;   (Pointer to the memory to store the Geoid elevation data )
 			int NumbGeoidElevs;    (number of points in the gridded file )
-	CALLS : none
+	CALLS : WMM_InitializeGeoidFromBuffer, WMM_InitializeGeoidQuantized, WMM_GeoidBuildTiles
 	 */
 	{
   int   ElevationsRead , SwabType,  Index;
@@ -781,6 +1320,16 @@ int WMM_InitializeGeoid(WMMtype_Geoid *Geoid)
   {
 	return (TRUE);
   }
+#if WMM_EMBED_DATA
+  else if (!strcmp(Geoid->GeoidFileName, WMM_GEOID_FILE))
+  {
+	return WMM_InitializeGeoidFromBuffer(Geoid, WMM_EmbeddedGeoid, (size_t) (WMM_EmbeddedGeoidEnd - WMM_EmbeddedGeoid));
+  }
+#endif
+  else if (Geoid->Storage == WMM_GEOID_INT16)
+  {
+	return WMM_InitializeGeoidQuantized(Geoid);
+  }
   else
   {
 
@@ -799,9 +1348,9 @@ int WMM_InitializeGeoid(WMMtype_Geoid *Geoid)
 
 
 
-  if (( GeoidHeightFile = fopen( "EGM9615.BIN" , "rb" ) ) == NULL)
+  if (( GeoidHeightFile = fopen( Geoid->GeoidFileName , "rb" ) ) == NULL)
   {
-	WMM_Error(16);
+	printf("\nError in opening %s file\n", Geoid->GeoidFileName);
 	//printf("Error in opening EGM9615.BIN file\n");
 	return (FALSE);
   }
@@ -838,82 +1387,443 @@ int WMM_InitializeGeoid(WMMtype_Geoid *Geoid)
 
 
   Geoid->Geoid_Initialized = 1;
+  if (Geoid->Tiled)
+	WMM_GeoidBuildTiles(Geoid);
   }
   return ( TRUE );
 	}  /*WMM_InitializeGeoid*/
 
-
-int WMM_GetGeoidHeight (double Latitude,
-						double Longitude,
-						double *DeltaHeight ,
-						WMMtype_Geoid *Geoid)
-/*
- * The  function WMM_GetGeoidHeight returns the height of the
- * EGM96 geiod above or below the WGS84 ellipsoid,
- * at the specified geodetic coordinates,
- * using a grid of height adjustments from the EGM96 gravity model.
- *
- *    Latitude            : Geodetic latitude in radians           (input)
- *    Longitude           : Geodetic longitude in radians          (input)
- *    DeltaHeight         : Height Adjustment, in meters.          (output)
- *    Geoid				  : WMMtype_Geoid with Geoid grid		   (input)
-	CALLS : none
- */
-{
-  long   Index;
-  double DeltaX, DeltaY;
-  double ElevationSE, ElevationSW, ElevationNE, ElevationNW;
-  double OffsetX, OffsetY;
-  double PostX, PostY;
-  double UpperY, LowerY;
-  int Error_Code = 0;
-
-  if (!Geoid->Geoid_Initialized)
-  {
-	WMM_Error(5);
-	//printf("Geoid not initialized\n");
-	return (FALSE);
-  }
-  if ((Latitude < -90) || (Latitude > 90))
-  { /* Latitude out of range */
-	Error_Code |= 1;
-  }
-  if ((Longitude < -180) || (Longitude > 360))
-  { /* Longitude out of range */
-	Error_Code |= 1;
-  }
-
-  if (!Error_Code)
-  { /* no errors */
-	/*  Compute X and Y Offsets into Geoid Height Array:                          */
-
-	if (Longitude < 0.0)
+int WMM_InitializeGeoidQuantized(WMMtype_Geoid *Geoid)
+	/*
+	 * Loads EGM9615.BIN as int16 centimetres into GeoidHeightBufferCm, half the memory
+	 * and cache footprint of the float grid (2.1 MB instead of 4.1 MB). The EGM96 heights,
+	 * -107 m to +86 m, fit easily. Each height is rounded to the nearest centimetre, so a
+	 * grid post is off by at most 0.5 cm from the float grid; since the bilinear interpolation
+	 * of WMM_GetGeoidHeight is a convex combination of four posts, the same bound holds for
+	 * any interpolated height (measured over all posts of EGM9615.BIN: 0.50 cm). Against magnetic field
+	 * computations in km, this is far below the resolution of the model.
+	 * Called by WMM_InitializeGeoid when Geoid->Storage is WMM_GEOID_INT16.
+
+	 INPUT  Geoid : as WMM_InitializeGeoid
+	 OUPUT  Geoid : GeoidHeightBufferCm filled, Geoid_Initialized set
+	 CALLS : WMM_swab_type, WMM_FloatSwap, WMM_GeoidQuantize, WMM_GeoidBuildTiles
+	 */
 	{
-	  OffsetX = ( Longitude + 360.0 ) *Geoid->ScaleFactor;
+	float Chunk[4096];
+	size_t Read, i, Done = 0, Count;
+	int SwabType;
+	FILE *GeoidHeightFile;
+
+	if (Geoid->Geoid_Initialized)
+		return (TRUE);
+	Geoid->GeoidHeightBufferCm = (int16_t *) malloc( (Geoid->NumbGeoidElevs + 1) * sizeof(int16_t) );
+	if (!Geoid->GeoidHeightBufferCm)
+	{
+		WMM_Error(3);
+		return (FALSE);
 	}
-	else
+	if (( GeoidHeightFile = fopen( Geoid->GeoidFileName , "rb" ) ) == NULL)
 	{
-	  OffsetX = Longitude * Geoid->ScaleFactor;
+		free(Geoid->GeoidHeightBufferCm);
+		Geoid->GeoidHeightBufferCm = NULL;
+		printf("\nError in opening %s file\n", Geoid->GeoidFileName);
+		return (FALSE);
 	}
-	OffsetY = ( 90.0 - Latitude ) * Geoid->ScaleFactor;
+	SwabType = WMM_swab_type();
+	Count = (size_t) Geoid->NumbGeoidElevs;
+	while (Done < Count)
+	{
+		Read = fread(Chunk, sizeof(float), Count - Done < 4096 ? Count - Done : 4096, GeoidHeightFile);
+		if (Read == 0)
+			break;
+		for (i = 0; i < Read; i++)	/* The file is little endian */
+			Geoid->GeoidHeightBufferCm[Done + i] = WMM_GeoidQuantize(SwabType == 0 ? WMM_FloatSwap(Chunk[i]) : Chunk[i]);
+		Done += Read;
+	}
+	fclose(GeoidHeightFile);
+	if (Done != Count)
+	{
+		free(Geoid->GeoidHeightBufferCm);
+		Geoid->GeoidHeightBufferCm = NULL;
+		WMM_Error(3);
+		return (FALSE);
+	}
+	Geoid->Geoid_Initialized = 1;
+	if (Geoid->Tiled)
+		WMM_GeoidBuildTiles(Geoid);
+	return (TRUE);
+	}  /*WMM_InitializeGeoidQuantized*/
 
-	/*  Find Four Nearest Geoid Height Cells for specified Latitude, Longitude;   */
-	/*  Assumes that (0,0) of Geoid Height Array is at Northwest corner:          */
+int16_t WMM_GeoidQuantize(double Height)
+	/*
+	 * Rounds a geoid height in meters to int16 centimetres, see WMM_InitializeGeoidQuantized.
+	 CALLS : none
+	 */
+	{
+	Height = floor(Height * 100.0 + 0.5);
+	if (Height > 32767.0) Height = 32767.0;
+	if (Height < -32767.0) Height = -32767.0;
+	return (int16_t) Height;
+	}  /*WMM_GeoidQuantize*/
 
-	PostX = floor( OffsetX );
+int WMM_InitializeGeoidFromBuffer(WMMtype_Geoid *Geoid, const void *Buffer, size_t Size)
+	/*
+	 * Same as WMM_InitializeGeoid, from a copy of EGM9615.BIN in memory (little endian floats)
+	 * instead of the file. With the float storage on a little endian host and a 4 byte aligned
+	 * buffer nothing is copied: GeoidHeightBuffer points into Buffer, which must outlive the
+	 * geoid and is never written to or freed. Otherwise the heights are copied, swapped or
+	 * quantized as by WMM_InitializeGeoid. Release with WMM_FreeGeoid.
+
+	 INPUT  Geoid  : as WMM_InitializeGeoid
+			Buffer : EGM9615.BIN contents
+			Size   : bytes in Buffer, at least NumbGeoidElevs floats
+	 OUPUT  Geoid  : as WMM_InitializeGeoid, with External set if Buffer is used in place
+	 CALLS : WMM_swab_type, WMM_FloatSwap, WMM_GeoidQuantize, WMM_GeoidBuildTiles
+	 */
+	{
+	const unsigned char *Bytes = (const unsigned char *) Buffer;
+	size_t i, Count = (size_t) Geoid->NumbGeoidElevs;
+	int SwabType = WMM_swab_type();
+	float Height;
+
+	if (Geoid->Geoid_Initialized)
+		return (TRUE);
+	if (!Buffer || Size < Count * sizeof(float))
+	{
+		WMM_Error(3);
+		return (FALSE);
+	}
+	if (Geoid->Storage == WMM_GEOID_INT16)
+	{
+		Geoid->GeoidHeightBufferCm = (int16_t *) malloc( (Count + 1) * sizeof(int16_t) );
+		if (!Geoid->GeoidHeightBufferCm)
+		{
+			WMM_Error(3);
+			return (FALSE);
+		}
+		for (i = 0; i < Count; i++)
+		{
+			memcpy(&Height, &Bytes[i * sizeof(float)], sizeof(float));
+			Geoid->GeoidHeightBufferCm[i] = WMM_GeoidQuantize(SwabType == 0 ? WMM_FloatSwap(Height) : Height);
+		}
+	}
+	else if (SwabType == 1 && (uintptr_t) Buffer % sizeof(float) == 0)
+	{ /* Used in place */
+		Geoid->GeoidHeightBuffer = (float *) Buffer;
+		Geoid->External = 1;
+	}
+	else
+	{
+		Geoid->GeoidHeightBuffer = ( float *) malloc ( (Count + 1) * sizeof(float) );
+		if (!Geoid->GeoidHeightBuffer)
+		{
+			WMM_Error(3);
+			return (FALSE);
+		}
+		memcpy(Geoid->GeoidHeightBuffer, Buffer, Count * sizeof(float));
+		if (SwabType == 0)
+			for (i = 0; i < Count; i++)
+				Geoid->GeoidHeightBuffer[i] = (float)WMM_FloatSwap(Geoid->GeoidHeightBuffer[i]);
+	}
+	Geoid->Geoid_Initialized = 1;
+	if (Geoid->Tiled)
+		WMM_GeoidBuildTiles(Geoid);
+	return (TRUE);
+	}  /*WMM_InitializeGeoidFromBuffer*/
+
+int WMM_InitializeGeoidMapped(WMMtype_Geoid *Geoid)
+	/*
+	 * Same as WMM_InitializeGeoid, but maps EGM9615.BIN read-only into memory instead of
+	 * reading it. Nothing is copied: GeoidHeightBuffer points into the mapping, the pages are
+	 * shared with every other process mapping the file, and only the pages of the queried
+	 * cells are read from disk. The buffer must not be written to.
+	 * The file is little endian, so on big endian hosts, for the WMM_GEOID_INT16 storage, or
+	 * when built with WMM_MMAP 0, the function falls back to WMM_InitializeGeoid, as it does
+	 * for the embedded geoid of WMM_EMBED_DATA.
+	 * Release with WMM_FreeGeoid.
+
+	 INPUT  Geoid : as WMM_InitializeGeoid
+	 OUPUT  Geoid : as WMM_InitializeGeoid, with Mapped set if the file was mapped
+	 CALLS : WMM_InitializeGeoid, WMM_GeoidBuildTiles
+	 */
+	{
+#if WMM_MMAP
+	int fd;
+	struct stat FileStatus;
+	size_t Size;
+	void *Map;
+
+	if (Geoid->Geoid_Initialized)
+		return (TRUE);
+	if (WMM_swab_type() != 1 || Geoid->Storage != WMM_GEOID_FLOAT32)	/* The values must be swapped or converted */
+		return WMM_InitializeGeoid(Geoid);
+#if WMM_EMBED_DATA
+	if (!strcmp(Geoid->GeoidFileName, WMM_GEOID_FILE))	/* Already mapped with the program */
+		return WMM_InitializeGeoid(Geoid);
+#endif
+
+	if ((fd = open(Geoid->GeoidFileName, O_RDONLY)) < 0)
+	{
+		printf("\nError in opening %s file\n", Geoid->GeoidFileName);
+		return (FALSE);
+	}
+	Size = (size_t) Geoid->NumbGeoidElevs * sizeof(float);
+	if (fstat(fd, &FileStatus) != 0 || (size_t) FileStatus.st_size < Size)
+	{
+		close(fd);
+		WMM_Error(3);
+		return (FALSE);
+	}
+	Map = mmap(NULL, Size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);	/* The mapping stays valid */
+	if (Map == MAP_FAILED)
+		return WMM_InitializeGeoid(Geoid);
+	madvise(Map, Size, MADV_RANDOM);	/* Lookups touch few, scattered pages: no read-ahead */
+
+	Geoid->GeoidHeightBuffer = (float *) Map;
+	Geoid->Mapped = 1;
+	Geoid->MappedSize = Size;
+	Geoid->Geoid_Initialized = 1;
+	if (Geoid->Tiled)
+		WMM_GeoidBuildTiles(Geoid);
+	return (TRUE);
+#else
+	return WMM_InitializeGeoid(Geoid);
+#endif
+	}  /*WMM_InitializeGeoidMapped*/
+
+int WMM_FreeGeoid(WMMtype_Geoid *Geoid)
+	/*
+	 * Releases the geoid heights loaded by WMM_InitializeGeoid, WMM_InitializeGeoidMapped or
+	 * WMM_InitializeGeoidFromBuffer (the caller's buffer itself is left alone).
+	 * The geoid can be initialized again afterwards.
+
+	 INPUT  Geoid
+	 CALLS : none
+	 */
+	{
+	if (Geoid->GeoidHeightBufferCm)
+		free(Geoid->GeoidHeightBufferCm);
+	Geoid->GeoidHeightBufferCm = NULL;
+	if (Geoid->GeoidTiles)
+		free(Geoid->GeoidTiles);
+	Geoid->GeoidTiles = NULL;
+	if (Geoid->GeoidTilesCm)
+		free(Geoid->GeoidTilesCm);
+	Geoid->GeoidTilesCm = NULL;
+	if (Geoid->GeoidHeightBuffer && !Geoid->External)
+	{
+#if WMM_MMAP
+		if (Geoid->Mapped)
+			munmap(Geoid->GeoidHeightBuffer, Geoid->MappedSize);
+		else
+#endif
+			free(Geoid->GeoidHeightBuffer);
+	}
+	Geoid->GeoidHeightBuffer = NULL;
+	Geoid->External = 0;
+	Geoid->Mapped = 0;
+	Geoid->MappedSize = 0;
+	Geoid->Geoid_Initialized = 0;
+	return TRUE;
+	}  /*WMM_FreeGeoid*/
+
+double WMM_GeoidPost(WMMtype_Geoid *Geoid, long Index)
+/*
+ * Returns the geoid height in meters of grid post Index, from the float or the
+ * centimetre storage of the geoid.
+	CALLS : none
+ */
+{
+	if (Geoid->Storage == WMM_GEOID_INT16)
+		return Geoid->GeoidHeightBufferCm[ Index ] * 0.01;
+	return ( double ) Geoid->GeoidHeightBuffer[ Index ];
+}  /*WMM_GeoidPost*/
+
+int WMM_GeoidBuildTiles(WMMtype_Geoid *Geoid)
+/*
+ * Copies the loaded geoid grid into tiles of WMM_GEOID_TILE_SIZE x WMM_GEOID_TILE_SIZE cells.
+ * Each tile also holds the posts of the first row and column of its south and east
+ * neighbours (halo), so the four posts of any cell are in the same tile, 17 posts apart,
+ * instead of a whole grid row (5.7 KB) apart. A lookup touches two or three neighbouring
+ * cache lines and queries along a track stay in the same tile.
+ * The tiles keep the storage of the grid: float, or int16 centimetres. The row-major grid
+ * is kept, WMM_GetGeoidHeight uses the tiles whenever they exist. If the tiles can not be
+ * allocated, lookups simply stay on the row-major grid.
+ * Called at initialization when Geoid->Tiled is set. It is off by default: where the last
+ * level cache holds the whole grid, the index arithmetic makes lookups about 10% slower.
+
+	INPUT  Geoid : initialized geoid
+	OUTPUT Geoid : GeoidTiles or GeoidTilesCm, NumbTileCols
+	CALLS : none
+ */
+{
+	long NumTileCols, NumTileRows, Tile, TileX, TileY, x, y, Row, Col, Post;
+	size_t Count;
+
+	NumTileCols = (Geoid->NumbGeoidCols - 2) / WMM_GEOID_TILE_SIZE + 1;
+	NumTileRows = (Geoid->NumbGeoidRows - 2) / WMM_GEOID_TILE_SIZE + 1;
+	Count = (size_t) (NumTileCols * NumTileRows) * WMM_GEOID_TILE_POSTS;
+	if (Geoid->Storage == WMM_GEOID_INT16)	/* One spare post: WMM_GetGeoidHeightBatchAVX2 gathers 32 bits */
+		Geoid->GeoidTilesCm = (int16_t *) malloc((Count + 1) * sizeof(int16_t));
+	else
+		Geoid->GeoidTiles = (float *) malloc(Count * sizeof(float));
+	if (!Geoid->GeoidTiles && !Geoid->GeoidTilesCm)
+		return FALSE;
+
+	for (TileY = 0; TileY < NumTileRows; TileY++)
+		for (TileX = 0; TileX < NumTileCols; TileX++)
+		{
+			Tile = (TileY * NumTileCols + TileX) * WMM_GEOID_TILE_POSTS;
+			for (y = 0; y <= WMM_GEOID_TILE_SIZE; y++)
+			{
+				Row = TileY * WMM_GEOID_TILE_SIZE + y;
+				if (Row >= Geoid->NumbGeoidRows)	/* Halo past the edge of the grid, never read */
+					Row = Geoid->NumbGeoidRows - 1;
+				for (x = 0; x <= WMM_GEOID_TILE_SIZE; x++)
+				{
+					Col = TileX * WMM_GEOID_TILE_SIZE + x;
+					if (Col >= Geoid->NumbGeoidCols)
+						Col = Geoid->NumbGeoidCols - 1;
+					Post = Tile + y * (WMM_GEOID_TILE_SIZE + 1) + x;
+					if (Geoid->GeoidTilesCm)
+						Geoid->GeoidTilesCm[Post] = Geoid->GeoidHeightBufferCm[Row * Geoid->NumbGeoidCols + Col];
+					else
+						Geoid->GeoidTiles[Post] = Geoid->GeoidHeightBuffer[Row * Geoid->NumbGeoidCols + Col];
+				}
+			}
+		}
+	Geoid->NumbTileCols = (int) NumTileCols;
+	return TRUE;
+}  /*WMM_GeoidBuildTiles*/
+
+
+int WMM_GetGeoidHeight (double Latitude,
+						double Longitude,
+						double *DeltaHeight ,
+						WMMtype_Geoid *Geoid)
+/*
+ * WMM_GeoidHeightCode, printing the error if any.
+ *
+ *    Latitude            : Geodetic latitude in degrees           (input)
+ *    Longitude           : Longitude in degrees                   (input)
+ *    DeltaHeight         : Height Adjustment, in meters.          (output)
+ *    Geoid				  : WMMtype_Geoid with Geoid grid		   (input)
+	CALLS : WMM_GeoidHeightCode, WMM_Error
+ */
+{
+  int Error_Code;
+
+  WMM_STATS_BEGIN(WMM_STAT_GEOID);
+  Error_Code = WMM_GeoidHeightCode(Latitude, Longitude, DeltaHeight, Geoid);
+  WMM_STATS_END(WMM_STAT_GEOID);
+
+  if (Error_Code != WMM_ERR_NONE)
+  {
+	WMM_Error(Error_Code);
+	return (FALSE);
+  }
+  return TRUE;
+}  /*WMM_GetGeoidHeight*/
+
+int WMM_GeoidHeightCode (double Latitude,
+						double Longitude,
+						double *DeltaHeight ,
+						WMMtype_Geoid *Geoid)
+/*
+ * The  function WMM_GeoidHeightCode returns the height of the
+ * EGM96 geiod above or below the WGS84 ellipsoid,
+ * at the specified geodetic coordinates,
+ * using a grid of height adjustments from the EGM96 gravity model.
+ *
+ *    Latitude            : Geodetic latitude in radians           (input)
+ *    Longitude           : Geodetic longitude in radians          (input)
+ *    DeltaHeight         : Height Adjustment, in meters.          (output)
+ *    Geoid				  : WMMtype_Geoid with Geoid grid		   (input)
+ *  Returns WMM_ERR_NONE, or WMM_ERR_GEOID_NOT_INITIALIZED or WMM_ERR_GEOID_RANGE without
+ *  printing anything; safe to call concurrently on the same geoid.
+	CALLS : WMM_GeoidPost
+ */
+{
+  long   Index, Stride;
+  unsigned long Row, Column;
+  double DeltaX, DeltaY;
+  double ElevationSE, ElevationSW, ElevationNE, ElevationNW;
+  double OffsetX, OffsetY;
+  double PostX, PostY;
+  double UpperY, LowerY;
+  int Error_Code = 0;
+
+  if (!Geoid->Geoid_Initialized)
+  {
+	//printf("Geoid not initialized\n");
+	return (WMM_ERR_GEOID_NOT_INITIALIZED);
+  }
+  if (!((Latitude >= -90) && (Latitude <= 90)))
+  { /* Latitude out of range, or NaN */
+	Error_Code |= 1;
+  }
+  if (!((Longitude >= -180) && (Longitude <= 360)))
+  { /* Longitude out of range, or NaN */
+	Error_Code |= 1;
+  }
+
+  if (!Error_Code)
+  { /* no errors */
+	/*  Compute X and Y Offsets into Geoid Height Array:                          */
+
+	if (Longitude < 0.0)
+	{
+	  OffsetX = ( Longitude + 360.0 ) *Geoid->ScaleFactor;
+	}
+	else
+	{
+	  OffsetX = Longitude * Geoid->ScaleFactor;
+	}
+	OffsetY = ( 90.0 - Latitude ) * Geoid->ScaleFactor;
+
+	/*  Find Four Nearest Geoid Height Cells for specified Latitude, Longitude;   */
+	/*  Assumes that (0,0) of Geoid Height Array is at Northwest corner:          */
+
+	PostX = floor( OffsetX );
 	if ((PostX + 1) == Geoid->NumbGeoidCols)
 	  PostX--;
 	PostY = floor( OffsetY );
 	if ((PostY + 1) == Geoid->NumbGeoidRows)
 	  PostY--;
 
-	Index = (long)(PostY * Geoid->NumbGeoidCols + PostX);
-	ElevationNW = ( double ) Geoid->GeoidHeightBuffer[ Index ];
-	ElevationNE = ( double ) Geoid->GeoidHeightBuffer[ Index+ 1 ];
+	if (Geoid->GeoidTiles || Geoid->GeoidTilesCm)
+	{ /* Tiled layout, see WMM_GeoidBuildTiles */
+	  Column = (unsigned long) PostX;	/* Unsigned: the divisions below are shifts */
+	  Row = (unsigned long) PostY;
+	  Index = (long) (((Row / WMM_GEOID_TILE_SIZE) * Geoid->NumbTileCols + Column / WMM_GEOID_TILE_SIZE) * WMM_GEOID_TILE_POSTS
+		  + (Row % WMM_GEOID_TILE_SIZE) * (WMM_GEOID_TILE_SIZE + 1) + Column % WMM_GEOID_TILE_SIZE);
+	  Stride = WMM_GEOID_TILE_SIZE + 1;
+	  if (Geoid->GeoidTilesCm)
+	  {
+		ElevationNW = Geoid->GeoidTilesCm[ Index ] * 0.01;
+		ElevationNE = Geoid->GeoidTilesCm[ Index + 1 ] * 0.01;
+		ElevationSW = Geoid->GeoidTilesCm[ Index + Stride ] * 0.01;
+		ElevationSE = Geoid->GeoidTilesCm[ Index + Stride + 1 ] * 0.01;
+	  }
+	  else
+	  {
+		ElevationNW = ( double ) Geoid->GeoidTiles[ Index ];
+		ElevationNE = ( double ) Geoid->GeoidTiles[ Index + 1 ];
+		ElevationSW = ( double ) Geoid->GeoidTiles[ Index + Stride ];
+		ElevationSE = ( double ) Geoid->GeoidTiles[ Index + Stride + 1 ];
+	  }
+	}
+	else
+	{
+	  Index = (long)(PostY * Geoid->NumbGeoidCols + PostX);
+	  ElevationNW = WMM_GeoidPost( Geoid, Index );
+	  ElevationNE = WMM_GeoidPost( Geoid, Index + 1 );
 
-	Index = (long)((PostY + 1) * Geoid->NumbGeoidCols + PostX);
-	ElevationSW = ( double ) Geoid->GeoidHeightBuffer[ Index ];
-	ElevationSE = ( double ) Geoid->GeoidHeightBuffer[ Index + 1 ];
+	  Index = (long)((PostY + 1) * Geoid->NumbGeoidCols + PostX);
+	  ElevationSW = WMM_GeoidPost( Geoid, Index );
+	  ElevationSE = WMM_GeoidPost( Geoid, Index + 1 );
+	}
 
 	/*  Perform Bi-Linear Interpolation to compute Height above Ellipsoid:        */
 
@@ -928,12 +1838,150 @@ int WMM_GetGeoidHeight (double Latitude,
 
   else
   {
-	WMM_Error(17);
 	//printf("Latitude OR Longitude out of range in WMM_GetGeoidHeight\n");
-  return (FALSE);
+  return (WMM_ERR_GEOID_RANGE);
   }
-  return TRUE;
-}  /*WMM_GetGeoidHeight*/
+  return WMM_ERR_NONE;
+}  /*WMM_GeoidHeightCode*/
+
+int WMM_GetGeoidHeightBatch (const double *Latitude,
+						const double *Longitude,
+						size_t NumPoints,
+						double *DeltaHeight,
+						WMMtype_Geoid *Geoid)
+/*
+ * Same as WMM_GetGeoidHeight for NumPoints points. With WMM_SIMD_AVX2 or above
+ * (see WMM_GetSimdLevel), the points are interpolated 4 at a time by
+ * WMM_GetGeoidHeightBatchAVX2, with identical results.
+ *
+ *    Latitude            : Geodetic latitudes in degrees, NumPoints elements    (input)
+ *    Longitude           : Longitudes in degrees, NumPoints elements             (input)
+ *    NumPoints           : Number of points                                      (input)
+ *    DeltaHeight         : Height Adjustments, in meters, NumPoints elements.    (output)
+ *                          Not written for points out of range.
+ *    Geoid				  : WMMtype_Geoid with Geoid grid		   (input)
+ *  Returns FALSE if the geoid is not initialized or a point is out of range. Nothing is
+ *  printed, see WMM_GeoidHeightCode.
+	CALLS : WMM_GeoidHeightCode, WMM_GetGeoidHeightBatchAVX2
+ */
+{
+  size_t i;
+  int Status = TRUE;
+
+  if (!Geoid->Geoid_Initialized)
+	return (FALSE);
+  WMM_STATS_BEGIN(WMM_STAT_GEOID);
+#if WMM_SIMD_X86
+  if (WMM_GetSimdLevel() >= WMM_SIMD_AVX2)
+	Status = WMM_GetGeoidHeightBatchAVX2(Latitude, Longitude, NumPoints, DeltaHeight, Geoid);
+  else
+#endif
+  for (i = 0; i < NumPoints; i++)
+	if (WMM_GeoidHeightCode(Latitude[i], Longitude[i], &DeltaHeight[i], Geoid) != WMM_ERR_NONE)
+	  Status = FALSE;
+  WMM_STATS_END(WMM_STAT_GEOID);
+  return Status;
+}  /*WMM_GetGeoidHeightBatch*/
+
+#if WMM_SIMD_X86
+
+__attribute__((target("avx2")))
+int WMM_GetGeoidHeightBatchAVX2 (const double *Latitude,
+						const double *Longitude,
+						size_t NumPoints,
+						double *DeltaHeight,
+						WMMtype_Geoid *Geoid)
+/*
+ * AVX2 kernel of WMM_GetGeoidHeightBatch, 4 points per instruction. The four posts of each
+ * cell are fetched with gathers, from the float or int16 store, row-major or tiled; the
+ * interpolation repeats the operations of WMM_GetGeoidHeight without FMA, so the heights
+ * are bit-identical. Groups with a point out of range (or NaN), and the last NumPoints % 4
+ * points, go through WMM_GeoidHeightCode.
+	CALLS : WMM_GeoidHeightCode
+ */
+{
+  size_t i, j;
+  int Status = TRUE;
+  const int Tiled = Geoid->GeoidTiles || Geoid->GeoidTilesCm;
+  const int Int16 = Tiled ? Geoid->GeoidTilesCm != NULL : Geoid->Storage == WMM_GEOID_INT16;
+  const void *Base;
+  __m256d Lat, Lon, Bad, OffsetX, OffsetY, PostX, PostY, DeltaX, DeltaY;
+  __m256d ElevationNW, ElevationNE, ElevationSW, ElevationSE, UpperY, LowerY;
+  __m256d Scale = _mm256_set1_pd((double) Geoid->ScaleFactor);
+  __m256d MaxX = _mm256_set1_pd((double) (Geoid->NumbGeoidCols - 2));
+  __m256d MaxY = _mm256_set1_pd((double) (Geoid->NumbGeoidRows - 2));
+  __m128i X, Y, Index, Stride;
+
+  if (Tiled)
+  {
+	Base = Int16 ? (const void *) Geoid->GeoidTilesCm : (const void *) Geoid->GeoidTiles;
+	Stride = _mm_set1_epi32(WMM_GEOID_TILE_SIZE + 1);
+  }
+  else
+  {
+	Base = Int16 ? (const void *) Geoid->GeoidHeightBufferCm : (const void *) Geoid->GeoidHeightBuffer;
+	Stride = _mm_set1_epi32(Geoid->NumbGeoidCols);
+  }
+
+  for (i = 0; i + 4 <= NumPoints; i += 4)
+  {
+	Lat = _mm256_loadu_pd(&Latitude[i]);
+	Lon = _mm256_loadu_pd(&Longitude[i]);
+	Bad = _mm256_or_pd(_mm256_or_pd(_mm256_cmp_pd(Lat, _mm256_set1_pd(-90.0), _CMP_NGE_UQ), _mm256_cmp_pd(Lat, _mm256_set1_pd(90.0), _CMP_NLE_UQ)),
+		_mm256_or_pd(_mm256_cmp_pd(Lon, _mm256_set1_pd(-180.0), _CMP_NGE_UQ), _mm256_cmp_pd(Lon, _mm256_set1_pd(360.0), _CMP_NLE_UQ)));
+	if (_mm256_movemask_pd(Bad))
+	{
+	  for (j = i; j < i + 4; j++)
+		if (WMM_GeoidHeightCode(Latitude[j], Longitude[j], &DeltaHeight[j], Geoid) != WMM_ERR_NONE)
+		  Status = FALSE;
+	  continue;
+	}
+
+	/*  Offsets, posts and indices of the four points, see WMM_GetGeoidHeight      */
+	OffsetX = _mm256_mul_pd(_mm256_add_pd(Lon, _mm256_and_pd(_mm256_cmp_pd(Lon, _mm256_setzero_pd(), _CMP_LT_OQ), _mm256_set1_pd(360.0))), Scale);
+	OffsetY = _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(90.0), Lat), Scale);
+	PostX = _mm256_min_pd(_mm256_floor_pd(OffsetX), MaxX);
+	PostY = _mm256_min_pd(_mm256_floor_pd(OffsetY), MaxY);
+	X = _mm256_cvttpd_epi32(PostX);
+	Y = _mm256_cvttpd_epi32(PostY);
+	if (Tiled)
+	  Index = _mm_add_epi32(_mm_mullo_epi32(_mm_add_epi32(_mm_mullo_epi32(_mm_srli_epi32(Y, WMM_GEOID_TILE_SHIFT), _mm_set1_epi32(Geoid->NumbTileCols)), _mm_srli_epi32(X, WMM_GEOID_TILE_SHIFT)),
+		  _mm_set1_epi32(WMM_GEOID_TILE_POSTS)),
+		  _mm_add_epi32(_mm_mullo_epi32(_mm_and_si128(Y, _mm_set1_epi32(WMM_GEOID_TILE_SIZE - 1)), Stride), _mm_and_si128(X, _mm_set1_epi32(WMM_GEOID_TILE_SIZE - 1))));
+	else
+	  Index = _mm_add_epi32(_mm_mullo_epi32(Y, Stride), X);
+
+	if (Int16)
+	{ /* 32 bit gathers at 2 byte scale, the post is the sign extended low half */
+	  ElevationNW = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_srai_epi32(_mm_slli_epi32(_mm_i32gather_epi32((const int *) Base, Index, 2), 16), 16)), _mm256_set1_pd(0.01));
+	  ElevationNE = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_srai_epi32(_mm_slli_epi32(_mm_i32gather_epi32((const int *) Base, _mm_add_epi32(Index, _mm_set1_epi32(1)), 2), 16), 16)), _mm256_set1_pd(0.01));
+	  Index = _mm_add_epi32(Index, Stride);
+	  ElevationSW = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_srai_epi32(_mm_slli_epi32(_mm_i32gather_epi32((const int *) Base, Index, 2), 16), 16)), _mm256_set1_pd(0.01));
+	  ElevationSE = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_srai_epi32(_mm_slli_epi32(_mm_i32gather_epi32((const int *) Base, _mm_add_epi32(Index, _mm_set1_epi32(1)), 2), 16), 16)), _mm256_set1_pd(0.01));
+	}
+	else
+	{
+	  ElevationNW = _mm256_cvtps_pd(_mm_i32gather_ps((const float *) Base, Index, 4));
+	  ElevationNE = _mm256_cvtps_pd(_mm_i32gather_ps((const float *) Base, _mm_add_epi32(Index, _mm_set1_epi32(1)), 4));
+	  Index = _mm_add_epi32(Index, Stride);
+	  ElevationSW = _mm256_cvtps_pd(_mm_i32gather_ps((const float *) Base, Index, 4));
+	  ElevationSE = _mm256_cvtps_pd(_mm_i32gather_ps((const float *) Base, _mm_add_epi32(Index, _mm_set1_epi32(1)), 4));
+	}
+
+	/*  Bi-Linear Interpolation                                                   */
+	DeltaX = _mm256_sub_pd(OffsetX, PostX);
+	DeltaY = _mm256_sub_pd(OffsetY, PostY);
+	UpperY = _mm256_add_pd(ElevationNW, _mm256_mul_pd(DeltaX, _mm256_sub_pd(ElevationNE, ElevationNW)));
+	LowerY = _mm256_add_pd(ElevationSW, _mm256_mul_pd(DeltaX, _mm256_sub_pd(ElevationSE, ElevationSW)));
+	_mm256_storeu_pd(&DeltaHeight[i], _mm256_add_pd(UpperY, _mm256_mul_pd(DeltaY, _mm256_sub_pd(LowerY, UpperY))));
+  }
+  for (; i < NumPoints; i++)
+	if (WMM_GeoidHeightCode(Latitude[i], Longitude[i], &DeltaHeight[i], Geoid) != WMM_ERR_NONE)
+	  Status = FALSE;
+  return Status;
+}  /*WMM_GetGeoidHeightBatchAVX2*/
+
+#endif
 
 
 int WMM_ConvertGeoidToEllipsoidHeight (WMMtype_CoordGeodetic *CoordGeodetic, WMMtype_Geoid *Geoid)
@@ -1511,171 +2559,734 @@ cord_step_size, double altitude_step_size, double time_step, WMMtype_MagneticMod
 
 	   OUTPUT: none (prints the output to a file )
 
-	   CALLS : WMM_AllocateModelMemory To allocate memory for model coefficients
-              WMM_TimelyModifyMagneticModel This modifies the Magnetic coefficients to the correct date.
-			  WMM_ConvertGeoidToEllipsoidHeight (&CoordGeodetic, &Geoid);   Convert height above msl to height above WGS-84 ellipsoid
-			  WMM_GeodeticToSpherical Convert from geodeitic to Spherical Equations: 7-8, WMM Technical report
-			  WMM_ComputeSphericalHarmonicVariables Compute Spherical Harmonic variables
-			  WMM_AssociatedLegendreFunction Compute ALF  Equations 5-6, WMM Technical report
-			  WMM_Summation Accumulate the spherical harmonic coefficients Equations 10:12 , WMM Technical report
-			  WMM_RotateMagneticVector Map the computed Magnetic fields to Geodeitic coordinates Equation 16 , WMM Technical report
-			  WMM_CalculateGeoMagneticElements Calculate the geoMagnetic elements, Equation 18 , WMM Technical report
+	   CALLS : WMM_GridParallel, with one worker per online processor
 
 	*/
 
 
 {
-	int NumTerms;
-	double a, b, c, d, PrintElement;
+	return WMM_GridParallel(minimum, maximum, cord_step_size, altitude_step_size, time_step, MagneticModel, Geoid, Ellip,
+		StartDate, EndDate, ElementOption >= 1 && ElementOption <= WMM_GRID_MAX_ELEMENTS ? WMM_GRID_ELEMENT(ElementOption) : WMM_GRID_DECL,
+		PrintOption, OutputFile, WMM_GRID_TEXT, 0);
+	} /*WMM_Grid*/
 
-	WMMtype_MagneticModel *TimedMagneticModel;
-	WMMtype_CoordSpherical CoordSpherical;
-	WMMtype_MagneticResults MagneticResultsSph, MagneticResultsGeo, MagneticResultsSphVar, MagneticResultsGeoVar;
-	WMMtype_SphericalHarmonicVariables SphVariables;
-	WMMtype_GeoMagneticElements GeoMagneticElements;
-	WMMtype_LegendreFunction *LegendreFunction;
+int WMM_GridAxis(double Start, double End, double Step, double **Axis)
 
-	FILE *fileout;
+	/* Lists the values of a grid axis, for(x = Start; x <= End; x += Step), accumulated the same way
+	as the loops of the grid so that the printed coordinates do not change.
 
-	if (PrintOption == 1) {
-						fileout = fopen(OutputFile, "w");
-							}
-	if (!fileout)
+	INPUT: Start, End, Step
+	OUTPUT: Axis : newly allocated array of the values, to be freed by the caller
+	Returns the number of values, -1 if the memory could not be allocated.
+	CALLS : none
+	*/
+{
+	int n = 0;
+	double x;
+
+	for(x = Start; x <= End; x += Step)
+		n++;
+	*Axis = (double *) malloc( (n + 1) * sizeof(double) );
+	if (*Axis == NULL)
+		return -1;
+	n = 0;
+	for(x = Start; x <= End; x += Step)
+		(*Axis)[n++] = x;
+	return n;
+} /*WMM_GridAxis*/
+
+double WMM_GridElement(WMMtype_GeoMagneticElements *GeoMagneticElements, int ElementOption)
+
+	/* Returns the geomagnetic element selected by ElementOption (1 to 16, see WMM_Grid) */
+{
+	switch(ElementOption)
 	{
-		printf("Error opening %s to write", OutputFile);
-		return FALSE;
+	case 1:
+		return GeoMagneticElements->Decl; 		/*1. Angle between the magnetic field vector and true north, positive east*/
+	case 2:
+		return GeoMagneticElements->Incl;		/*2. Angle between the magnetic field vector and the horizontal plane, positive downward*/
+	case 3:
+		return GeoMagneticElements->F; 			/*3. Magnetic Field Strength*/
+	case 4:
+		return GeoMagneticElements->H; 			/*4. Horizontal Magnetic Field Strength*/
+	case 5:
+		return GeoMagneticElements->X; 			/*5. Northern component of the magnetic field vector*/
+	case 6:
+		return GeoMagneticElements->Y; 			/*6. Eastern component of the magnetic field vector*/
+	case 7:
+		return GeoMagneticElements->Z; 			/*7. Downward component of the magnetic field vector*/
+	case 8:
+		return GeoMagneticElements->GV; 		/*8. The Grid Variation*/
+	case 9:
+		return GeoMagneticElements->Decldot;	/*9. Yearly Rate of change in declination*/
+	case 10:
+		return GeoMagneticElements->Incldot;	/*10. Yearly Rate of change in inclination*/
+	case 11:
+		return GeoMagneticElements->Fdot; 		/*11. Yearly rate of change in Magnetic field strength*/
+	case 12:
+		return GeoMagneticElements->Hdot; 		/*12. Yearly rate of change in horizontal field strength*/
+	case 13:
+		return GeoMagneticElements->Xdot; 		/*13. Yearly rate of change in the northern component*/
+	case 14:
+		return GeoMagneticElements->Ydot; 		/*14. Yearly rate of change in the eastern component*/
+	case 15:
+		return GeoMagneticElements->Zdot; 		/*15. Yearly rate of change in the downward component*/
+	case 16:
+		return GeoMagneticElements->GVdot;		/*16. Yearly rate of chnage in grid variation*/
+	default:
+		return GeoMagneticElements->Decl; 		/* 1. Angle between the magnetic field vector and true north, positive east*/
 	}
+} /*WMM_GridElement*/
 
+int WMM_GridParallel(WMMtype_CoordGeodetic minimum, WMMtype_CoordGeodetic maximum, double
+cord_step_size, double altitude_step_size, double time_step, WMMtype_MagneticModel *MagneticModel, WMMtype_Geoid
+*Geoid, WMMtype_Ellipsoid Ellip, WMMtype_Date StartDate, WMMtype_Date EndDate, unsigned int ElementMask, int PrintOption, char *OutputFile,
+int OutputFormat, int NumThreads)
+
+	/* Same as WMM_Grid, with the latitude rows computed by a pool of NumThreads worker threads.
+	A row is one latitude at one altitude: every longitude and every date of it. Each worker has its
+	own workspace (Legendre functions and time modified model) and formats its rows into memory,
+	while the calling thread writes the rows out in the order of the serial loops. The output is
+	identical to that of a single thread. Workers stay at most WMM_GRID_ROWS_PER_THREAD rows per
+	thread ahead of the writer, which bounds the memory used. The spherical harmonic sums of each
+	point are evaluated once, for the main field at the model epoch and for the secular variation,
+	and each date of the time axis is their linear combination (WMM_TimeSeriesElements).
+	With heights above the ellipsoid the grid is separable, see WMM_GridRowSeparable.
+
+	INPUT: as WMM_Grid, except
+			ElementMask : elements to output, an OR of WMM_GRID_ELEMENT(ElementOption) bits such as
+						WMM_GRID_DECL | WMM_GRID_F. All of them come from the same evaluation of each point.
+			OutputFormat : WMM_GRID_TEXT for the lines of WMM_Grid, with one column per element in
+						increasing ElementOption order, WMM_GRID_FLOAT32 or WMM_GRID_FLOAT64 for a binary file
+						(PrintOption must be 1): a WMMtype_GridFileHeader, the axes and one plane of values
+						per element, laid out as described in WMMHeader.h so that the file can be mapped
+						into memory and used directly.
+			NumThreads : number of worker threads, 0 for one per online processor. With 1, or when
+						built with WMM_THREADS 0, the rows are computed by the calling thread.
+	OUTPUT: none (prints the output to a file or to the screen)
+
+	CALLS : WMM_GridAxis
+			WMM_TimelyModifyMagneticModel
+			WMM_ComputeSphericalHarmonicVariables
+			WMM_GridWriteHeader
+			WMM_GridWorker
+			WMM_GridRow
+			WMM_GridFormatRow
+			WMM_GridWriteRow
+			WMM_AllocateWorkspace
+	*/
+{
+	WMMtype_GridJob Job;
+	WMMtype_Workspace *Workspace;
+	WMMtype_CoordSpherical CoordSpherical;
+	WMMtype_SphericalHarmonicVariables SphVariables;
+	FILE *fileout;
+	char *Data;
+	double *Values;
+	int Row, i, NumTerms, Status = TRUE;
+#if WMM_THREADS
+	pthread_t *Threads = NULL;
+	int NumStarted = 0, Written;
+#endif
 
 	if(fabs(cord_step_size) < 1.0e-10 )	 	cord_step_size = 99999.0; //checks to make sure that the step_size is not too small
 	if(fabs(altitude_step_size) < 1.0e-10)  altitude_step_size = 99999.0;
 	if(fabs(time_step)  < 1.0e-10)     		time_step = 99999.0;
 
+	memset(&Job, 0, sizeof(Job));
+	Job.NumHeights = WMM_GridAxis(minimum.HeightAboveGeoid, maximum.HeightAboveGeoid, altitude_step_size, &Job.Heights);
+	Job.NumLatitudes = WMM_GridAxis(minimum.phi, maximum.phi, cord_step_size, &Job.Latitudes);
+	Job.NumLongitudes = WMM_GridAxis(minimum.lambda, maximum.lambda, cord_step_size, &Job.Longitudes);
+	Job.NumYears = WMM_GridAxis(StartDate.DecimalYear, EndDate.DecimalYear, time_step, &Job.Years);
+	Job.MagneticModel = MagneticModel;
+	Job.EpochMagneticModel = NULL;
+	Job.Geoid = Geoid;
+	Job.Ellip = Ellip;
+	for (i = 1; i <= WMM_GRID_MAX_ELEMENTS; i++)
+		if (ElementMask & WMM_GRID_ELEMENT(i))
+			Job.Elements[Job.NumElements++] = i;
+	if (Job.NumElements == 0)
+		Job.Elements[Job.NumElements++] = 1;
+	Job.OutputFormat = OutputFormat;
+	Job.Status = TRUE;
+	if (Job.NumHeights < 0 || Job.NumLatitudes < 0 || Job.NumLongitudes < 0 || Job.NumYears < 0)
+		Status = FALSE;
+	else
+	{
+		Job.NumRows = Job.NumHeights * Job.NumLatitudes;
+		Job.RowData = (char **) calloc( Job.NumRows + 1, sizeof(char *) );
+		Job.RowSize = (size_t *) calloc( Job.NumRows + 1, sizeof(size_t) );
+		if (!Job.RowData || !Job.RowSize)
+			Status = FALSE;
+		/* A copy of the model at its epoch, shared read-only by every point; the dates of the time axis
+		are combined from its main field and secular variation sums */
+		NumTerms = ( ( MagneticModel->nMax + 1 ) * ( MagneticModel->nMax + 2 ) / 2 );
+		Job.EpochMagneticModel = WMM_AllocateModelMemory(NumTerms);
+		if (!Job.EpochMagneticModel)
+			Status = FALSE;
+		else
+		{
+			StartDate.DecimalYear = MagneticModel->epoch;
+			WMM_TimelyModifyMagneticModel(StartDate, MagneticModel, Job.EpochMagneticModel);
+			Job.EpochMagneticModel->SecularVariationUsed = TRUE;
+		}
+		/* cos(m lambda) and sin(m lambda) of each longitude, used by WMM_GridRowSeparable */
+		Job.cos_mlambda = (double *) malloc( ((size_t) Job.NumLongitudes * (MagneticModel->nMax + 1) + 1) * sizeof(double) );
+		Job.sin_mlambda = (double *) malloc( ((size_t) Job.NumLongitudes * (MagneticModel->nMax + 1) + 1) * sizeof(double) );
+		if (!Job.cos_mlambda || !Job.sin_mlambda)
+			Status = FALSE;
+		for (i = 0; Status && i < Job.NumLongitudes; i++)
+		{
+			CoordSpherical.lambda = Job.Longitudes[i];
+			CoordSpherical.phig = 0.0;
+			CoordSpherical.r = Ellip.re;
+			WMM_ComputeSphericalHarmonicVariables(Ellip, CoordSpherical, MagneticModel->nMax, &SphVariables);
+			memcpy(&Job.cos_mlambda[i * (MagneticModel->nMax + 1)], SphVariables.cos_mlambda, (MagneticModel->nMax + 1) * sizeof(double));
+			memcpy(&Job.sin_mlambda[i * (MagneticModel->nMax + 1)], SphVariables.sin_mlambda, (MagneticModel->nMax + 1) * sizeof(double));
+		}
+	}
+	if (!Status)
+	{
+		WMM_GridFreeJob(&Job);
+		WMM_Error(25);
+		return FALSE;
+	}
 
-	NumTerms = ( ( WMM_MAX_MODEL_DEGREES + 1 ) * ( WMM_MAX_MODEL_DEGREES + 2) / 2 );
-	TimedMagneticModel = WMM_AllocateModelMemory(NumTerms);
-	LegendreFunction   = WMM_AllocateLegendreFunctionMemory(NumTerms);  /* For storing the ALF functions */
-	a = minimum.HeightAboveGeoid; //sets the loop intialization values
-	b = minimum.phi;
-	c = minimum.lambda;
-	d = StartDate.DecimalYear;
-
+	if (PrintOption == 1)
+	{
+		fileout = fopen(OutputFile, OutputFormat == WMM_GRID_TEXT ? "w" : "wb");
+		if (!fileout)
+		{
+			printf("Error opening %s to write", OutputFile);
+			WMM_GridFreeJob(&Job);
+			return FALSE;
+		}
+		setvbuf(fileout, NULL, _IOFBF, WMM_GRID_WRITE_BUFFER);	/* Rows are written in large chunks */
+	}
+	else if (OutputFormat == WMM_GRID_TEXT)
+		fileout = stdout;
+	else
+	{
+		printf("Binary grid output needs an output file");
+		WMM_GridFreeJob(&Job);
+		return FALSE;
+	}
+	if (OutputFormat != WMM_GRID_TEXT && !WMM_GridWriteHeader(&Job, fileout))
+		Status = FALSE;
+
+#if WMM_THREADS
+	if (NumThreads <= 0)
+		NumThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (NumThreads > Job.NumRows)
+		NumThreads = Job.NumRows;
+	if (NumThreads > 1 && Status)
+	{
+		Job.Window = NumThreads * WMM_GRID_ROWS_PER_THREAD;
+		pthread_mutex_init(&Job.Lock, NULL);
+		pthread_cond_init(&Job.RowReady, NULL);
+		pthread_cond_init(&Job.RowWritten, NULL);
+		Threads = (pthread_t *) malloc( NumThreads * sizeof(pthread_t) );
+		for (i = 0; Threads && i < NumThreads; i++)
+		{
+			if (pthread_create(&Threads[i], NULL, WMM_GridWorker, &Job) != 0)
+				break;
+			NumStarted++;
+		}
 
+		/* Write the rows in order as the workers complete them */
+		for (Row = 0; Row < Job.NumRows && NumStarted > 0; Row++)
+		{
+			pthread_mutex_lock(&Job.Lock);
+			while (Job.RowData[Row] == NULL && Job.Status)
+				pthread_cond_wait(&Job.RowReady, &Job.Lock);
+			Data = Job.RowData[Row];
+			pthread_mutex_unlock(&Job.Lock);
+			if (Data == NULL)
+				break;
+			Written = WMM_GridWriteRow(&Job, fileout, Data, Job.RowSize[Row]);
+			free(Data);
+			pthread_mutex_lock(&Job.Lock);
+			if (!Written)
+				Job.Status = FALSE;	/* Stops the workers at their next row */
+			Job.RowData[Row] = NULL;
+			Job.RowsWritten++;
+			pthread_cond_broadcast(&Job.RowWritten);
+			pthread_mutex_unlock(&Job.Lock);
+		}
 
-   	for(minimum.HeightAboveGeoid = a; minimum.HeightAboveGeoid<=maximum.HeightAboveGeoid; minimum.HeightAboveGeoid += altitude_step_size) /* Altitude loop*/
+		/* Stops the workers if the writer left early */
+		pthread_mutex_lock(&Job.Lock);
+		if (Row < Job.NumRows)
+			Job.Status = FALSE;
+		Job.NextRow = Job.NumRows;
+		pthread_cond_broadcast(&Job.RowWritten);
+		pthread_mutex_unlock(&Job.Lock);
+		for (i = 0; i < NumStarted; i++)
+			pthread_join(Threads[i], NULL);
+		if (NumStarted == 0)
+			Job.Status = FALSE;
+		free(Threads);
+		pthread_mutex_destroy(&Job.Lock);
+		pthread_cond_destroy(&Job.RowReady);
+		pthread_cond_destroy(&Job.RowWritten);
+		Status = Job.Status;
+	}
+	else if (Status)
+#endif
+	{
+		/* Single thread: compute and write one row at a time */
+		Workspace = WMM_AllocateWorkspace(MagneticModel->nMax);
+		Values = (double *) malloc( ((size_t) Job.NumLongitudes * Job.NumYears * Job.NumElements + 1) * sizeof(double) );
+		Data = (char *) malloc( WMM_GridRowBufferSize(&Job) );
+		if (!Workspace || !Values || !Data)
+			Status = FALSE;
+		for (Row = 0; Status && Row < Job.NumRows; Row++)
 		{
+			WMM_GridRow(&Job, Row, Workspace, Values);
+			if (!WMM_GridWriteRow(&Job, fileout, Data, WMM_GridFormatRow(&Job, Row, Values, Data)))
+				Status = FALSE;
+		}
+		WMM_FreeWorkspace(Workspace);
+		free(Values);
+		free(Data);
+	}
 
+	if (Status && !WMM_GridWriteRow(&Job, fileout, NULL, 0))	/* Flush the staged planes */
+		Status = FALSE;
+	if (PrintOption == 1 && fclose(fileout) != 0)
+		Status = FALSE;
+	WMM_GridFreeJob(&Job);
+	return Status;
+	} /*WMM_GridParallel*/
 
-			for(minimum.phi = b; minimum.phi<= maximum.phi; minimum.phi+= cord_step_size) /*Latitude loop*/
-			{
+void WMM_GridFreeJob(WMMtype_GridJob *Job)
 
+	/* Frees the axes, epoch model, longitude tables and row and plane buffers of a grid job */
+{
+	int i;
 
+	if (Job->EpochMagneticModel)
+		WMM_FreeMagneticModelMemory(Job->EpochMagneticModel);
+	if (Job->RowData)
+		for (i = 0; i < Job->NumRows; i++)
+			free(Job->RowData[i]);
+	free(Job->Heights); free(Job->Latitudes); free(Job->Longitudes); free(Job->Years);
+	free(Job->cos_mlambda); free(Job->sin_mlambda);
+	free(Job->RowData); free(Job->RowSize);
+	free(Job->PlaneBuffer);
+	memset(Job, 0, sizeof(*Job));
+} /*WMM_GridFreeJob*/
+
+int WMM_GridRow(WMMtype_GridJob *Job, int Row, WMMtype_Workspace *Workspace, double *Values)
+
+	/* Computes the selected elements on one row of a grid (one altitude and latitude, all longitudes
+	and dates). Uses only the workspace for intermediate values, so rows can be computed concurrently.
+	Heights above the ellipsoid are separable and go through WMM_GridRowSeparable.
+
+	INPUT: Job, Row
+			Workspace : allocated for at least Job->MagneticModel->nMax
+	OUTPUT: Values : NumElements * NumLongitudes * NumYears values,
+					Values[(element * NumLongitudes + longitude) * NumYears + date]
+	CALLS : WMM_GridRowSeparable
+			WMM_ConvertGeoidToEllipsoidHeight
+			WMM_GeodeticToSpherical
+			WMM_ComputeSphericalHarmonicVariables
+			WMM_AssociatedLegendreFunctionWithWorkspace
+			WMM_SummationWithSecVar
+			WMM_RotateMagneticVector
+			WMM_TimeSeriesElements
+			WMM_CalculateGridVariation
+			WMM_GridElement
+	*/
+{
+	WMMtype_CoordGeodetic CoordGeodetic;
+	WMMtype_CoordSpherical CoordSpherical;
+	WMMtype_MagneticResults MagneticResultsSph, MagneticResultsGeo, MagneticResultsSphVar, MagneticResultsGeoVar;
+	WMMtype_SphericalHarmonicVariables SphVariables;
+	WMMtype_GeoMagneticElements GeoMagneticElements;
+	int i, j, e, GridVariation = FALSE;
 
-				for(minimum.lambda = c; minimum.lambda <= maximum.lambda; minimum.lambda += cord_step_size) /*Longitude loop*/
-				{
-					if(Geoid->UseGeoid == 1)
-						WMM_ConvertGeoidToEllipsoidHeight(&minimum, Geoid); //This converts the height above mean sea level to height above the WGS-84 ellipsoid
-					else
-						minimum.HeightAboveEllipsoid = minimum.HeightAboveGeoid;
-					WMM_GeodeticToSpherical(Ellip, minimum, &CoordSpherical);
-					WMM_ComputeSphericalHarmonicVariables( Ellip, CoordSpherical, MagneticModel->nMax, &SphVariables); /* Compute Spherical Harmonic variables  */
-					WMM_AssociatedLegendreFunction(CoordSpherical, MagneticModel->nMax, LegendreFunction);  	/* Compute ALF  Equations 5-6, WMM Technical report*/
+	WMM_STATS_BEGIN(WMM_STAT_GRID_ROW);
+	if (Job->Geoid->UseGeoid != 1 && Job->cos_mlambda && WMM_GridRowSeparable(Job, Row, Workspace, Values))
+	{
+		WMM_STATS_END(WMM_STAT_GRID_ROW);
+		return TRUE;
+	}
 
-					for(StartDate.DecimalYear = d ; StartDate.DecimalYear <= EndDate.DecimalYear; StartDate.DecimalYear += time_step) /*Year loop*/
-					{
+	for (e = 0; e < Job->NumElements; e++)
+		if (Job->Elements[e] == 8)
+			GridVariation = TRUE;
+	CoordGeodetic.HeightAboveGeoid = Job->Heights[Row / Job->NumLatitudes];
+	CoordGeodetic.phi = Job->Latitudes[Row % Job->NumLatitudes];
+	for (i = 0; i < Job->NumLongitudes; i++)
+	{
+		CoordGeodetic.lambda = Job->Longitudes[i];
+		if(Job->Geoid->UseGeoid == 1)
+			WMM_ConvertGeoidToEllipsoidHeight(&CoordGeodetic, Job->Geoid); //This converts the height above mean sea level to height above the WGS-84 ellipsoid
+		else
+			CoordGeodetic.HeightAboveEllipsoid = CoordGeodetic.HeightAboveGeoid;
+		WMM_GeodeticToSpherical(Job->Ellip, CoordGeodetic, &CoordSpherical);
+		WMM_ComputeSphericalHarmonicVariables( Job->Ellip, CoordSpherical, Job->MagneticModel->nMax, &SphVariables); /* Compute Spherical Harmonic variables  */
+		WMM_AssociatedLegendreFunctionWithWorkspace(CoordSpherical, Job->MagneticModel->nMax, Workspace);  	/* Compute ALF  Equations 5-6, WMM Technical report*/
+		WMM_SummationWithSecVar(&Workspace->LegendreFunction, Job->EpochMagneticModel, SphVariables, CoordSpherical, &MagneticResultsSph, &MagneticResultsSphVar, Workspace->PcupS); /* Accumulate the spherical harmonic coefficients and the Secular Variation Coefficients, Equations 10:15 , WMM Technical report*/
+		WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSph, &MagneticResultsGeo); /* Map the computed Magnetic fields to Geodeitic coordinates Equation 16 , WMM Technical report */
+		WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSphVar, &MagneticResultsGeoVar); /* Map the secular variation field components to Geodetic coordinates, Equation 17 , WMM Technical report*/
+
+		for (j = 0; j < Job->NumYears; j++)
+		{
+			WMM_TimeSeriesElements(MagneticResultsGeo, MagneticResultsGeoVar, Job->Years[j] - Job->EpochMagneticModel->epoch, &GeoMagneticElements); /* Elements of the date, Equations 18-19, WMM Technical report */
+			if (GridVariation)
+				WMM_CalculateGridVariation(CoordGeodetic, &GeoMagneticElements);
+			for (e = 0; e < Job->NumElements; e++)
+				Values[(e * Job->NumLongitudes + i) * Job->NumYears + j] = WMM_GridElement(&GeoMagneticElements, Job->Elements[e]);
+		}
+	}
+	WMM_STATS_END(WMM_STAT_GRID_ROW);
+	return TRUE;
+} /*WMM_GridRow*/
 
-					WMM_TimelyModifyMagneticModel(StartDate, MagneticModel, TimedMagneticModel); /*This modifies the Magnetic coefficients to the correct date. */
-					WMM_Summation(LegendreFunction, TimedMagneticModel, SphVariables, CoordSpherical, &MagneticResultsSph); /* Accumulate the spherical harmonic coefficients Equations 10:12 , WMM Technical report*/
-					WMM_SecVarSummation(LegendreFunction, TimedMagneticModel, SphVariables, CoordSpherical, &MagneticResultsSphVar); /*Sum the Secular Variation Coefficients, Equations 13:15 , WMM Technical report  */
-					WMM_RotateMagneticVector(CoordSpherical, minimum, MagneticResultsSph, &MagneticResultsGeo); /* Map the computed Magnetic fields to Geodeitic coordinates Equation 16 , WMM Technical report */
-					WMM_RotateMagneticVector(CoordSpherical, minimum, MagneticResultsSphVar, &MagneticResultsGeoVar); /* Map the secular variation field components to Geodetic coordinates, Equation 17 , WMM Technical report*/
-					WMM_CalculateGeoMagneticElements(&MagneticResultsGeo, &GeoMagneticElements);   /* Calculate the Geomagnetic elements, Equation 18 , WMM Technical report */
-					WMM_CalculateSecularVariation(MagneticResultsGeoVar, &GeoMagneticElements); /*Calculate the secular variation of each of the Geomagnetic elements, Equation 19, WMM Technical report*/
+size_t WMM_GridRowBufferSize(WMMtype_GridJob *Job)
 
-					switch(ElementOption)
-					{
-					case 1:
-					PrintElement = GeoMagneticElements.Decl; 	/*1. Angle between the magnetic field vector and true north, positive east*/
-					break;
-					case 2:
-					PrintElement = GeoMagneticElements.Incl;	/*2. Angle between the magnetic field vector and the horizontal plane, positive downward*/
-					break;
-					case 3:
-					PrintElement = GeoMagneticElements.F; 		/*3. Magnetic Field Strength*/
-					break;
-					case 4:
-					PrintElement = GeoMagneticElements.H; 		/*4. Horizontal Magnetic Field Strength*/
-					break;
-					case 5:
-					PrintElement = GeoMagneticElements.X; 		/*5. Northern component of the magnetic field vector*/
-					break;
-					case 6:
-					PrintElement = GeoMagneticElements.Y; 		/*6. Eastern component of the magnetic field vector*/
-					break;
-					case 7:
-					PrintElement = GeoMagneticElements.Z; 		/*7. Downward component of the magnetic field vector*/
-					break;
-					case 8:
-					PrintElement = GeoMagneticElements.GV; 		/*8. The Grid Variation*/
-					break;
-					case 9:
-					PrintElement = GeoMagneticElements.Decldot;	/*9. Yearly Rate of change in declination*/
-					break;
-					case 10:
-					PrintElement = GeoMagneticElements.Incldot;	/*10. Yearly Rate of change in inclination*/
-					break;
-					case 11:
-					PrintElement = GeoMagneticElements.Fdot; 	/*11. Yearly rate of change in Magnetic field strength*/
-					break;
-					case 12:
-					PrintElement = GeoMagneticElements.Hdot; 	/*12. Yearly rate of change in horizontal field strength*/
-					break;
-					case 13:
-					PrintElement = GeoMagneticElements.Xdot; 	/*13. Yearly rate of change in the northern component*/
-					break;
-					case 14:
-					PrintElement = GeoMagneticElements.Ydot; 	/*14. Yearly rate of change in the eastern component*/
-					break;
-					case 15:
-					PrintElement = GeoMagneticElements.Zdot; 	/*15. Yearly rate of change in the downward component*/
-					break;
-					case 16:
-					PrintElement = GeoMagneticElements.GVdot;	/*16. Yearly rate of chnage in grid variation*/;
-					break;
-					default:
-					PrintElement = GeoMagneticElements.Decl; 	/* 1. Angle between the magnetic field vector and true north, positive east*/
-					}
+	/* Size in bytes of the buffer WMM_GridFormatRow needs for one row of the job */
+{
+	size_t Cells = (size_t) Job->NumLongitudes * Job->NumYears;
 
-					if(Geoid->UseGeoid == 1)
-					{
-						if (PrintOption == 1) fprintf(fileout, "%5.2lf %6.2lf %8.4lf %7.2lf %10.2lf\n", minimum.phi, minimum.lambda, minimum.HeightAboveGeoid, StartDate.DecimalYear, PrintElement) ;
-						else  printf("%5.2lf %6.2lf %8.4lf %7.2lf %10.2lf\n", minimum.phi, minimum.lambda, minimum.HeightAboveGeoid, StartDate.DecimalYear, PrintElement);
-					}
-					else
-					{
-						if (PrintOption == 1) fprintf(fileout, "%5.2lf %6.2lf %8.4lf %7.2lf %10.2lf\n", minimum.phi, minimum.lambda, minimum.HeightAboveEllipsoid, StartDate.DecimalYear, PrintElement) ;
-						else  printf("%5.2lf %6.2lf %8.4lf %7.2lf %10.2lf\n", minimum.phi, minimum.lambda, minimum.HeightAboveEllipsoid, StartDate.DecimalYear, PrintElement);
-					}
+	if (Job->OutputFormat == WMM_GRID_FLOAT32)
+		return Cells * Job->NumElements * sizeof(float) + 1;
+	if (Job->OutputFormat == WMM_GRID_FLOAT64)
+		return Cells * Job->NumElements * sizeof(double) + 1;
+	return Cells * (WMM_GRID_LINE_LENGTH + Job->NumElements * WMM_GRID_COLUMN_LENGTH) + 1;
+} /*WMM_GridRowBufferSize*/
+
+size_t WMM_GridFormatRow(WMMtype_GridJob *Job, int Row, double *Values, char *Data)
 
+	/* Formats the values of a row computed by WMM_GridRow for output: the text lines of WMM_Grid
+	with one value column per element, or for the binary formats the values as float32 or float64 in
+	the native byte order, element after element as in Values.
 
+	INPUT: Job, Row, Values
+	OUTPUT: Data : WMM_GridRowBufferSize(Job) bytes
+	Returns the number of bytes to write.
+	CALLS : none
+	*/
+{
+	size_t Cells = (size_t) Job->NumLongitudes * Job->NumYears, k, Length = 0;
+	float Value32;
+	int i, j, e;
+
+	if (Job->OutputFormat == WMM_GRID_FLOAT64)
+	{
+		memcpy(Data, Values, Cells * Job->NumElements * sizeof(double));
+		return Cells * Job->NumElements * sizeof(double);
+	}
+	if (Job->OutputFormat == WMM_GRID_FLOAT32)
+	{
+		for (k = 0; k < Cells * Job->NumElements; k++)
+		{
+			Value32 = (float) Values[k];
+			memcpy(Data + k * sizeof(float), &Value32, sizeof(float));
+		}
+		return Cells * Job->NumElements * sizeof(float);
+	}
+	for (i = 0; i < Job->NumLongitudes; i++)
+		for (j = 0; j < Job->NumYears; j++)
+		{
+			Length += snprintf(Data + Length, WMM_GRID_LINE_LENGTH, "%5.2lf %6.2lf %8.4lf %7.2lf", Job->Latitudes[Row % Job->NumLatitudes],
+				Job->Longitudes[i], Job->Heights[Row / Job->NumLatitudes], Job->Years[j]);
+			for (e = 0; e < Job->NumElements; e++)
+				Length += snprintf(Data + Length, WMM_GRID_COLUMN_LENGTH, " %10.2lf", Values[(e * Job->NumLongitudes + i) * Job->NumYears + j]);
+			Data[Length++] = '\n';
+		}
+	return Length;
+} /*WMM_GridFormatRow*/
 
+int WMM_GridWriteHeader(WMMtype_GridJob *Job, FILE *fileout)
+
+	/* Writes the header and the axes of a binary grid file, padded up to Header.DataOffset.
+
+	INPUT: Job : with OutputFormat WMM_GRID_FLOAT32 or WMM_GRID_FLOAT64
+			fileout : binary file open for writing
+	OUTPUT: none
+	Returns TRUE on success, FALSE if the file could not be written.
+	CALLS : none
+	*/
+{
+	WMMtype_GridFileHeader Header;
+	char Padding[WMM_GRID_FILE_ALIGNMENT];
+	uint64_t Offset;
+	int i;
 
+	memset(&Header, 0, sizeof(Header));
+	memcpy(Header.Magic, WMM_GRID_FILE_MAGIC, sizeof(Header.Magic));
+	Header.Version = WMM_GRID_FILE_VERSION;
+	Header.ByteOrder = WMM_GRID_FILE_BYTE_ORDER;
+	Header.ValueSize = Job->OutputFormat == WMM_GRID_FLOAT32 ? sizeof(float) : sizeof(double);
+	Header.NumElements = Job->NumElements;
+	Header.NumHeights = Job->NumHeights;
+	Header.NumLatitudes = Job->NumLatitudes;
+	Header.NumLongitudes = Job->NumLongitudes;
+	Header.NumYears = Job->NumYears;
+	for (i = 0; i < Job->NumElements; i++)
+		Header.Elements[i] = Job->Elements[i];
+	Header.HeightAboveGeoid = (Job->Geoid->UseGeoid == 1);
+	strncpy(Header.ModelName, Job->MagneticModel->ModelName, sizeof(Header.ModelName) - 1);
+	Header.Epoch = Job->MagneticModel->epoch;
+	Header.EditionDate = Job->MagneticModel->EditionDate;
+	Offset = sizeof(Header) + sizeof(double) * ((uint64_t) Job->NumHeights + Job->NumLatitudes + Job->NumLongitudes + Job->NumYears);
+	Header.DataOffset = (Offset + WMM_GRID_FILE_ALIGNMENT - 1) / WMM_GRID_FILE_ALIGNMENT * WMM_GRID_FILE_ALIGNMENT;
+	memset(Padding, 0, sizeof(Padding));
+
+	if (fwrite(&Header, sizeof(Header), 1, fileout) != 1 ||
+		fwrite(Job->Heights, sizeof(double), Job->NumHeights, fileout) != (size_t) Job->NumHeights ||
+		fwrite(Job->Latitudes, sizeof(double), Job->NumLatitudes, fileout) != (size_t) Job->NumLatitudes ||
+		fwrite(Job->Longitudes, sizeof(double), Job->NumLongitudes, fileout) != (size_t) Job->NumLongitudes ||
+		fwrite(Job->Years, sizeof(double), Job->NumYears, fileout) != (size_t) Job->NumYears ||
+		fwrite(Padding, 1, (size_t) (Header.DataOffset - Offset), fileout) != (size_t) (Header.DataOffset - Offset))
+		return FALSE;
+	Job->DataOffset = Header.DataOffset;
+	return TRUE;
+} /*WMM_GridWriteHeader*/
 
-				} /* year loop */
+int WMM_GridWriteRow(WMMtype_GridJob *Job, FILE *fileout, char *Data, size_t Size)
 
-			} /*Longitude Loop */
+	/* Writes the rows formatted by WMM_GridFormatRow, in row order. Text rows are written as they are.
+	Binary rows hold a part of every element plane; these parts are staged in Job->PlaneBuffer for
+	as many consecutive rows as fit in about WMM_GRID_WRITE_BUFFER bytes, then each plane's part is
+	written with one seek and one write. Call with Data NULL after the last row to flush.
 
-		} /* Latitude Loop */
+	INPUT: Job : after WMM_GridWriteHeader for the binary formats
+			fileout
+			Data, Size : formatted row, or NULL
+	OUTPUT: none
+	Returns TRUE on success, FALSE if the file could not be written or the buffer allocated.
+	CALLS : none
+	*/
+{
+	size_t RowPlaneSize;
+	uint64_t PlaneSize, Offset;
+	int e;
 
-	} /* Altitude Loop */
-		if (PrintOption == 1)  fclose(fileout);
+	if (Job->OutputFormat == WMM_GRID_TEXT)
+		return Data == NULL || fwrite(Data, 1, Size, fileout) == Size;
 
+	RowPlaneSize = Size / Job->NumElements;
+	if (Data && Job->PlaneBuffer == NULL)
+	{
+		Job->PlaneRows = (int) (WMM_GRID_WRITE_BUFFER / (RowPlaneSize * Job->NumElements + 1)) + 1;
+		Job->PlaneBuffer = (char *) malloc( (size_t) Job->PlaneRows * RowPlaneSize * Job->NumElements + 1 );
+		Job->PlaneRowSize = RowPlaneSize;
+		if (Job->PlaneBuffer == NULL)
+			return FALSE;
+	}
+	if (Data)
+	{
+		for (e = 0; e < Job->NumElements; e++)
+			memcpy(Job->PlaneBuffer + ((size_t) e * Job->PlaneRows + Job->PlaneStagedRows) * RowPlaneSize, Data + e * RowPlaneSize, RowPlaneSize);
+		Job->PlaneStagedRows++;
+	}
+	if (Job->PlaneStagedRows > 0 && (Data == NULL || Job->PlaneStagedRows == Job->PlaneRows))
+	{
+		PlaneSize = (uint64_t) Job->NumRows * Job->PlaneRowSize;
+		for (e = 0; e < Job->NumElements; e++)
+		{
+			Offset = Job->DataOffset + (uint64_t) e * PlaneSize + (uint64_t) Job->PlaneFirstRow * Job->PlaneRowSize;
+			if (WMM_FSEEK(fileout, Offset) != 0 ||
+				fwrite(Job->PlaneBuffer + (size_t) e * Job->PlaneRows * Job->PlaneRowSize, Job->PlaneRowSize, Job->PlaneStagedRows, fileout) != (size_t) Job->PlaneStagedRows)
+				return FALSE;
+		}
+		Job->PlaneFirstRow += Job->PlaneStagedRows;
+		Job->PlaneStagedRows = 0;
+	}
+	return TRUE;
+} /*WMM_GridWriteRow*/
+
+int WMM_GridRowSeparable(WMMtype_GridJob *Job, int Row, WMMtype_Workspace *Workspace, double *Values)
+
+	/* WMM_GridRow for a grid whose heights are above the ellipsoid. The spherical latitude, radius and
+	so the Legendre functions are then the same for the whole row and are computed once, while
+	cos(m lambda) and sin(m lambda) come from the per longitude tables of the job. For every date the
+	n sums are folded per order m,
+			   nMax  (n+2)         m                                  m
+		ZG(m) = SUM (a/r)  (n+1) g  P,   ... , and Bz = - SUM [ZG(m) cos(m p) + ZH(m) sin(m p)]
+			   n=m             n  n                       m=0
+	so each cell costs an inner product over m instead of the full n/m triangle. As in WMM_GridRow
+	the sums are those of the epoch model, and the dates are combined by WMM_TimeSeriesElements.
+	The results equal those of WMM_GridRow up to rounding.
+
+	INPUT: Job, Row, Workspace, as WMM_GridRow
+	OUTPUT: Values, as WMM_GridRow
+	Returns TRUE, or FALSE if the row must be computed cell by cell instead
+	(geographic poles, or out of memory).
+	CALLS : WMM_GeodeticToSpherical
+			WMM_ComputeSphericalHarmonicVariables
+			WMM_AssociatedLegendreFunctionWithWorkspace
+			WMM_RotateMagneticVector
+			WMM_TimeSeriesElements
+			WMM_CalculateGridVariation
+			WMM_GridElement
+	*/
+{
+	WMMtype_CoordGeodetic CoordGeodetic;
+	WMMtype_CoordSpherical CoordSpherical;
+	WMMtype_MagneticResults MagneticResultsSph, MagneticResultsGeo, MagneticResultsSphVar, MagneticResultsGeoVar;
+	WMMtype_SphericalHarmonicVariables SphVariables;
+	WMMtype_GeoMagneticElements GeoMagneticElements;
+	WMMtype_MagneticModel *EpochMagneticModel = Job->EpochMagneticModel;
+	double *Sums, *S, *c, *s, cos_phi, R, P, dP;
+	int i, j, e, m, n, index, nMax, nMaxSum, GridVariation = FALSE;
+
+	nMax = Job->MagneticModel->nMax;
+	for (e = 0; e < Job->NumElements; e++)
+		if (Job->Elements[e] == 8)
+			GridVariation = TRUE;
+	CoordGeodetic.HeightAboveGeoid = Job->Heights[Row / Job->NumLatitudes];
+	CoordGeodetic.HeightAboveEllipsoid = CoordGeodetic.HeightAboveGeoid;
+	CoordGeodetic.phi = Job->Latitudes[Row % Job->NumLatitudes];
+	CoordGeodetic.lambda = Job->Longitudes[0];
+	WMM_GeodeticToSpherical(Job->Ellip, CoordGeodetic, &CoordSpherical);
+	cos_phi = cos ( DEG2RAD ( CoordSpherical.phig ) );
+	if ( fabs(cos_phi) <= 1.0e-10 || Job->MagneticModel->nMaxSecVar > nMax )
+		return FALSE;	/* By needs the special summation at the poles */
 
-   WMM_FreeMagneticModelMemory(TimedMagneticModel);
-   WMM_FreeLegendreMemory(LegendreFunction);
+	/* 12 sums per order m: ZG, ZH, YG, YH, XG, XH for the main field then for the secular variation */
+	Sums = (double *) calloc( (size_t) 12 * (nMax + 1), sizeof(double) );
+	if (!Sums)
+		return FALSE;
 
-  return TRUE;
-	} /*WMM_Grid*/
+	WMM_ComputeSphericalHarmonicVariables( Job->Ellip, CoordSpherical, nMax, &SphVariables); /* Only the radius powers are used */
+	WMM_AssociatedLegendreFunctionWithWorkspace(CoordSpherical, nMax, Workspace);  	/* Compute ALF  Equations 5-6, WMM Technical report*/
+	nMaxSum = EpochMagneticModel->nMax > EpochMagneticModel->nMaxSecVar ? EpochMagneticModel->nMax : EpochMagneticModel->nMaxSecVar;
+	for (n = 1; n <= nMaxSum; n++)
+	{
+		R = SphVariables.RelativeRadiusPower[n];
+		for (m = 0; m <= n; m++)
+		{
+			index = (n * (n + 1) / 2 + m);
+			S = &Sums[m * 12];
+			P = Workspace->LegendreFunction.Pcup[index];
+			dP = Workspace->LegendreFunction.dPcup[index];
+			if (n <= EpochMagneticModel->nMax)
+			{
+				S[0] += R * (double) (n+1) * P * EpochMagneticModel->Main_Field_Coeff_G[index];
+				S[1] += R * (double) (n+1) * P * EpochMagneticModel->Main_Field_Coeff_H[index];
+				S[2] += R * (double) (m) * P * EpochMagneticModel->Main_Field_Coeff_G[index];
+				S[3] += R * (double) (m) * P * EpochMagneticModel->Main_Field_Coeff_H[index];
+				S[4] += R * dP * EpochMagneticModel->Main_Field_Coeff_G[index];
+				S[5] += R * dP * EpochMagneticModel->Main_Field_Coeff_H[index];
+			}
+			if (n <= EpochMagneticModel->nMaxSecVar)
+			{
+				S[6] += R * (double) (n+1) * P * EpochMagneticModel->Secular_Var_Coeff_G[index];
+				S[7] += R * (double) (n+1) * P * EpochMagneticModel->Secular_Var_Coeff_H[index];
+				S[8] += R * (double) (m) * P * EpochMagneticModel->Secular_Var_Coeff_G[index];
+				S[9] += R * (double) (m) * P * EpochMagneticModel->Secular_Var_Coeff_H[index];
+				S[10] += R * dP * EpochMagneticModel->Secular_Var_Coeff_G[index];
+				S[11] += R * dP * EpochMagneticModel->Secular_Var_Coeff_H[index];
+			}
+		}
+	}
+
+	for (i = 0; i < Job->NumLongitudes; i++)
+	{
+		CoordGeodetic.lambda = Job->Longitudes[i];
+		CoordSpherical.lambda = CoordGeodetic.lambda;
+		c = &Job->cos_mlambda[i * (nMax + 1)];
+		s = &Job->sin_mlambda[i * (nMax + 1)];
+		MagneticResultsSph.Bx = MagneticResultsSph.By = MagneticResultsSph.Bz = 0.0;
+		MagneticResultsSphVar.Bx = MagneticResultsSphVar.By = MagneticResultsSphVar.Bz = 0.0;
+		for (m = 0; m <= nMax; m++)
+		{
+			S = &Sums[m * 12];
+			MagneticResultsSph.Bz -= S[0] * c[m] + S[1] * s[m];
+			MagneticResultsSph.By += S[2] * s[m] - S[3] * c[m];
+			MagneticResultsSph.Bx -= S[4] * c[m] + S[5] * s[m];
+			MagneticResultsSphVar.Bz -= S[6] * c[m] + S[7] * s[m];
+			MagneticResultsSphVar.By += S[8] * s[m] - S[9] * c[m];
+			MagneticResultsSphVar.Bx -= S[10] * c[m] + S[11] * s[m];
+		}
+		MagneticResultsSph.By /= cos_phi;
+		MagneticResultsSphVar.By /= cos_phi;
+		WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSph, &MagneticResultsGeo); /* Map the computed Magnetic fields to Geodeitic coordinates Equation 16 , WMM Technical report */
+		WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSphVar, &MagneticResultsGeoVar); /* Map the secular variation field components to Geodetic coordinates, Equation 17 , WMM Technical report*/
+		for (j = 0; j < Job->NumYears; j++)
+		{
+			WMM_TimeSeriesElements(MagneticResultsGeo, MagneticResultsGeoVar, Job->Years[j] - EpochMagneticModel->epoch, &GeoMagneticElements); /* Elements of the date, Equations 18-19, WMM Technical report */
+			if (GridVariation)
+				WMM_CalculateGridVariation(CoordGeodetic, &GeoMagneticElements);
+			for (e = 0; e < Job->NumElements; e++)
+				Values[(e * Job->NumLongitudes + i) * Job->NumYears + j] = WMM_GridElement(&GeoMagneticElements, Job->Elements[e]);
+		}
+	}
+	free(Sums);
+	return TRUE;
+} /*WMM_GridRowSeparable*/
+
+void *WMM_GridWorker(void *JobPointer)
+
+	/* Thread routine of WMM_GridParallel. Takes the next row of the job, computes it and hands
+	it to the writer, until all rows are taken or the job failed.
+	CALLS : WMM_AllocateWorkspace, WMM_GridRow, WMM_GridFormatRow
+	*/
+{
+#if WMM_THREADS
+	WMMtype_GridJob *Job = (WMMtype_GridJob *) JobPointer;
+	WMMtype_Workspace *Workspace;
+	double *Values;
+	char *Data;
+	size_t Size = 0;
+	int Row;
+
+	Workspace = WMM_AllocateWorkspace(Job->MagneticModel->nMax);
+	Values = (double *) malloc( ((size_t) Job->NumLongitudes * Job->NumYears * Job->NumElements + 1) * sizeof(double) );
+	if (!Workspace || !Values)
+	{
+		WMM_FreeWorkspace(Workspace);
+		free(Values);
+		pthread_mutex_lock(&Job->Lock);
+		Job->Status = FALSE;
+		pthread_cond_broadcast(&Job->RowReady);
+		pthread_mutex_unlock(&Job->Lock);
+		return NULL;
+	}
+	for (;;)
+	{
+		pthread_mutex_lock(&Job->Lock);
+		while (Job->NextRow < Job->NumRows && Job->NextRow >= Job->RowsWritten + Job->Window)
+			pthread_cond_wait(&Job->RowWritten, &Job->Lock);
+		Row = Job->NextRow;
+		if (Row < Job->NumRows)
+			Job->NextRow++;
+		pthread_mutex_unlock(&Job->Lock);
+		if (Row >= Job->NumRows)
+			break;
+
+		Data = (char *) malloc( WMM_GridRowBufferSize(Job) );
+		if (Data)
+		{
+			WMM_GridRow(Job, Row, Workspace, Values);
+			Size = WMM_GridFormatRow(Job, Row, Values, Data);
+		}
+
+		pthread_mutex_lock(&Job->Lock);
+		if (Data)
+		{
+			Job->RowData[Row] = Data;
+			Job->RowSize[Row] = Size;
+		}
+		else
+			Job->Status = FALSE;
+		pthread_cond_broadcast(&Job->RowReady);
+		pthread_mutex_unlock(&Job->Lock);
+		if (!Data)
+			break;
+	}
+	WMM_FreeWorkspace(Workspace);
+	free(Values);
+#else
+	(void) JobPointer;
+#endif
+	return NULL;
+} /*WMM_GridWorker*/
 
 
 
@@ -1745,8 +3356,8 @@ WMMtype_MagneticModel *WMM_AllocateModelMemory(int NumTerms)
 				int nMaxSecVar; Maxumum degree of spherical harmonic secular model
 				int SecularVariationUsed; Whether or not the magnetic secular variation vector will be needed by program
 
-				FALSE: Failed to allocate memory
-	CALLS : none
+				FALSE: Failed to allocate memory; nothing is left allocated
+	CALLS : WMM_FreeMagneticModelMemory
 	*/
 	{
 	WMMtype_MagneticModel *MagneticModel;
@@ -1766,6 +3377,7 @@ WMMtype_MagneticModel *WMM_AllocateModelMemory(int NumTerms)
 	{
 		WMM_Error(2);
 		//printf("error allocating in WMM_AllocateModelMemory\n");
+		WMM_FreeMagneticModelMemory(MagneticModel);
 		return FALSE;
 	}
 
@@ -1775,6 +3387,7 @@ WMMtype_MagneticModel *WMM_AllocateModelMemory(int NumTerms)
 	{
 		WMM_Error(2);
 		//printf("error allocating in WMM_AllocateModelMemory\n");
+		WMM_FreeMagneticModelMemory(MagneticModel);
 		return FALSE;
 	}
 	MagneticModel->Secular_Var_Coeff_G =  (double *) 	malloc	( (NumTerms +1) * sizeof ( double ) );
@@ -1782,6 +3395,7 @@ WMMtype_MagneticModel *WMM_AllocateModelMemory(int NumTerms)
 	{
 		WMM_Error(2);
 		//printf("error allocating in WMM_AllocateModelMemory\n");
+		WMM_FreeMagneticModelMemory(MagneticModel);
 		return FALSE;
 	}
 	MagneticModel->Secular_Var_Coeff_H =  (double *) 	malloc	( (NumTerms +1) * sizeof ( double ) );
@@ -1789,12 +3403,105 @@ WMMtype_MagneticModel *WMM_AllocateModelMemory(int NumTerms)
 	{
 		WMM_Error(2);
 		//printf("error allocating in WMM_AllocateModelMemory\n");
+		WMM_FreeMagneticModelMemory(MagneticModel);
 		return FALSE;
 	}
+
+	/* Coefficient tables, filled by WMM_ComputeCoefficientTables once the model is read */
+	MagneticModel->Main_Field_Coeff_GS =  (double *) 	malloc	( (NumTerms +1) * sizeof ( double ) );
+	MagneticModel->Main_Field_Coeff_HS =  (double *) 	malloc	( (NumTerms +1) * sizeof ( double ) );
+	MagneticModel->Secular_Var_Coeff_GS =  (double *) 	malloc	( (NumTerms +1) * sizeof ( double ) );
+	MagneticModel->Secular_Var_Coeff_HS =  (double *) 	malloc	( (NumTerms +1) * sizeof ( double ) );
+	MagneticModel->SchmidtQuasiNorm =  (double *) 	malloc	( (NumTerms +1) * sizeof ( double ) );
+	MagneticModel->RecursionCoeff =  (double *) 	malloc	( (NumTerms +1) * sizeof ( double ) );
+	if (!MagneticModel->Main_Field_Coeff_GS || !MagneticModel->Main_Field_Coeff_HS || !MagneticModel->Secular_Var_Coeff_GS ||
+		!MagneticModel->Secular_Var_Coeff_HS || !MagneticModel->SchmidtQuasiNorm || !MagneticModel->RecursionCoeff)
+	{
+		WMM_Error(2);
+		WMM_FreeMagneticModelMemory(MagneticModel);
+		return FALSE;
+	}
+	MagneticModel->CoefficientTablesNMax = 0;
 	return MagneticModel;
 
 	} /*WMM_AllocateModelMemory*/
 
+WMMtype_Workspace *WMM_AllocateWorkspace(int nMax)
+
+	/* Allocate a reusable evaluation workspace for models up to degree nMax.
+	The workspace owns the Legendre function buffers, the Schmidt quasi-normalization
+	table, the WMM_PcupHigh recursion tables and the scratch space of the polar summations.
+	The tables depend only on nMax and are computed here once. The workspace also holds
+	the time modified models used by the batch functions (see WMM_SetWorkspaceDate) and the
+	single precision buffers of WMM_ContextGeomagBatchFloat.
+	A workspace must not be shared between threads; allocate one per thread and pass it
+	to WMM_GeomagWithWorkspace or WMM_GeomagBatch.
+
+	  INPUT: nMax : int : Maximum degree of spherical harmonic model
+
+	 OUTPUT:    Pointer to data structure WMMtype_Workspace
+
+				FALSE: Failed to allocate memory
+	CALLS : WMM_SchmidtQuasiNormFactors, WMM_PcupHighFactors
+	*/
+	{
+	WMMtype_Workspace *Workspace;
+	int NumTerms, n, m;
+
+	NumTerms = ( ( nMax + 1 ) * ( nMax + 2 ) / 2 );
+
+	Workspace = (WMMtype_Workspace *) calloc(1, sizeof(WMMtype_Workspace));
+	if (!Workspace) {
+		WMM_Error(25);
+		return FALSE;
+					}
+	Workspace->nMax = nMax;
+	Workspace->NumTerms = NumTerms;
+
+	Workspace->LegendreFunction.Pcup = (double *) malloc ( (NumTerms +1) * sizeof ( double ) );
+	Workspace->LegendreFunction.dPcup = (double *) malloc ( (NumTerms +1) * sizeof ( double ) );
+	Workspace->SchmidtQuasiNorm = (double *) malloc ( (NumTerms +1) * sizeof ( double ) );
+	Workspace->PreSqr = (double *) malloc ( (2 * nMax + 2) * sizeof ( double ) );
+	Workspace->f1 = (double *) malloc ( (NumTerms +1) * sizeof ( double ) );
+	Workspace->f2 = (double *) malloc ( (NumTerms +1) * sizeof ( double ) );
+	Workspace->PcupS = (double *) malloc ( (nMax +1) * sizeof ( double ) );
+	Workspace->PcupBlock = (double *) malloc ( (NumTerms +1) * WMM_SIMD_LANES * sizeof ( double ) );
+	Workspace->dPcupBlock = (double *) malloc ( (NumTerms +1) * WMM_SIMD_LANES * sizeof ( double ) );
+	Workspace->RelativeRadiusPowerBlock = (double *) malloc ( (nMax +1) * WMM_SIMD_LANES * sizeof ( double ) );
+	Workspace->cos_mlambdaBlock = (double *) malloc ( (nMax +1) * WMM_SIMD_LANES * sizeof ( double ) );
+	Workspace->sin_mlambdaBlock = (double *) malloc ( (nMax +1) * WMM_SIMD_LANES * sizeof ( double ) );
+	Workspace->TimedMagneticModel = WMM_AllocateModelMemory(NumTerms);
+	Workspace->TimedCache[0] = Workspace->TimedMagneticModel;
+	Workspace->TimedSource = NULL;
+	Workspace->FloatCoeff = (WMMtype_Float *) malloc ( 5 * NumTerms * sizeof ( WMMtype_Float ) );
+	Workspace->PcupFloat = (WMMtype_Float *) malloc ( (NumTerms +1) * WMM_FLOAT_LANES * sizeof ( WMMtype_Float ) );
+	Workspace->dPcupFloat = (WMMtype_Float *) malloc ( (NumTerms +1) * WMM_FLOAT_LANES * sizeof ( WMMtype_Float ) );
+	Workspace->RelativeRadiusPowerFloat = (WMMtype_Float *) malloc ( (nMax +1) * WMM_FLOAT_LANES * sizeof ( WMMtype_Float ) );
+	Workspace->cos_mlambdaFloat = (WMMtype_Float *) malloc ( (nMax +1) * WMM_FLOAT_LANES * sizeof ( WMMtype_Float ) );
+	Workspace->sin_mlambdaFloat = (WMMtype_Float *) malloc ( (nMax +1) * WMM_FLOAT_LANES * sizeof ( WMMtype_Float ) );
+	Workspace->FloatSource = NULL;
+
+	if (!Workspace->LegendreFunction.Pcup || !Workspace->LegendreFunction.dPcup || !Workspace->SchmidtQuasiNorm ||
+		!Workspace->PreSqr || !Workspace->f1 || !Workspace->f2 || !Workspace->PcupS || !Workspace->TimedMagneticModel ||
+		!Workspace->PcupBlock || !Workspace->dPcupBlock || !Workspace->RelativeRadiusPowerBlock ||
+		!Workspace->cos_mlambdaBlock || !Workspace->sin_mlambdaBlock || !Workspace->FloatCoeff || !Workspace->PcupFloat ||
+		!Workspace->dPcupFloat || !Workspace->RelativeRadiusPowerFloat || !Workspace->cos_mlambdaFloat || !Workspace->sin_mlambdaFloat)
+	{
+		WMM_Error(25);
+		WMM_FreeWorkspace(Workspace);
+		return FALSE;
+	}
+
+	WMM_SchmidtQuasiNormFactors(Workspace->SchmidtQuasiNorm, nMax);
+	WMM_PcupHighFactors(Workspace->PreSqr, Workspace->f1, Workspace->f2, nMax);
+	for (n = 0; n <= nMax; n++)
+		for (m = 0; m <= n; m++)	/* k(n,m) of WMM_ComputeCoefficientTables, for the single precision engine */
+			Workspace->FloatCoeff[4 * NumTerms + n * (n + 1) / 2 + m] = (WMMtype_Float) (m <= n - 2 ?
+				(double)( ( ( n - 1 ) * ( n - 1 ) ) - ( m * m ) ) / ( double ) ( ( 2 * n - 1 ) * ( 2 * n - 3 ) ) : 0.0);
+
+	return Workspace;
+	} /*WMM_AllocateWorkspace*/
+
 int WMM_PcupHigh(double *Pcup, double *dPcup, double x, int nMax)
 
 /*	This function evaluates all of the Schmidt-semi normalized associated Legendre
@@ -1838,9 +3545,8 @@ int WMM_PcupHigh(double *Pcup, double *dPcup, double x, int nMax)
   The derivates can't be computed for latitude = |90| degrees.
 	*/
 	{
-	double  pm2, pm1, pmm, plm, rescalem, z, scalef;
 	double *f1, *f2, *PreSqr;
-	int k, kstart, m, n, NumTerms, astat[3];
+	int NumTerms, FLAG;
 
 	NumTerms = ( ( nMax + 1 ) * ( nMax + 2 ) / 2 );
 
@@ -1879,7 +3585,32 @@ int WMM_PcupHigh(double *Pcup, double *dPcup, double x, int nMax)
 		return FALSE;
 	}
 
-	scalef = 1.0e-280;
+	WMM_PcupHighFactors(PreSqr, f1, f2, nMax);
+	FLAG = WMM_PcupHighWithFactors(Pcup, dPcup, x, nMax, PreSqr, f1, f2);
+
+	free(f1);
+	free(PreSqr);
+	free(f2);
+
+	return FLAG ;
+} /* WMM_PcupHigh */
+
+int WMM_PcupHighFactors(double *PreSqr, double *f1, double *f2, int nMax)
+
+/*	Computes the tables used by the WMM_PcupHigh recursion. They depend only on nMax
+	and may be computed once and reused for every evaluation.
+
+		INPUT
+			nMax:	 Maximum spherical harmonic degree to compute.
+
+		OUTPUT
+			PreSqr:	sqrt(n) for n = 0 ... 2*nMax+1
+			f1, f2:	Recursion coefficients, (nMax+1)*(nMax+2)/2+1 elements each
+
+		CALLS : none
+	*/
+	{
+	int k, m, n;
 
 	for(n = 0 ; n <= 2*nMax+1 ; ++n )
 	{
@@ -1901,6 +3632,37 @@ int WMM_PcupHigh(double *Pcup, double *dPcup, double x, int nMax)
 		}
 		k = k + 2;
 	}
+	return TRUE;
+} /* WMM_PcupHighFactors */
+
+int WMM_PcupHighWithFactors(double *Pcup, double *dPcup, double x, int nMax, double *PreSqr, double *f1, double *f2)
+
+/*	Same as WMM_PcupHigh, but uses the tables computed by WMM_PcupHighFactors
+	instead of allocating and computing them on every call.
+
+		INPUT
+			nMax:	 Maximum spherical harmonic degree to compute.
+			x:		cos(colatitude) or sin(latitude).
+			PreSqr, f1, f2: Tables from WMM_PcupHighFactors for at least nMax
+
+		OUTPUT
+			Pcup:	A vector of all associated Legendgre polynomials evaluated at
+					x up to nMax.
+		  dPcup:   Derivative of Pcup(x) with respect to latitude
+
+		CALLS : none
+	*/
+	{
+	double  pm2, pm1, pmm, plm, rescalem, z, scalef;
+	int k, kstart, m, n;
+
+	if (fabs(x) == 1.0)
+	{
+	  printf("Error in PcupHigh: derivative cannot be calculated at poles\n");
+	  return FALSE;
+	}
+
+	scalef = 1.0e-280;
 
 	/*z = sin (geocentric latitude) */
 	z = sqrt((1.0-x)*(1.0+x));
@@ -1961,12 +3723,9 @@ int WMM_PcupHigh(double *Pcup, double *dPcup, double x, int nMax)
 	pmm =  pmm  / PreSqr[2*nMax];
 	Pcup[kstart] = pmm * rescalem;
 	dPcup[kstart] = -(double)(nMax) * x * Pcup[kstart] / z;
-	free(f1);
-	free(PreSqr);
-	free(f2);
 
 	return TRUE ;
-} /* WMM_PcupHigh */
+} /* WMM_PcupHighWithFactors */
 
 int WMM_PcupLow( double *Pcup, double *dPcup, double x, int nMax)
 
@@ -1994,12 +3753,8 @@ int WMM_PcupLow( double *Pcup, double *dPcup, double x, int nMax)
   the Associated Legendre Functions.
 */
 {
-	int n, m, index, index1, index2, NumTerms;
-	double k, z, *schmidtQuasiNorm;
-	Pcup[0] = 1.0;
-	dPcup[0] = 0.0;
-		/*sin (geocentric latitude) - sin_phi */
-	z = sqrt( ( 1.0 - x ) * ( 1.0 + x ) ) ;
+	int NumTerms, FLAG;
+	double *schmidtQuasiNorm;
 
 	NumTerms = ( ( nMax + 1 ) * ( nMax + 2 ) / 2 );
 	schmidtQuasiNorm  =   	(double *) 	malloc	( (NumTerms +1 )* sizeof ( double ) );
@@ -2011,6 +3766,39 @@ int WMM_PcupLow( double *Pcup, double *dPcup, double x, int nMax)
 		return FALSE;
 	}
 
+	WMM_SchmidtQuasiNormFactors(schmidtQuasiNorm, nMax);
+	FLAG = WMM_PcupLowWithNorm(Pcup, dPcup, x, nMax, schmidtQuasiNorm);
+
+	if(schmidtQuasiNorm)
+		free(schmidtQuasiNorm);
+	return FLAG;
+}   /*WMM_PcupLow */
+
+int WMM_PcupLowWithNorm( double *Pcup, double *dPcup, double x, int nMax, double *schmidtQuasiNorm)
+
+/*   Same as WMM_PcupLow, but uses the Schmidt quasi-normalization ratios
+	computed by WMM_SchmidtQuasiNormFactors instead of allocating and
+	computing them on every call.
+
+	Calling Parameters:
+		INPUT
+			nMax:	 Maximum spherical harmonic degree to compute.
+			x:		cos(colatitude) or sin(latitude).
+			schmidtQuasiNorm: Ratios from WMM_SchmidtQuasiNormFactors for at least nMax
+
+		OUTPUT
+			Pcup:	A vector of all associated Legendgre polynomials evaluated at
+					x up to nMax.
+		   dPcup: Derivative of Pcup(x) with respect to latitude
+*/
+{
+	int n, m, index, index1, index2;
+	double k, z;
+	Pcup[0] = 1.0;
+	dPcup[0] = 0.0;
+		/*sin (geocentric latitude) - sin_phi */
+	z = sqrt( ( 1.0 - x ) * ( 1.0 + x ) ) ;
+
 	/*	 First,	Compute the Gauss-normalized associated Legendre  functions*/
 	for (n = 1; n <=  nMax; n++)
 	{
@@ -2047,27 +3835,6 @@ int WMM_PcupLow( double *Pcup, double *dPcup, double x, int nMax)
 			}
 		}
 	}
-/*Compute the ration between the Gauss-normalized associated Legendre
-  functions and the Schmidt quasi-normalized version. This is equivalent to
-  sqrt((m==0?1:2)*(n-m)!/(n+m!))*(2n-1)!!/(n-m)!  */
-
-	schmidtQuasiNorm[0] = 1.0;
-	for (n = 1; n <= nMax; n++)
-	{
-		index = (n * (n + 1) / 2);
-		index1 = (n - 1)  * n / 2 ;
-		/* for m = 0 */
-		schmidtQuasiNorm[index] =  schmidtQuasiNorm[index1] * (double) (2 * n - 1) / (double) n;
-
-		for ( m = 1; m <= n; m++)
-		{
-			index = (n * (n + 1) / 2 + m);
-			index1 = (n * (n + 1) / 2 + m - 1);
-			schmidtQuasiNorm[index] = schmidtQuasiNorm[index1] * sqrt( (double) ((n - m + 1) * (m == 1 ? 2 : 1)) / (double) (n + m));
-		}
-
-	}
-
 /* Converts the  Gauss-normalized associated Legendre
 	  functions to the Schmidt quasi-normalized version using pre-computed
 	  relation stored in the variable schmidtQuasiNorm */
@@ -2084,50 +3851,254 @@ int WMM_PcupLow( double *Pcup, double *dPcup, double x, int nMax)
 		}
 	}
 
-	if(schmidtQuasiNorm)
-		free(schmidtQuasiNorm);
 	return TRUE;
-}   /*WMM_PcupLow */
+}   /*WMM_PcupLowWithNorm */
 
+int WMM_PcupLowWithTables( double *Pcup, double *dPcup, double x, int nMax, double *RecursionCoeff)
 
-void WMM_PrintUserData(WMMtype_GeoMagneticElements GeomagElements, WMMtype_CoordGeodetic SpaceInput, WMMtype_Date TimeInput, WMMtype_MagneticModel *MagneticModel, WMMtype_Geoid *Geoid)
-	/* This function prints the results in  Geomagnetic Elements for a point calculation. It takes the calculated
-	*  Geomagnetic elements "GeomagElements" as input.
-	*  As well as the coordinates, date, and Magnetic Model.
-	INPUT :  GeomagElements : Data structure WMMtype_GeoMagneticElements with the following elements
-				double Decl; (Angle between the magnetic field vector and true north, positive east)
-				double Incl; Angle between the magnetic field vector and the horizontal plane, positive down
-				double F; Magnetic Field Strength
-				double H; Horizontal Magnetic Field Strength
-				double X; Northern component of the magnetic field vector
-				double Y; Eastern component of the magnetic field vector
-				double Z; Downward component of the magnetic field vector4
-				double Decldot; Yearly Rate of change in declination
-				double Incldot; Yearly Rate of change in inclination
-				double Fdot; Yearly rate of change in Magnetic field strength
-				double Hdot; Yearly rate of change in horizontal field strength
-				double Xdot; Yearly rate of change in the northern component
-				double Ydot; Yearly rate of change in the eastern component
-				double Zdot; Yearly rate of change in the downward component
-				double GVdot;Yearly rate of chnage in grid variation
-		CoordGeodetic Pointer to the  data  structure with the following elements
-				double lambda; (longitude)
-				double phi; ( geodetic latitude)
-				double HeightAboveEllipsoid; (height above the ellipsoid (HaE) )
-				double HeightAboveGeoid;(height above the Geoid )
-		TimeInput :  data structure WMMtype_Date with the following elements
-				int	Year;
-				int	Month;
-				int	Day;
-				double DecimalYear;      decimal years
-		MagneticModel :	 data structure with the following elements
-				double EditionDate;
-				double epoch;       Base time of Geomagnetic model epoch (yrs)
-				char  ModelName[20];
-				double *Main_Field_Coeff_G;          C - Gauss coefficients of main geomagnetic model (nT)
-				double *Main_Field_Coeff_H;          C - Gauss coefficients of main geomagnetic model (nT)
-				double *Secular_Var_Coeff_G;  CD - Gauss coefficients of secular geomagnetic model (nT/yr)
-				double *Secular_Var_Coeff_H;  CD - Gauss coefficients of secular geomagnetic model (nT/yr)
+/*   Evaluates the Gauss-normalized associated Legendre functions and their derivatives
+	with respect to latitude up to degree nMax, using the recursion coefficients of
+	WMM_ComputeCoefficientTables. The Schmidt quasi-normalization is not applied here;
+	the functions must be combined with the Schmidt scaled coefficients
+	(Main_Field_Coeff_GS etc.). With the coefficients precomputed, each term is a
+	multiply-add chain without divisions.
+
+	Calling Parameters:
+		INPUT
+			nMax:	 Maximum spherical harmonic degree to compute.
+			x:		cos(colatitude) or sin(latitude).
+			RecursionCoeff: k(n,m) table of the model, for at least nMax
+
+		OUTPUT
+			Pcup:	Gauss-normalized associated Legendre functions evaluated at x up to nMax.
+		   dPcup: Derivative of Pcup(x) with respect to latitude
+
+	Notes: Same range of validity as WMM_PcupLow. Must not be used at the geographic poles
+	together with WMM_SummationSpecial, which expects the unscaled coefficients.
+*/
+{
+	int n, m, index, index1, index2;
+	double z, k;
+
+	WMM_STATS_BEGIN(WMM_STAT_LEGENDRE);
+	Pcup[0] = 1.0;
+	dPcup[0] = 0.0;
+		/*sin (geocentric latitude) - sin_phi */
+	z = sqrt( ( 1.0 - x ) * ( 1.0 + x ) ) ;
+
+	for (n = 1; n <=  nMax; n++)
+	{
+		/* m < n : P(n,m) = x P(n-1,m) - k(n,m) P(n-2,m). k is zero for m = n-1, and the
+		index of the P(n-2,m) term is then only required to be valid. */
+		for (m = 0; m < n; m++)
+		{
+			index = (n * (n + 1) / 2 + m);
+			index1 = (n > 1 ? ( n - 2 ) * ( n - 1 ) / 2 + m : 0);
+			index2 = ( n - 1) * n / 2 + m;
+			k = RecursionCoeff[index];
+			Pcup[index]  = x *  Pcup[index2]  - k  *  Pcup[index1];
+			dPcup[index] = x *  dPcup[index2] + z *  Pcup[index2] - k *  dPcup[index1];
+		}
+		/* m = n : P(n,n) = z P(n-1,n-1) */
+		index = (n * (n + 1) / 2 + n);
+		index1 = ( n - 1 ) * n / 2 + n - 1;
+		Pcup[index]  = z * Pcup[index1];
+		dPcup[index] = z *  dPcup[index1] - x *  Pcup[index1];
+	}
+	WMM_STATS_END(WMM_STAT_LEGENDRE);
+	return TRUE;
+}   /*WMM_PcupLowWithTables */
+
+int WMM_PcupLowWithTablesBlock( double *Pcup, double *dPcup, double *x, int nMax, double *RecursionCoeff)
+
+/*   Same as WMM_PcupLowWithTables for WMM_SIMD_LANES points at once. The functions are stored
+	interleaved, element [index * WMM_SIMD_LANES + lane], which is the layout expected by the
+	block summation kernels.
+
+	Calling Parameters:
+		INPUT
+			nMax:	 Maximum spherical harmonic degree to compute.
+			x:		sin(latitude) of WMM_SIMD_LANES points.
+			RecursionCoeff: k(n,m) table of the model, for at least nMax
+
+		OUTPUT
+			Pcup:	Gauss-normalized associated Legendre functions, (nMax+1)*(nMax+2)/2 * WMM_SIMD_LANES elements
+		   dPcup: Derivatives of Pcup(x) with respect to latitude
+*/
+{
+	int n, m, p, index, index1, index2;
+	double z[WMM_SIMD_LANES], k;
+
+	WMM_STATS_BEGIN(WMM_STAT_LEGENDRE);
+
+	for (p = 0; p < WMM_SIMD_LANES; p++)
+	{
+		Pcup[p] = 1.0;
+		dPcup[p] = 0.0;
+		z[p] = sqrt( ( 1.0 - x[p] ) * ( 1.0 + x[p] ) ) ;
+	}
+
+	for (n = 1; n <=  nMax; n++)
+	{
+		for (m = 0; m < n; m++)
+		{
+			index = (n * (n + 1) / 2 + m) * WMM_SIMD_LANES;
+			index1 = (n > 1 ? ( n - 2 ) * ( n - 1 ) / 2 + m : 0) * WMM_SIMD_LANES;
+			index2 = (( n - 1) * n / 2 + m) * WMM_SIMD_LANES;
+			k = RecursionCoeff[n * (n + 1) / 2 + m];
+			for (p = 0; p < WMM_SIMD_LANES; p++)
+			{
+				Pcup[index + p]  = x[p] *  Pcup[index2 + p]  - k  *  Pcup[index1 + p];
+				dPcup[index + p] = x[p] *  dPcup[index2 + p] + z[p] *  Pcup[index2 + p] - k *  dPcup[index1 + p];
+			}
+		}
+		index = (n * (n + 1) / 2 + n) * WMM_SIMD_LANES;
+		index1 = (( n - 1 ) * n / 2 + n - 1) * WMM_SIMD_LANES;
+		for (p = 0; p < WMM_SIMD_LANES; p++)
+		{
+			Pcup[index + p]  = z[p] * Pcup[index1 + p];
+			dPcup[index + p] = z[p] *  dPcup[index1 + p] - x[p] *  Pcup[index1 + p];
+		}
+	}
+	WMM_STATS_END(WMM_STAT_LEGENDRE);
+	return TRUE;
+}   /*WMM_PcupLowWithTablesBlock */
+
+int WMM_PcupLowWithTablesFloatBlock( WMMtype_Float *Pcup, WMMtype_Float *dPcup, const WMMtype_Float *x, const WMMtype_Float *z, int nMax, const WMMtype_Float *RecursionCoeff)
+
+/*   WMM_PcupLowWithTablesBlock in single precision, for WMM_FLOAT_LANES points. The cosine of the
+	latitude is an input: near the poles (1 - x)(1 + x) is below the resolution of float, and
+	the caller rounds the double value instead.
+
+	Calling Parameters:
+		INPUT
+			nMax:	 Maximum spherical harmonic degree to compute.
+			x:		sin(latitude) of WMM_FLOAT_LANES points.
+			z:		cos(latitude) of the same points.
+			RecursionCoeff: k(n,m) table, as in Workspace->FloatCoeff
+
+		OUTPUT
+			Pcup:	Gauss-normalized associated Legendre functions, (nMax+1)*(nMax+2)/2 * WMM_FLOAT_LANES elements,
+					element [index * WMM_FLOAT_LANES + lane]
+		   dPcup: Derivatives of Pcup(x) with respect to latitude
+*/
+{
+	int n, m, p, index, index1, index2;
+	WMMtype_Float k;
+
+	WMM_STATS_BEGIN(WMM_STAT_LEGENDRE);
+
+	for (p = 0; p < WMM_FLOAT_LANES; p++)
+	{
+		Pcup[p] = 1;
+		dPcup[p] = 0;
+	}
+
+	for (n = 1; n <=  nMax; n++)
+	{
+		for (m = 0; m < n; m++)
+		{
+			index = (n * (n + 1) / 2 + m) * WMM_FLOAT_LANES;
+			index1 = (n > 1 ? ( n - 2 ) * ( n - 1 ) / 2 + m : 0) * WMM_FLOAT_LANES;
+			index2 = (( n - 1) * n / 2 + m) * WMM_FLOAT_LANES;
+			k = RecursionCoeff[n * (n + 1) / 2 + m];
+			WMM_IVDEP
+			for (p = 0; p < WMM_FLOAT_LANES; p++)
+			{
+				Pcup[index + p]  = x[p] *  Pcup[index2 + p]  - k  *  Pcup[index1 + p];
+				dPcup[index + p] = x[p] *  dPcup[index2 + p] + z[p] *  Pcup[index2 + p] - k *  dPcup[index1 + p];
+			}
+		}
+		index = (n * (n + 1) / 2 + n) * WMM_FLOAT_LANES;
+		index1 = (( n - 1 ) * n / 2 + n - 1) * WMM_FLOAT_LANES;
+		WMM_IVDEP
+		for (p = 0; p < WMM_FLOAT_LANES; p++)
+		{
+			Pcup[index + p]  = z[p] * Pcup[index1 + p];
+			dPcup[index + p] = z[p] *  dPcup[index1 + p] - x[p] *  Pcup[index1 + p];
+		}
+	}
+	WMM_STATS_END(WMM_STAT_LEGENDRE);
+	return TRUE;
+}   /*WMM_PcupLowWithTablesFloatBlock */
+
+int WMM_SchmidtQuasiNormFactors(double *schmidtQuasiNorm, int nMax)
+
+/*   Computes the ratios between the Gauss-normalized associated Legendre functions
+	and the Schmidt quasi-normalized version up to degree nMax. The ratios depend
+	only on nMax and may be computed once and reused for every evaluation.
+
+		INPUT
+			nMax:	 Maximum spherical harmonic degree to compute.
+
+		OUTPUT
+			schmidtQuasiNorm:	(nMax+1)*(nMax+2)/2 ratios, in the same order as Pcup
+*/
+{
+	int n, m, index, index1;
+
+/*Compute the ration between the Gauss-normalized associated Legendre
+  functions and the Schmidt quasi-normalized version. This is equivalent to
+  sqrt((m==0?1:2)*(n-m)!/(n+m!))*(2n-1)!!/(n-m)!  */
+
+	schmidtQuasiNorm[0] = 1.0;
+	for (n = 1; n <= nMax; n++)
+	{
+		index = (n * (n + 1) / 2);
+		index1 = (n - 1)  * n / 2 ;
+		/* for m = 0 */
+		schmidtQuasiNorm[index] =  schmidtQuasiNorm[index1] * (double) (2 * n - 1) / (double) n;
+
+		for ( m = 1; m <= n; m++)
+		{
+			index = (n * (n + 1) / 2 + m);
+			index1 = (n * (n + 1) / 2 + m - 1);
+			schmidtQuasiNorm[index] = schmidtQuasiNorm[index1] * sqrt( (double) ((n - m + 1) * (m == 1 ? 2 : 1)) / (double) (n + m));
+		}
+
+	}
+	return TRUE;
+}   /*WMM_SchmidtQuasiNormFactors */
+
+
+void WMM_PrintUserData(WMMtype_GeoMagneticElements GeomagElements, WMMtype_CoordGeodetic SpaceInput, WMMtype_Date TimeInput, WMMtype_MagneticModel *MagneticModel, WMMtype_Geoid *Geoid)
+	/* This function prints the results in  Geomagnetic Elements for a point calculation. It takes the calculated
+	*  Geomagnetic elements "GeomagElements" as input.
+	*  As well as the coordinates, date, and Magnetic Model.
+	INPUT :  GeomagElements : Data structure WMMtype_GeoMagneticElements with the following elements
+				double Decl; (Angle between the magnetic field vector and true north, positive east)
+				double Incl; Angle between the magnetic field vector and the horizontal plane, positive down
+				double F; Magnetic Field Strength
+				double H; Horizontal Magnetic Field Strength
+				double X; Northern component of the magnetic field vector
+				double Y; Eastern component of the magnetic field vector
+				double Z; Downward component of the magnetic field vector4
+				double Decldot; Yearly Rate of change in declination
+				double Incldot; Yearly Rate of change in inclination
+				double Fdot; Yearly rate of change in Magnetic field strength
+				double Hdot; Yearly rate of change in horizontal field strength
+				double Xdot; Yearly rate of change in the northern component
+				double Ydot; Yearly rate of change in the eastern component
+				double Zdot; Yearly rate of change in the downward component
+				double GVdot;Yearly rate of chnage in grid variation
+		CoordGeodetic Pointer to the  data  structure with the following elements
+				double lambda; (longitude)
+				double phi; ( geodetic latitude)
+				double HeightAboveEllipsoid; (height above the ellipsoid (HaE) )
+				double HeightAboveGeoid;(height above the Geoid )
+		TimeInput :  data structure WMMtype_Date with the following elements
+				int	Year;
+				int	Month;
+				int	Day;
+				double DecimalYear;      decimal years
+		MagneticModel :	 data structure with the following elements
+				double EditionDate;
+				double epoch;       Base time of Geomagnetic model epoch (yrs)
+				char  ModelName[20];
+				double *Main_Field_Coeff_G;          C - Gauss coefficients of main geomagnetic model (nT)
+				double *Main_Field_Coeff_H;          C - Gauss coefficients of main geomagnetic model (nT)
+				double *Secular_Var_Coeff_G;  CD - Gauss coefficients of secular geomagnetic model (nT/yr)
+				double *Secular_Var_Coeff_H;  CD - Gauss coefficients of secular geomagnetic model (nT/yr)
 				int nMax;  Maximum degree of spherical harmonic model
 				int nMaxSecVar; Maxumum degree of spherical harmonic secular model
 				int SecularVariationUsed; Whether or not the magnetic secular variation vector will be needed by program
@@ -2222,6 +4193,9 @@ int WMM_readMagneticModel(char *filename, WMMtype_MagneticModel * MagneticModel)
 {
 
 /* READ WORLD Magnetic MODEL SPHERICAL HARMONIC COEFFICIENTS (WMM.cof)
+   The file is read whole and parsed by WMM_readMagneticModelFromBuffer; a file larger than
+   WMM_COF_BUFFER_SIZE is rejected. When built with WMM_EMBED_DATA, a filename of
+   WMM_COF_FILE selects the embedded coefficients instead.
    INPUT :  filename
    	MagneticModel : Pointer to the data structure with the following fields required as inputs
 				nMax : 	Number of static coefficients
@@ -2232,14 +4206,19 @@ int WMM_readMagneticModel(char *filename, WMMtype_MagneticModel * MagneticModel)
 				double *Main_Field_Coeff_H;          C - Gauss coefficients of main geomagnetic model (nT)
 				double *Secular_Var_Coeff_G;  CD - Gauss coefficients of secular geomagnetic model (nT/yr)
 				double *Secular_Var_Coeff_H;  CD - Gauss coefficients of secular geomagnetic model (nT/yr)
-	CALLS : none
+	CALLS : WMM_readMagneticModelFromBuffer
 
 */
 
 	FILE *WMM_COF_File;
-	char c_str[81], c_new[5];   /*these strings are used to read a line from coefficient file*/
-	int i, icomp, m, n, EOF_Flag = 0, index;
-	double epoch, gnm, hnm, dgnm, dhnm;
+	char *Buffer;
+	size_t Size = 0, Read;
+	int Status;
+
+#if WMM_EMBED_DATA
+	if (!strcmp(filename, WMM_COF_FILE))
+		return WMM_readMagneticModelFromBuffer(WMM_EmbeddedCOF, (size_t) (WMM_EmbeddedCOFEnd - WMM_EmbeddedCOF), MagneticModel);
+#endif
 	WMM_COF_File = fopen(filename,"r");
 	if (WMM_COF_File == NULL)
 	{
@@ -2248,16 +4227,66 @@ int WMM_readMagneticModel(char *filename, WMMtype_MagneticModel * MagneticModel)
 		return FALSE;
 		/* should we have a standard error printing routine ?*/
 	}
+	Buffer = (char *) malloc(WMM_COF_BUFFER_SIZE);
+	if (!Buffer)
+	{
+		fclose(WMM_COF_File);
+		WMM_Error(2);
+		return FALSE;
+	}
+	while (Size < WMM_COF_BUFFER_SIZE && (Read = fread(Buffer + Size, 1, WMM_COF_BUFFER_SIZE - Size, WMM_COF_File)) > 0)
+		Size += Read;
+	if (Size == WMM_COF_BUFFER_SIZE && fgetc(WMM_COF_File) != EOF)
+	{ /* Parsing the first WMM_COF_BUFFER_SIZE bytes would drop the rest of the model */
+		fclose(WMM_COF_File);
+		free(Buffer);
+		printf("\nError: %s is larger than %d bytes\n", filename, WMM_COF_BUFFER_SIZE);
+		return FALSE;
+	}
+	fclose(WMM_COF_File);
+	Status = WMM_readMagneticModelFromBuffer(Buffer, Size, MagneticModel);
+	free(Buffer);
+	return Status;
+} /*WMM_readMagneticModel */
+
+int WMM_readMagneticModelFromBuffer(const char *Buffer, size_t Size, WMMtype_MagneticModel * MagneticModel)
+{
+
+/* Same as WMM_readMagneticModel, from the contents of a WMM.COF file in memory.
+   Each line is parsed as one read from the file, up to the "9999" end line.
+   INPUT :  Buffer : WMM.COF contents, not necessarily null terminated
+			Size   : bytes in Buffer
+			MagneticModel : as WMM_readMagneticModel
+   UPDATES : MagneticModel : as WMM_readMagneticModel
+   Returns FALSE if the buffer ends before the "9999" line, or if a coefficient line
+   has a degree n outside [1, MagneticModel->nMax] or an order m outside [0, n].
+	CALLS : WMM_BufferLine, WMM_ComputeCoefficientTables
+
+*/
+
+	char c_str[81], c_new[5];   /*these strings are used to read a line from coefficient file*/
+	int i, icomp, m, n, EOF_Flag = 0, index;
+	double epoch, gnm, hnm, dgnm, dhnm;
+	size_t Position = 0;
+
 	MagneticModel->Main_Field_Coeff_H[0] = 0.0;
 	MagneticModel->Main_Field_Coeff_G[0] = 0.0;
 	MagneticModel->Secular_Var_Coeff_H[0] = 0.0;
 	MagneticModel->Secular_Var_Coeff_G[0] = 0.0;
-	fgets(c_str, 80, WMM_COF_File);
+	if (WMM_BufferLine(Buffer, Size, &Position, c_str, 80) == 0)
+	{
+		WMM_Error(8);
+		return FALSE;
+	}
 	sscanf(c_str,"%lf%s",&epoch, MagneticModel->ModelName);
 	MagneticModel->epoch = epoch;
 	while (EOF_Flag == 0)
 	{
-		fgets(c_str, 80, WMM_COF_File);
+		if (WMM_BufferLine(Buffer, Size, &Position, c_str, 80) == 0)
+		{ /* No "9999" line */
+			WMM_Error(8);
+			return FALSE;
+		}
 		/* CHECK FOR LAST LINE IN FILE */
 		for (i=0; i<4 && (c_str[i] != '\0'); i++)
 		{
@@ -2271,9 +4300,13 @@ int WMM_readMagneticModel(char *filename, WMMtype_MagneticModel * MagneticModel)
 			break;
 		}
 		/* END OF FILE NOT ENCOUNTERED, GET VALUES */
-		sscanf(c_str,"%d%d%lf%lf%lf%lf",&n,&m,&gnm,&hnm,&dgnm,&dhnm);
-		if (m <= n)
+		if (sscanf(c_str,"%d%d%lf%lf%lf%lf",&n,&m,&gnm,&hnm,&dgnm,&dhnm) == 6)
 		{
+			if (n < 1 || n > MagneticModel->nMax || m < 0 || m > n)
+			{ /* Degree or order the coefficient arrays do not hold */
+				WMM_Error(8);
+				return FALSE;
+			}
 			index = (n * (n + 1) / 2 + m);
 			MagneticModel->Main_Field_Coeff_G[index] = gnm;
 			MagneticModel->Secular_Var_Coeff_G[index] = dgnm;
@@ -2282,9 +4315,29 @@ int WMM_readMagneticModel(char *filename, WMMtype_MagneticModel * MagneticModel)
 		}
 	}
 
-	fclose(WMM_COF_File);
+	WMM_ComputeCoefficientTables(MagneticModel);
 	return TRUE;
-} /*WMM_readMagneticModel */
+} /*WMM_readMagneticModelFromBuffer */
+
+size_t WMM_BufferLine(const char *Buffer, size_t Size, size_t *Position, char *Line, size_t LineSize)
+{
+/* Copies the next line of Buffer, from *Position, into Line the way fgets(Line, LineSize, File)
+   reads a file: at most LineSize - 1 characters, the newline included, null terminated.
+   Advances *Position. Returns the number of characters copied, 0 at the end of the buffer.
+	CALLS : none
+*/
+	size_t Length = 0;
+
+	while (*Position < Size && Length + 1 < LineSize)
+	{
+		Line[Length++] = Buffer[*Position];
+		(*Position)++;
+		if (Line[Length - 1] == '\n')
+			break;
+	}
+	Line[Length] = '\0';
+	return Length;
+} /*WMM_BufferLine */
 
 
 int WMM_readMagneticModel_Large(char *filename, char *filenameSV, WMMtype_MagneticModel *MagneticModel)
@@ -2302,7 +4355,7 @@ int WMM_readMagneticModel_Large(char *filename, char *filenameSV, WMMtype_Magnet
 				double *Main_Field_Coeff_H;          C - Gauss coefficients of main geomagnetic model (nT)
 				double *Secular_Var_Coeff_G;  CD - Gauss coefficients of secular geomagnetic model (nT/yr)
 				double *Secular_Var_Coeff_H;  CD - Gauss coefficients of secular geomagnetic model (nT/yr)
-	CALLS : none
+	CALLS : WMM_ComputeCoefficientTables
 
 */
 {
@@ -2359,6 +4412,7 @@ int WMM_readMagneticModel_Large(char *filename, char *filenameSV, WMMtype_Magnet
 		}
 	}
 	//printf("%d, %d, %lf, %lf", index, m, gnm, hnm);
+	WMM_ComputeCoefficientTables(MagneticModel);
 	return TRUE;
 }/*WMM_Large Reader*/
 
@@ -2393,6 +4447,8 @@ int WMM_RotateMagneticVector(WMMtype_CoordSpherical CoordSpherical, WMMtype_Coor
 	*/
 	{
 	double  Psi;
+
+	WMM_STATS_BEGIN(WMM_STAT_ROTATION);
 		 /* Difference between the spherical and Geodetic latitudes */
 	Psi =  ( M_PI/180 ) * ( CoordSpherical.phig - CoordGeodetic.phi );
 
@@ -2400,6 +4456,7 @@ int WMM_RotateMagneticVector(WMMtype_CoordSpherical CoordSpherical, WMMtype_Coor
 		MagneticResultsGeo->Bz =     MagneticResultsSph.Bx *  sin(Psi) + MagneticResultsSph.Bz * cos(Psi);
 		MagneticResultsGeo->Bx =     MagneticResultsSph.Bx *  cos(Psi) - MagneticResultsSph.Bz * sin(Psi);
 		MagneticResultsGeo->By =     MagneticResultsSph.By;
+	WMM_STATS_END(WMM_STAT_ROTATION);
 	return TRUE;
 	}   /*WMM_RotateMagneticVector*/
 
@@ -2441,91 +4498,287 @@ int WMM_SetDefaults(WMMtype_Ellipsoid *Ellip, WMMtype_MagneticModel *MagneticMod
 		Geoid->NumbGeoidElevs  = Geoid->NumbGeoidCols * Geoid->NumbGeoidRows;
 		Geoid->Geoid_Initialized  = 0; /*  Geoid will be initialized only if this is set to zero */
 		Geoid->UseGeoid = WMM_USE_GEOID;
+		Geoid->GeoidHeightBuffer = NULL;
+		Geoid->GeoidHeightBufferCm = NULL;
+		Geoid->GeoidFileName = WMM_GEOID_FILE; /* Change before WMM_InitializeGeoid to load the geoid from elsewhere */
+		Geoid->External = 0;
+		Geoid->Storage = WMM_GEOID_FLOAT32; /* Set to WMM_GEOID_INT16 before WMM_InitializeGeoid for the compact store */
+		Geoid->Tiled = 0; /* Set to 1 before WMM_InitializeGeoid for the cache-blocked layout */
+		Geoid->GeoidTiles = NULL;
+		Geoid->GeoidTilesCm = NULL;
+		Geoid->NumbTileCols = 0;
+		Geoid->Mapped = 0;
+		Geoid->MappedSize = 0;
 
 
 		return TRUE;
 }  /*WMM_SetDefaults */
 
-int WMM_SecVarSummation(WMMtype_LegendreFunction *LegendreFunction, WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults)
-{
-	/*This Function sums the secular variation coefficients to get the secular variation of the Magnetic vector.
-	INPUT :  LegendreFunction
+int WMM_SetWorkspaceDate(WMMtype_Workspace *Workspace, WMMtype_MagneticModel *MagneticModel, double DecimalYear)
+
+/*
+	Makes the time modified model of the workspace current for the given model and date.
+	The workspace keeps up to WMM_TIMED_CACHE_SIZE time modified models, keyed by model and date,
+	and WMM_TimelyModifyMagneticModel is only called for a pair not in the cache; the least recently
+	used entry is then replaced. Streams that alternate between a few dates therefore share the
+	coefficient setup. If Workspace->DateResolution is not 0 (see WMM_SetDateResolution) the date
+	is first rounded to the nearest multiple of it. If the coefficients of MagneticModel are changed
+	in place, call WMM_ClearTimedModels to force a rebuild.
+
+	INPUT : Workspace
 			MagneticModel
-			SphVariables
-			CoordSpherical
-	OUTPUT : MagneticResults
+			DecimalYear
+	UPDATES : Workspace->TimedMagneticModel, TimedSource, TimedDecimalYear
+			  Workspace->TimedCache
 
-	CALLS : WMM_SecVarSummationSpecial
+	CALLS : WMM_TimelyModifyMagneticModel, WMM_AllocateModelMemory
+*/
+{
+	WMMtype_Date Date;
+	int i, Entry;
 
-	*/
-	int m, n, index;
-	double cos_phi;
-	MagneticModel->SecularVariationUsed = TRUE;
-	MagneticResults->Bz = 0.0;
-	MagneticResults->By = 0.0;
-	MagneticResults->Bx = 0.0;
-	for (n = 1; n <=  MagneticModel->nMaxSecVar; n++)
+	if (!Workspace || !MagneticModel || MagneticModel->nMax > Workspace->nMax)
+		return FALSE;
+	if (Workspace->DateResolution > 0)
+		DecimalYear = floor(DecimalYear / Workspace->DateResolution + 0.5) * Workspace->DateResolution;
+	Workspace->TimedCacheClock++;
+
+	/* Look the date up; remember the least recently used entry in case it is not there */
+	Entry = 0;
+	for (i = 0; i < WMM_TIMED_CACHE_SIZE; i++)
 	{
-		for (m=0;m<=n;m++)
+		if (Workspace->TimedCacheSource[i] == MagneticModel && Workspace->TimedCacheYear[i] == DecimalYear)
 		{
-			index = (n * (n + 1) / 2 + m);
-
-/*		    nMax  	(n+2) 	  n     m            m           m
-	Bz =   -SUM (a/r)   (n+1) SUM  [g cos(m p) + h sin(m p)] P (sin(phi))
-			n=1      	      m=0   n            n           n  */
-/*  Derivative with respect to radius.*/
-			MagneticResults->Bz -= 	SphVariables.RelativeRadiusPower[n] *
-					(	MagneticModel->Secular_Var_Coeff_G[index]*SphVariables.cos_mlambda[m] +
-						MagneticModel->Secular_Var_Coeff_H[index]*SphVariables.sin_mlambda[m]	)
-						* (double) (n+1) * LegendreFunction-> Pcup[index];
-
-/*		  1 nMax  (n+2)    n     m            m           m
-	By =    SUM (a/r) (m)  SUM  [g cos(m p) + h sin(m p)] dP (sin(phi))
-		   n=1             m=0   n            n           n  */
-/* Derivative with respect to longitude, divided by radius. */
-			MagneticResults->By += 	SphVariables.RelativeRadiusPower[n] *
-					(	MagneticModel->Secular_Var_Coeff_G[index]*SphVariables.sin_mlambda[m] -
-						MagneticModel->Secular_Var_Coeff_H[index]*SphVariables.cos_mlambda[m]  )
-						* (double) (m) * LegendreFunction-> Pcup[index];
-/*		   nMax  (n+2) n     m            m           m
-	Bx = - SUM (a/r)   SUM  [g cos(m p) + h sin(m p)] dP (sin(phi))
-		   n=1         m=0   n            n           n  */
-/* Derivative with respect to latitude, divided by radius. */
-
-			MagneticResults->Bx -= 	SphVariables.RelativeRadiusPower[n] *
-					(	MagneticModel->Secular_Var_Coeff_G[index]*SphVariables.cos_mlambda[m]  +
-						MagneticModel->Secular_Var_Coeff_H[index]*SphVariables.sin_mlambda[m]  )
-						* LegendreFunction-> dPcup[index];
+			Workspace->TimedCacheUse[i] = Workspace->TimedCacheClock;
+			Workspace->TimedMagneticModel = Workspace->TimedCache[i];
+			Workspace->TimedSource = MagneticModel;
+			Workspace->TimedDecimalYear = DecimalYear;
+			return TRUE;
 		}
+		if (Workspace->TimedCacheUse[i] < Workspace->TimedCacheUse[Entry])
+			Entry = i;
 	}
-	cos_phi = cos ( DEG2RAD ( CoordSpherical.phig ) );
-	if ( fabs(cos_phi) > 1.0e-10 )
-	{
-		MagneticResults->By = MagneticResults->By / cos_phi ;
-	}
-	else
-	/* Special calculation for component By at Geographic poles */
+
+	/* Entries past the first are allocated when first needed; without memory the cache stays smaller */
+	if (!Workspace->TimedCache[Entry])
+		Workspace->TimedCache[Entry] = WMM_AllocateModelMemory(Workspace->NumTerms);
+	if (!Workspace->TimedCache[Entry])
 	{
-		WMM_SecVarSummationSpecial(MagneticModel, SphVariables, CoordSpherical, MagneticResults);
+		Entry = 0;
+		for (i = 1; i < WMM_TIMED_CACHE_SIZE; i++)
+			if (Workspace->TimedCache[i] && Workspace->TimedCacheUse[i] < Workspace->TimedCacheUse[Entry])
+				Entry = i;
 	}
+
+	Date.DecimalYear = DecimalYear;
+	WMM_TimelyModifyMagneticModel(Date, MagneticModel, Workspace->TimedCache[Entry]);
+	Workspace->TimedCacheSource[Entry] = MagneticModel;
+	Workspace->TimedCacheYear[Entry] = DecimalYear;
+	Workspace->TimedCacheUse[Entry] = Workspace->TimedCacheClock;
+	Workspace->TimedMagneticModel = Workspace->TimedCache[Entry];
+	Workspace->TimedSource = MagneticModel;
+	Workspace->TimedDecimalYear = DecimalYear;
 	return TRUE;
-} /*WMM_SecVarSummation*/
+}  /*WMM_SetWorkspaceDate */
 
-int WMM_SecVarSummationSpecial(WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults)
-{
-	/*Special calculation for the secular variation summation at the poles.
+int WMM_SetWorkspaceFloatCoeff(WMMtype_Workspace *Workspace)
 
+/*
+	Converts the coefficients of the current time modified model of the workspace to single
+	precision for WMM_ContextGeomagBatchFloat, unless they were already converted for the same
+	model and date. The products with the Schmidt quasi-normalization factors are formed in
+	double and rounded once, so each coefficient is within half an ulp of float of the
+	Main_Field_Coeff_GS etc. of the double path.
+
+	INPUT : Workspace	WMM_SetWorkspaceDate called for the model and date
+	UPDATES : Workspace->FloatCoeff, FloatSource, FloatDecimalYear
+
+	CALLS : none
+*/
+{
+	WMMtype_MagneticModel *TimedMagneticModel;
+	WMMtype_Float *G, *H, *dG, *dH;
+	int n, m, index, b, NumTerms;
+
+	if (!Workspace || !Workspace->TimedSource)
+		return FALSE;
+	if (Workspace->FloatSource == Workspace->TimedSource && Workspace->FloatDecimalYear == Workspace->TimedDecimalYear)
+		return TRUE;
+
+	WMM_STATS_BEGIN(WMM_STAT_TIMELY_MODIFY);
+	TimedMagneticModel = Workspace->TimedMagneticModel;
+	NumTerms = Workspace->NumTerms;
+	G = Workspace->FloatCoeff;
+	H = G + NumTerms;
+	dG = H + NumTerms;
+	dH = dG + NumTerms;
+	b = (TimedMagneticModel->nMaxSecVar * (TimedMagneticModel->nMaxSecVar + 1) / 2 + TimedMagneticModel->nMaxSecVar);
+	G[0] = H[0] = dG[0] = dH[0] = 0;
+	for (n = 1; n <= TimedMagneticModel->nMax; n++)
+	{
+		for (m = 0; m <= n; m++)
+		{
+			index = (n * (n + 1) / 2 + m);
+			G[index] = (WMMtype_Float) (TimedMagneticModel->Main_Field_Coeff_G[index] * Workspace->SchmidtQuasiNorm[index]);
+			H[index] = (WMMtype_Float) (TimedMagneticModel->Main_Field_Coeff_H[index] * Workspace->SchmidtQuasiNorm[index]);
+			dG[index] = index <= b ? (WMMtype_Float) (TimedMagneticModel->Secular_Var_Coeff_G[index] * Workspace->SchmidtQuasiNorm[index]) : 0;
+			dH[index] = index <= b ? (WMMtype_Float) (TimedMagneticModel->Secular_Var_Coeff_H[index] * Workspace->SchmidtQuasiNorm[index]) : 0;
+		}
+	}
+	Workspace->FloatSource = Workspace->TimedSource;
+	Workspace->FloatDecimalYear = Workspace->TimedDecimalYear;
+	WMM_STATS_END(WMM_STAT_TIMELY_MODIFY);
+	return TRUE;
+}  /*WMM_SetWorkspaceFloatCoeff */
+
+int WMM_SetDateResolution(WMMtype_Workspace *Workspace, double Resolution)
+
+/*
+	Sets the resolution dates are rounded to by WMM_SetWorkspaceDate. With a resolution of, say,
+	1/365.25 years all points of the same day share one time modified model; the field then
+	differs from the exact date by at most the secular variation over half the resolution.
+	0 (the default) uses dates as given.
+
+	INPUT : Workspace
+			Resolution	In decimal years, 0 or positive
+	UPDATES : Workspace->DateResolution
+
+	CALLS : none
+*/
+{
+	if (!Workspace || !(Resolution >= 0) || !isfinite(Resolution))
+		return FALSE;
+	Workspace->DateResolution = Resolution;
+	return TRUE;
+}  /*WMM_SetDateResolution */
+
+void WMM_ClearTimedModels(WMMtype_Workspace *Workspace)
+
+/*
+	Forgets the time modified models of the workspace, for instance after the coefficients of a
+	model were changed in place. The memory is kept for reuse.
+
+	INPUT : Workspace
+	UPDATES : Workspace->TimedSource, Workspace->TimedCacheSource, Workspace->FloatSource
 
-	INPUT: MagneticModel
-		   SphVariables
-		   CoordSpherical
-	OUTPUT: MagneticResults
 	CALLS : none
+*/
+{
+	int i;
+
+	if (!Workspace)
+		return;
+	Workspace->TimedSource = NULL;
+	Workspace->FloatSource = NULL;
+	for (i = 0; i < WMM_TIMED_CACHE_SIZE; i++)
+		Workspace->TimedCacheSource[i] = NULL;
+}  /*WMM_ClearTimedModels */
+
+int WMM_SecVarSummation(WMMtype_LegendreFunction *LegendreFunction, WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults)
+{
+	/*This Function sums the secular variation coefficients to get the secular variation of the Magnetic vector.
+	INPUT :  LegendreFunction
+			MagneticModel
+			SphVariables
+			CoordSpherical
+	OUTPUT : MagneticResults
 
+	CALLS : WMM_SecVarSummationWithScratch
 
 	*/
-	int n, index;
-	double k, sin_phi, *PcupS, schmidtQuasiNorm1, schmidtQuasiNorm2, schmidtQuasiNorm3;
+	int Status;
+
+	WMM_STATS_BEGIN(WMM_STAT_SUMMATION);
+	Status = WMM_SecVarSummationWithScratch(LegendreFunction, MagneticModel, SphVariables, CoordSpherical, MagneticResults, NULL);
+	WMM_STATS_END(WMM_STAT_SUMMATION);
+	return Status;
+} /*WMM_SecVarSummation*/
+
+int WMM_SecVarSummationWithScratch(WMMtype_LegendreFunction *LegendreFunction, WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults, double *PcupS)
+{
+	/*Same as WMM_SecVarSummation. If PcupS is not NULL it must hold nMaxSecVar+1 doubles and
+	is used as scratch space at the geographic poles instead of allocating memory.
+	INPUT :  LegendreFunction
+			MagneticModel
+			SphVariables
+			CoordSpherical
+			PcupS
+	OUTPUT : MagneticResults
+
+	CALLS : WMM_SecVarSummationSpecial, WMM_SecVarSummationSpecialWithScratch
+
+	*/
+	int m, n, index;
+	double cos_phi;
+	MagneticModel->SecularVariationUsed = TRUE;
+	MagneticResults->Bz = 0.0;
+	MagneticResults->By = 0.0;
+	MagneticResults->Bx = 0.0;
+	for (n = 1; n <=  MagneticModel->nMaxSecVar; n++)
+	{
+		for (m=0;m<=n;m++)
+		{
+			index = (n * (n + 1) / 2 + m);
+
+/*		    nMax  	(n+2) 	  n     m            m           m
+	Bz =   -SUM (a/r)   (n+1) SUM  [g cos(m p) + h sin(m p)] P (sin(phi))
+			n=1      	      m=0   n            n           n  */
+/*  Derivative with respect to radius.*/
+			MagneticResults->Bz -= 	SphVariables.RelativeRadiusPower[n] *
+					(	MagneticModel->Secular_Var_Coeff_G[index]*SphVariables.cos_mlambda[m] +
+						MagneticModel->Secular_Var_Coeff_H[index]*SphVariables.sin_mlambda[m]	)
+						* (double) (n+1) * LegendreFunction-> Pcup[index];
+
+/*		  1 nMax  (n+2)    n     m            m           m
+	By =    SUM (a/r) (m)  SUM  [g cos(m p) + h sin(m p)] dP (sin(phi))
+		   n=1             m=0   n            n           n  */
+/* Derivative with respect to longitude, divided by radius. */
+			MagneticResults->By += 	SphVariables.RelativeRadiusPower[n] *
+					(	MagneticModel->Secular_Var_Coeff_G[index]*SphVariables.sin_mlambda[m] -
+						MagneticModel->Secular_Var_Coeff_H[index]*SphVariables.cos_mlambda[m]  )
+						* (double) (m) * LegendreFunction-> Pcup[index];
+/*		   nMax  (n+2) n     m            m           m
+	Bx = - SUM (a/r)   SUM  [g cos(m p) + h sin(m p)] dP (sin(phi))
+		   n=1         m=0   n            n           n  */
+/* Derivative with respect to latitude, divided by radius. */
+
+			MagneticResults->Bx -= 	SphVariables.RelativeRadiusPower[n] *
+					(	MagneticModel->Secular_Var_Coeff_G[index]*SphVariables.cos_mlambda[m]  +
+						MagneticModel->Secular_Var_Coeff_H[index]*SphVariables.sin_mlambda[m]  )
+						* LegendreFunction-> dPcup[index];
+		}
+	}
+	cos_phi = cos ( DEG2RAD ( CoordSpherical.phig ) );
+	if ( fabs(cos_phi) > 1.0e-10 )
+	{
+		MagneticResults->By = MagneticResults->By / cos_phi ;
+	}
+	else
+	/* Special calculation for component By at Geographic poles */
+	{
+		if (PcupS)
+			WMM_SecVarSummationSpecialWithScratch(MagneticModel, SphVariables, CoordSpherical, MagneticResults, PcupS);
+		else
+			WMM_SecVarSummationSpecial(MagneticModel, SphVariables, CoordSpherical, MagneticResults);
+	}
+	return TRUE;
+} /*WMM_SecVarSummationWithScratch*/
+
+int WMM_SecVarSummationSpecial(WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults)
+{
+	/*Special calculation for the secular variation summation at the poles.
+
+
+	INPUT: MagneticModel
+		   SphVariables
+		   CoordSpherical
+	OUTPUT: MagneticResults
+	CALLS : WMM_SecVarSummationSpecialWithScratch
+
+
+	*/
+	double *PcupS;
+	int FLAG;
 
 	PcupS = (double *) malloc ( (MagneticModel->nMaxSecVar +1) * sizeof (double) );
 
@@ -2536,6 +4789,30 @@ int WMM_SecVarSummationSpecial(WMMtype_MagneticModel *MagneticModel, WMMtype_Sph
 		return FALSE;
 	}
 
+	FLAG = WMM_SecVarSummationSpecialWithScratch(MagneticModel, SphVariables, CoordSpherical, MagneticResults, PcupS);
+
+	if (PcupS)
+		free(PcupS);
+	return FLAG;
+}/*SecVarSummationSpecial*/
+
+int WMM_SecVarSummationSpecialWithScratch(WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults, double *PcupS)
+{
+	/*Same as WMM_SecVarSummationSpecial, using the caller supplied scratch space PcupS
+	of nMaxSecVar+1 doubles.
+
+	INPUT: MagneticModel
+		   SphVariables
+		   CoordSpherical
+		   PcupS
+	OUTPUT: MagneticResults
+	CALLS : none
+
+
+	*/
+	int n, index;
+	double k, sin_phi, schmidtQuasiNorm1, schmidtQuasiNorm2, schmidtQuasiNorm3;
+
 	PcupS[0] = 1;
 	schmidtQuasiNorm1 = 1.0;
 
@@ -2569,10 +4846,8 @@ int WMM_SecVarSummationSpecial(WMMtype_MagneticModel *MagneticModel, WMMtype_Sph
 						*  PcupS[n] * schmidtQuasiNorm3;
 	}
 
-	if (PcupS)
-		free(PcupS);
 	return TRUE;
-}/*SecVarSummationSpecial*/
+}/*SecVarSummationSpecialWithScratch*/
 
 int WMM_Summation(WMMtype_LegendreFunction *LegendreFunction, WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults)
 {
@@ -2599,6 +4874,28 @@ int WMM_Summation(WMMtype_LegendreFunction *LegendreFunction, WMMtype_MagneticMo
 
 
    Manoj Nair, June, 2009 Manoj.C.Nair@Noaa.Gov
+   */
+	int Status;
+
+	WMM_STATS_BEGIN(WMM_STAT_SUMMATION);
+	Status = WMM_SummationWithScratch(LegendreFunction, MagneticModel, SphVariables, CoordSpherical, MagneticResults, NULL);
+	WMM_STATS_END(WMM_STAT_SUMMATION);
+	return Status;
+}/*WMM_Summation */
+
+int WMM_SummationWithScratch(WMMtype_LegendreFunction *LegendreFunction, WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults, double *PcupS)
+{
+	/* Same as WMM_Summation. If PcupS is not NULL it must hold nMax+1 doubles and
+	is used as scratch space at the geographic poles instead of allocating memory.
+
+	INPUT :  LegendreFunction
+			MagneticModel
+			SphVariables
+			CoordSpherical
+			PcupS
+	OUTPUT : MagneticResults
+
+	CALLS : WMM_SummationSpecial, WMM_SummationSpecialWithScratch
    */
 	int m, n, index;
 	double cos_phi;
@@ -2656,100 +4953,740 @@ int WMM_Summation(WMMtype_LegendreFunction *LegendreFunction, WMMtype_MagneticMo
 	*/
 
 	{
-		WMM_SummationSpecial(MagneticModel, SphVariables, CoordSpherical, MagneticResults);
+		if (PcupS)
+			WMM_SummationSpecialWithScratch(MagneticModel, SphVariables, CoordSpherical, MagneticResults, PcupS);
+		else
+			WMM_SummationSpecial(MagneticModel, SphVariables, CoordSpherical, MagneticResults);
 	}
 	return TRUE;
-}/*WMM_Summation */
+}/*WMM_SummationWithScratch */
 
-int WMM_SummationSpecial(WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults)
-	/* Special calculation for the component By at Geographic poles.
-	Manoj Nair, June, 2009 manoj.c.nair@noaa.gov
-    INPUT: MagneticModel
-		   SphVariables
-		   CoordSpherical
-	OUTPUT: MagneticResults
-	CALLS : none
-	See Section 1.4, "SINGULARITIES AT THE GEOGRAPHIC POLES", WMM Technical report
+int WMM_SummationWithSecVar(WMMtype_LegendreFunction *LegendreFunction, WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults, WMMtype_MagneticResults *MagneticResultsSV, double *PcupS)
+{
+	/* WMM_Summation and WMM_SecVarSummation in a single pass over the n/m triangle. Each Legendre
+	function, radius power and longitude term is loaded once and used for both the main field and the
+	secular variation. The two sums are accumulated separately, in the same order as the two
+	routines, so the results are identical to calling them one after the other.
+	If PcupS is not NULL it must hold nMax+1 doubles and is used as scratch space at the geographic
+	poles instead of allocating memory.
+
+	INPUT :  LegendreFunction
+			MagneticModel
+			SphVariables
+			CoordSpherical
+			PcupS
+	OUTPUT : MagneticResults	Main field, as WMM_Summation
+			MagneticResultsSV	Secular variation, as WMM_SecVarSummation
 
+	CALLS : WMM_SummationSpecial, WMM_SummationSpecialWithScratch,
+			WMM_SecVarSummationSpecial, WMM_SecVarSummationSpecialWithScratch
 	*/
+	int m, n, index, nMaxSum;
+	double Bx = 0.0, By = 0.0, Bz = 0.0, BxSV = 0.0, BySV = 0.0, BzSV = 0.0;
+	double R, c, s, P, dP, cos_phi;
+
+	WMM_STATS_BEGIN(WMM_STAT_SUMMATION);
+	if (MagneticModel->SecularVariationUsed != TRUE)	/* Shared models are left untouched */
+		MagneticModel->SecularVariationUsed = TRUE;
+	nMaxSum = MagneticModel->nMax > MagneticModel->nMaxSecVar ? MagneticModel->nMax : MagneticModel->nMaxSecVar;
+	for (n = 1; n <= nMaxSum; n++)
 	{
-	int n, index;
-	double k, sin_phi, *PcupS, schmidtQuasiNorm1, schmidtQuasiNorm2, schmidtQuasiNorm3;
+		R = SphVariables.RelativeRadiusPower[n];
+		for (m = 0; m <= n; m++)
+		{
+			index = (n * (n + 1) / 2 + m);
+			c = SphVariables.cos_mlambda[m];
+			s = SphVariables.sin_mlambda[m];
+			P = LegendreFunction->Pcup[index];
+			dP = LegendreFunction->dPcup[index];
 
-	PcupS = (double *) malloc ( (MagneticModel->nMax +1) * sizeof (double) );
-	if (PcupS == 0)
-	{
-		WMM_Error(14);
-		//printf("error allocating in WMM_SummationSpecial\n");
-		return FALSE;
+			/* Equations 10-12 in the WMM Technical report, see WMM_Summation */
+			if (n <= MagneticModel->nMax)
+			{
+				Bz -= R * ( MagneticModel->Main_Field_Coeff_G[index] * c + MagneticModel->Main_Field_Coeff_H[index] * s ) * (double) (n+1) * P;
+				By += R * ( MagneticModel->Main_Field_Coeff_G[index] * s - MagneticModel->Main_Field_Coeff_H[index] * c ) * (double) (m) * P;
+				Bx -= R * ( MagneticModel->Main_Field_Coeff_G[index] * c + MagneticModel->Main_Field_Coeff_H[index] * s ) * dP;
+			}
+			/* Equations 13-15, see WMM_SecVarSummation */
+			if (n <= MagneticModel->nMaxSecVar)
+			{
+				BzSV -= R * ( MagneticModel->Secular_Var_Coeff_G[index] * c + MagneticModel->Secular_Var_Coeff_H[index] * s ) * (double) (n+1) * P;
+				BySV += R * ( MagneticModel->Secular_Var_Coeff_G[index] * s - MagneticModel->Secular_Var_Coeff_H[index] * c ) * (double) (m) * P;
+				BxSV -= R * ( MagneticModel->Secular_Var_Coeff_G[index] * c + MagneticModel->Secular_Var_Coeff_H[index] * s ) * dP;
+			}
+		}
 	}
+	MagneticResults->Bx = Bx;
+	MagneticResults->By = By;
+	MagneticResults->Bz = Bz;
+	MagneticResultsSV->Bx = BxSV;
+	MagneticResultsSV->By = BySV;
+	MagneticResultsSV->Bz = BzSV;
 
-	PcupS[0] = 1;
-	schmidtQuasiNorm1 = 1.0;
-
-	MagneticResults->By = 0.0;
-	sin_phi = sin ( DEG2RAD ( CoordSpherical.phig ) );
-
-	for (n = 1; n <=  MagneticModel->nMax; n++)
+	cos_phi = cos ( DEG2RAD ( CoordSpherical.phig ) );
+	if ( fabs(cos_phi) > 1.0e-10 )
 	{
-
-	/*Compute the ration between the Gauss-normalized associated Legendre
-  functions and the Schmidt quasi-normalized version. This is equivalent to
-  sqrt((m==0?1:2)*(n-m)!/(n+m!))*(2n-1)!!/(n-m)!  */
-
-		index = (n * (n + 1) / 2 + 1);
-		schmidtQuasiNorm2 = schmidtQuasiNorm1 * (double) (2 * n - 1) / (double) n;
-		schmidtQuasiNorm3 = schmidtQuasiNorm2 *  sqrt( (double) (n * 2) / (double) (n + 1));
-		schmidtQuasiNorm1 = schmidtQuasiNorm2;
-		if (n == 1)
+		MagneticResults->By = MagneticResults->By / cos_phi ;
+		MagneticResultsSV->By = MagneticResultsSV->By / cos_phi ;
+	}
+	else
+	/* Special calculation for component By at Geographic poles */
+	{
+		if (PcupS)
 		{
-			PcupS[n] = PcupS[n-1];
+			WMM_SummationSpecialWithScratch(MagneticModel, SphVariables, CoordSpherical, MagneticResults, PcupS);
+			WMM_SecVarSummationSpecialWithScratch(MagneticModel, SphVariables, CoordSpherical, MagneticResultsSV, PcupS);
 		}
 		else
 		{
-			k = (double)( ( (n - 1) * (n - 1) ) - 1) / ( double ) ( (2 * n - 1) * (2 * n - 3) );
-			PcupS[n] =     sin_phi * PcupS[n-1] - k * PcupS[n-2];
+			WMM_SummationSpecial(MagneticModel, SphVariables, CoordSpherical, MagneticResults);
+			WMM_SecVarSummationSpecial(MagneticModel, SphVariables, CoordSpherical, MagneticResultsSV);
 		}
+	}
+	WMM_STATS_END(WMM_STAT_SUMMATION);
+	return TRUE;
+}/*WMM_SummationWithSecVar */
 
-/*		  1 nMax  (n+2)    n     m            m           m
-	By =    SUM (a/r) (m)  SUM  [g cos(m p) + h sin(m p)] dP (sin(phi))
-		   n=1             m=0   n            n           n  */
-/* Equation 11 in the WMM Technical report. Derivative with respect to longitude, divided by radius. */
+int WMM_GetSimdLevel(void)
 
-		MagneticResults->By += 	SphVariables.RelativeRadiusPower[n] *
-					(	MagneticModel->Main_Field_Coeff_G[index]*SphVariables.sin_mlambda[1] -
-						MagneticModel->Main_Field_Coeff_H[index]*SphVariables.cos_mlambda[1]  )
-						*  PcupS[n] * schmidtQuasiNorm3;
+	/* Returns the summation kernel used by WMM_SummationBlock, one of WMM_SIMD_NONE,
+	WMM_SIMD_SSE2, WMM_SIMD_AVX2 or WMM_SIMD_AVX512. Unless set with WMM_SetSimdLevel,
+	the best kernel supported by the CPU is detected with CPUID on the first call, once
+	even when the first calls are concurrent.
+	CALLS : WMM_SetSimdLevel
+	*/
+{
+	int Level = WMM_ATOMIC_LOAD(WMM_SimdLevel);
+
+	if (Level < 0)
+	{
+#if WMM_THREADS
+		pthread_once(&WMM_SimdLevelOnce, WMM_DetectSimdLevel);
+		Level = WMM_ATOMIC_LOAD(WMM_SimdLevel);
+#else
+		Level = WMM_SetSimdLevel(WMM_SIMD_AUTO);
+#endif
 	}
+	return Level;
+} /*WMM_GetSimdLevel*/
 
-	if (PcupS)
-		free(PcupS);
-	return TRUE;
-	}/*WMM_SummationSpecial */
+void WMM_DetectSimdLevel(void)
 
-int WMM_TimelyModifyMagneticModel(WMMtype_Date UserDate, WMMtype_MagneticModel *MagneticModel,  WMMtype_MagneticModel *TimedMagneticModel)
+	/* Selects the best supported kernel unless one was set meanwhile. Run once by WMM_GetSimdLevel.
+	CALLS : WMM_SetSimdLevel
+	*/
+{
+	if (WMM_ATOMIC_LOAD(WMM_SimdLevel) < 0)
+		WMM_SetSimdLevel(WMM_SIMD_AUTO);
+} /*WMM_DetectSimdLevel*/
 
-	/* Time change the Model coefficients from the base year of the model using secular variation coefficients.
-	Store the coefficients of the static model with their values advanced from epoch t0 to epoch t.
-	Copy the SV coefficients.  If input "t�" is the same as "t0", then this is merely a copy operation.
-	If the address of "TimedMagneticModel" is the same as the address of "MagneticModel", then this procedure overwrites
-	the given item "MagneticModel".
+int WMM_SetSimdLevel(int Level)
 
-	INPUT: UserDate
-		   MagneticModel
-	OUTPUT:TimedMagneticModel
+	/* Selects the summation kernel used by WMM_SummationBlock. Level is one of the WMM_SIMD_*
+	values; WMM_SIMD_AUTO selects the best kernel supported by the CPU. A level the CPU does
+	not support is lowered to the best supported one. Returns the level in use. Meant to be
+	called once at start up, or to compare the kernels against WMM_SIMD_NONE.
 	CALLS : none
 	*/
+{
+	int Supported = WMM_SIMD_NONE;
+#if WMM_SIMD_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		Supported = WMM_SIMD_SSE2;
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		Supported = WMM_SIMD_AVX2;
+	if (__builtin_cpu_supports("avx512f"))
+		Supported = WMM_SIMD_AVX512;
+#endif
+	if (Level < 0 || Level > Supported)
+		Level = Supported;
+	WMM_ATOMIC_STORE(WMM_SimdLevel, Level);
+	return Level;
+} /*WMM_SetSimdLevel*/
+
+void WMM_SummationBlock(WMMtype_Workspace *Workspace, double *G, double *H, double *dG, double *dH, int nMax, int nMaxSecVar, double *Results)
+
+	/* Spherical harmonic summation of the main field and of the secular variation for
+	WMM_SIMD_LANES points, with the kernel selected by WMM_GetSimdLevel.
+
+	INPUT :  Workspace	PcupBlock, dPcupBlock, RelativeRadiusPowerBlock, cos_mlambdaBlock and
+						sin_mlambdaBlock filled for WMM_SIMD_LANES points
+			G, H		Main field coefficients matching the normalization of PcupBlock
+			dG, dH		Secular variation coefficients with the same normalization
+			nMax, nMaxSecVar
+	OUTPUT : Results	6 * WMM_SIMD_LANES values, element [c * WMM_SIMD_LANES + lane] with c = 0..5 for
+						Bx, By, Bz of the main field and Bx, By, Bz of the secular variation.
+						By is not yet divided by cos(phi); see WMM_Summation.
+
+	CALLS : WMM_SummationBlockScalar, WMM_SummationBlockSSE2, WMM_SummationBlockAVX2, WMM_SummationBlockAVX512
+	*/
+{
+	WMM_STATS_BEGIN(WMM_STAT_SUMMATION);
+	switch (WMM_GetSimdLevel())
+	{
+#if WMM_SIMD_X86
+		case WMM_SIMD_AVX512:
+			WMM_SummationBlockAVX512(Workspace, G, H, dG, dH, nMax, nMaxSecVar, Results);
+			break;
+		case WMM_SIMD_AVX2:
+			WMM_SummationBlockAVX2(Workspace, G, H, dG, dH, nMax, nMaxSecVar, Results);
+			break;
+		case WMM_SIMD_SSE2:
+			WMM_SummationBlockSSE2(Workspace, G, H, dG, dH, nMax, nMaxSecVar, Results);
+			break;
+#endif
+		default:
+			WMM_SummationBlockScalar(Workspace, G, H, dG, dH, nMax, nMaxSecVar, Results);
+			break;
+	}
+	WMM_STATS_END(WMM_STAT_SUMMATION);
+} /*WMM_SummationBlock*/
+
+void WMM_SummationBlockScalar(WMMtype_Workspace *Workspace, double *G, double *H, double *dG, double *dH, int nMax, int nMaxSecVar, double *Results)
+
+	/* Portable kernel of WMM_SummationBlock. Each point is summed in the same order and with
+	the same operations as WMM_Summation and WMM_SecVarSummation.
+	CALLS : none
+	*/
+{
+	int m, n, p, index, L = WMM_SIMD_LANES;
+	double Bx, By, Bz, BxSV, BySV, BzSV, R, c, s, P, dP;
 
+	for (p = 0; p < L; p++)
 	{
-	int n, m, index, a, b;
-	TimedMagneticModel->EditionDate = MagneticModel->EditionDate;
-	TimedMagneticModel->epoch	   = MagneticModel->epoch;
+		Bx = By = Bz = BxSV = BySV = BzSV = 0.0;
+		for (n = 1; n <= nMax; n++)
+		{
+			R = Workspace->RelativeRadiusPowerBlock[n * L + p];
+			for (m = 0; m <= n; m++)
+			{
+				index = (n * (n + 1) / 2 + m);
+				c = Workspace->cos_mlambdaBlock[m * L + p];
+				s = Workspace->sin_mlambdaBlock[m * L + p];
+				P = Workspace->PcupBlock[index * L + p];
+				dP = Workspace->dPcupBlock[index * L + p];
+				Bz -= R * ( G[index] * c + H[index] * s ) * (double) (n+1) * P;
+				By += R * ( G[index] * s - H[index] * c ) * (double) (m) * P;
+				Bx -= R * ( G[index] * c + H[index] * s ) * dP;
+				if (n <= nMaxSecVar)
+				{
+					BzSV -= R * ( dG[index] * c + dH[index] * s ) * (double) (n+1) * P;
+					BySV += R * ( dG[index] * s - dH[index] * c ) * (double) (m) * P;
+					BxSV -= R * ( dG[index] * c + dH[index] * s ) * dP;
+				}
+			}
+		}
+		Results[0 * L + p] = Bx;
+		Results[1 * L + p] = By;
+		Results[2 * L + p] = Bz;
+		Results[3 * L + p] = BxSV;
+		Results[4 * L + p] = BySV;
+		Results[5 * L + p] = BzSV;
+	}
+} /*WMM_SummationBlockScalar*/
+
+#if WMM_SIMD_X86
+
+__attribute__((target("sse2")))
+void WMM_SummationBlockSSE2(WMMtype_Workspace *Workspace, double *G, double *H, double *dG, double *dH, int nMax, int nMaxSecVar, double *Results)
+
+	/* SSE2 kernel of WMM_SummationBlock, 2 points per instruction.
+	CALLS : none
+	*/
+{
+	int m, n, p, index, L = WMM_SIMD_LANES;
+	__m128d Bx, By, Bz, BxSV, BySV, BzSV, R, c, s, P, dP, gc, gs, nP, mP;
+
+	for (p = 0; p < L; p += 2)
+	{
+		Bx = By = Bz = BxSV = BySV = BzSV = _mm_setzero_pd();
+		for (n = 1; n <= nMax; n++)
+		{
+			R = _mm_loadu_pd(&Workspace->RelativeRadiusPowerBlock[n * L + p]);
+			for (m = 0; m <= n; m++)
+			{
+				index = (n * (n + 1) / 2 + m);
+				c = _mm_mul_pd(R, _mm_loadu_pd(&Workspace->cos_mlambdaBlock[m * L + p]));
+				s = _mm_mul_pd(R, _mm_loadu_pd(&Workspace->sin_mlambdaBlock[m * L + p]));
+				P = _mm_loadu_pd(&Workspace->PcupBlock[index * L + p]);
+				dP = _mm_loadu_pd(&Workspace->dPcupBlock[index * L + p]);
+				nP = _mm_mul_pd(_mm_set1_pd((double) (n+1)), P);
+				mP = _mm_mul_pd(_mm_set1_pd((double) (m)), P);
+				gc = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(G[index]), c), _mm_mul_pd(_mm_set1_pd(H[index]), s));
+				gs = _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(G[index]), s), _mm_mul_pd(_mm_set1_pd(H[index]), c));
+				Bz = _mm_sub_pd(Bz, _mm_mul_pd(gc, nP));
+				By = _mm_add_pd(By, _mm_mul_pd(gs, mP));
+				Bx = _mm_sub_pd(Bx, _mm_mul_pd(gc, dP));
+				if (n <= nMaxSecVar)
+				{
+					gc = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(dG[index]), c), _mm_mul_pd(_mm_set1_pd(dH[index]), s));
+					gs = _mm_sub_pd(_mm_mul_pd(_mm_set1_pd(dG[index]), s), _mm_mul_pd(_mm_set1_pd(dH[index]), c));
+					BzSV = _mm_sub_pd(BzSV, _mm_mul_pd(gc, nP));
+					BySV = _mm_add_pd(BySV, _mm_mul_pd(gs, mP));
+					BxSV = _mm_sub_pd(BxSV, _mm_mul_pd(gc, dP));
+				}
+			}
+		}
+		_mm_storeu_pd(&Results[0 * L + p], Bx);
+		_mm_storeu_pd(&Results[1 * L + p], By);
+		_mm_storeu_pd(&Results[2 * L + p], Bz);
+		_mm_storeu_pd(&Results[3 * L + p], BxSV);
+		_mm_storeu_pd(&Results[4 * L + p], BySV);
+		_mm_storeu_pd(&Results[5 * L + p], BzSV);
+	}
+} /*WMM_SummationBlockSSE2*/
+
+__attribute__((target("avx2,fma")))
+void WMM_SummationBlockAVX2(WMMtype_Workspace *Workspace, double *G, double *H, double *dG, double *dH, int nMax, int nMaxSecVar, double *Results)
+
+	/* AVX2/FMA kernel of WMM_SummationBlock, 4 points per instruction.
+	CALLS : none
+	*/
+{
+	int m, n, p, index, L = WMM_SIMD_LANES;
+	__m256d Bx, By, Bz, BxSV, BySV, BzSV, R, c, s, P, dP, gc, gs, nP, mP;
+
+	for (p = 0; p < L; p += 4)
+	{
+		Bx = By = Bz = BxSV = BySV = BzSV = _mm256_setzero_pd();
+		for (n = 1; n <= nMax; n++)
+		{
+			R = _mm256_loadu_pd(&Workspace->RelativeRadiusPowerBlock[n * L + p]);
+			for (m = 0; m <= n; m++)
+			{
+				index = (n * (n + 1) / 2 + m);
+				c = _mm256_mul_pd(R, _mm256_loadu_pd(&Workspace->cos_mlambdaBlock[m * L + p]));
+				s = _mm256_mul_pd(R, _mm256_loadu_pd(&Workspace->sin_mlambdaBlock[m * L + p]));
+				P = _mm256_loadu_pd(&Workspace->PcupBlock[index * L + p]);
+				dP = _mm256_loadu_pd(&Workspace->dPcupBlock[index * L + p]);
+				nP = _mm256_mul_pd(_mm256_set1_pd((double) (n+1)), P);
+				mP = _mm256_mul_pd(_mm256_set1_pd((double) (m)), P);
+				gc = _mm256_fmadd_pd(_mm256_set1_pd(G[index]), c, _mm256_mul_pd(_mm256_set1_pd(H[index]), s));
+				gs = _mm256_fmsub_pd(_mm256_set1_pd(G[index]), s, _mm256_mul_pd(_mm256_set1_pd(H[index]), c));
+				Bz = _mm256_fnmadd_pd(gc, nP, Bz);
+				By = _mm256_fmadd_pd(gs, mP, By);
+				Bx = _mm256_fnmadd_pd(gc, dP, Bx);
+				if (n <= nMaxSecVar)
+				{
+					gc = _mm256_fmadd_pd(_mm256_set1_pd(dG[index]), c, _mm256_mul_pd(_mm256_set1_pd(dH[index]), s));
+					gs = _mm256_fmsub_pd(_mm256_set1_pd(dG[index]), s, _mm256_mul_pd(_mm256_set1_pd(dH[index]), c));
+					BzSV = _mm256_fnmadd_pd(gc, nP, BzSV);
+					BySV = _mm256_fmadd_pd(gs, mP, BySV);
+					BxSV = _mm256_fnmadd_pd(gc, dP, BxSV);
+				}
+			}
+		}
+		_mm256_storeu_pd(&Results[0 * L + p], Bx);
+		_mm256_storeu_pd(&Results[1 * L + p], By);
+		_mm256_storeu_pd(&Results[2 * L + p], Bz);
+		_mm256_storeu_pd(&Results[3 * L + p], BxSV);
+		_mm256_storeu_pd(&Results[4 * L + p], BySV);
+		_mm256_storeu_pd(&Results[5 * L + p], BzSV);
+	}
+} /*WMM_SummationBlockAVX2*/
+
+__attribute__((target("avx512f")))
+void WMM_SummationBlockAVX512(WMMtype_Workspace *Workspace, double *G, double *H, double *dG, double *dH, int nMax, int nMaxSecVar, double *Results)
+
+	/* AVX-512F kernel of WMM_SummationBlock, all WMM_SIMD_LANES points per instruction.
+	CALLS : none
+	*/
+{
+	int m, n, index, L = WMM_SIMD_LANES;
+	__m512d Bx, By, Bz, BxSV, BySV, BzSV, R, c, s, P, dP, gc, gs, nP, mP;
+
+	Bx = By = Bz = BxSV = BySV = BzSV = _mm512_setzero_pd();
+	for (n = 1; n <= nMax; n++)
+	{
+		R = _mm512_loadu_pd(&Workspace->RelativeRadiusPowerBlock[n * L]);
+		for (m = 0; m <= n; m++)
+		{
+			index = (n * (n + 1) / 2 + m);
+			c = _mm512_mul_pd(R, _mm512_loadu_pd(&Workspace->cos_mlambdaBlock[m * L]));
+			s = _mm512_mul_pd(R, _mm512_loadu_pd(&Workspace->sin_mlambdaBlock[m * L]));
+			P = _mm512_loadu_pd(&Workspace->PcupBlock[index * L]);
+			dP = _mm512_loadu_pd(&Workspace->dPcupBlock[index * L]);
+			nP = _mm512_mul_pd(_mm512_set1_pd((double) (n+1)), P);
+			mP = _mm512_mul_pd(_mm512_set1_pd((double) (m)), P);
+			gc = _mm512_fmadd_pd(_mm512_set1_pd(G[index]), c, _mm512_mul_pd(_mm512_set1_pd(H[index]), s));
+			gs = _mm512_fmsub_pd(_mm512_set1_pd(G[index]), s, _mm512_mul_pd(_mm512_set1_pd(H[index]), c));
+			Bz = _mm512_fnmadd_pd(gc, nP, Bz);
+			By = _mm512_fmadd_pd(gs, mP, By);
+			Bx = _mm512_fnmadd_pd(gc, dP, Bx);
+			if (n <= nMaxSecVar)
+			{
+				gc = _mm512_fmadd_pd(_mm512_set1_pd(dG[index]), c, _mm512_mul_pd(_mm512_set1_pd(dH[index]), s));
+				gs = _mm512_fmsub_pd(_mm512_set1_pd(dG[index]), s, _mm512_mul_pd(_mm512_set1_pd(dH[index]), c));
+				BzSV = _mm512_fnmadd_pd(gc, nP, BzSV);
+				BySV = _mm512_fmadd_pd(gs, mP, BySV);
+				BxSV = _mm512_fnmadd_pd(gc, dP, BxSV);
+			}
+		}
+	}
+	_mm512_storeu_pd(&Results[0 * L], Bx);
+	_mm512_storeu_pd(&Results[1 * L], By);
+	_mm512_storeu_pd(&Results[2 * L], Bz);
+	_mm512_storeu_pd(&Results[3 * L], BxSV);
+	_mm512_storeu_pd(&Results[4 * L], BySV);
+	_mm512_storeu_pd(&Results[5 * L], BzSV);
+} /*WMM_SummationBlockAVX512*/
+
+#endif /* WMM_SIMD_X86 */
+
+void WMM_SummationFloatBlock(WMMtype_Workspace *Workspace, const WMMtype_Float *G, const WMMtype_Float *H, const WMMtype_Float *dG, const WMMtype_Float *dH, int nMax, int nMaxSecVar, WMMtype_Float *Results)
+
+	/* WMM_SummationBlock in single precision, for WMM_FLOAT_LANES points. A vector holds twice as
+	many floats as doubles, so each kernel sums twice the points per instruction of its double
+	counterpart.
+
+	INPUT :  Workspace	PcupFloat, dPcupFloat, RelativeRadiusPowerFloat, cos_mlambdaFloat and
+						sin_mlambdaFloat filled for WMM_FLOAT_LANES points
+			G, H, dG, dH	Coefficients of Workspace->FloatCoeff
+			nMax, nMaxSecVar
+	OUTPUT : Results	6 * WMM_FLOAT_LANES values, element [c * WMM_FLOAT_LANES + lane], as WMM_SummationBlock.
+						By is not yet divided by cos(phi).
+
+	CALLS : WMM_SummationFloatBlockScalar, WMM_SummationFloatBlockSSE2, WMM_SummationFloatBlockAVX2,
+			WMM_SummationFloatBlockAVX512
+	*/
+{
+	WMM_STATS_BEGIN(WMM_STAT_SUMMATION);
+	switch (WMM_GetSimdLevel())
+	{
+#if WMM_SIMD_X86
+		case WMM_SIMD_AVX512:
+			WMM_SummationFloatBlockAVX512(Workspace, G, H, dG, dH, nMax, nMaxSecVar, Results);
+			break;
+		case WMM_SIMD_AVX2:
+			WMM_SummationFloatBlockAVX2(Workspace, G, H, dG, dH, nMax, nMaxSecVar, Results);
+			break;
+		case WMM_SIMD_SSE2:
+			WMM_SummationFloatBlockSSE2(Workspace, G, H, dG, dH, nMax, nMaxSecVar, Results);
+			break;
+#endif
+		default:
+			WMM_SummationFloatBlockScalar(Workspace, G, H, dG, dH, nMax, nMaxSecVar, Results);
+			break;
+	}
+	WMM_STATS_END(WMM_STAT_SUMMATION);
+} /*WMM_SummationFloatBlock*/
+
+void WMM_SummationFloatBlockScalar(WMMtype_Workspace *Workspace, const WMMtype_Float *G, const WMMtype_Float *H, const WMMtype_Float *dG, const WMMtype_Float *dH, int nMax, int nMaxSecVar, WMMtype_Float *Results)
+
+	/* Portable kernel of WMM_SummationFloatBlock, the operations of WMM_SummationBlockScalar in float.
+	CALLS : none
+	*/
+{
+	int m, n, p, index, L = WMM_FLOAT_LANES;
+	WMMtype_Float Bx, By, Bz, BxSV, BySV, BzSV, R, c, s, P, dP;
+
+	for (p = 0; p < L; p++)
+	{
+		Bx = By = Bz = BxSV = BySV = BzSV = 0;
+		for (n = 1; n <= nMax; n++)
+		{
+			R = Workspace->RelativeRadiusPowerFloat[n * L + p];
+			for (m = 0; m <= n; m++)
+			{
+				index = (n * (n + 1) / 2 + m);
+				c = Workspace->cos_mlambdaFloat[m * L + p];
+				s = Workspace->sin_mlambdaFloat[m * L + p];
+				P = Workspace->PcupFloat[index * L + p];
+				dP = Workspace->dPcupFloat[index * L + p];
+				Bz -= R * ( G[index] * c + H[index] * s ) * (WMMtype_Float) (n+1) * P;
+				By += R * ( G[index] * s - H[index] * c ) * (WMMtype_Float) (m) * P;
+				Bx -= R * ( G[index] * c + H[index] * s ) * dP;
+				if (n <= nMaxSecVar)
+				{
+					BzSV -= R * ( dG[index] * c + dH[index] * s ) * (WMMtype_Float) (n+1) * P;
+					BySV += R * ( dG[index] * s - dH[index] * c ) * (WMMtype_Float) (m) * P;
+					BxSV -= R * ( dG[index] * c + dH[index] * s ) * dP;
+				}
+			}
+		}
+		Results[0 * L + p] = Bx;
+		Results[1 * L + p] = By;
+		Results[2 * L + p] = Bz;
+		Results[3 * L + p] = BxSV;
+		Results[4 * L + p] = BySV;
+		Results[5 * L + p] = BzSV;
+	}
+} /*WMM_SummationFloatBlockScalar*/
+
+#if WMM_SIMD_X86
+
+__attribute__((target("sse2")))
+void WMM_SummationFloatBlockSSE2(WMMtype_Workspace *Workspace, const WMMtype_Float *G, const WMMtype_Float *H, const WMMtype_Float *dG, const WMMtype_Float *dH, int nMax, int nMaxSecVar, WMMtype_Float *Results)
+
+	/* SSE2 kernel of WMM_SummationFloatBlock, 4 points per instruction.
+	CALLS : none
+	*/
+{
+	int m, n, p, index, L = WMM_FLOAT_LANES;
+	__m128 Bx, By, Bz, BxSV, BySV, BzSV, R, c, s, P, dP, gc, gs, nP, mP;
+
+	for (p = 0; p < L; p += 4)
+	{
+		Bx = By = Bz = BxSV = BySV = BzSV = _mm_setzero_ps();
+		for (n = 1; n <= nMax; n++)
+		{
+			R = _mm_loadu_ps(&Workspace->RelativeRadiusPowerFloat[n * L + p]);
+			for (m = 0; m <= n; m++)
+			{
+				index = (n * (n + 1) / 2 + m);
+				c = _mm_mul_ps(R, _mm_loadu_ps(&Workspace->cos_mlambdaFloat[m * L + p]));
+				s = _mm_mul_ps(R, _mm_loadu_ps(&Workspace->sin_mlambdaFloat[m * L + p]));
+				P = _mm_loadu_ps(&Workspace->PcupFloat[index * L + p]);
+				dP = _mm_loadu_ps(&Workspace->dPcupFloat[index * L + p]);
+				nP = _mm_mul_ps(_mm_set1_ps((WMMtype_Float) (n+1)), P);
+				mP = _mm_mul_ps(_mm_set1_ps((WMMtype_Float) (m)), P);
+				gc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(G[index]), c), _mm_mul_ps(_mm_set1_ps(H[index]), s));
+				gs = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(G[index]), s), _mm_mul_ps(_mm_set1_ps(H[index]), c));
+				Bz = _mm_sub_ps(Bz, _mm_mul_ps(gc, nP));
+				By = _mm_add_ps(By, _mm_mul_ps(gs, mP));
+				Bx = _mm_sub_ps(Bx, _mm_mul_ps(gc, dP));
+				if (n <= nMaxSecVar)
+				{
+					gc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dG[index]), c), _mm_mul_ps(_mm_set1_ps(dH[index]), s));
+					gs = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(dG[index]), s), _mm_mul_ps(_mm_set1_ps(dH[index]), c));
+					BzSV = _mm_sub_ps(BzSV, _mm_mul_ps(gc, nP));
+					BySV = _mm_add_ps(BySV, _mm_mul_ps(gs, mP));
+					BxSV = _mm_sub_ps(BxSV, _mm_mul_ps(gc, dP));
+				}
+			}
+		}
+		_mm_storeu_ps(&Results[0 * L + p], Bx);
+		_mm_storeu_ps(&Results[1 * L + p], By);
+		_mm_storeu_ps(&Results[2 * L + p], Bz);
+		_mm_storeu_ps(&Results[3 * L + p], BxSV);
+		_mm_storeu_ps(&Results[4 * L + p], BySV);
+		_mm_storeu_ps(&Results[5 * L + p], BzSV);
+	}
+} /*WMM_SummationFloatBlockSSE2*/
+
+__attribute__((target("avx2,fma")))
+void WMM_SummationFloatBlockAVX2(WMMtype_Workspace *Workspace, const WMMtype_Float *G, const WMMtype_Float *H, const WMMtype_Float *dG, const WMMtype_Float *dH, int nMax, int nMaxSecVar, WMMtype_Float *Results)
+
+	/* AVX2/FMA kernel of WMM_SummationFloatBlock, 8 points per instruction.
+	CALLS : none
+	*/
+{
+	int m, n, p, index, L = WMM_FLOAT_LANES;
+	__m256 Bx, By, Bz, BxSV, BySV, BzSV, R, c, s, P, dP, gc, gs, nP, mP;
+
+	for (p = 0; p < L; p += 8)
+	{
+		Bx = By = Bz = BxSV = BySV = BzSV = _mm256_setzero_ps();
+		for (n = 1; n <= nMax; n++)
+		{
+			R = _mm256_loadu_ps(&Workspace->RelativeRadiusPowerFloat[n * L + p]);
+			for (m = 0; m <= n; m++)
+			{
+				index = (n * (n + 1) / 2 + m);
+				c = _mm256_mul_ps(R, _mm256_loadu_ps(&Workspace->cos_mlambdaFloat[m * L + p]));
+				s = _mm256_mul_ps(R, _mm256_loadu_ps(&Workspace->sin_mlambdaFloat[m * L + p]));
+				P = _mm256_loadu_ps(&Workspace->PcupFloat[index * L + p]);
+				dP = _mm256_loadu_ps(&Workspace->dPcupFloat[index * L + p]);
+				nP = _mm256_mul_ps(_mm256_set1_ps((WMMtype_Float) (n+1)), P);
+				mP = _mm256_mul_ps(_mm256_set1_ps((WMMtype_Float) (m)), P);
+				gc = _mm256_fmadd_ps(_mm256_set1_ps(G[index]), c, _mm256_mul_ps(_mm256_set1_ps(H[index]), s));
+				gs = _mm256_fmsub_ps(_mm256_set1_ps(G[index]), s, _mm256_mul_ps(_mm256_set1_ps(H[index]), c));
+				Bz = _mm256_fnmadd_ps(gc, nP, Bz);
+				By = _mm256_fmadd_ps(gs, mP, By);
+				Bx = _mm256_fnmadd_ps(gc, dP, Bx);
+				if (n <= nMaxSecVar)
+				{
+					gc = _mm256_fmadd_ps(_mm256_set1_ps(dG[index]), c, _mm256_mul_ps(_mm256_set1_ps(dH[index]), s));
+					gs = _mm256_fmsub_ps(_mm256_set1_ps(dG[index]), s, _mm256_mul_ps(_mm256_set1_ps(dH[index]), c));
+					BzSV = _mm256_fnmadd_ps(gc, nP, BzSV);
+					BySV = _mm256_fmadd_ps(gs, mP, BySV);
+					BxSV = _mm256_fnmadd_ps(gc, dP, BxSV);
+				}
+			}
+		}
+		_mm256_storeu_ps(&Results[0 * L + p], Bx);
+		_mm256_storeu_ps(&Results[1 * L + p], By);
+		_mm256_storeu_ps(&Results[2 * L + p], Bz);
+		_mm256_storeu_ps(&Results[3 * L + p], BxSV);
+		_mm256_storeu_ps(&Results[4 * L + p], BySV);
+		_mm256_storeu_ps(&Results[5 * L + p], BzSV);
+	}
+} /*WMM_SummationFloatBlockAVX2*/
+
+__attribute__((target("avx512f")))
+void WMM_SummationFloatBlockAVX512(WMMtype_Workspace *Workspace, const WMMtype_Float *G, const WMMtype_Float *H, const WMMtype_Float *dG, const WMMtype_Float *dH, int nMax, int nMaxSecVar, WMMtype_Float *Results)
+
+	/* AVX-512F kernel of WMM_SummationFloatBlock, all WMM_FLOAT_LANES points per instruction.
+	CALLS : none
+	*/
+{
+	int m, n, index, L = WMM_FLOAT_LANES;
+	__m512 Bx, By, Bz, BxSV, BySV, BzSV, R, c, s, P, dP, gc, gs, nP, mP;
+
+	Bx = By = Bz = BxSV = BySV = BzSV = _mm512_setzero_ps();
+	for (n = 1; n <= nMax; n++)
+	{
+		R = _mm512_loadu_ps(&Workspace->RelativeRadiusPowerFloat[n * L]);
+		for (m = 0; m <= n; m++)
+		{
+			index = (n * (n + 1) / 2 + m);
+			c = _mm512_mul_ps(R, _mm512_loadu_ps(&Workspace->cos_mlambdaFloat[m * L]));
+			s = _mm512_mul_ps(R, _mm512_loadu_ps(&Workspace->sin_mlambdaFloat[m * L]));
+			P = _mm512_loadu_ps(&Workspace->PcupFloat[index * L]);
+			dP = _mm512_loadu_ps(&Workspace->dPcupFloat[index * L]);
+			nP = _mm512_mul_ps(_mm512_set1_ps((WMMtype_Float) (n+1)), P);
+			mP = _mm512_mul_ps(_mm512_set1_ps((WMMtype_Float) (m)), P);
+			gc = _mm512_fmadd_ps(_mm512_set1_ps(G[index]), c, _mm512_mul_ps(_mm512_set1_ps(H[index]), s));
+			gs = _mm512_fmsub_ps(_mm512_set1_ps(G[index]), s, _mm512_mul_ps(_mm512_set1_ps(H[index]), c));
+			Bz = _mm512_fnmadd_ps(gc, nP, Bz);
+			By = _mm512_fmadd_ps(gs, mP, By);
+			Bx = _mm512_fnmadd_ps(gc, dP, Bx);
+			if (n <= nMaxSecVar)
+			{
+				gc = _mm512_fmadd_ps(_mm512_set1_ps(dG[index]), c, _mm512_mul_ps(_mm512_set1_ps(dH[index]), s));
+				gs = _mm512_fmsub_ps(_mm512_set1_ps(dG[index]), s, _mm512_mul_ps(_mm512_set1_ps(dH[index]), c));
+				BzSV = _mm512_fnmadd_ps(gc, nP, BzSV);
+				BySV = _mm512_fmadd_ps(gs, mP, BySV);
+				BxSV = _mm512_fnmadd_ps(gc, dP, BxSV);
+			}
+		}
+	}
+	_mm512_storeu_ps(&Results[0 * L], Bx);
+	_mm512_storeu_ps(&Results[1 * L], By);
+	_mm512_storeu_ps(&Results[2 * L], Bz);
+	_mm512_storeu_ps(&Results[3 * L], BxSV);
+	_mm512_storeu_ps(&Results[4 * L], BySV);
+	_mm512_storeu_ps(&Results[5 * L], BzSV);
+} /*WMM_SummationFloatBlockAVX512*/
+
+#endif /* WMM_SIMD_X86 */
+
+int WMM_SummationSpecial(WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults)
+	/* Special calculation for the component By at Geographic poles.
+	Manoj Nair, June, 2009 manoj.c.nair@noaa.gov
+    INPUT: MagneticModel
+		   SphVariables
+		   CoordSpherical
+	OUTPUT: MagneticResults
+	CALLS : none
+	See Section 1.4, "SINGULARITIES AT THE GEOGRAPHIC POLES", WMM Technical report
+
+	*/
+	{
+	double *PcupS;
+	int FLAG;
+
+	PcupS = (double *) malloc ( (MagneticModel->nMax +1) * sizeof (double) );
+	if (PcupS == 0)
+	{
+		WMM_Error(14);
+		//printf("error allocating in WMM_SummationSpecial\n");
+		return FALSE;
+	}
+
+	FLAG = WMM_SummationSpecialWithScratch(MagneticModel, SphVariables, CoordSpherical, MagneticResults, PcupS);
+
+	if (PcupS)
+		free(PcupS);
+	return FLAG;
+	}/*WMM_SummationSpecial */
+
+int WMM_SummationSpecialWithScratch(WMMtype_MagneticModel *MagneticModel, WMMtype_SphericalHarmonicVariables SphVariables, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticResults *MagneticResults, double *PcupS)
+	/* Same as WMM_SummationSpecial, using the caller supplied scratch space PcupS
+	of nMax+1 doubles.
+    INPUT: MagneticModel
+		   SphVariables
+		   CoordSpherical
+		   PcupS
+	OUTPUT: MagneticResults
+	CALLS : none
+
+	*/
+	{
+	int n, index;
+	double k, sin_phi, schmidtQuasiNorm1, schmidtQuasiNorm2, schmidtQuasiNorm3;
+
+	PcupS[0] = 1;
+	schmidtQuasiNorm1 = 1.0;
+
+	MagneticResults->By = 0.0;
+	sin_phi = sin ( DEG2RAD ( CoordSpherical.phig ) );
+
+	for (n = 1; n <=  MagneticModel->nMax; n++)
+	{
+
+	/*Compute the ration between the Gauss-normalized associated Legendre
+  functions and the Schmidt quasi-normalized version. This is equivalent to
+  sqrt((m==0?1:2)*(n-m)!/(n+m!))*(2n-1)!!/(n-m)!  */
+
+		index = (n * (n + 1) / 2 + 1);
+		schmidtQuasiNorm2 = schmidtQuasiNorm1 * (double) (2 * n - 1) / (double) n;
+		schmidtQuasiNorm3 = schmidtQuasiNorm2 *  sqrt( (double) (n * 2) / (double) (n + 1));
+		schmidtQuasiNorm1 = schmidtQuasiNorm2;
+		if (n == 1)
+		{
+			PcupS[n] = PcupS[n-1];
+		}
+		else
+		{
+			k = (double)( ( (n - 1) * (n - 1) ) - 1) / ( double ) ( (2 * n - 1) * (2 * n - 3) );
+			PcupS[n] =     sin_phi * PcupS[n-1] - k * PcupS[n-2];
+		}
+
+/*		  1 nMax  (n+2)    n     m            m           m
+	By =    SUM (a/r) (m)  SUM  [g cos(m p) + h sin(m p)] dP (sin(phi))
+		   n=1             m=0   n            n           n  */
+/* Equation 11 in the WMM Technical report. Derivative with respect to longitude, divided by radius. */
+
+		MagneticResults->By += 	SphVariables.RelativeRadiusPower[n] *
+					(	MagneticModel->Main_Field_Coeff_G[index]*SphVariables.sin_mlambda[1] -
+						MagneticModel->Main_Field_Coeff_H[index]*SphVariables.cos_mlambda[1]  )
+						*  PcupS[n] * schmidtQuasiNorm3;
+	}
+
+	return TRUE;
+	}/*WMM_SummationSpecialWithScratch */
+
+int WMM_TimelyModifyMagneticModel(WMMtype_Date UserDate, WMMtype_MagneticModel *MagneticModel,  WMMtype_MagneticModel *TimedMagneticModel)
+
+	/* Time change the Model coefficients from the base year of the model using secular variation coefficients.
+	Store the coefficients of the static model with their values advanced from epoch t0 to epoch t.
+	Copy the SV coefficients.  If input "t�" is the same as "t0", then this is merely a copy operation.
+	If the address of "TimedMagneticModel" is the same as the address of "MagneticModel", then this procedure overwrites
+	the given item "MagneticModel".
+
+	INPUT: UserDate
+		   MagneticModel
+	OUTPUT:TimedMagneticModel
+	CALLS : none
+	*/
+
+	{
+	int n, m, index, a, b, NumTerms, Tables;
+	double dt;
+
+	WMM_STATS_BEGIN(WMM_STAT_TIMELY_MODIFY);
+	TimedMagneticModel->EditionDate = MagneticModel->EditionDate;
+	TimedMagneticModel->epoch	   = MagneticModel->epoch;
         TimedMagneticModel->nMax	   	   = MagneticModel->nMax;
 	TimedMagneticModel->nMaxSecVar = MagneticModel->nMaxSecVar;
 	a = TimedMagneticModel->nMaxSecVar;
 	b = (a * (a + 1) / 2 + a);
 	strcpy(TimedMagneticModel->ModelName,MagneticModel->ModelName);
+	dt = UserDate.DecimalYear - MagneticModel->epoch;
+
+	/* Carry the coefficient tables over. The normalization and recursion tables depend only on nMax
+	and are copied only when the time modified model does not have them yet. */
+	Tables = (MagneticModel->CoefficientTablesNMax == MagneticModel->nMax && TimedMagneticModel->Main_Field_Coeff_GS != NULL);
+	if (Tables && TimedMagneticModel->CoefficientTablesNMax != MagneticModel->nMax)
+	{
+		NumTerms = ( ( MagneticModel->nMax + 1 ) * ( MagneticModel->nMax + 2 ) / 2 );
+		memcpy(TimedMagneticModel->SchmidtQuasiNorm, MagneticModel->SchmidtQuasiNorm, NumTerms * sizeof(double));
+		memcpy(TimedMagneticModel->RecursionCoeff, MagneticModel->RecursionCoeff, NumTerms * sizeof(double));
+	}
+	TimedMagneticModel->CoefficientTablesNMax = Tables ? MagneticModel->nMax : 0;
+
 	for (n = 1; n <=  MagneticModel->nMax; n++)
 	{
 		for (m=0;m<=n;m++)
@@ -2757,18 +5694,31 @@ int WMM_TimelyModifyMagneticModel(WMMtype_Date UserDate, WMMtype_MagneticModel *
 			index = (n * (n + 1) / 2 + m);
 			if(index <= b)
 			{
-				TimedMagneticModel->Main_Field_Coeff_H[index]   = MagneticModel->Main_Field_Coeff_H[index] + (UserDate.DecimalYear - MagneticModel->epoch) * MagneticModel->Secular_Var_Coeff_H[index];
-				TimedMagneticModel->Main_Field_Coeff_G[index]   = MagneticModel->Main_Field_Coeff_G[index] + (UserDate.DecimalYear - MagneticModel->epoch) * MagneticModel->Secular_Var_Coeff_G[index];
+				TimedMagneticModel->Main_Field_Coeff_H[index]   = MagneticModel->Main_Field_Coeff_H[index] + dt * MagneticModel->Secular_Var_Coeff_H[index];
+				TimedMagneticModel->Main_Field_Coeff_G[index]   = MagneticModel->Main_Field_Coeff_G[index] + dt * MagneticModel->Secular_Var_Coeff_G[index];
 				TimedMagneticModel->Secular_Var_Coeff_H[index]  = MagneticModel->Secular_Var_Coeff_H[index]; // We need a copy of the secular var coef to calculate secular change
 				TimedMagneticModel->Secular_Var_Coeff_G[index]  = MagneticModel->Secular_Var_Coeff_G[index];
+				if (Tables)
+				{
+					TimedMagneticModel->Main_Field_Coeff_HS[index]   = MagneticModel->Main_Field_Coeff_HS[index] + dt * MagneticModel->Secular_Var_Coeff_HS[index];
+					TimedMagneticModel->Main_Field_Coeff_GS[index]   = MagneticModel->Main_Field_Coeff_GS[index] + dt * MagneticModel->Secular_Var_Coeff_GS[index];
+					TimedMagneticModel->Secular_Var_Coeff_HS[index]  = MagneticModel->Secular_Var_Coeff_HS[index];
+					TimedMagneticModel->Secular_Var_Coeff_GS[index]  = MagneticModel->Secular_Var_Coeff_GS[index];
+				}
 			}
 			else
 			{
 				TimedMagneticModel->Main_Field_Coeff_H[index] = MagneticModel->Main_Field_Coeff_H[index];
 				TimedMagneticModel->Main_Field_Coeff_G[index] = MagneticModel->Main_Field_Coeff_G[index];
+				if (Tables)
+				{
+					TimedMagneticModel->Main_Field_Coeff_HS[index] = MagneticModel->Main_Field_Coeff_HS[index];
+					TimedMagneticModel->Main_Field_Coeff_GS[index] = MagneticModel->Main_Field_Coeff_GS[index];
+				}
 			}
 		}
 	}
+	WMM_STATS_END(WMM_STAT_TIMELY_MODIFY);
 	return TRUE;
 	} /* WMM_TimelyModifyMagneticModel */
 
@@ -3023,8 +5973,7 @@ int WMM_Geomag(WMMtype_Ellipsoid Ellip,  WMMtype_CoordSpherical CoordSpherical,
    CALLS:  	WMM_AllocateLegendreFunctionMemory(NumTerms);  ( For storing the ALF functions )
 			WMM_ComputeSphericalHarmonicVariables( Ellip, CoordSpherical, TimedMagneticModel->nMax, &SphVariables); (Compute Spherical Harmonic variables  )
 			WMM_AssociatedLegendreFunction(CoordSpherical, TimedMagneticModel->nMax, LegendreFunction);  	Compute ALF
-			WMM_Summation(LegendreFunction, TimedMagneticModel, SphVariables, CoordSpherical, &MagneticResultsSph);  Accumulate the spherical harmonic coefficients
-			WMM_SecVarSummation(LegendreFunction, TimedMagneticModel, SphVariables, CoordSpherical, &MagneticResultsSphVar); Sum the Secular Variation Coefficients
+			WMM_SummationWithSecVar(LegendreFunction, TimedMagneticModel, SphVariables, CoordSpherical, &MagneticResultsSph, &MagneticResultsSphVar, NULL);  Accumulate the spherical harmonic and Secular Variation coefficients
 			WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSph, &MagneticResultsGeo); Map the computed Magnetic fields to Geodeitic coordinates
 			WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSphVar, &MagneticResultsGeoVar);  Map the secular variation field components to Geodetic coordinates
 			WMM_CalculateGeoMagneticElements(&MagneticResultsGeo, GeoMagneticElements);   Calculate the Geomagnetic elements
@@ -3040,27 +5989,1134 @@ int WMM_Geomag(WMMtype_Ellipsoid Ellip,  WMMtype_CoordSpherical CoordSpherical,
 	int NumTerms;
 	WMMtype_MagneticResults MagneticResultsSph, MagneticResultsGeo, MagneticResultsSphVar, MagneticResultsGeoVar;
 
+	WMM_STATS_BEGIN(WMM_STAT_GEOMAG);
 	NumTerms = ( ( WMM_MAX_MODEL_DEGREES + 1 ) * ( WMM_MAX_MODEL_DEGREES + 2 ) / 2 );    /* MAXDEGREEOFMODEL is defined in WMMHEADER.H */
 	LegendreFunction 		   = WMM_AllocateLegendreFunctionMemory(NumTerms);  /* For storing the ALF functions */
 
 	WMM_ComputeSphericalHarmonicVariables( Ellip, CoordSpherical, TimedMagneticModel->nMax, &SphVariables); /* Compute Spherical Harmonic variables  */
 	WMM_AssociatedLegendreFunction(CoordSpherical, TimedMagneticModel->nMax, LegendreFunction);  	/* Compute ALF  */
-	WMM_Summation(LegendreFunction, TimedMagneticModel, SphVariables, CoordSpherical, &MagneticResultsSph); /* Accumulate the spherical harmonic coefficients*/
-	WMM_SecVarSummation(LegendreFunction, TimedMagneticModel, SphVariables, CoordSpherical, &MagneticResultsSphVar); /*Sum the Secular Variation Coefficients  */
+	WMM_SummationWithSecVar(LegendreFunction, TimedMagneticModel, SphVariables, CoordSpherical, &MagneticResultsSph, &MagneticResultsSphVar, NULL); /* Accumulate the spherical harmonic and Secular Variation coefficients */
 	WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSph, &MagneticResultsGeo); /* Map the computed Magnetic fields to Geodeitic coordinates  */
 	WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSphVar, &MagneticResultsGeoVar); /* Map the secular variation field components to Geodetic coordinates*/
 	WMM_CalculateGeoMagneticElements(&MagneticResultsGeo, GeoMagneticElements);   /* Calculate the Geomagnetic elements, Equation 18 , WMM Technical report */
 	WMM_CalculateSecularVariation(MagneticResultsGeoVar, GeoMagneticElements); /*Calculate the secular variation of each of the Geomagnetic elements*/
 
 	WMM_FreeLegendreMemory(LegendreFunction);
+	WMM_STATS_END(WMM_STAT_GEOMAG);
+
+    return TRUE;
+	} /*WMM_Geomag*/
+
+int WMM_GeomagWithWorkspace(WMMtype_Ellipsoid Ellip,  WMMtype_CoordSpherical CoordSpherical, WMMtype_CoordGeodetic CoordGeodetic,
+	WMMtype_MagneticModel *TimedMagneticModel, WMMtype_GeoMagneticElements  *GeoMagneticElements, WMMtype_Workspace *Workspace)
+   /*
+   Same as WMM_Geomag, but all buffers and tables come from a workspace allocated once with
+   WMM_AllocateWorkspace, so no heap memory is allocated per point. The spherical field and its
+   secular variation come from WMM_SphericalSummationWithWorkspace; the results agree with
+   WMM_Geomag to rounding. Each thread must use its own workspace.
+
+   INPUT: Ellip
+		 CoordSpherical
+		 CoordGeodetic
+		 TimedMagneticModel
+		 Workspace	Allocated for at least TimedMagneticModel->nMax
+
+   OUTPUT : GeoMagneticElements
+
+   CALLS:  	WMM_SphericalSummationWithWorkspace
+			WMM_RotateMagneticVector
+			WMM_CalculateGeoMagneticElements
+			WMM_CalculateSecularVariation
+
+   */
+	{
+	WMMtype_MagneticResults MagneticResultsSph, MagneticResultsGeo, MagneticResultsSphVar, MagneticResultsGeoVar;
+
+	WMM_STATS_BEGIN(WMM_STAT_GEOMAG);
+	if (!WMM_SphericalSummationWithWorkspace(Ellip, CoordSpherical, TimedMagneticModel, Workspace, &MagneticResultsSph, &MagneticResultsSphVar))
+	{
+		WMM_STATS_END(WMM_STAT_GEOMAG);
+		return FALSE;
+	}
+	WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSph, &MagneticResultsGeo); /* Map the computed Magnetic fields to Geodeitic coordinates  */
+	WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSphVar, &MagneticResultsGeoVar); /* Map the secular variation field components to Geodetic coordinates*/
+	WMM_CalculateGeoMagneticElements(&MagneticResultsGeo, GeoMagneticElements);   /* Calculate the Geomagnetic elements, Equation 18 , WMM Technical report */
+	WMM_CalculateSecularVariation(MagneticResultsGeoVar, GeoMagneticElements); /*Calculate the secular variation of each of the Geomagnetic elements*/
+	WMM_STATS_END(WMM_STAT_GEOMAG);
+
+    return TRUE;
+	} /*WMM_GeomagWithWorkspace*/
+
+int WMM_SphericalSummationWithWorkspace(WMMtype_Ellipsoid Ellip, WMMtype_CoordSpherical CoordSpherical, WMMtype_MagneticModel *TimedMagneticModel,
+	WMMtype_Workspace *Workspace, WMMtype_MagneticResults *MagneticResultsSph, WMMtype_MagneticResults *MagneticResultsSphVar)
+   /*
+   Computes the main field and secular variation vectors in spherical coordinates for a single point,
+   using the buffers and tables of the workspace. This is the part of WMM_GeomagWithWorkspace that
+   precedes the rotation to geodetic coordinates. When the model carries the coefficient tables of
+   WMM_ComputeCoefficientTables, the Legendre functions are computed with WMM_PcupLowWithTables and
+   summed with the Schmidt scaled coefficients.
+
+   INPUT: Ellip
+		 CoordSpherical
+		 TimedMagneticModel
+		 Workspace	Allocated for at least TimedMagneticModel->nMax
+
+   OUTPUT : MagneticResultsSph		Main field in spherical coordinates
+			MagneticResultsSphVar	Secular variation in spherical coordinates
+
+   CALLS:  	WMM_ComputeSphericalHarmonicVariables
+			WMM_PcupLowWithTables
+			WMM_AssociatedLegendreFunctionWithWorkspace
+			WMM_SummationWithSecVar
+   */
+	{
+	WMMtype_SphericalHarmonicVariables SphVariables;
+	WMMtype_MagneticModel ScaledModel;
+
+	if (!Workspace || TimedMagneticModel->nMax > Workspace->nMax || TimedMagneticModel->nMaxSecVar > Workspace->nMax)
+		return FALSE;
+
+	WMM_ComputeSphericalHarmonicVariables( Ellip, CoordSpherical, TimedMagneticModel->nMax, &SphVariables); /* Compute Spherical Harmonic variables  */
 
+	if (TimedMagneticModel->CoefficientTablesNMax == TimedMagneticModel->nMax && TimedMagneticModel->nMax <= WMM_TABLE_MAX_DEGREE &&
+		fabs(cos(DEG2RAD(CoordSpherical.phig))) > 1.0e-10)
+	{
+		/* Gauss-normalized functions combined with the Schmidt scaled coefficients of the model.
+		The summations only see the scaled coefficient arrays. */
+		ScaledModel = *TimedMagneticModel;
+		ScaledModel.Main_Field_Coeff_G = TimedMagneticModel->Main_Field_Coeff_GS;
+		ScaledModel.Main_Field_Coeff_H = TimedMagneticModel->Main_Field_Coeff_HS;
+		ScaledModel.Secular_Var_Coeff_G = TimedMagneticModel->Secular_Var_Coeff_GS;
+		ScaledModel.Secular_Var_Coeff_H = TimedMagneticModel->Secular_Var_Coeff_HS;
+		WMM_PcupLowWithTables(Workspace->LegendreFunction.Pcup, Workspace->LegendreFunction.dPcup, sin(DEG2RAD(CoordSpherical.phig)), TimedMagneticModel->nMax, TimedMagneticModel->RecursionCoeff);
+		WMM_SummationWithSecVar(&Workspace->LegendreFunction, &ScaledModel, SphVariables, CoordSpherical, MagneticResultsSph, MagneticResultsSphVar, Workspace->PcupS);
+	}
+	else
+	{
+		WMM_AssociatedLegendreFunctionWithWorkspace(CoordSpherical, TimedMagneticModel->nMax, Workspace);  	/* Compute ALF  */
+		WMM_SummationWithSecVar(&Workspace->LegendreFunction, TimedMagneticModel, SphVariables, CoordSpherical, MagneticResultsSph, MagneticResultsSphVar, Workspace->PcupS); /* Accumulate the spherical harmonic and Secular Variation coefficients */
+	}
     return TRUE;
+	} /*WMM_SphericalSummationWithWorkspace*/
+
+int WMM_SphericalSummationBlock(WMMtype_Ellipsoid Ellip, WMMtype_CoordSpherical *CoordSpherical, int NumPoints, WMMtype_MagneticModel *TimedMagneticModel,
+	WMMtype_Workspace *Workspace, WMMtype_MagneticResults *MagneticResultsSph, WMMtype_MagneticResults *MagneticResultsSphVar)
+   /*
+   WMM_SphericalSummationWithWorkspace for up to WMM_SIMD_LANES points. The harmonic variables and Legendre
+   functions of the points are stored interleaved in the workspace and summed together by WMM_SummationBlock.
+   Unused lanes repeat the first point. Points at the geographic poles are redone with
+   WMM_SphericalSummationWithWorkspace, which handles By there.
+
+   INPUT: Ellip
+		 CoordSpherical		NumPoints points
+		 NumPoints			1 to WMM_SIMD_LANES
+		 TimedMagneticModel
+		 Workspace			Allocated for at least TimedMagneticModel->nMax
+
+   OUTPUT : MagneticResultsSph		Main field in spherical coordinates, NumPoints elements
+			MagneticResultsSphVar	Secular variation in spherical coordinates, NumPoints elements
+
+   CALLS:  	WMM_ComputeSphericalHarmonicVariables
+			WMM_PcupLowWithTablesBlock
+			WMM_AssociatedLegendreFunctionWithWorkspace
+			WMM_SummationBlock
+			WMM_SphericalSummationWithWorkspace
+   */
+	{
+	WMMtype_SphericalHarmonicVariables SphVariables;
+	WMMtype_CoordSpherical Point;
+	double x[WMM_SIMD_LANES], cos_phi[WMM_SIMD_LANES], Sum[6 * WMM_SIMD_LANES];
+	int n, p, index, NumTerms, UseTables, L = WMM_SIMD_LANES;
+	int Status = TRUE;
+
+	if (!Workspace || NumPoints < 1 || NumPoints > WMM_SIMD_LANES ||
+		TimedMagneticModel->nMax > Workspace->nMax || TimedMagneticModel->nMaxSecVar > Workspace->nMax)
+		return FALSE;
+
+	NumTerms = ( ( TimedMagneticModel->nMax + 1 ) * ( TimedMagneticModel->nMax + 2 ) / 2 );
+	UseTables = (TimedMagneticModel->CoefficientTablesNMax == TimedMagneticModel->nMax && TimedMagneticModel->nMax <= WMM_TABLE_MAX_DEGREE);
+
+	for (p = 0; p < L; p++)
+	{
+		Point = CoordSpherical[p < NumPoints ? p : 0];
+		WMM_ComputeSphericalHarmonicVariables( Ellip, Point, TimedMagneticModel->nMax, &SphVariables);
+		for (n = 0; n <= TimedMagneticModel->nMax; n++)
+		{
+			Workspace->RelativeRadiusPowerBlock[n * L + p] = SphVariables.RelativeRadiusPower[n];
+			Workspace->cos_mlambdaBlock[n * L + p] = SphVariables.cos_mlambda[n];
+			Workspace->sin_mlambdaBlock[n * L + p] = SphVariables.sin_mlambda[n];
+		}
+		x[p] = sin ( DEG2RAD ( Point.phig ) );
+		cos_phi[p] = cos ( DEG2RAD ( Point.phig ) );
+		if (!UseTables)
+		{
+			WMM_AssociatedLegendreFunctionWithWorkspace(Point, TimedMagneticModel->nMax, Workspace);
+			for (index = 0; index < NumTerms; index++)
+			{
+				Workspace->PcupBlock[index * L + p] = Workspace->LegendreFunction.Pcup[index];
+				Workspace->dPcupBlock[index * L + p] = Workspace->LegendreFunction.dPcup[index];
+			}
+		}
+	}
+
+	if (UseTables)
+	{
+		WMM_PcupLowWithTablesBlock(Workspace->PcupBlock, Workspace->dPcupBlock, x, TimedMagneticModel->nMax, TimedMagneticModel->RecursionCoeff);
+		WMM_SummationBlock(Workspace, TimedMagneticModel->Main_Field_Coeff_GS, TimedMagneticModel->Main_Field_Coeff_HS,
+			TimedMagneticModel->Secular_Var_Coeff_GS, TimedMagneticModel->Secular_Var_Coeff_HS,
+			TimedMagneticModel->nMax, TimedMagneticModel->nMaxSecVar, Sum);
+	}
+	else
+		WMM_SummationBlock(Workspace, TimedMagneticModel->Main_Field_Coeff_G, TimedMagneticModel->Main_Field_Coeff_H,
+			TimedMagneticModel->Secular_Var_Coeff_G, TimedMagneticModel->Secular_Var_Coeff_H,
+			TimedMagneticModel->nMax, TimedMagneticModel->nMaxSecVar, Sum);
+
+	for (p = 0; p < NumPoints; p++)
+	{
+		if ( fabs(cos_phi[p]) > 1.0e-10 )
+		{
+			MagneticResultsSph[p].Bx = Sum[0 * L + p];
+			MagneticResultsSph[p].By = Sum[1 * L + p] / cos_phi[p];
+			MagneticResultsSph[p].Bz = Sum[2 * L + p];
+			MagneticResultsSphVar[p].Bx = Sum[3 * L + p];
+			MagneticResultsSphVar[p].By = Sum[4 * L + p] / cos_phi[p];
+			MagneticResultsSphVar[p].Bz = Sum[5 * L + p];
+		}
+		else if (!WMM_SphericalSummationWithWorkspace(Ellip, CoordSpherical[p], TimedMagneticModel, Workspace, &MagneticResultsSph[p], &MagneticResultsSphVar[p]))
+			Status = FALSE;
+	}
+	return Status;
+	} /*WMM_SphericalSummationBlock*/
+
+int WMM_SphericalSummationFloatBlock(WMMtype_Ellipsoid Ellip, WMMtype_CoordSpherical *CoordSpherical, int NumPoints,
+	WMMtype_Workspace *Workspace, WMMtype_Float *Results)
+   /*
+   WMM_SphericalSummationBlock in single precision for up to WMM_FLOAT_LANES points, with the
+   coefficients converted by WMM_SetWorkspaceFloatCoeff. The spherical coordinates are in double;
+   the sines and cosines of each point are rounded to float once, and the harmonic variables,
+   Legendre functions and sums are float. Unused lanes repeat the first point. At the geographic
+   poles By is summed from the m = 1 terms only, as WMM_SummationSpecial does.
+
+   INPUT: Ellip
+		 CoordSpherical		NumPoints points
+		 NumPoints			1 to WMM_FLOAT_LANES
+		 Workspace			WMM_SetWorkspaceDate and WMM_SetWorkspaceFloatCoeff called
+
+   OUTPUT : Results		6 * WMM_FLOAT_LANES values, element [c * WMM_FLOAT_LANES + lane] with c = 0..5 for
+						Bx, By, Bz of the main field and Bx, By, Bz of the secular variation, in
+						spherical coordinates
+
+   CALLS:  	WMM_PcupLowWithTablesFloatBlock
+			WMM_SummationFloatBlock
+   */
+	{
+	WMMtype_MagneticModel *TimedMagneticModel;
+	WMMtype_CoordSpherical Point;
+	const WMMtype_Float *G, *H, *dG, *dH, *k;
+	WMMtype_Float x[WMM_FLOAT_LANES], z[WMM_FLOAT_LANES], Ratio[WMM_FLOAT_LANES], c[WMM_FLOAT_LANES], s[WMM_FLOAT_LANES];
+	WMMtype_Float R, P, P1, P2, By, BySV;
+	WMMtype_Float *RelativeRadiusPower, *cos_mlambda, *sin_mlambda;
+	double cos_phi[WMM_FLOAT_LANES];
+	const double Deg2Rad = M_PI / 180.0;	/* Double rather than the long double of DEG2RAD, the lanes are float */
+	int n, p, index, nMax, nMaxSecVar, L = WMM_FLOAT_LANES;
+
+	if (!Workspace || NumPoints < 1 || NumPoints > WMM_FLOAT_LANES || !Workspace->FloatSource)
+		return FALSE;
+
+	TimedMagneticModel = Workspace->TimedMagneticModel;
+	nMax = TimedMagneticModel->nMax;
+	nMaxSecVar = TimedMagneticModel->nMaxSecVar;
+	G = Workspace->FloatCoeff;
+	H = G + Workspace->NumTerms;
+	dG = H + Workspace->NumTerms;
+	dH = dG + Workspace->NumTerms;
+	k = dH + Workspace->NumTerms;
+	RelativeRadiusPower = Workspace->RelativeRadiusPowerFloat;
+	cos_mlambda = Workspace->cos_mlambdaFloat;
+	sin_mlambda = Workspace->sin_mlambdaFloat;
+
+	/* (a/r)^(n+2), cos(m lambda) and sin(m lambda) of each lane, as WMM_ComputeSphericalHarmonicVariables */
+	WMM_STATS_BEGIN(WMM_STAT_HARMONIC);
+	for (p = 0; p < L; p++)
+	{
+		Point = CoordSpherical[p < NumPoints ? p : 0];
+		Ratio[p] = (WMMtype_Float) (Ellip.re / Point.r);
+		c[p] = (WMMtype_Float) cos(Deg2Rad * Point.lambda);
+		s[p] = (WMMtype_Float) sin(Deg2Rad * Point.lambda);
+		RelativeRadiusPower[p] = Ratio[p] * Ratio[p];
+		cos_mlambda[p] = 1;
+		sin_mlambda[p] = 0;
+		cos_phi[p] = cos(Deg2Rad * Point.phig);
+		x[p] = (WMMtype_Float) sin(Deg2Rad * Point.phig);
+		z[p] = (WMMtype_Float) cos_phi[p];
+	}
+	for (n = 1; n <= nMax; n++)
+	{
+		WMM_IVDEP
+		for (p = 0; p < L; p++)
+		{
+			RelativeRadiusPower[n * L + p] = RelativeRadiusPower[(n - 1) * L + p] * Ratio[p];
+			cos_mlambda[n * L + p] = cos_mlambda[(n - 1) * L + p] * c[p] - sin_mlambda[(n - 1) * L + p] * s[p];
+			sin_mlambda[n * L + p] = cos_mlambda[(n - 1) * L + p] * s[p] + sin_mlambda[(n - 1) * L + p] * c[p];
+		}
+	}
+	WMM_STATS_END(WMM_STAT_HARMONIC);
+
+	WMM_PcupLowWithTablesFloatBlock(Workspace->PcupFloat, Workspace->dPcupFloat, x, z, nMax, k);
+	WMM_SummationFloatBlock(Workspace, G, H, dG, dH, nMax, nMaxSecVar, Results);
+
+	for (p = 0; p < NumPoints; p++)
+	{
+		if ( fabs(cos_phi[p]) > 1.0e-10 )
+		{
+			Results[1 * L + p] /= z[p];
+			Results[4 * L + p] /= z[p];
+			continue;
+		}
+		/* At the poles P(n,1) / cos(phi) follows the recursion of P(n,1), from 1 at n = 1,
+		and the terms of m > 1 vanish */
+		By = BySV = 0;
+		P1 = P2 = 1;
+		for (n = 1; n <= nMax; n++)
+		{
+			index = (n * (n + 1) / 2 + 1);
+			P = n == 1 ? 1 : x[p] * P1 - k[index] * P2;
+			R = RelativeRadiusPower[n * L + p];
+			By += R * ( G[index] * sin_mlambda[L + p] - H[index] * cos_mlambda[L + p] ) * P;
+			if (n <= nMaxSecVar)
+				BySV += R * ( dG[index] * sin_mlambda[L + p] - dH[index] * cos_mlambda[L + p] ) * P;
+			P2 = P1;
+			P1 = P;
+		}
+		Results[1 * L + p] = By;
+		Results[4 * L + p] = BySV;
+	}
+	return TRUE;
+	} /*WMM_SphericalSummationFloatBlock*/
+
+int WMM_GeomagBatch(const double *Latitude, const double *Longitude, const double *Height, double DecimalYear, size_t NumPoints,
+	WMMtype_Ellipsoid Ellip, WMMtype_MagneticModel *MagneticModel, WMMtype_Geoid *Geoid, WMMtype_Workspace *Workspace,
+	WMMtype_GeoMagneticElementsBatch *Results)
+   /*
+   Computes the magnetic field elements and their rates of change for NumPoints points at a single date.
+   Same as WMM_ContextGeomagBatch, with a context on the stack around the caller's workspace.
+
+   INPUT: Latitude		Geodetic latitudes in degrees, NumPoints elements
+		 Longitude		Longitudes in degrees, NumPoints elements
+		 Height			Heights in km, above MSL if Geoid is not NULL and Geoid->UseGeoid is 1,
+						above the WGS-84 ellipsoid otherwise, NumPoints elements
+		 DecimalYear	Date of all points
+		 NumPoints
+		 Ellip
+		 MagneticModel	Model as read by WMM_readMagneticModel (not time modified)
+		 Geoid			Initialized geoid, or NULL
+		 Workspace		Allocated for at least MagneticModel->nMax
+
+   OUTPUT : Results		Caller owned arrays of NumPoints elements; NULL arrays are not written
+   Returns FALSE if any point failed; see WMM_ContextGeomagBatch.
+
+   CALLS:  	WMM_ContextGeomagBatch
+   */
+	{
+	WMMtype_Context Context;
+
+	Context.Ellip = Ellip;
+	Context.MagneticModel = MagneticModel;
+	Context.Geoid = Geoid;
+	Context.Workspace = Workspace;
+	Context.OwnsWorkspace = 0;
+	WMM_ContextClearError(&Context);
+	return WMM_ContextGeomagBatch(&Context, Latitude, Longitude, Height, DecimalYear, NumPoints, Results) == WMM_ERR_NONE;
+	} /*WMM_GeomagBatch*/
+
+WMMtype_Context *WMM_CreateContext(WMMtype_Ellipsoid Ellip, WMMtype_MagneticModel *MagneticModel, WMMtype_Geoid *Geoid)
+   /*
+   Creates a context for the reentrant API: WMM_ContextGeomagBatch and WMM_ContextGeomag.
+   The model and the geoid are only read, so any number of contexts, one per thread, may share
+   them; each context owns its workspace and its error state. Nothing the context functions
+   call prints, exits or touches global state other than the SIMD level (WMM_GetSimdLevel).
+
+   INPUT: Ellip
+		 MagneticModel	Model as read by WMM_readMagneticModel (not time modified)
+		 Geoid			Initialized geoid, or NULL for heights above the ellipsoid
+   OUTPUT: Context, NULL if out of memory. Release with WMM_FreeContext.
+
+   CALLS:  	WMM_AllocateWorkspace, WMM_GetSimdLevel
+   */
+	{
+	WMMtype_Context *Context;
+
+	if (!MagneticModel)
+		return NULL;
+	Context = (WMMtype_Context *) calloc(1, sizeof(WMMtype_Context));
+	if (!Context)
+		return NULL;
+	Context->Workspace = WMM_AllocateWorkspace(MagneticModel->nMax);
+	if (!Context->Workspace)
+	{
+		free(Context);
+		return NULL;
+	}
+	Context->OwnsWorkspace = 1;
+	Context->Ellip = Ellip;
+	Context->MagneticModel = MagneticModel;
+	Context->Geoid = Geoid;
+	WMM_ContextClearError(Context);
+	WMM_GetSimdLevel();	/* Resolved now rather than by the first point */
+	return Context;
+	} /*WMM_CreateContext*/
+
+void WMM_FreeContext(WMMtype_Context *Context)
+   /*
+   Releases a context of WMM_CreateContext. The model and geoid are left alone.
+   CALLS:  	WMM_FreeWorkspace
+   */
+	{
+	if (!Context)
+		return;
+	if (Context->OwnsWorkspace)
+		WMM_FreeWorkspace(Context->Workspace);
+	free(Context);
+	} /*WMM_FreeContext*/
+
+void WMM_ContextClearError(WMMtype_Context *Context)
+   /*
+   Resets the error state of the context to WMM_ERR_NONE.
+   CALLS:  	none
+   */
+	{
+	Context->Error = WMM_ERR_NONE;
+	Context->ErrorIndex = 0;
+	Context->NumErrors = 0;
+	} /*WMM_ContextClearError*/
+
+int WMM_ContextGeomagBatch(WMMtype_Context *Context, const double *Latitude, const double *Longitude, const double *Height,
+	double DecimalYear, size_t NumPoints, WMMtype_GeoMagneticElementsBatch *Results)
+   /*
+   Computes the magnetic field elements and their rates of change for NumPoints points at a single date.
+   Inputs and outputs are structure-of-arrays. The model is time modified once for the whole batch
+   (and not at all if the workspace already holds it for this date), and the points are processed in
+   blocks of WMM_BATCH_BLOCK_SIZE: the coordinate conversion, the spherical harmonic summation and the
+   derivation of the elements each run over a whole block, whose intermediates stay in L1 cache.
+   The summation runs WMM_SIMD_LANES points at a time with the vector kernel of WMM_SummationBlock.
+   No heap memory is allocated and nothing is printed. Results match WMM_GeomagWithWorkspace for each
+   point to rounding.
+   A point with a latitude outside [-90, 90], a longitude outside [-180, 360] or a height that is not
+   finite does not stop the batch: its results are NaN and it is counted in Context->NumErrors.
+   Points whose summation fails get NaN results and WMM_ERR_MODEL the same way.
+
+   INPUT: Context		From WMM_CreateContext; Heights are above MSL if Context->Geoid is not NULL
+						and Context->Geoid->UseGeoid is 1, above the WGS-84 ellipsoid otherwise
+		 Latitude		Geodetic latitudes in degrees, NumPoints elements
+		 Longitude		Longitudes in degrees, NumPoints elements
+		 Height			Heights in km, NumPoints elements
+		 DecimalYear	Date of all points
+		 NumPoints
+
+   OUTPUT : Results		Caller owned arrays of NumPoints elements; NULL arrays are not written
+   Returns WMM_ERR_NONE, or the WMM_ERR_* of the first failure, which is also recorded in
+			Context->Error and Context->ErrorIndex unless an earlier one is pending.
+
+   CALLS:  	WMM_SetWorkspaceDate
+			WMM_GetGeoidHeightBatch
+			WMM_GeodeticToSpherical
+			WMM_SphericalSummationBlock
+			WMM_RotateMagneticVector
+			WMM_CalculateGeoMagneticElements
+			WMM_CalculateSecularVariation
+   */
+	{
+	WMMtype_CoordGeodetic CoordGeodetic[WMM_BATCH_BLOCK_SIZE];
+	WMMtype_CoordSpherical CoordSpherical[WMM_BATCH_BLOCK_SIZE];
+	WMMtype_MagneticResults MagneticResultsSph[WMM_BATCH_BLOCK_SIZE], MagneticResultsSphVar[WMM_BATCH_BLOCK_SIZE];
+	WMMtype_MagneticResults MagneticResultsGeo, MagneticResultsGeoVar;
+	WMMtype_GeoMagneticElements GeoMagneticElements;
+	WMMtype_Workspace *Workspace;
+	WMMtype_Geoid *Geoid;
+	double DeltaHeight[WMM_BATCH_BLOCK_SIZE], BlockLatitude[WMM_BATCH_BLOCK_SIZE], BlockLongitude[WMM_BATCH_BLOCK_SIZE];
+	char Valid[WMM_BATCH_BLOCK_SIZE];
+	size_t Start, i, j, k, BlockSize, Lanes;
+	int Code = WMM_ERR_NONE, UseGeoid;
+
+	if (!Context)
+		return WMM_ERR_ARGUMENT;
+	WMM_STATS_BEGIN(WMM_STAT_BATCH);
+	Workspace = Context->Workspace;
+	Geoid = Context->Geoid;
+	UseGeoid = Geoid && Geoid->UseGeoid == 1;
+	if (!Latitude || !Longitude || !Height || !Results || !Workspace)
+		Code = WMM_ERR_ARGUMENT;
+	else if (UseGeoid && !Geoid->Geoid_Initialized)
+		Code = WMM_ERR_GEOID_NOT_INITIALIZED;
+	else if (!WMM_SetWorkspaceDate(Workspace, Context->MagneticModel, DecimalYear))
+		Code = WMM_ERR_MODEL;
+	if (Code != WMM_ERR_NONE)
+	{
+		if (Context->Error == WMM_ERR_NONE)
+		{
+			Context->Error = Code;
+			Context->ErrorIndex = 0;
+		}
+		Context->NumErrors += NumPoints;
+		WMM_STATS_END(WMM_STAT_BATCH);
+		return Code;
 	}
 
+	for (Start = 0; Start < NumPoints; Start += WMM_BATCH_BLOCK_SIZE)
+	{
+		BlockSize = NumPoints - Start < WMM_BATCH_BLOCK_SIZE ? NumPoints - Start : WMM_BATCH_BLOCK_SIZE;
+
+		/* Points of the block; invalid ones are computed at (0, 0) and discarded */
+		for (j = 0; j < BlockSize; j++)
+		{
+			i = Start + j;
+			Valid[j] = Latitude[i] >= -90.0 && Latitude[i] <= 90.0 && Longitude[i] >= -180.0 && Longitude[i] <= 360.0
+				&& isfinite(Height[i]);
+			BlockLatitude[j] = Valid[j] ? Latitude[i] : 0.0;
+			BlockLongitude[j] = Valid[j] ? Longitude[i] : 0.0;
+			DeltaHeight[j] = 0.0;
+			if (!Valid[j])
+			{
+				if (Code == WMM_ERR_NONE)
+				{
+					Code = WMM_ERR_RANGE;
+					if (Context->Error == WMM_ERR_NONE)
+					{
+						Context->Error = Code;
+						Context->ErrorIndex = i;
+					}
+				}
+				Context->NumErrors++;
+			}
+		}
+
+		/* Geoid heights of the block; every point is in range */
+		if (UseGeoid)
+			WMM_GetGeoidHeightBatch(BlockLatitude, BlockLongitude, BlockSize, DeltaHeight, Geoid);
+
+		/* Coordinates of the block */
+		for (j = 0; j < BlockSize; j++)
+		{
+			i = Start + j;
+			CoordGeodetic[j].phi = BlockLatitude[j];
+			CoordGeodetic[j].lambda = BlockLongitude[j];
+			CoordGeodetic[j].HeightAboveGeoid = Valid[j] ? Height[i] : 0.0;
+			CoordGeodetic[j].HeightAboveEllipsoid = CoordGeodetic[j].HeightAboveGeoid;
+			if (UseGeoid)
+				CoordGeodetic[j].HeightAboveEllipsoid = CoordGeodetic[j].HeightAboveGeoid + DeltaHeight[j] / 1000; /* As WMM_ConvertGeoidToEllipsoidHeight */
+			WMM_GeodeticToSpherical(Context->Ellip, CoordGeodetic[j], &CoordSpherical[j]);
+		}
+
+		/* Spherical harmonic summation of the block, WMM_SIMD_LANES points at a time */
+		for (j = 0; j < BlockSize; j += WMM_SIMD_LANES)
+		{
+			Lanes = BlockSize - j < WMM_SIMD_LANES ? BlockSize - j : WMM_SIMD_LANES;
+			if (!WMM_SphericalSummationBlock(Context->Ellip, &CoordSpherical[j], Lanes,
+				Workspace->TimedMagneticModel, Workspace, &MagneticResultsSph[j], &MagneticResultsSphVar[j]))
+			{
+				/* The model does not fit the workspace; every point of the lane group fails */
+				for (k = j; k < j + Lanes; k++)
+				{
+					if (!Valid[k])
+						continue; /* Already counted as out of range */
+					Valid[k] = 0;
+					if (Code == WMM_ERR_NONE)
+					{
+						Code = WMM_ERR_MODEL;
+						if (Context->Error == WMM_ERR_NONE)
+						{
+							Context->Error = Code;
+							Context->ErrorIndex = Start + k;
+						}
+					}
+					Context->NumErrors++;
+				}
+			}
+		}
+
+		/* Rotation and geomagnetic elements of the block */
+		for (j = 0; j < BlockSize; j++)
+		{
+			i = Start + j;
+			if (Valid[j])
+			{
+				WMM_RotateMagneticVector(CoordSpherical[j], CoordGeodetic[j], MagneticResultsSph[j], &MagneticResultsGeo);
+				WMM_RotateMagneticVector(CoordSpherical[j], CoordGeodetic[j], MagneticResultsSphVar[j], &MagneticResultsGeoVar);
+				WMM_CalculateGeoMagneticElements(&MagneticResultsGeo, &GeoMagneticElements);
+				WMM_CalculateSecularVariation(MagneticResultsGeoVar, &GeoMagneticElements);
+			}
+			else
+				GeoMagneticElements.X = GeoMagneticElements.Y = GeoMagneticElements.Z = GeoMagneticElements.F =
+				GeoMagneticElements.H = GeoMagneticElements.Decl = GeoMagneticElements.Incl = GeoMagneticElements.Xdot =
+				GeoMagneticElements.Ydot = GeoMagneticElements.Zdot = GeoMagneticElements.Fdot = GeoMagneticElements.Hdot =
+				GeoMagneticElements.Decldot = GeoMagneticElements.Incldot = NAN;
+			if (Results->X) Results->X[i] = GeoMagneticElements.X;
+			if (Results->Y) Results->Y[i] = GeoMagneticElements.Y;
+			if (Results->Z) Results->Z[i] = GeoMagneticElements.Z;
+			if (Results->F) Results->F[i] = GeoMagneticElements.F;
+			if (Results->H) Results->H[i] = GeoMagneticElements.H;
+			if (Results->Decl) Results->Decl[i] = GeoMagneticElements.Decl;
+			if (Results->Incl) Results->Incl[i] = GeoMagneticElements.Incl;
+			if (Results->Xdot) Results->Xdot[i] = GeoMagneticElements.Xdot;
+			if (Results->Ydot) Results->Ydot[i] = GeoMagneticElements.Ydot;
+			if (Results->Zdot) Results->Zdot[i] = GeoMagneticElements.Zdot;
+			if (Results->Fdot) Results->Fdot[i] = GeoMagneticElements.Fdot;
+			if (Results->Hdot) Results->Hdot[i] = GeoMagneticElements.Hdot;
+			if (Results->Decldot) Results->Decldot[i] = GeoMagneticElements.Decldot;
+			if (Results->Incldot) Results->Incldot[i] = GeoMagneticElements.Incldot;
+		}
+	}
+	WMM_STATS_END(WMM_STAT_BATCH);
+	return Code;
+	} /*WMM_ContextGeomagBatch*/
+
+int WMM_ContextGeomagBatchFloat(WMMtype_Context *Context, const WMMtype_Float *Latitude, const WMMtype_Float *Longitude,
+	const WMMtype_Float *Height, double DecimalYear, size_t NumPoints, WMMtype_GeoMagneticElementsBatchFloat *Results)
+   /*
+   WMM_ContextGeomagBatch in single precision. Inputs and results are float arrays. The model is
+   time modified in double and its coefficients rounded to float once per date
+   (WMM_SetWorkspaceFloatCoeff). The geoid height and the geodetic to spherical conversion of each
+   point stay in double; the harmonic variables, Legendre functions, summations, rotation and
+   elements are float, and the summation kernels sum twice the points per instruction of the
+   double ones (WMM_SummationFloatBlock). wmm_accuracy reports the error against the double path,
+   a few hundredths of a nT for the WMM.
+   Invalid points and errors are handled as by WMM_ContextGeomagBatch.
+
+   INPUT: Context		As WMM_ContextGeomagBatch
+		 Latitude		Geodetic latitudes in degrees, NumPoints elements
+		 Longitude		Longitudes in degrees, NumPoints elements
+		 Height			Heights in km, NumPoints elements
+		 DecimalYear	Date of all points
+		 NumPoints
+
+   OUTPUT : Results		Caller owned arrays of NumPoints elements; NULL arrays are not written
+   Returns WMM_ERR_NONE, or the WMM_ERR_* of the first failure, as WMM_ContextGeomagBatch.
+
+   CALLS:  	WMM_SetWorkspaceDate
+			WMM_SetWorkspaceFloatCoeff
+			WMM_GetGeoidHeightBatch
+			WMM_GeodeticToSpherical
+			WMM_SphericalSummationFloatBlock
+   */
+	{
+	WMMtype_CoordGeodetic CoordGeodetic;
+	WMMtype_CoordSpherical CoordSpherical[WMM_BATCH_BLOCK_SIZE];
+	WMMtype_Workspace *Workspace;
+	WMMtype_Geoid *Geoid;
+	WMMtype_Float Sum[6 * WMM_FLOAT_LANES], Field[6][WMM_BATCH_BLOCK_SIZE], Psi[WMM_BATCH_BLOCK_SIZE];
+	WMMtype_Float X, Y, Z, H, F, Xdot, Ydot, Zdot, Hdot, Fdot, Decl, Incl, Decldot, Incldot, c, s;
+	const WMMtype_Float Rad2Deg = (WMMtype_Float) (180.0 / M_PI);
+	const double Deg2Rad = M_PI / 180.0;
+	double DeltaHeight[WMM_BATCH_BLOCK_SIZE], BlockLatitude[WMM_BATCH_BLOCK_SIZE], BlockLongitude[WMM_BATCH_BLOCK_SIZE];
+	char Valid[WMM_BATCH_BLOCK_SIZE];
+	size_t Start, i, j, BlockSize, Lanes, p;
+	int Code = WMM_ERR_NONE, UseGeoid, e;
+
+	if (!Context)
+		return WMM_ERR_ARGUMENT;
+	WMM_STATS_BEGIN(WMM_STAT_BATCH);
+	Workspace = Context->Workspace;
+	Geoid = Context->Geoid;
+	UseGeoid = Geoid && Geoid->UseGeoid == 1;
+	if (!Latitude || !Longitude || !Height || !Results || !Workspace)
+		Code = WMM_ERR_ARGUMENT;
+	else if (UseGeoid && !Geoid->Geoid_Initialized)
+		Code = WMM_ERR_GEOID_NOT_INITIALIZED;
+	else if (!WMM_SetWorkspaceDate(Workspace, Context->MagneticModel, DecimalYear) || !WMM_SetWorkspaceFloatCoeff(Workspace))
+		Code = WMM_ERR_MODEL;
+	if (Code != WMM_ERR_NONE)
+	{
+		if (Context->Error == WMM_ERR_NONE)
+		{
+			Context->Error = Code;
+			Context->ErrorIndex = 0;
+		}
+		Context->NumErrors += NumPoints;
+		WMM_STATS_END(WMM_STAT_BATCH);
+		return Code;
+	}
+
+	for (Start = 0; Start < NumPoints; Start += WMM_BATCH_BLOCK_SIZE)
+	{
+		BlockSize = NumPoints - Start < WMM_BATCH_BLOCK_SIZE ? NumPoints - Start : WMM_BATCH_BLOCK_SIZE;
+
+		/* Points of the block; invalid ones are computed at (0, 0) and discarded */
+		for (j = 0; j < BlockSize; j++)
+		{
+			i = Start + j;
+			Valid[j] = Latitude[i] >= -90.0f && Latitude[i] <= 90.0f && Longitude[i] >= -180.0f && Longitude[i] <= 360.0f
+				&& isfinite(Height[i]);
+			BlockLatitude[j] = Valid[j] ? Latitude[i] : 0.0;
+			BlockLongitude[j] = Valid[j] ? Longitude[i] : 0.0;
+			DeltaHeight[j] = 0.0;
+			if (!Valid[j])
+			{
+				if (Code == WMM_ERR_NONE)
+				{
+					Code = WMM_ERR_RANGE;
+					if (Context->Error == WMM_ERR_NONE)
+					{
+						Context->Error = Code;
+						Context->ErrorIndex = i;
+					}
+				}
+				Context->NumErrors++;
+			}
+		}
+
+		/* Geoid heights and spherical coordinates of the block, in double */
+		if (UseGeoid)
+			WMM_GetGeoidHeightBatch(BlockLatitude, BlockLongitude, BlockSize, DeltaHeight, Geoid);
+		for (j = 0; j < BlockSize; j++)
+		{
+			CoordGeodetic.phi = BlockLatitude[j];
+			CoordGeodetic.lambda = BlockLongitude[j];
+			CoordGeodetic.HeightAboveGeoid = Valid[j] ? Height[Start + j] : 0.0;
+			CoordGeodetic.HeightAboveEllipsoid = CoordGeodetic.HeightAboveGeoid;
+			if (UseGeoid)
+				CoordGeodetic.HeightAboveEllipsoid = CoordGeodetic.HeightAboveGeoid + DeltaHeight[j] / 1000; /* As WMM_ConvertGeoidToEllipsoidHeight */
+			WMM_GeodeticToSpherical(Context->Ellip, CoordGeodetic, &CoordSpherical[j]);
+			Psi[j] = (WMMtype_Float) (Deg2Rad * (CoordSpherical[j].phig - CoordGeodetic.phi));
+		}
+
+		/* Spherical harmonic summation of the block, WMM_FLOAT_LANES points at a time */
+		for (j = 0; j < BlockSize; j += WMM_FLOAT_LANES)
+		{
+			Lanes = BlockSize - j < WMM_FLOAT_LANES ? BlockSize - j : WMM_FLOAT_LANES;
+			WMM_SphericalSummationFloatBlock(Context->Ellip, &CoordSpherical[j], (int) Lanes, Workspace, Sum);
+			for (e = 0; e < 6; e++)
+				for (p = 0; p < Lanes; p++)
+					Field[e][j + p] = Sum[e * WMM_FLOAT_LANES + p];
+		}
+
+		/* Rotation to geodetic coordinates, as WMM_RotateMagneticVector */
+		WMM_STATS_BEGIN(WMM_STAT_ROTATION);
+		for (j = 0; j < BlockSize; j++)
+		{
+			c = cosf(Psi[j]);
+			s = sinf(Psi[j]);
+			X = Field[0][j] * c - Field[2][j] * s;
+			Z = Field[0][j] * s + Field[2][j] * c;
+			Xdot = Field[3][j] * c - Field[5][j] * s;
+			Zdot = Field[3][j] * s + Field[5][j] * c;
+			Field[0][j] = X;
+			Field[2][j] = Z;
+			Field[3][j] = Xdot;
+			Field[5][j] = Zdot;
+		}
+		WMM_STATS_END(WMM_STAT_ROTATION);
+
+		/* Geomagnetic elements of the block, as WMM_CalculateGeoMagneticElements and WMM_CalculateSecularVariation */
+		WMM_STATS_BEGIN(WMM_STAT_ELEMENTS);
+		for (j = 0; j < BlockSize; j++)
+		{
+			i = Start + j;
+			X = Field[0][j];
+			Y = Field[1][j];
+			Z = Field[2][j];
+			Xdot = Field[3][j];
+			Ydot = Field[4][j];
+			Zdot = Field[5][j];
+			H = sqrtf(X * X + Y * Y);
+			F = sqrtf(H * H + Z * Z);
+			Decl = Rad2Deg * atan2f(Y, X);
+			Incl = Rad2Deg * atan2f(Z, H);
+			Hdot = (X * Xdot + Y * Ydot) / H;
+			Fdot = (X * Xdot + Y * Ydot + Z * Zdot) / F;
+			Decldot = Rad2Deg * (X * Ydot - Y * Xdot) / (H * H);
+			Incldot = Rad2Deg * (H * Zdot - Z * Hdot) / (F * F);
+			if (!Valid[j])
+				X = Y = Z = F = H = Decl = Incl = Xdot = Ydot = Zdot = Fdot = Hdot = Decldot = Incldot = NAN;
+			if (Results->X) Results->X[i] = X;
+			if (Results->Y) Results->Y[i] = Y;
+			if (Results->Z) Results->Z[i] = Z;
+			if (Results->F) Results->F[i] = F;
+			if (Results->H) Results->H[i] = H;
+			if (Results->Decl) Results->Decl[i] = Decl;
+			if (Results->Incl) Results->Incl[i] = Incl;
+			if (Results->Xdot) Results->Xdot[i] = Xdot;
+			if (Results->Ydot) Results->Ydot[i] = Ydot;
+			if (Results->Zdot) Results->Zdot[i] = Zdot;
+			if (Results->Fdot) Results->Fdot[i] = Fdot;
+			if (Results->Hdot) Results->Hdot[i] = Hdot;
+			if (Results->Decldot) Results->Decldot[i] = Decldot;
+			if (Results->Incldot) Results->Incldot[i] = Incldot;
+		}
+		WMM_STATS_END(WMM_STAT_ELEMENTS);
+	}
+	WMM_STATS_END(WMM_STAT_BATCH);
+	return Code;
+	} /*WMM_ContextGeomagBatchFloat*/
+
+int WMM_ContextGeomag(WMMtype_Context *Context, double Latitude, double Longitude, double Height, double DecimalYear,
+	WMMtype_GeoMagneticElements *GeoMagneticElements)
+   /*
+   WMM_ContextGeomagBatch for a single point. Fills the elements X to Incldot of GeoMagneticElements;
+   the grid variation is not computed (see WMM_CalculateGridVariation).
+
+   INPUT: Context, Latitude, Longitude, Height, DecimalYear	as WMM_ContextGeomagBatch
+   OUTPUT : GeoMagneticElements
+   Returns WMM_ERR_NONE or the WMM_ERR_* of the failure.
+
+   CALLS:  	WMM_ContextGeomagBatch
+   */
+	{
+	WMMtype_GeoMagneticElementsBatch Results;
+
+	if (!GeoMagneticElements)
+		return WMM_ERR_ARGUMENT;
+	Results.X = &GeoMagneticElements->X;
+	Results.Y = &GeoMagneticElements->Y;
+	Results.Z = &GeoMagneticElements->Z;
+	Results.F = &GeoMagneticElements->F;
+	Results.H = &GeoMagneticElements->H;
+	Results.Decl = &GeoMagneticElements->Decl;
+	Results.Incl = &GeoMagneticElements->Incl;
+	Results.Xdot = &GeoMagneticElements->Xdot;
+	Results.Ydot = &GeoMagneticElements->Ydot;
+	Results.Zdot = &GeoMagneticElements->Zdot;
+	Results.Fdot = &GeoMagneticElements->Fdot;
+	Results.Hdot = &GeoMagneticElements->Hdot;
+	Results.Decldot = &GeoMagneticElements->Decldot;
+	Results.Incldot = &GeoMagneticElements->Incldot;
+	return WMM_ContextGeomagBatch(Context, &Latitude, &Longitude, &Height, DecimalYear, 1, &Results);
+	} /*WMM_ContextGeomag*/
+
+int WMM_ContextGeomagTimeSeries(WMMtype_Context *Context, double Latitude, double Longitude, double Height,
+	const double *DecimalYear, size_t NumDates, WMMtype_GeoMagneticElementsBatch *Results)
+   /*
+   Computes the magnetic field elements and their rates of change at one point for NumDates dates.
+   The model is linear in time, G(t) = G(t0) + (t - t0) dG, and so is the field:
+   B(t) = B(t0) + (t - t0) Bsv. The spherical harmonic sums of the main field at the model epoch t0
+   and of the secular variation are evaluated once, and each date then costs only the derivation
+   of the elements (WMM_TimeSeriesElements). Results match WMM_ContextGeomag at each date to rounding.
+   No heap memory is allocated unless the workspace caches a new time modified model.
+
+   INPUT: Context		As WMM_ContextGeomagBatch
+		 Latitude, Longitude, Height	The point, as one point of WMM_ContextGeomagBatch
+		 DecimalYear	Dates, NumDates elements
+		 NumDates
+
+   OUTPUT : Results		Caller owned arrays of NumDates elements; NULL arrays are not written.
+						An invalid point, or a model the summation fails on, gives NaN at every date.
+   Returns WMM_ERR_NONE, or the WMM_ERR_* of the failure, which is also recorded in
+			Context->Error unless an earlier one is pending.
+
+   CALLS:  	WMM_SetWorkspaceDate
+			WMM_ConvertGeoidToEllipsoidHeight
+			WMM_GeodeticToSpherical
+			WMM_SphericalSummationWithWorkspace
+			WMM_RotateMagneticVector
+			WMM_TimeSeriesElements
+   */
+	{
+	WMMtype_CoordGeodetic CoordGeodetic;
+	WMMtype_CoordSpherical CoordSpherical;
+	WMMtype_MagneticResults MagneticResultsSph, MagneticResultsSphVar, MagneticResultsGeo, MagneticResultsGeoVar;
+	WMMtype_GeoMagneticElements GeoMagneticElements;
+	WMMtype_Workspace *Workspace;
+	WMMtype_Geoid *Geoid;
+	double Resolution;
+	size_t i;
+	int Code = WMM_ERR_NONE, UseGeoid;
+
+	if (!Context)
+		return WMM_ERR_ARGUMENT;
+	WMM_STATS_BEGIN(WMM_STAT_TIME_SERIES);
+	Workspace = Context->Workspace;
+	Geoid = Context->Geoid;
+	UseGeoid = Geoid && Geoid->UseGeoid == 1;
+	if (!DecimalYear || !Results || !Workspace || !Context->MagneticModel)
+		Code = WMM_ERR_ARGUMENT;
+	else if (UseGeoid && !Geoid->Geoid_Initialized)
+		Code = WMM_ERR_GEOID_NOT_INITIALIZED;
+	else if (!(Latitude >= -90.0 && Latitude <= 90.0 && Longitude >= -180.0 && Longitude <= 360.0 && isfinite(Height)))
+		Code = WMM_ERR_RANGE;
+	else
+	{
+		/* The epoch model comes from the workspace cache, at the exact epoch whatever the date resolution */
+		Resolution = Workspace->DateResolution;
+		Workspace->DateResolution = 0;
+		if (!WMM_SetWorkspaceDate(Workspace, Context->MagneticModel, Context->MagneticModel->epoch))
+			Code = WMM_ERR_MODEL;
+		Workspace->DateResolution = Resolution;
+	}
+
+	if (Code == WMM_ERR_NONE)
+	{
+		CoordGeodetic.phi = Latitude;
+		CoordGeodetic.lambda = Longitude;
+		CoordGeodetic.HeightAboveGeoid = Height;
+		CoordGeodetic.HeightAboveEllipsoid = Height;
+		if (UseGeoid)
+			WMM_ConvertGeoidToEllipsoidHeight(&CoordGeodetic, Geoid);
+		WMM_GeodeticToSpherical(Context->Ellip, CoordGeodetic, &CoordSpherical);
+		if (WMM_SphericalSummationWithWorkspace(Context->Ellip, CoordSpherical, Workspace->TimedMagneticModel, Workspace,
+			&MagneticResultsSph, &MagneticResultsSphVar))
+		{
+			WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSph, &MagneticResultsGeo);
+			WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSphVar, &MagneticResultsGeoVar);
+		}
+		else
+			Code = WMM_ERR_MODEL;
+	}
+	if (Code != WMM_ERR_NONE)
+	{
+		if (Context->Error == WMM_ERR_NONE)
+		{
+			Context->Error = Code;
+			Context->ErrorIndex = 0;
+		}
+		Context->NumErrors += NumDates;
+		if ((Code != WMM_ERR_RANGE && Code != WMM_ERR_MODEL) || !DecimalYear || !Results)
+		{
+			WMM_STATS_END(WMM_STAT_TIME_SERIES);
+			return Code;
+		}
+	}
+
+	for (i = 0; i < NumDates; i++)
+	{
+		if (Code == WMM_ERR_NONE)
+			WMM_TimeSeriesElements(MagneticResultsGeo, MagneticResultsGeoVar, DecimalYear[i] - Context->MagneticModel->epoch, &GeoMagneticElements);
+		else
+			GeoMagneticElements.X = GeoMagneticElements.Y = GeoMagneticElements.Z = GeoMagneticElements.F =
+			GeoMagneticElements.H = GeoMagneticElements.Decl = GeoMagneticElements.Incl = GeoMagneticElements.Xdot =
+			GeoMagneticElements.Ydot = GeoMagneticElements.Zdot = GeoMagneticElements.Fdot = GeoMagneticElements.Hdot =
+			GeoMagneticElements.Decldot = GeoMagneticElements.Incldot = NAN;
+		if (Results->X) Results->X[i] = GeoMagneticElements.X;
+		if (Results->Y) Results->Y[i] = GeoMagneticElements.Y;
+		if (Results->Z) Results->Z[i] = GeoMagneticElements.Z;
+		if (Results->F) Results->F[i] = GeoMagneticElements.F;
+		if (Results->H) Results->H[i] = GeoMagneticElements.H;
+		if (Results->Decl) Results->Decl[i] = GeoMagneticElements.Decl;
+		if (Results->Incl) Results->Incl[i] = GeoMagneticElements.Incl;
+		if (Results->Xdot) Results->Xdot[i] = GeoMagneticElements.Xdot;
+		if (Results->Ydot) Results->Ydot[i] = GeoMagneticElements.Ydot;
+		if (Results->Zdot) Results->Zdot[i] = GeoMagneticElements.Zdot;
+		if (Results->Fdot) Results->Fdot[i] = GeoMagneticElements.Fdot;
+		if (Results->Hdot) Results->Hdot[i] = GeoMagneticElements.Hdot;
+		if (Results->Decldot) Results->Decldot[i] = GeoMagneticElements.Decldot;
+		if (Results->Incldot) Results->Incldot[i] = GeoMagneticElements.Incldot;
+	}
+	WMM_STATS_END(WMM_STAT_TIME_SERIES);
+	return Code;
+	} /*WMM_ContextGeomagTimeSeries*/
+
+int WMM_TimeSeriesElements(WMMtype_MagneticResults MagneticResultsGeo, WMMtype_MagneticResults MagneticResultsGeoVar, double dt,
+	WMMtype_GeoMagneticElements *GeoMagneticElements)
+   /*
+   Geomagnetic elements at the date t0 + dt from the field at the model epoch t0 and its secular
+   variation, both in geodetic coordinates. The time modification of the coefficients (Equation 19,
+   WMM Technical report) and the summation and rotation are linear, so B(t0 + dt) = B(t0) + dt Bsv
+   and the sums of a point need not be repeated for each date.
+
+   INPUT: MagneticResultsGeo	Main field of the epoch model, as WMM_RotateMagneticVector
+		 MagneticResultsGeoVar	Secular variation, as WMM_RotateMagneticVector
+		 dt			Date minus the model epoch, in years
+   OUTPUT : GeoMagneticElements	X to Incldot
+
+   CALLS:  	WMM_CalculateGeoMagneticElements
+			WMM_CalculateSecularVariation
+   */
+	{
+	WMMtype_MagneticResults MagneticResultsDate;
+
+	MagneticResultsDate.Bx = MagneticResultsGeo.Bx + dt * MagneticResultsGeoVar.Bx;
+	MagneticResultsDate.By = MagneticResultsGeo.By + dt * MagneticResultsGeoVar.By;
+	MagneticResultsDate.Bz = MagneticResultsGeo.Bz + dt * MagneticResultsGeoVar.Bz;
+	WMM_CalculateGeoMagneticElements(&MagneticResultsDate, GeoMagneticElements);   /* Equation 18, WMM Technical report */
+	WMM_CalculateSecularVariation(MagneticResultsGeoVar, GeoMagneticElements); /* Equation 19, WMM Technical report */
+	return TRUE;
+	} /*WMM_TimeSeriesElements*/
+
+
+int WMM_GetStats(WMMtype_Stats *Stats)
+
+	/* Sums the instrumentation counters of every thread that has counted a call, including
+	threads that have ended. The counters of running threads are read while they count, so
+	a stage in progress shows up at the next call.
+	INPUT  none
+	OUTPUT Stats	Calls and ticks of each WMM_STAT_* stage; all zero, with Clock
+					WMM_STATS_CLOCK_NONE, when the library is built without WMM_STATS
+	Returns TRUE if the library counts, FALSE otherwise.
+	CALLS : none
+	*/
+{
+#if WMM_STATS
+	WMMtype_StatsBlock *Block;
+	int Stat;
+#endif
+
+	memset(Stats, 0, sizeof(WMMtype_Stats));
+#if WMM_STATS
+	Stats->Clock = WMM_SIMD_X86 ? WMM_STATS_CLOCK_TSC : WMM_STATS_CLOCK_NS;
+#if WMM_THREADS
+	pthread_mutex_lock(&WMM_StatsLock);
+#endif
+	for (Block = WMM_StatsBlocks; Block; Block = Block->Next)
+	{
+		for (Stat = 0; Stat < WMM_NUM_STATS; Stat++)
+		{
+			Stats->Calls[Stat] += WMM_STATS_LOAD(Block->Calls[Stat]);
+			Stats->Ticks[Stat] += WMM_STATS_LOAD(Block->Ticks[Stat]);
+		}
+		Stats->NumThreads++;
+	}
+#if WMM_THREADS
+	pthread_mutex_unlock(&WMM_StatsLock);
+#endif
+	return TRUE;
+#else
+	return FALSE;
+#endif
+} /*WMM_GetStats*/
+
+void WMM_ResetStats(void)
+
+	/* Sets the instrumentation counters of every thread to zero. Calls that are counted
+	while the counters are reset may be lost or kept in part.
+	CALLS : none
+	*/
+{
+#if WMM_STATS
+	WMMtype_StatsBlock *Block;
+	int Stat;
+
+#if WMM_THREADS
+	pthread_mutex_lock(&WMM_StatsLock);
+#endif
+	for (Block = WMM_StatsBlocks; Block; Block = Block->Next)
+		for (Stat = 0; Stat < WMM_NUM_STATS; Stat++)
+		{
+			WMM_STATS_STORE(Block->Calls[Stat], 0);
+			WMM_STATS_STORE(Block->Ticks[Stat], 0);
+		}
+#if WMM_THREADS
+	pthread_mutex_unlock(&WMM_StatsLock);
+#endif
+#endif
+} /*WMM_ResetStats*/
+
+const char *WMM_StatName(int Stat)
+
+	/* Returns a constant description of a WMM_STAT_* stage: its name and the functions it counts.
+	Outer stages include the time of the inner ones they call.
+	CALLS : none
+	*/
+{
+	switch(Stat)
+	{
+		case WMM_STAT_GEOMAG:
+			return "geomag (WMM_Geomag, WMM_GeomagWithWorkspace)";
+		case WMM_STAT_BATCH:
+			return "batch (WMM_ContextGeomagBatch, WMM_ContextGeomagBatchFloat)";
+		case WMM_STAT_TIME_SERIES:
+			return "time series (WMM_ContextGeomagTimeSeries)";
+		case WMM_STAT_GRID_ROW:
+			return "grid row (WMM_GridRow)";
+		case WMM_STAT_TIMELY_MODIFY:
+			return "time modify (WMM_TimelyModifyMagneticModel, WMM_SetWorkspaceFloatCoeff)";
+		case WMM_STAT_GEODETIC:
+			return "geodetic to spherical (WMM_GeodeticToSpherical)";
+		case WMM_STAT_GEOID:
+			return "geoid (WMM_GetGeoidHeight, WMM_GetGeoidHeightBatch)";
+		case WMM_STAT_HARMONIC:
+			return "harmonic variables (WMM_ComputeSphericalHarmonicVariables, WMM_SphericalSummationFloatBlock)";
+		case WMM_STAT_LEGENDRE:
+			return "legendre (WMM_AssociatedLegendreFunction*, WMM_PcupLowWithTables*)";
+		case WMM_STAT_SUMMATION:
+			return "summation (WMM_Summation, WMM_SecVarSummation, WMM_SummationWithSecVar, WMM_SummationBlock, WMM_SummationFloatBlock, WMM_FixedSummation)";
+		case WMM_STAT_ROTATION:
+			return "rotation (WMM_RotateMagneticVector, WMM_ContextGeomagBatchFloat)";
+		case WMM_STAT_ELEMENTS:
+			return "elements (WMM_CalculateGeoMagneticElements, WMM_CalculateSecularVariation, WMM_ContextGeomagBatchFloat)";
+		case WMM_STAT_TRANSVERSE_MERCATOR:
+			return "transverse mercator (WMM_GetTransverseMercator)";
+		default:
+			return "unknown stage";
+	}
+} /*WMM_StatName*/
+
+void WMM_PrintStats(FILE *Stream)
+
+	/* Prints the counters of WMM_GetStats, one stage per line: calls, ticks, ticks per call
+	and the share of the ticks of the inner stages (time modify to transverse mercator).
+	INPUT  Stream	Output stream, such as stderr
+	CALLS : WMM_GetStats
+			WMM_StatName
+	*/
+{
+	WMMtype_Stats Stats;
+	unsigned long long InnerTicks = 0;
+	int Stat;
+
+	if (!WMM_GetStats(&Stats))
+	{
+		fprintf(Stream, "WMM statistics: not compiled in (WMM_STATS)\n");
+		return;
+	}
+	for (Stat = WMM_STAT_TIMELY_MODIFY; Stat < WMM_NUM_STATS; Stat++)
+		InnerTicks += Stats.Ticks[Stat];
+	fprintf(Stream, "WMM statistics, %d thread(s), ticks in %s\n", Stats.NumThreads,
+		Stats.Clock == WMM_STATS_CLOCK_TSC ? "time stamp counter cycles" : "nanoseconds");
+	fprintf(Stream, "%14s %16s %12s %7s  %s\n", "calls", "ticks", "ticks/call", "share", "stage");
+	for (Stat = 0; Stat < WMM_NUM_STATS; Stat++)
+	{
+		if (Stats.Calls[Stat] == 0)
+			continue;
+		fprintf(Stream, "%14llu %16llu %12.1f ", Stats.Calls[Stat], Stats.Ticks[Stat], (double) Stats.Ticks[Stat] / Stats.Calls[Stat]);
+		if (Stat >= WMM_STAT_TIMELY_MODIFY && InnerTicks > 0)
+			fprintf(Stream, "%6.1f%%", 100.0 * Stats.Ticks[Stat] / InnerTicks);
+		else
+			fprintf(Stream, "%7s", "");
+		fprintf(Stream, "  %s\n", WMM_StatName(Stat));
+	}
+} /*WMM_PrintStats*/
+
+#if WMM_STATS
+static WMMtype_StatsBlock *WMM_StatsNewBlock(void)
+
+	/* Creates the counter block of the calling thread and links it into WMM_StatsBlocks.
+	The blocks are never freed, the counts of ended threads stay in the totals.
+	Returns NULL if the memory could not be allocated; the thread then counts nothing.
+	CALLS : none
+	*/
+{
+	WMMtype_StatsBlock *Block = (WMMtype_StatsBlock *) calloc(1, sizeof(WMMtype_StatsBlock));
+
+	if (Block == NULL)
+		return NULL;
+#if WMM_THREADS
+	pthread_mutex_lock(&WMM_StatsLock);
+#endif
+	Block->Next = WMM_StatsBlocks;
+	WMM_StatsBlocks = Block;
+#if WMM_THREADS
+	pthread_mutex_unlock(&WMM_StatsLock);
+#endif
+	WMM_ThreadStats = Block;
+	return Block;
+} /*WMM_StatsNewBlock*/
+#endif
 
 int WMM_Comparison(WMMtype_MagneticModel *MagneticModel, WMMtype_Ellipsoid Ellip, WMMtype_LegendreFunction *LegendreFunction, WMMtype_Geoid *Geoid)
+
+	/* Compares WMM_Geomag with the field listed in comp.txt, one point per line:
+	latitude, longitude, height above the ellipsoid (km), decimal year, X, Y, Z (nT).
+	Points more than 10 nT off are written to Variations.txt. See wmm_accuracy.c
+	for the comparison of the evaluation paths of the library.
+
+	INPUT :  MagneticModel, Ellip
+	OUTPUT : none (prints the RMS differences)
+	Returns FALSE if a file could not be opened or no point was read, TRUE otherwise.
+	CALLS : WMM_AllocateModelMemory
+			WMM_TimelyModifyMagneticModel
+			WMM_GeodeticToSpherical
+			WMM_Geomag
+	*/
 {
-	int n = 0, NumTerms, i = 0;
+	int n = 0, NumTerms;
 	double Bx, By, Bz, tot_RMSx = 0, tot_RMSy = 0, tot_RMSz = 0;
 	WMMtype_GeoMagneticElements Results;
 	WMMtype_MagneticModel *TimedMagneticModel;
@@ -3071,33 +7127,59 @@ int WMM_Comparison(WMMtype_MagneticModel *MagneticModel, WMMtype_Ellipsoid Ellip
 	FILE *filein;
 	char filename[] = "Variations.txt";
 
+	(void) LegendreFunction;
+	(void) Geoid;
 	NumTerms = ( ( WMM_MAX_MODEL_DEGREES + 1 ) * ( WMM_MAX_MODEL_DEGREES + 2) / 2 );
 	TimedMagneticModel = WMM_AllocateModelMemory(NumTerms);
+	if (TimedMagneticModel == NULL)
+	{
+		WMM_Error(2);
+		return FALSE;
+	}
 
-	fileout = fopen(filename,"w");
 	filein = fopen("comp.txt","r");
-	Date.DecimalYear = 2010.0;
-	WMM_TimelyModifyMagneticModel(Date, MagneticModel, TimedMagneticModel);
-	while(i == 0)
+	if (filein == NULL)
+	{
+		printf("Error opening comp.txt\n");
+		WMM_FreeMagneticModelMemory(TimedMagneticModel);
+		return FALSE;
+	}
+	fileout = fopen(filename,"w");
+	if (fileout == NULL)
+	{
+		printf("Error opening %s to write\n", filename);
+		fclose(filein);
+		WMM_FreeMagneticModelMemory(TimedMagneticModel);
+		return FALSE;
+	}
+	CoordGeodetic.UseGeoid = 0;
+	while (fscanf(filein, "%lf %lf %lf %lf %lf %lf %lf", &CoordGeodetic.phi, &CoordGeodetic.lambda, &CoordGeodetic.HeightAboveEllipsoid, &Date.DecimalYear, &Bx, &By, &Bz) == 7)
  	{
-		fscanf(filein, "%lf %lf %lf %lf %lf %lf %lf\n", &CoordGeodetic.phi, &CoordGeodetic.lambda, &CoordGeodetic.HeightAboveEllipsoid, &Date.DecimalYear, &Bx, &By, &Bz);
+		WMM_TimelyModifyMagneticModel(Date, MagneticModel, TimedMagneticModel);	/* Each point is at its own date */
 		WMM_GeodeticToSpherical(Ellip, CoordGeodetic, &CoordSpherical);
 		WMM_Geomag(Ellip, CoordSpherical, CoordGeodetic, TimedMagneticModel, &Results);
 		if(fabs(Results.X - Bx) > 10.0 || fabs(Results.Y - By) > 10.0 || fabs(Results.Z - Bz) > 10.0)
-			fprintf(fileout, "%lf %lf %lf %lf: %lf => %lf, %lf => %lf, %lf => %lf\n", CoordGeodetic.phi, CoordGeodetic.lambda, CoordGeodetic.HeightAboveEllipsoid, Date.DecimalYear, Results.X, Results.X - Bx, Results.Y, Results.Y - By, Results.Z, Results.Z - Bz);+
+			fprintf(fileout, "%lf %lf %lf %lf: %lf => %lf, %lf => %lf, %lf => %lf\n", CoordGeodetic.phi, CoordGeodetic.lambda, CoordGeodetic.HeightAboveEllipsoid, Date.DecimalYear, Results.X, Results.X - Bx, Results.Y, Results.Y - By, Results.Z, Results.Z - Bz);
 		printf("%lf %lf %lf %lf:\n %lf => %lf, %lf => %lf, %lf => %lf\n", CoordGeodetic.phi, CoordGeodetic.lambda, CoordGeodetic.HeightAboveEllipsoid, Date.DecimalYear, Results.X, Results.X - Bx, Results.Y, Results.Y - By, Results.Z, Results.Z - Bz);
 		tot_RMSx += (Results.X - Bx) * (Results.X - Bx);
 		tot_RMSy += (Results.Y - By) * (Results.Y - By);
 		tot_RMSz += (Results.Z - Bz) * (Results.Z - Bz);
 		n++;
-		i = feof(filein);
 	}
-	tot_RMSx = sqrt(tot_RMSx) / n;
-	tot_RMSy = sqrt(tot_RMSy) / n;
-	tot_RMSz = sqrt(tot_RMSz) / n;
-	printf("RMS x = %lf\nRMS y = %lf\nRMS z = %lf\nn = %d", tot_RMSx, tot_RMSy, tot_RMSz, n);
-    return TRUE;
+	fclose(filein);
+	fclose(fileout);
+	WMM_FreeMagneticModelMemory(TimedMagneticModel);
+	if (n == 0)
+	{
+		printf("No points read from comp.txt\n");
+		return FALSE;
 	}
+	tot_RMSx = sqrt(tot_RMSx / n);
+	tot_RMSy = sqrt(tot_RMSy / n);
+	tot_RMSz = sqrt(tot_RMSz / n);
+	printf("RMS x = %lf\nRMS y = %lf\nRMS z = %lf\nn = %d\n", tot_RMSx, tot_RMSy, tot_RMSz, n);
+    return TRUE;
+	} /*WMM_Comparison*/
 
 /* -- test */
 
@@ -3200,6 +7282,7 @@ int WMM_GetTransverseMercator(WMMtype_CoordGeodetic CoordGeodetic, WMMtype_UTMPa
 
 /*   Get the map projection  parameters */
 
+   WMM_STATS_BEGIN(WMM_STAT_TRANSVERSE_MERCATOR);
    Lambda = DEG2RAD (CoordGeodetic.lambda);
    Phi = DEG2RAD (CoordGeodetic.phi);
 
@@ -3260,6 +7343,7 @@ int WMM_GetTransverseMercator(WMMtype_CoordGeodetic CoordGeodetic, WMMtype_UTMPa
 	UTMParameters->ConvergenceOfMeridians = RAD2DEG (CoM) ;  /* Convergence of meridians of the UTM Zone and location */
 	UTMParameters->PointScale = pscale;
 
+   WMM_STATS_END(WMM_STAT_TRANSVERSE_MERCATOR);
    return 0;
    }
 
@@ -0,0 +1,1117 @@
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "WMMHeader.h"
+#include "WMM_SubLibrary.c"
+
+//---------------------------------------------------------------------------
+
+/* WMM sublibrary is used to make an accuracy check program. The program evaluates a
+fixed set of reference points through every evaluation path of the library and compares
+each of them with the scalar double path of wmm_point (WMM_TimelyModifyMagneticModel and
+WMM_Geomag). The points are the WMM2010 test values, points at and next to the geographic
+poles, pseudo-random points from 1 km below the ellipsoid up to 850 km, and regular grids
+with heights above the ellipsoid and above MSL. The scalar path is also checked against the
+published test values. The grid paths also compare the grid variation GV and its rate GVdot
+with WMM_CalculateGridVariation. For each path the program prints the largest absolute error of each
+element, in nT and degrees and in nT and degrees per year, and fails if any of them is
+above the thresholds. The single precision paths (WMM_ContextGeomagBatchFloat) have
+thresholds of their own, ACC_FLOAT_* by default, and so has the fixed point engine
+(WMM_FixedSummation), ACC_FIXED_*. The model and geoid loaded from memory
+(WMM_readMagneticModelFromBuffer and WMM_InitializeGeoidFromBuffer) must reproduce the
+reference. The geoid paths compare the heights of the other geoid stores and lookups with
+WMM_GetGeoidHeight on the float grid: the tiled layout and WMM_GetGeoidHeightBatch must match
+it exactly, the int16 store within ACC_GEOID_INT16_TOLERANCE. The program expects WMM.COF and EGM9615.BIN in the current
+directory, as the other programs do.
+
+Usage: wmm_accuracy [-f nT] [-a degrees] [-sf nT] [-sa degrees] [-xf nT] [-xa degrees]
+	("make check" runs it)
+	-f	Largest error allowed in X, Y, Z, H and F, in nT, and in their rates, in nT per year
+	-a	Largest error allowed in Decl, Incl and GV, in degrees, and in their rates, in degrees per year
+	-sf, -sa	Same as -f and -a for the single precision paths
+	-xf, -xa	Same as -f and -a for the fixed point engine
+Returns 0 if every path is within the thresholds, 1 otherwise.
+
+ *
+ * MODIFICATIONS
+ *
+ *    Date                 Version
+ *    ----                 -----------
+ *    Oct 17, 2026         1.0
+ *    Oct 17, 2026         1.1   Single precision batch paths
+ *    Oct 17, 2026         1.2   Fixed point engine path
+ *    Oct 17, 2026         1.3   Grid variation in the grid paths
+ *    Oct 17, 2026         1.4   -sf and -sa thresholds of the single precision paths
+ *    Oct 17, 2026         1.5   -xf and -xa thresholds of the fixed point engine
+ *    Oct 17, 2026         1.6   Geoid paths and the model and geoid loaded from memory
+
+
+*/
+
+#define ACC_FIELD_TOLERANCE	1.0e-6	/* Default largest error of the field components, nT and nT per year */
+#define ACC_ANGLE_TOLERANCE	1.0e-8	/* Default largest error of the angles, degrees and degrees per year */
+#define ACC_FLOAT_FIELD_TOLERANCE	0.1	/* Largest error of the single precision paths, nT and nT per year, */
+#define ACC_FLOAT_ANGLE_TOLERANCE	1.0e-4	/* and degrees and degrees per year */
+#define ACC_FIXED_FIELD_TOLERANCE	0.01	/* Largest error of the fixed point path, nT and nT per year, */
+#define ACC_FIXED_ANGLE_TOLERANCE	1.0e-4	/* and degrees and degrees per year */
+#define ACC_DOUBLE	0		/* Precision of a path, selects its thresholds; index of the threshold arrays of main */
+#define ACC_FLOAT	1
+#define ACC_FIXED	2
+#define ACC_TEST_FIELD_TOLERANCE	0.05	/* The test values are published to 0.1 nT */
+#define ACC_TEST_ANGLE_TOLERANCE	0.005	/* and to 0.01 degrees */
+#define ACC_NUM_ELEMENTS	14	/* X to Incldot, the elements every path computes */
+#define ACC_NUM_GRID_ELEMENTS	16	/* and GV and GVdot, which the grid paths compute too */
+#define ACC_MAX_DATES	4		/* Dates of each point set */
+#define ACC_RANDOM_POINTS	256
+#define ACC_GRID_THREADS	4		/* Worker threads of the threaded grid path */
+#define ACC_GRID_FILE	"wmm_accuracy.tmp"	/* Binary grid written and read back by the grid paths */
+#define ACC_GEOID_INT16_TOLERANCE	0.005	/* Largest geoid height error of the int16 store, meters: half a centimeter of rounding */
+
+typedef struct {
+	const char *Name;
+	size_t Offset;			/* Of the element in WMMtype_GeoMagneticElements */
+	int Angle;				/* 1 for degrees, 0 for nT */
+	int GridOption;			/* ElementOption of WMM_Grid */
+} AccElement;
+
+static const AccElement Elements[ACC_NUM_GRID_ELEMENTS] = {
+	{"X", offsetof(WMMtype_GeoMagneticElements, X), 0, 5},
+	{"Y", offsetof(WMMtype_GeoMagneticElements, Y), 0, 6},
+	{"Z", offsetof(WMMtype_GeoMagneticElements, Z), 0, 7},
+	{"H", offsetof(WMMtype_GeoMagneticElements, H), 0, 4},
+	{"F", offsetof(WMMtype_GeoMagneticElements, F), 0, 3},
+	{"Decl", offsetof(WMMtype_GeoMagneticElements, Decl), 1, 1},
+	{"Incl", offsetof(WMMtype_GeoMagneticElements, Incl), 1, 2},
+	{"Xdot", offsetof(WMMtype_GeoMagneticElements, Xdot), 0, 13},
+	{"Ydot", offsetof(WMMtype_GeoMagneticElements, Ydot), 0, 14},
+	{"Zdot", offsetof(WMMtype_GeoMagneticElements, Zdot), 0, 15},
+	{"Hdot", offsetof(WMMtype_GeoMagneticElements, Hdot), 0, 12},
+	{"Fdot", offsetof(WMMtype_GeoMagneticElements, Fdot), 0, 11},
+	{"Decldot", offsetof(WMMtype_GeoMagneticElements, Decldot), 1, 9},
+	{"Incldot", offsetof(WMMtype_GeoMagneticElements, Incldot), 1, 10},
+	{"GV", offsetof(WMMtype_GeoMagneticElements, GV), 1, 8},
+	{"GVdot", offsetof(WMMtype_GeoMagneticElements, GVdot), 1, 16},
+};
+
+#define ACC_ELEMENT(E, k)	(*(double *) ((char *) (E) + Elements[k].Offset))
+
+/* WMM2010 test values: date, height above the ellipsoid (km), latitude, longitude,
+X, Y, Z, H, F (nT), Incl, Decl (degrees) */
+static const double TestValues[12][11] = {
+	{2010.0, 0, 80, 0, 6649.5, -714.6, 54346.2, 6687.8, 54756.2, 82.98, -6.13},
+	{2010.0, 0, 0, 120, 39428.8, 664.9, -11683.8, 39434.5, 41128.9, -16.50, 0.97},
+	{2010.0, 0, -80, 240, 5657.7, 15727.3, -53407.5, 16714.0, 55961.8, -72.62, 70.21},
+	{2010.0, 100, 80, 0, 6332.2, -729.1, 52194.9, 6374.0, 52582.6, 83.04, -6.57},
+	{2010.0, 100, 0, 120, 37452.0, 611.9, -11180.8, 37457.0, 39090.1, -16.62, 0.94},
+	{2010.0, 100, -80, 240, 5484.3, 14762.8, -50834.8, 15748.6, 53218.3, -72.79, 69.62},
+	{2012.5, 0, 80, 0, 6658.0, -606.7, 54420.4, 6685.5, 54829.5, 83.00, -5.21},
+	{2012.5, 0, 0, 120, 39423.9, 608.1, -11540.5, 39428.6, 41082.8, -16.31, 0.88},
+	{2012.5, 0, -80, 240, 5713.6, 15731.8, -53184.3, 16737.2, 55755.7, -72.53, 70.04},
+	{2012.5, 100, 80, 0, 6340.9, -625.1, 52261.9, 6371.6, 52648.9, 83.05, -5.63},
+	{2012.5, 100, 0, 120, 37448.1, 559.7, -11044.2, 37452.2, 39046.7, -16.43, 0.86},
+	{2012.5, 100, -80, 240, 5535.5, 14765.4, -50625.9, 15768.9, 53024.9, -72.70, 69.45},
+};
+
+/* A point set: every location at every date. Results are stored date by date,
+element [Date * NumLocations + Location]. */
+typedef struct {
+	const char *Name;
+	size_t NumLocations;
+	int NumDates;
+	double Years[ACC_MAX_DATES];
+	double *Latitude, *Longitude, *Height;	/* Heights in km, above MSL if UseGeoid, above the ellipsoid otherwise */
+	int UseGeoid;
+	int IsGrid;				/* Locations are the grid of GridMinimum, GridMaximum and the steps below, in WMM_Grid order */
+	WMMtype_CoordGeodetic GridMinimum, GridMaximum;
+	double GridStep, GridHeightStep, GridYearStep;
+	WMMtype_GeoMagneticElements *Reference;
+} AccSet;
+
+typedef struct {
+	WMMtype_MagneticModel *MagneticModel;
+	WMMtype_Ellipsoid Ellip;
+	WMMtype_Geoid *Geoid;	/* UseGeoid is set to that of the set being evaluated */
+	WMMtype_Context *Context;
+	double *Out[ACC_NUM_ELEMENTS];	/* Batch results, as many elements as the largest set */
+	WMMtype_Float *FloatIn[3];		/* Latitudes, longitudes and heights of the single precision paths */
+	WMMtype_Float *FloatOut[ACC_NUM_ELEMENTS];	/* Their results */
+	WMMtype_FixedModel *FixedModel;	/* Tables of the fixed point path */
+	WMMtype_Context *BufferContext;	/* Model and geoid loaded from memory, see run_FromBuffer */
+	int SimdLevel;			/* Of the batch paths */
+	int NumThreads;			/* Of the grid paths */
+} AccInput;
+
+typedef struct {
+	const char *Name;
+	int (*Run)(AccInput *Input, AccSet *Set, WMMtype_GeoMagneticElements *Results);	/* Returns 0 if the path does not apply to the set */
+	int SimdLevel;
+	int NumThreads;
+	int Precision;			/* ACC_DOUBLE, ACC_FLOAT or ACC_FIXED; the latter two have their own thresholds */
+	int NumElements;		/* Elements compared, ACC_NUM_ELEMENTS or ACC_NUM_GRID_ELEMENTS */
+	double MaxError[ACC_NUM_GRID_ELEMENTS];
+	const char *MaxErrorSet[ACC_NUM_GRID_ELEMENTS];
+	size_t NumPoints;
+} AccPath;
+
+/* A geoid path: a geoid store and lookup compared with WMM_GetGeoidHeight on the float
+row-major grid, at the locations of every set */
+typedef struct {
+	const char *Name;
+	int Storage;			/* WMM_GEOID_FLOAT32 or WMM_GEOID_INT16 */
+	int Tiled;
+	int FromBuffer;			/* Loaded with WMM_InitializeGeoidFromBuffer rather than from the file */
+	int Batch;				/* Evaluated with WMM_GetGeoidHeightBatch rather than WMM_GetGeoidHeight */
+	int SimdLevel;			/* Of WMM_GetGeoidHeightBatch */
+	double Tolerance;		/* Largest height error, meters */
+	double MaxError;
+	size_t NumPoints;
+} AccGeoidPath;
+
+double acc_random(unsigned long long *State);
+int acc_allocate_set(AccSet *Set, const char *Name, size_t NumLocations);
+void acc_free_set(AccSet *Set);
+int acc_setup(AccSet *Sets, WMMtype_MagneticModel *MagneticModel);
+int acc_setup_grid(AccSet *Set, const char *Name, WMMtype_MagneticModel *MagneticModel, int UseGeoid);
+void acc_reference(AccInput *Input, AccSet *Set);
+double acc_error(int k, double Value, double Reference);
+int acc_check_test_values(AccSet *Set, const char *ModelName, double FieldTolerance, double AngleTolerance);
+char *acc_read_file(const char *FileName, size_t *Size);
+int acc_geoid_path(AccGeoidPath *Path, AccSet *Sets, WMMtype_Geoid *Reference, const char *GeoidBuffer, size_t GeoidSize,
+	double *Heights);
+
+/****************************************************************************/
+/*                                                                          */
+/*                       The evaluation paths                               */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Each path evaluates every point of a set and stores the elements in     */
+/*     Results, element [Date * NumLocations + Location].                   */
+/*                                                                          */
+/****************************************************************************/
+
+static int run_GeomagWithWorkspace(AccInput *in, AccSet *set, WMMtype_GeoMagneticElements *Results)
+{
+	WMMtype_Workspace *Workspace = in->Context->Workspace;
+	WMMtype_CoordGeodetic CoordGeodetic;
+	WMMtype_CoordSpherical CoordSpherical;
+	size_t i;
+	int d;
+
+	for (d = 0; d < set->NumDates; d++)
+	{
+		WMM_SetWorkspaceDate(Workspace, in->MagneticModel, set->Years[d]);
+		for (i = 0; i < set->NumLocations; i++)
+		{
+			CoordGeodetic.phi = set->Latitude[i];
+			CoordGeodetic.lambda = set->Longitude[i];
+			CoordGeodetic.HeightAboveGeoid = set->Height[i];
+			CoordGeodetic.UseGeoid = set->UseGeoid;
+			WMM_ConvertGeoidToEllipsoidHeight(&CoordGeodetic, in->Geoid);
+			WMM_GeodeticToSpherical(in->Ellip, CoordGeodetic, &CoordSpherical);
+			WMM_GeomagWithWorkspace(in->Ellip, CoordSpherical, CoordGeodetic, Workspace->TimedMagneticModel,
+				&Results[d * set->NumLocations + i], Workspace);
+		}
+	}
+	return 1;
+}
+
+static int run_ContextGeomag(AccInput *in, AccSet *set, WMMtype_GeoMagneticElements *Results)
+{
+	size_t i;
+	int d;
+
+	for (d = 0; d < set->NumDates; d++)
+		for (i = 0; i < set->NumLocations; i++)
+			WMM_ContextGeomag(in->Context, set->Latitude[i], set->Longitude[i], set->Height[i], set->Years[d],
+				&Results[d * set->NumLocations + i]);
+	return 1;
+}
+
+static void acc_batch_results(AccInput *in, WMMtype_GeoMagneticElementsBatch *Batch)
+{
+	Batch->X = in->Out[0];
+	Batch->Y = in->Out[1];
+	Batch->Z = in->Out[2];
+	Batch->H = in->Out[3];
+	Batch->F = in->Out[4];
+	Batch->Decl = in->Out[5];
+	Batch->Incl = in->Out[6];
+	Batch->Xdot = in->Out[7];
+	Batch->Ydot = in->Out[8];
+	Batch->Zdot = in->Out[9];
+	Batch->Hdot = in->Out[10];
+	Batch->Fdot = in->Out[11];
+	Batch->Decldot = in->Out[12];
+	Batch->Incldot = in->Out[13];
+}
+
+static int run_ContextGeomagBatch(AccInput *in, AccSet *set, WMMtype_GeoMagneticElementsBatch *Batch, WMMtype_GeoMagneticElements *Results)
+{
+	size_t i;
+	int d, k;
+
+	for (d = 0; d < set->NumDates; d++)
+	{
+		WMM_ContextGeomagBatch(in->Context, set->Latitude, set->Longitude, set->Height, set->Years[d], set->NumLocations, Batch);
+		for (i = 0; i < set->NumLocations; i++)
+			for (k = 0; k < ACC_NUM_ELEMENTS; k++)
+				ACC_ELEMENT(&Results[d * set->NumLocations + i], k) = in->Out[k][i];
+	}
+	return 1;
+}
+
+static int run_Batch(AccInput *in, AccSet *set, WMMtype_GeoMagneticElements *Results)
+{
+	WMMtype_GeoMagneticElementsBatch Batch;
+	int Status;
+
+	acc_batch_results(in, &Batch);
+	WMM_SetSimdLevel(in->SimdLevel);
+	Status = run_ContextGeomagBatch(in, set, &Batch, Results);
+	WMM_SetSimdLevel(WMM_SIMD_AUTO);
+	return Status;
+}
+
+static int run_ContextGeomagTimeSeries(AccInput *in, AccSet *set, WMMtype_GeoMagneticElements *Results)
+{
+	WMMtype_GeoMagneticElementsBatch Batch;
+	size_t i;
+	int d, k;
+
+	acc_batch_results(in, &Batch);
+	for (i = 0; i < set->NumLocations; i++)
+	{
+		WMM_ContextGeomagTimeSeries(in->Context, set->Latitude[i], set->Longitude[i], set->Height[i], set->Years,
+			set->NumDates, &Batch);
+		for (d = 0; d < set->NumDates; d++)
+			for (k = 0; k < ACC_NUM_ELEMENTS; k++)
+				ACC_ELEMENT(&Results[d * set->NumLocations + i], k) = in->Out[k][d];
+	}
+	return 1;
+}
+
+static int run_GridParallel(AccInput *in, AccSet *set, WMMtype_GeoMagneticElements *Results)
+{
+	WMMtype_GridFileHeader Header;
+	WMMtype_Date StartDate, EndDate;
+	FILE *filein;
+	double *Plane;
+	unsigned int Mask = 0;
+	size_t i, PlaneSize = set->NumLocations * set->NumDates;
+	int d, k, e, Status;
+
+	if (!set->IsGrid)
+		return 0;
+	for (k = 0; k < ACC_NUM_GRID_ELEMENTS; k++)
+		Mask |= WMM_GRID_ELEMENT(Elements[k].GridOption);
+	StartDate.DecimalYear = set->Years[0];
+	EndDate.DecimalYear = set->Years[set->NumDates - 1];
+	if (!WMM_GridParallel(set->GridMinimum, set->GridMaximum, set->GridStep, set->GridHeightStep, set->GridYearStep,
+		in->MagneticModel, in->Geoid, in->Ellip, StartDate, EndDate, Mask, 1, ACC_GRID_FILE, WMM_GRID_FLOAT64, in->NumThreads))
+		return 0;
+
+	/* The planes are [Height][Latitude][Longitude][Year], in increasing ElementOption order */
+	filein = fopen(ACC_GRID_FILE, "rb");
+	Plane = (double *) malloc(PlaneSize * sizeof(double));
+	Status = filein && Plane && fread(&Header, sizeof(Header), 1, filein) == 1 &&
+		(size_t) Header.NumHeights * Header.NumLatitudes * Header.NumLongitudes == set->NumLocations &&
+		Header.NumYears == set->NumDates && Header.NumElements == ACC_NUM_GRID_ELEMENTS;
+	for (k = 0; Status && k < Header.NumElements; k++)
+	{
+		Status = fseek(filein, (long) (Header.DataOffset + k * PlaneSize * sizeof(double)), SEEK_SET) == 0 &&
+			fread(Plane, sizeof(double), PlaneSize, filein) == PlaneSize;
+		for (e = 0; e < ACC_NUM_GRID_ELEMENTS && Elements[e].GridOption != Header.Elements[k]; e++)
+			;
+		Status = Status && e < ACC_NUM_GRID_ELEMENTS;
+		for (i = 0; Status && i < set->NumLocations; i++)
+			for (d = 0; d < set->NumDates; d++)
+				ACC_ELEMENT(&Results[d * set->NumLocations + i], e) = Plane[i * set->NumDates + d];
+	}
+	if (filein)
+		fclose(filein);
+	remove(ACC_GRID_FILE);
+	free(Plane);
+	if (!Status)
+		printf("Error reading back %s\n", ACC_GRID_FILE);
+	return Status;
+}
+
+static int run_BatchFloat(AccInput *in, AccSet *set, WMMtype_GeoMagneticElements *Results)
+{
+	WMMtype_GeoMagneticElementsBatchFloat Batch;
+	size_t i;
+	int d, k;
+
+	Batch.X = in->FloatOut[0];
+	Batch.Y = in->FloatOut[1];
+	Batch.Z = in->FloatOut[2];
+	Batch.H = in->FloatOut[3];
+	Batch.F = in->FloatOut[4];
+	Batch.Decl = in->FloatOut[5];
+	Batch.Incl = in->FloatOut[6];
+	Batch.Xdot = in->FloatOut[7];
+	Batch.Ydot = in->FloatOut[8];
+	Batch.Zdot = in->FloatOut[9];
+	Batch.Hdot = in->FloatOut[10];
+	Batch.Fdot = in->FloatOut[11];
+	Batch.Decldot = in->FloatOut[12];
+	Batch.Incldot = in->FloatOut[13];
+	for (i = 0; i < set->NumLocations; i++)
+	{
+		in->FloatIn[0][i] = (WMMtype_Float) set->Latitude[i];
+		in->FloatIn[1][i] = (WMMtype_Float) set->Longitude[i];
+		in->FloatIn[2][i] = (WMMtype_Float) set->Height[i];
+	}
+	WMM_SetSimdLevel(in->SimdLevel);
+	for (d = 0; d < set->NumDates; d++)
+	{
+		WMM_ContextGeomagBatchFloat(in->Context, in->FloatIn[0], in->FloatIn[1], in->FloatIn[2], set->Years[d],
+			set->NumLocations, &Batch);
+		for (i = 0; i < set->NumLocations; i++)
+			for (k = 0; k < ACC_NUM_ELEMENTS; k++)
+				ACC_ELEMENT(&Results[d * set->NumLocations + i], k) = in->FloatOut[k][i];
+	}
+	WMM_SetSimdLevel(WMM_SIMD_AUTO);
+	return 1;
+}
+
+static int run_FixedSummation(AccInput *in, AccSet *set, WMMtype_GeoMagneticElements *Results)
+{
+	WMMtype_CoordGeodetic CoordGeodetic;
+	WMMtype_CoordSpherical CoordSpherical;
+	WMMtype_CoordSphericalFixed CoordFixed;
+	WMMtype_MagneticResultsFixed FixedSph, FixedSphVar;
+	WMMtype_MagneticResults MagneticResultsSph, MagneticResultsSphVar, MagneticResultsGeo, MagneticResultsGeoVar;
+	WMMtype_Fixed YearOffset;
+	size_t i;
+	int d;
+
+	/* Only the field summation is in fixed point; the coordinates, the rotation and the elements
+	are computed in double as the target would do them in software */
+	for (d = 0; d < set->NumDates; d++)
+	{
+		YearOffset = WMM_FIXED_FROM_DOUBLE(set->Years[d] - in->MagneticModel->epoch, WMM_FIXED_YEAR_BITS);
+		for (i = 0; i < set->NumLocations; i++)
+		{
+			CoordGeodetic.phi = set->Latitude[i];
+			CoordGeodetic.lambda = set->Longitude[i];
+			CoordGeodetic.HeightAboveGeoid = set->Height[i];
+			CoordGeodetic.UseGeoid = set->UseGeoid;
+			WMM_ConvertGeoidToEllipsoidHeight(&CoordGeodetic, in->Geoid);
+			WMM_GeodeticToSpherical(in->Ellip, CoordGeodetic, &CoordSpherical);
+			WMM_FixedFromSpherical(in->Ellip, CoordSpherical, &CoordFixed);
+			WMM_FixedSummation(in->FixedModel, YearOffset, &CoordFixed, &FixedSph, &FixedSphVar);
+			MagneticResultsSph.Bx = WMM_FIXED_TO_DOUBLE(FixedSph.Bx, WMM_FIXED_FIELD_BITS);
+			MagneticResultsSph.By = WMM_FIXED_TO_DOUBLE(FixedSph.By, WMM_FIXED_FIELD_BITS);
+			MagneticResultsSph.Bz = WMM_FIXED_TO_DOUBLE(FixedSph.Bz, WMM_FIXED_FIELD_BITS);
+			MagneticResultsSphVar.Bx = WMM_FIXED_TO_DOUBLE(FixedSphVar.Bx, WMM_FIXED_FIELD_BITS);
+			MagneticResultsSphVar.By = WMM_FIXED_TO_DOUBLE(FixedSphVar.By, WMM_FIXED_FIELD_BITS);
+			MagneticResultsSphVar.Bz = WMM_FIXED_TO_DOUBLE(FixedSphVar.Bz, WMM_FIXED_FIELD_BITS);
+			WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSph, &MagneticResultsGeo);
+			WMM_RotateMagneticVector(CoordSpherical, CoordGeodetic, MagneticResultsSphVar, &MagneticResultsGeoVar);
+			WMM_CalculateGeoMagneticElements(&MagneticResultsGeo, &Results[d * set->NumLocations + i]);
+			WMM_CalculateSecularVariation(MagneticResultsGeoVar, &Results[d * set->NumLocations + i]);
+		}
+	}
+	return 1;
+}
+
+static int run_FromBuffer(AccInput *in, AccSet *set, WMMtype_GeoMagneticElements *Results)
+{
+	size_t i;
+	int d;
+
+	/* As run_ContextGeomag, with the model of WMM_readMagneticModelFromBuffer and the geoid of
+	WMM_InitializeGeoidFromBuffer */
+	in->BufferContext->Geoid->UseGeoid = set->UseGeoid;
+	for (d = 0; d < set->NumDates; d++)
+		for (i = 0; i < set->NumLocations; i++)
+			WMM_ContextGeomag(in->BufferContext, set->Latitude[i], set->Longitude[i], set->Height[i], set->Years[d],
+				&Results[d * set->NumLocations + i]);
+	return 1;
+}
+
+static AccPath Paths[] = {
+	{"WMM_GeomagWithWorkspace", run_GeomagWithWorkspace, WMM_SIMD_AUTO, 1, ACC_DOUBLE, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_ContextGeomag", run_ContextGeomag, WMM_SIMD_AUTO, 1, ACC_DOUBLE, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_ContextGeomagBatch none", run_Batch, WMM_SIMD_NONE, 1, ACC_DOUBLE, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_ContextGeomagBatch sse2", run_Batch, WMM_SIMD_SSE2, 1, ACC_DOUBLE, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_ContextGeomagBatch avx2", run_Batch, WMM_SIMD_AVX2, 1, ACC_DOUBLE, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_ContextGeomagBatch avx512", run_Batch, WMM_SIMD_AVX512, 1, ACC_DOUBLE, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_ContextGeomagTimeSeries", run_ContextGeomagTimeSeries, WMM_SIMD_AUTO, 1, ACC_DOUBLE, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_GridParallel 1 thread", run_GridParallel, WMM_SIMD_AUTO, 1, ACC_DOUBLE, ACC_NUM_GRID_ELEMENTS, {0}, {0}, 0},
+	{"WMM_GridParallel threads", run_GridParallel, WMM_SIMD_AUTO, ACC_GRID_THREADS, ACC_DOUBLE, ACC_NUM_GRID_ELEMENTS, {0}, {0}, 0},
+	{"WMM_ContextGeomagBatchFloat none", run_BatchFloat, WMM_SIMD_NONE, 1, ACC_FLOAT, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_ContextGeomagBatchFloat sse2", run_BatchFloat, WMM_SIMD_SSE2, 1, ACC_FLOAT, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_ContextGeomagBatchFloat avx2", run_BatchFloat, WMM_SIMD_AVX2, 1, ACC_FLOAT, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_ContextGeomagBatchFloat avx512", run_BatchFloat, WMM_SIMD_AVX512, 1, ACC_FLOAT, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_FixedSummation", run_FixedSummation, WMM_SIMD_AUTO, 1, ACC_FIXED, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+	{"WMM_readMagneticModelFromBuffer", run_FromBuffer, WMM_SIMD_AUTO, 1, ACC_DOUBLE, ACC_NUM_ELEMENTS, {0}, {0}, 0},
+};
+
+static AccGeoidPath GeoidPaths[] = {
+	{"WMM_GetGeoidHeight int16", WMM_GEOID_INT16, 0, 0, 0, WMM_SIMD_AUTO, ACC_GEOID_INT16_TOLERANCE, 0, 0},
+	{"WMM_GetGeoidHeight tiled", WMM_GEOID_FLOAT32, 1, 0, 0, WMM_SIMD_AUTO, 0.0, 0, 0},
+	{"WMM_GetGeoidHeight int16 tiled", WMM_GEOID_INT16, 1, 0, 0, WMM_SIMD_AUTO, ACC_GEOID_INT16_TOLERANCE, 0, 0},
+	{"WMM_GetGeoidHeightBatch none", WMM_GEOID_FLOAT32, 0, 0, 1, WMM_SIMD_NONE, 0.0, 0, 0},
+	{"WMM_GetGeoidHeightBatch avx2", WMM_GEOID_FLOAT32, 0, 0, 1, WMM_SIMD_AVX2, 0.0, 0, 0},
+	{"WMM_GetGeoidHeightBatch avx2 tiled", WMM_GEOID_FLOAT32, 1, 0, 1, WMM_SIMD_AVX2, 0.0, 0, 0},
+	{"WMM_GetGeoidHeightBatch avx2 int16", WMM_GEOID_INT16, 0, 0, 1, WMM_SIMD_AVX2, ACC_GEOID_INT16_TOLERANCE, 0, 0},
+	{"WMM_InitializeGeoidFromBuffer", WMM_GEOID_FLOAT32, 0, 1, 0, WMM_SIMD_AUTO, 0.0, 0, 0},
+	{"WMM_InitializeGeoidFromBuffer int16", WMM_GEOID_INT16, 0, 1, 0, WMM_SIMD_AUTO, ACC_GEOID_INT16_TOLERANCE, 0, 0},
+};
+
+#define ACC_NUM_SETS	5
+
+int main(int argc, char *argv[])
+{
+	WMMtype_MagneticModel *MagneticModel;
+	WMMtype_Ellipsoid Ellip;
+	WMMtype_MagneticModel *BufferModel;
+	WMMtype_Geoid Geoid, BufferGeoid;
+	WMMtype_GeoMagneticElements *Results;
+	AccSet Sets[ACC_NUM_SETS];
+	AccInput Input;
+	AccPath *Path;
+	AccGeoidPath *GeoidPath;
+	char *CofBuffer, *GeoidBuffer;
+	double FieldTolerance[3] = {ACC_FIELD_TOLERANCE, ACC_FLOAT_FIELD_TOLERANCE, ACC_FIXED_FIELD_TOLERANCE};	/* By precision */
+	double AngleTolerance[3] = {ACC_ANGLE_TOLERANCE, ACC_FLOAT_ANGLE_TOLERANCE, ACC_FIXED_ANGLE_TOLERANCE};
+	double Error, Tolerance;
+	double *Heights;
+	size_t i, MaxPoints = 0, MaxLocations = 0, CofSize, GeoidSize;
+	int NumTerms, iarg, p, s, k, Failed = 0, PathFailed;
+
+	for (iarg = 1; iarg < argc; iarg++)
+	{
+		if (iarg + 1 < argc && !strcmp(argv[iarg], "-f"))
+			FieldTolerance[ACC_DOUBLE] = atof(argv[++iarg]);
+		else if (iarg + 1 < argc && !strcmp(argv[iarg], "-a"))
+			AngleTolerance[ACC_DOUBLE] = atof(argv[++iarg]);
+		else if (iarg + 1 < argc && !strcmp(argv[iarg], "-sf"))
+			FieldTolerance[ACC_FLOAT] = atof(argv[++iarg]);
+		else if (iarg + 1 < argc && !strcmp(argv[iarg], "-sa"))
+			AngleTolerance[ACC_FLOAT] = atof(argv[++iarg]);
+		else if (iarg + 1 < argc && !strcmp(argv[iarg], "-xf"))
+			FieldTolerance[ACC_FIXED] = atof(argv[++iarg]);
+		else if (iarg + 1 < argc && !strcmp(argv[iarg], "-xa"))
+			AngleTolerance[ACC_FIXED] = atof(argv[++iarg]);
+		else
+		{
+			printf("Usage: wmm_accuracy [-f nT] [-a degrees] [-sf nT] [-sa degrees] [-xf nT] [-xa degrees]\n");
+			return 1;
+		}
+	}
+
+	NumTerms = ( ( WMM_MAX_MODEL_DEGREES + 1 ) * ( WMM_MAX_MODEL_DEGREES + 2 ) / 2 );    /* WMM_MAX_MODEL_DEGREES is defined in WMM_Header.h */
+	MagneticModel = WMM_AllocateModelMemory(NumTerms);
+	if(MagneticModel == NULL)
+	{
+		WMM_Error(2);
+		return 1;
+	}
+	WMM_SetDefaults(&Ellip, MagneticModel, &Geoid); /* Set default values and constants */
+	WMM_readMagneticModel(WMM_COF_FILE, MagneticModel);
+	WMM_InitializeGeoidMapped(&Geoid);    /* Read the Geoid file */
+	if (!Geoid.Geoid_Initialized)
+		return 1;
+
+	/* The same files loaded from memory, for run_FromBuffer and the geoid paths */
+	CofBuffer = acc_read_file(WMM_COF_FILE, &CofSize);
+	GeoidBuffer = acc_read_file(Geoid.GeoidFileName, &GeoidSize);
+	BufferModel = WMM_AllocateModelMemory(NumTerms);
+	if (!CofBuffer || !GeoidBuffer || !BufferModel)
+	{
+		WMM_Error(2);
+		return 1;
+	}
+	WMM_SetDefaults(&Ellip, BufferModel, &BufferGeoid);
+	if (!WMM_readMagneticModelFromBuffer(CofBuffer, CofSize, BufferModel) ||
+		!WMM_InitializeGeoidFromBuffer(&BufferGeoid, GeoidBuffer, GeoidSize))
+		return 1;
+
+	memset(&Input, 0, sizeof(Input));
+	Input.MagneticModel = MagneticModel;
+	Input.Ellip = Ellip;
+	Input.Geoid = &Geoid;
+	Input.Context = WMM_CreateContext(Ellip, MagneticModel, &Geoid);
+	Input.BufferContext = WMM_CreateContext(Ellip, BufferModel, &BufferGeoid);
+	Input.FixedModel = (WMMtype_FixedModel *) malloc(sizeof(WMMtype_FixedModel));
+	if (!Input.Context || !Input.BufferContext || !Input.FixedModel || !WMM_FixedModelFromModel(MagneticModel, Input.FixedModel) || !acc_setup(Sets, MagneticModel))
+	{
+		WMM_Error(2);
+		return 1;
+	}
+	for (s = 0; s < ACC_NUM_SETS; s++)
+	{
+		if (Sets[s].NumLocations * Sets[s].NumDates > MaxPoints)
+			MaxPoints = Sets[s].NumLocations * Sets[s].NumDates;
+		if (Sets[s].NumLocations > MaxLocations)
+			MaxLocations = Sets[s].NumLocations;
+	}
+	Results = (WMMtype_GeoMagneticElements *) malloc(MaxPoints * sizeof(WMMtype_GeoMagneticElements));
+	Heights = (double *) malloc(MaxLocations * sizeof(double));
+	if (!Heights)
+		Results = NULL;
+	for (k = 0; k < ACC_NUM_ELEMENTS; k++)
+	{
+		Input.Out[k] = (double *) malloc(MaxLocations * sizeof(double));
+		Input.FloatOut[k] = (WMMtype_Float *) malloc(MaxLocations * sizeof(WMMtype_Float));
+	}
+	for (k = 0; k < 3; k++)
+		Input.FloatIn[k] = (WMMtype_Float *) malloc(MaxLocations * sizeof(WMMtype_Float));
+	for (k = 0; k < ACC_NUM_ELEMENTS && Results; k++)
+		if (!Input.Out[k] || !Input.FloatOut[k] || (k < 3 && !Input.FloatIn[k]))
+			Results = NULL;
+	if (!Results)
+	{
+		WMM_Error(2);
+		return 1;
+	}
+
+	for (s = 0; s < ACC_NUM_SETS; s++)
+	{
+		Geoid.UseGeoid = Sets[s].UseGeoid;
+		acc_reference(&Input, &Sets[s]);
+	}
+	Geoid.UseGeoid = 0;
+	if (!acc_check_test_values(&Sets[0], MagneticModel->ModelName, ACC_TEST_FIELD_TOLERANCE, ACC_TEST_ANGLE_TOLERANCE))
+		Failed++;
+
+	/* Every path over every set it applies to */
+	for (p = 0; p < (int) (sizeof(Paths) / sizeof(Paths[0])); p++)
+	{
+		Path = &Paths[p];
+		if (Path->SimdLevel != WMM_SIMD_AUTO && WMM_SetSimdLevel(Path->SimdLevel) != Path->SimdLevel)
+		{
+			Path->NumPoints = 0;	/* Not supported by this CPU */
+			WMM_SetSimdLevel(WMM_SIMD_AUTO);
+			continue;
+		}
+		WMM_SetSimdLevel(WMM_SIMD_AUTO);
+		Input.SimdLevel = Path->SimdLevel;
+		Input.NumThreads = Path->NumThreads;
+		for (s = 0; s < ACC_NUM_SETS; s++)
+		{
+			Geoid.UseGeoid = Sets[s].UseGeoid;
+			if (!Path->Run(&Input, &Sets[s], Results))
+				continue;
+			for (i = 0; i < Sets[s].NumLocations * Sets[s].NumDates; i++)
+				for (k = 0; k < Path->NumElements; k++)
+				{
+					Error = acc_error(k, ACC_ELEMENT(&Results[i], k), ACC_ELEMENT(&Sets[s].Reference[i], k));
+					if (Error > Path->MaxError[k] || Path->MaxErrorSet[k] == NULL)
+					{
+						Path->MaxError[k] = Error;
+						Path->MaxErrorSet[k] = Sets[s].Name;
+					}
+				}
+			Path->NumPoints += Sets[s].NumLocations * Sets[s].NumDates;
+		}
+		Geoid.UseGeoid = 0;
+	}
+	WMM_ContextClearError(Input.Context);
+	WMM_ContextClearError(Input.BufferContext);
+
+	/* Every geoid path over the locations of every set */
+	for (p = 0; p < (int) (sizeof(GeoidPaths) / sizeof(GeoidPaths[0])); p++)
+	{
+		GeoidPath = &GeoidPaths[p];
+		if (GeoidPath->Batch && GeoidPath->SimdLevel != WMM_SIMD_AUTO && WMM_SetSimdLevel(GeoidPath->SimdLevel) != GeoidPath->SimdLevel)
+			GeoidPath->NumPoints = 0;	/* Not supported by this CPU */
+		else if (!acc_geoid_path(GeoidPath, Sets, &Geoid, GeoidBuffer, GeoidSize, Heights))
+			Failed++;
+		WMM_SetSimdLevel(WMM_SIMD_AUTO);
+	}
+
+	/* Report */
+	for (s = 0; s < 2; s++)
+	{
+		printf("\n%s, largest absolute error against WMM_Geomag (%s)\n", s == 0 ? "Main field" : "Secular variation",
+			s == 0 ? "nT, degrees" : "nT per year, degrees per year");
+		printf("%-36s %7s", "path", "points");
+		for (k = 7 * s; k < 7 * s + 7; k++)
+			printf(" %9s", Elements[k].Name);
+		printf("\n");
+		for (p = 0; p < (int) (sizeof(Paths) / sizeof(Paths[0])); p++)
+		{
+			Path = &Paths[p];
+			printf("%-36s %7lu", Path->Name, (unsigned long) Path->NumPoints);
+			if (Path->NumPoints == 0)
+			{
+				printf("   not supported on this CPU\n");
+				continue;
+			}
+			for (k = 7 * s; k < 7 * s + 7; k++)
+				printf(" %9.2e", Path->MaxError[k]);
+			printf("\n");
+		}
+	}
+
+	printf("\nGrid variation, largest absolute error against WMM_CalculateGridVariation (degrees, degrees per year)\n");
+	printf("%-36s %7s", "path", "points");
+	for (k = ACC_NUM_ELEMENTS; k < ACC_NUM_GRID_ELEMENTS; k++)
+		printf(" %9s", Elements[k].Name);
+	printf("\n");
+	for (p = 0; p < (int) (sizeof(Paths) / sizeof(Paths[0])); p++)
+	{
+		Path = &Paths[p];
+		if (Path->NumElements <= ACC_NUM_ELEMENTS)
+			continue;
+		printf("%-36s %7lu", Path->Name, (unsigned long) Path->NumPoints);
+		for (k = ACC_NUM_ELEMENTS; k < ACC_NUM_GRID_ELEMENTS; k++)
+			printf(" %9.2e", Path->MaxError[k]);
+		printf("\n");
+	}
+
+	printf("\nGeoid height, largest absolute error against WMM_GetGeoidHeight on the float grid (meters)\n");
+	printf("%-36s %7s %9s %9s\n", "path", "points", "height", "allowed");
+	for (p = 0; p < (int) (sizeof(GeoidPaths) / sizeof(GeoidPaths[0])); p++)
+	{
+		GeoidPath = &GeoidPaths[p];
+		printf("%-36s %7lu", GeoidPath->Name, (unsigned long) GeoidPath->NumPoints);
+		if (GeoidPath->NumPoints == 0)
+		{
+			printf("   not supported on this CPU\n");
+			continue;
+		}
+		printf(" %9.7f %9.7f\n", GeoidPath->MaxError, GeoidPath->Tolerance);
+	}
+
+	printf("\nThresholds: %g nT, %g degrees (single precision: %g nT, %g degrees; fixed point: %g nT, %g degrees)\n",
+		FieldTolerance[ACC_DOUBLE], AngleTolerance[ACC_DOUBLE], FieldTolerance[ACC_FLOAT], AngleTolerance[ACC_FLOAT],
+		FieldTolerance[ACC_FIXED], AngleTolerance[ACC_FIXED]);
+	for (p = 0; p < (int) (sizeof(Paths) / sizeof(Paths[0])); p++)
+	{
+		Path = &Paths[p];
+		PathFailed = 0;
+		for (k = 0; k < Path->NumElements && Path->NumPoints > 0; k++)
+		{
+			Tolerance = Elements[k].Angle ? AngleTolerance[Path->Precision] : FieldTolerance[Path->Precision];
+			if (!(Path->MaxError[k] <= Tolerance))	/* NaN fails too */
+			{
+				printf("FAIL %s: %s error %g above %g (set %s)\n", Path->Name, Elements[k].Name, Path->MaxError[k],
+					Tolerance, Path->MaxErrorSet[k]);
+				PathFailed = 1;
+			}
+		}
+		Failed += PathFailed;
+	}
+	for (p = 0; p < (int) (sizeof(GeoidPaths) / sizeof(GeoidPaths[0])); p++)
+	{
+		GeoidPath = &GeoidPaths[p];
+		if (GeoidPath->NumPoints > 0 && !(GeoidPath->MaxError <= GeoidPath->Tolerance))
+		{
+			printf("FAIL %s: geoid height error %g above %g\n", GeoidPath->Name, GeoidPath->MaxError, GeoidPath->Tolerance);
+			Failed++;
+		}
+	}
+	printf("%s\n", Failed ? "FAILED" : "PASSED");
+
+	for (s = 0; s < ACC_NUM_SETS; s++)
+		acc_free_set(&Sets[s]);
+	for (k = 0; k < ACC_NUM_ELEMENTS; k++)
+	{
+		free(Input.Out[k]);
+		free(Input.FloatOut[k]);
+	}
+	for (k = 0; k < 3; k++)
+		free(Input.FloatIn[k]);
+	free(Results);
+	free(Heights);
+	free(Input.FixedModel);
+	WMM_FreeContext(Input.Context);
+	WMM_FreeContext(Input.BufferContext);
+	WMM_FreeMagneticModelMemory(MagneticModel);
+	WMM_FreeMagneticModelMemory(BufferModel);
+	WMM_FreeGeoid(&Geoid);
+	WMM_FreeGeoid(&BufferGeoid);
+	free(CofBuffer);
+	free(GeoidBuffer);
+	return Failed ? 1 : 0;
+}
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine acc_setup                               */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Builds the point sets: the WMM2010 test points, the poles, random       */
+/*     points up to 850 km and two grids, with heights above the ellipsoid  */
+/*     and above MSL. The inputs do not depend on the platform.             */
+/*                                                                          */
+/*  Input:  MagneticModel - As read by the program, for its epoch           */
+/*                                                                          */
+/*  Output: Sets - ACC_NUM_SETS sets. Returns 1 on success, 0 if memory     */
+/*          ran out                                                         */
+/*                                                                          */
+/****************************************************************************/
+
+int acc_setup(AccSet *Sets, WMMtype_MagneticModel *MagneticModel)
+{
+	static const double PoleLatitudes[] = {90.0, 90.0 - 1e-9, 90.0 - 1e-6, 90.0 - 1e-3, -90.0, -90.0 + 1e-9, -90.0 + 1e-6, -90.0 + 1e-3};
+	static const double PoleLongitudes[] = {-180.0, -45.0, 0.0, 137.5, 180.0};
+	static const double PoleHeights[] = {-1.0, 0.0, 850.0};
+	unsigned long long State = 0x5eed0003ULL;
+	AccSet *Set;
+	size_t i, a, b, c;
+
+	memset(Sets, 0, ACC_NUM_SETS * sizeof(AccSet));
+
+	/* The test points, 6 locations at 2 dates */
+	Set = &Sets[0];
+	if (!acc_allocate_set(Set, "test", 6))
+		return 0;
+	Set->NumDates = 2;
+	for (i = 0; i < 6; i++)
+	{
+		Set->Height[i] = TestValues[i][1];
+		Set->Latitude[i] = TestValues[i][2];
+		Set->Longitude[i] = TestValues[i][3];
+	}
+	Set->Years[0] = TestValues[0][0];
+	Set->Years[1] = TestValues[6][0];
+
+	/* At and next to the poles, where the By summation switches to the special case */
+	Set = &Sets[1];
+	if (!acc_allocate_set(Set, "pole", 8 * 5 * 3))
+		return 0;
+	Set->NumDates = 3;
+	for (a = 0, i = 0; a < 8; a++)
+		for (b = 0; b < 5; b++)
+			for (c = 0; c < 3; c++, i++)
+			{
+				Set->Latitude[i] = PoleLatitudes[a];
+				Set->Longitude[i] = PoleLongitudes[b];
+				Set->Height[i] = PoleHeights[c];
+			}
+	for (i = 0; i < 3; i++)
+		Set->Years[i] = MagneticModel->epoch + 2.5 * i;
+
+	/* Uniform over the sphere, from 1 km below the ellipsoid to 850 km */
+	Set = &Sets[2];
+	if (!acc_allocate_set(Set, "random", ACC_RANDOM_POINTS))
+		return 0;
+	Set->NumDates = 4;
+	for (i = 0; i < ACC_RANDOM_POINTS; i++)
+	{
+		Set->Latitude[i] = RAD2DEG(asin(2.0 * acc_random(&State) - 1.0));
+		Set->Longitude[i] = 360.0 * acc_random(&State) - 180.0;
+		Set->Height[i] = 851.0 * acc_random(&State) - 1.0;
+	}
+	Set->Years[0] = MagneticModel->epoch;
+	Set->Years[1] = MagneticModel->epoch + 1.7;
+	Set->Years[2] = MagneticModel->epoch + 3.3;
+	Set->Years[3] = MagneticModel->epoch + 5.0;
+
+	return acc_setup_grid(&Sets[3], "grid", MagneticModel, 0) && acc_setup_grid(&Sets[4], "geoid", MagneticModel, 1);
+} /* acc_setup */
+
+int acc_setup_grid(AccSet *Set, const char *Name, WMMtype_MagneticModel *MagneticModel, int UseGeoid)
+{
+	double *Heights, *Latitudes, *Longitudes, *Years;
+	int NumHeights, NumLatitudes, NumLongitudes, NumYears, h, a, b, Status;
+	size_t i;
+
+	/* The axes are built by WMM_GridAxis, as WMM_GridParallel builds them */
+	Set->GridMinimum.phi = -90.0;
+	Set->GridMaximum.phi = 90.0;
+	Set->GridMinimum.lambda = -180.0;
+	Set->GridMaximum.lambda = 180.0;
+	Set->GridMinimum.HeightAboveGeoid = 0.0;
+	Set->GridMaximum.HeightAboveGeoid = 850.0;
+	Set->GridStep = 22.5;
+	Set->GridHeightStep = 425.0;
+	Set->GridYearStep = 2.5;
+	NumHeights = WMM_GridAxis(0.0, 850.0, Set->GridHeightStep, &Heights);
+	NumLatitudes = WMM_GridAxis(-90.0, 90.0, Set->GridStep, &Latitudes);
+	NumLongitudes = WMM_GridAxis(-180.0, 180.0, Set->GridStep, &Longitudes);
+	NumYears = WMM_GridAxis(MagneticModel->epoch, MagneticModel->epoch + 5.0, Set->GridYearStep, &Years);
+	Status = NumHeights > 0 && NumLatitudes > 0 && NumLongitudes > 0 && NumYears > 0 && NumYears <= ACC_MAX_DATES &&
+		acc_allocate_set(Set, Name, (size_t) NumHeights * NumLatitudes * NumLongitudes);
+	Set->UseGeoid = UseGeoid;
+	Set->IsGrid = 1;
+	for (h = 0, i = 0; Status && h < NumHeights; h++)
+		for (a = 0; a < NumLatitudes; a++)
+			for (b = 0; b < NumLongitudes; b++, i++)
+			{
+				Set->Height[i] = Heights[h];
+				Set->Latitude[i] = Latitudes[a];
+				Set->Longitude[i] = Longitudes[b];
+			}
+	for (h = 0; Status && h < NumYears; h++)
+		Set->Years[h] = Years[h];
+	Set->NumDates = NumYears;
+	free(Heights);
+	free(Latitudes);
+	free(Longitudes);
+	free(Years);
+	return Status;
+} /* acc_setup_grid */
+
+int acc_allocate_set(AccSet *Set, const char *Name, size_t NumLocations)
+{
+	Set->Name = Name;
+	Set->NumLocations = NumLocations;
+	Set->Latitude = (double *) malloc(NumLocations * sizeof(double));
+	Set->Longitude = (double *) malloc(NumLocations * sizeof(double));
+	Set->Height = (double *) malloc(NumLocations * sizeof(double));
+	Set->Reference = (WMMtype_GeoMagneticElements *) malloc(NumLocations * ACC_MAX_DATES * sizeof(WMMtype_GeoMagneticElements));
+	return Set->Latitude && Set->Longitude && Set->Height && Set->Reference;
+} /* acc_allocate_set */
+
+void acc_free_set(AccSet *Set)
+{
+	free(Set->Latitude);
+	free(Set->Longitude);
+	free(Set->Height);
+	free(Set->Reference);
+} /* acc_free_set */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine acc_reference                           */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Computes the reference elements of a set with the scalar double path    */
+/*     of wmm_point: one time modified model per date and WMM_Geomag, then  */
+/*     WMM_CalculateGridVariation for the grid variation.                   */
+/*                                                                          */
+/*  Input:  Input - Model, ellipsoid and geoid, with Geoid->UseGeoid set    */
+/*          to that of the set                                              */
+/*  Output: Set->Reference                                                  */
+/*                                                                          */
+/****************************************************************************/
+
+void acc_reference(AccInput *Input, AccSet *Set)
+{
+	WMMtype_MagneticModel *TimedMagneticModel;
+	WMMtype_CoordGeodetic CoordGeodetic;
+	WMMtype_CoordSpherical CoordSpherical;
+	WMMtype_Date Date;
+	size_t i;
+	int d;
+
+	TimedMagneticModel = WMM_AllocateModelMemory(( Input->MagneticModel->nMax + 1 ) * ( Input->MagneticModel->nMax + 2 ) / 2);
+	if (TimedMagneticModel == NULL)
+	{
+		WMM_Error(2);
+		exit(1);
+	}
+	for (d = 0; d < Set->NumDates; d++)
+	{
+		Date.DecimalYear = Set->Years[d];
+		WMM_TimelyModifyMagneticModel(Date, Input->MagneticModel, TimedMagneticModel);
+		for (i = 0; i < Set->NumLocations; i++)
+		{
+			CoordGeodetic.phi = Set->Latitude[i];
+			CoordGeodetic.lambda = Set->Longitude[i];
+			CoordGeodetic.HeightAboveGeoid = Set->Height[i];
+			CoordGeodetic.UseGeoid = Set->UseGeoid;
+			WMM_ConvertGeoidToEllipsoidHeight(&CoordGeodetic, Input->Geoid);
+			WMM_GeodeticToSpherical(Input->Ellip, CoordGeodetic, &CoordSpherical);
+			WMM_Geomag(Input->Ellip, CoordSpherical, CoordGeodetic, TimedMagneticModel, &Set->Reference[d * Set->NumLocations + i]);
+			WMM_CalculateGridVariation(CoordGeodetic, &Set->Reference[d * Set->NumLocations + i]);
+		}
+	}
+	WMM_FreeMagneticModelMemory(TimedMagneticModel);
+} /* acc_reference */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine acc_check_test_values                   */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Compares the reference elements of the test set with the published     */
+/*     WMM2010 test values, which are rounded to 0.1 nT and 0.01 degrees.   */
+/*                                                                          */
+/*  Input:  Set - The test set, with its reference elements                 */
+/*          ModelName, FieldTolerance, AngleTolerance                       */
+/*  Output: Returns 1 if every value is within the tolerances               */
+/*                                                                          */
+/****************************************************************************/
+
+int acc_check_test_values(AccSet *Set, const char *ModelName, double FieldTolerance, double AngleTolerance)
+{
+	WMMtype_GeoMagneticElements *Reference;
+	double Value[7], MaxField = 0, MaxAngle = 0, Error;
+	int i, k, Status = 1;
+
+	for (i = 0; i < 12; i++)
+	{
+		Reference = &Set->Reference[i];	/* Rows 0 to 5 are the first date, 6 to 11 the second */
+		Value[0] = Reference->X;
+		Value[1] = Reference->Y;
+		Value[2] = Reference->Z;
+		Value[3] = Reference->H;
+		Value[4] = Reference->F;
+		Value[5] = Reference->Incl;
+		Value[6] = Reference->Decl;
+		for (k = 0; k < 7; k++)
+		{
+			Error = fabs(Value[k] - TestValues[i][4 + k]);
+			if (k < 5 && Error > MaxField)
+				MaxField = Error;
+			if (k >= 5 && Error > MaxAngle)
+				MaxAngle = Error;
+			if (!(Error <= (k < 5 ? FieldTolerance : AngleTolerance) + 1e-9))
+			{
+				printf("FAIL test value %d: %s %.4f instead of %.2f\n", i + 1, Elements[k < 5 ? k : 11 - k].Name,
+					Value[k], TestValues[i][4 + k]);
+				Status = 0;
+			}
+		}
+	}
+	printf("WMM_Geomag against the %s test values: largest difference %.3f nT, %.4f degrees (published to 0.1 nT, 0.01 degrees)\n",
+		ModelName, MaxField, MaxAngle);
+	return Status;
+} /* acc_check_test_values */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine acc_error                               */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Absolute error of element k. Declinations and grid variations are      */
+/*     compared modulo 360 degrees. A NaN on either side gives an infinite  */
+/*     error.                                                               */
+/*                                                                          */
+/****************************************************************************/
+
+double acc_error(int k, double Value, double Reference)
+{
+	double Error = Value - Reference;
+
+	if (isnan(Error))
+		return INFINITY;
+	if (Elements[k].Offset == offsetof(WMMtype_GeoMagneticElements, Decl) || Elements[k].Offset == offsetof(WMMtype_GeoMagneticElements, GV))
+		Error = remainder(Error, 360.0);
+	return fabs(Error);
+} /* acc_error */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine acc_geoid_path                          */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Loads a geoid as the path describes and compares its heights at the     */
+/*     locations of every set with those of the reference geoid.            */
+/*                                                                          */
+/*  Input:  Path - Storage, layout, loading and lookup of the geoid         */
+/*          Sets - ACC_NUM_SETS sets                                        */
+/*          Reference - The float row-major geoid of the program            */
+/*          GeoidBuffer, GeoidSize - EGM9615.BIN in memory                  */
+/*          Heights - Scratch, as many elements as the largest set          */
+/*  Output: Path->MaxError and Path->NumPoints. Returns 1 on success, 0 if  */
+/*          the geoid could not be loaded                                   */
+/*                                                                          */
+/****************************************************************************/
+
+int acc_geoid_path(AccGeoidPath *Path, AccSet *Sets, WMMtype_Geoid *Reference, const char *GeoidBuffer, size_t GeoidSize,
+	double *Heights)
+{
+	WMMtype_MagneticModel MagneticModel;
+	WMMtype_Ellipsoid Ellip;
+	WMMtype_Geoid Geoid;
+	double Error, ReferenceHeight;
+	size_t i;
+	int s;
+
+	WMM_SetDefaults(&Ellip, &MagneticModel, &Geoid);
+	Geoid.Storage = Path->Storage;
+	Geoid.Tiled = Path->Tiled;
+	if (Path->FromBuffer)
+		WMM_InitializeGeoidFromBuffer(&Geoid, GeoidBuffer, GeoidSize);
+	else
+		WMM_InitializeGeoid(&Geoid);
+	if (!Geoid.Geoid_Initialized)
+	{
+		printf("FAIL %s: geoid not loaded\n", Path->Name);
+		return 0;
+	}
+	for (s = 0; s < ACC_NUM_SETS; s++)
+	{
+		if (Path->Batch)
+			WMM_GetGeoidHeightBatch(Sets[s].Latitude, Sets[s].Longitude, Sets[s].NumLocations, Heights, &Geoid);
+		else
+			for (i = 0; i < Sets[s].NumLocations; i++)
+				WMM_GetGeoidHeight(Sets[s].Latitude[i], Sets[s].Longitude[i], &Heights[i], &Geoid);
+		for (i = 0; i < Sets[s].NumLocations; i++)
+		{
+			WMM_GetGeoidHeight(Sets[s].Latitude[i], Sets[s].Longitude[i], &ReferenceHeight, Reference);
+			Error = fabs(Heights[i] - ReferenceHeight);
+			if (!(Error <= Path->MaxError))	/* NaN is kept */
+				Path->MaxError = isnan(Error) ? INFINITY : Error;
+		}
+		Path->NumPoints += Sets[s].NumLocations;
+	}
+	WMM_FreeGeoid(&Geoid);
+	return 1;
+} /* acc_geoid_path */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine acc_read_file                           */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Reads a whole file into memory.                                         */
+/*                                                                          */
+/*  Input:  FileName                                                        */
+/*  Output: Size - Bytes read. Returns the contents, to be freed by the     */
+/*          caller, or NULL if the file could not be read                   */
+/*                                                                          */
+/****************************************************************************/
+
+char *acc_read_file(const char *FileName, size_t *Size)
+{
+	FILE *filein;
+	char *Buffer = NULL;
+	long Length;
+
+	filein = fopen(FileName, "rb");
+	if (!filein)
+		return NULL;
+	if (fseek(filein, 0, SEEK_END) == 0 && (Length = ftell(filein)) > 0 && fseek(filein, 0, SEEK_SET) == 0)
+	{
+		Buffer = (char *) malloc((size_t) Length);
+		if (Buffer && fread(Buffer, 1, (size_t) Length, filein) != (size_t) Length)
+		{
+			free(Buffer);
+			Buffer = NULL;
+		}
+		*Size = (size_t) Length;
+	}
+	fclose(filein);
+	return Buffer;
+} /* acc_read_file */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine acc_random                              */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Uniform pseudo-random number in [0, 1) from a xorshift64* generator, so */
+/*     the points are the same on every platform and C library.             */
+/*                                                                          */
+/****************************************************************************/
+
+double acc_random(unsigned long long *State)
+{
+	*State ^= *State >> 12;
+	*State ^= *State << 25;
+	*State ^= *State >> 27;
+	return (double) ((*State * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+} /* acc_random */
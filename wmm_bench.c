@@ -0,0 +1,568 @@
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "WMMHeader.h"
+#include "WMM_SubLibrary.c"
+
+//---------------------------------------------------------------------------
+
+/* WMM sublibrary is used to make a benchmark program. The program times the stages
+of a WMM evaluation one by one (Legendre functions, spherical harmonic variables,
+summations, coordinate conversion, geoid, UTM, the complete WMM_Geomag, the double and
+single precision batches and the fixed point engine) over a fixed
+set of pseudo-random points and over a set of points at and next to the geographic
+poles. For each stage and input set it reports the time per point, the points per
+second and, on x86, the time stamp counter cycles per point, on the screen and as JSON.
+The inputs do not depend on the platform or the C library, so the results of two
+builds can be compared directly. The program expects WMM.COF and EGM9615.BIN in the
+current directory, as the other programs do.
+
+Usage: wmm_bench [output_file]	(default wmm_bench.json, "make bench" runs it)
+
+ *
+ * MODIFICATIONS
+ *
+ *    Date                 Version
+ *    ----                 -----------
+ *    Oct 17, 2026         1.0
+ *    Oct 17, 2026         1.1   Single precision batch stage
+ *    Oct 17, 2026         1.2   Fixed point engine stage
+
+
+*/
+
+#define BENCH_POINTS	1024	/* Points of each input set */
+#define BENCH_RUNS	5		/* Timed runs of each stage, the fastest is reported */
+#define BENCH_MIN_SECONDS	0.05	/* Minimum duration of one timed run */
+
+typedef struct {
+	const char *Name;		/* "random" or "pole" */
+	size_t NumPoints;
+	int NumTerms;
+	WMMtype_Ellipsoid Ellip;
+	WMMtype_MagneticModel *MagneticModel;	/* As read from the file */
+	WMMtype_MagneticModel *TimedMagneticModel;	/* Time modified to DecimalYear */
+	WMMtype_Geoid *Geoid;
+	WMMtype_Context *Context;
+	double DecimalYear;
+	double *Latitude, *Longitude, *Height;	/* Geodetic coordinates, heights in km above the ellipsoid */
+	double *x;				/* sin(geocentric latitude), the argument of the Legendre functions */
+	WMMtype_CoordGeodetic *CoordGeodetic;
+	WMMtype_CoordSpherical *CoordSpherical;
+	WMMtype_SphericalHarmonicVariables *SphVariables;
+	WMMtype_LegendreFunction *LegendreFunction;	/* Per point, Pcup and dPcup point into the arrays below */
+	double *Pcup, *dPcup;
+	double *Scratch;		/* Legendre function buffers of the stages that compute them */
+	double *Out[7];			/* Batch results */
+	WMMtype_Float *FloatLatitude, *FloatLongitude, *FloatHeight;	/* Inputs of the single precision batch */
+	WMMtype_Float *FloatOut[7];	/* Its results */
+	WMMtype_FixedModel *FixedModel;	/* Tables of the fixed point engine */
+	WMMtype_CoordSphericalFixed *CoordFixed;	/* Its inputs, from CoordSpherical */
+	WMMtype_Fixed YearOffset;	/* DecimalYear minus the epoch, Q24 */
+} BenchInput;
+
+typedef struct {
+	const char *Name;
+	double (*Run)(BenchInput *Input);	/* Evaluates the stage at every point, returns a checksum */
+} BenchStage;
+
+static double BenchSink;	/* Checksums go here so that no stage can be optimized away */
+
+double bench_seconds(void);
+unsigned long long bench_cycles(void);
+double bench_random(unsigned long long *State);
+int bench_setup(BenchInput *Input, const char *Name, WMMtype_MagneticModel *MagneticModel, WMMtype_Ellipsoid Ellip,
+				WMMtype_Geoid *Geoid, int Poles);
+void bench_free(BenchInput *Input);
+void bench_stage(BenchStage *Stage, BenchInput *Input, FILE *json, int *First);
+
+/****************************************************************************/
+/*                                                                          */
+/*                       The stages                                         */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Each stage runs one library function at every point of the input, with  */
+/*     the inputs of that function precomputed by bench_setup.              */
+/*                                                                          */
+/****************************************************************************/
+
+static double run_PcupLow(BenchInput *in)
+{
+	double Sum = 0;
+	size_t i;
+
+	for (i = 0; i < in->NumPoints; i++)
+	{
+		WMM_PcupLow(in->Scratch, in->Scratch + in->NumTerms + 1, in->x[i], in->MagneticModel->nMax);
+		Sum += in->Scratch[in->NumTerms - 1];
+	}
+	return Sum;
+}
+
+static double run_PcupHigh(BenchInput *in)
+{
+	double Sum = 0, x;
+	size_t i;
+
+	for (i = 0; i < in->NumPoints; i++)
+	{
+		x = in->x[i];
+		if (fabs(x) == 1.0)	/* The derivatives are not defined at the poles, see WMM_PcupHigh */
+			x = nextafter(x, 0.0);
+		WMM_PcupHigh(in->Scratch, in->Scratch + in->NumTerms + 1, x, in->MagneticModel->nMax);
+		Sum += in->Scratch[in->NumTerms - 1];
+	}
+	return Sum;
+}
+
+static double run_ComputeSphericalHarmonicVariables(BenchInput *in)
+{
+	WMMtype_SphericalHarmonicVariables SphVariables;
+	double Sum = 0;
+	size_t i;
+
+	for (i = 0; i < in->NumPoints; i++)
+	{
+		WMM_ComputeSphericalHarmonicVariables(in->Ellip, in->CoordSpherical[i], in->MagneticModel->nMax, &SphVariables);
+		Sum += SphVariables.cos_mlambda[in->MagneticModel->nMax] + SphVariables.RelativeRadiusPower[in->MagneticModel->nMax];
+	}
+	return Sum;
+}
+
+static double run_Summation(BenchInput *in)
+{
+	WMMtype_MagneticResults MagneticResults;
+	double Sum = 0;
+	size_t i;
+
+	for (i = 0; i < in->NumPoints; i++)
+	{
+		WMM_Summation(&in->LegendreFunction[i], in->TimedMagneticModel, in->SphVariables[i], in->CoordSpherical[i], &MagneticResults);
+		Sum += MagneticResults.Bx + MagneticResults.By + MagneticResults.Bz;
+	}
+	return Sum;
+}
+
+static double run_SecVarSummation(BenchInput *in)
+{
+	WMMtype_MagneticResults MagneticResults;
+	double Sum = 0;
+	size_t i;
+
+	for (i = 0; i < in->NumPoints; i++)
+	{
+		WMM_SecVarSummation(&in->LegendreFunction[i], in->TimedMagneticModel, in->SphVariables[i], in->CoordSpherical[i], &MagneticResults);
+		Sum += MagneticResults.Bx + MagneticResults.By + MagneticResults.Bz;
+	}
+	return Sum;
+}
+
+static double run_GeodeticToSpherical(BenchInput *in)
+{
+	WMMtype_CoordSpherical CoordSpherical;
+	double Sum = 0;
+	size_t i;
+
+	for (i = 0; i < in->NumPoints; i++)
+	{
+		WMM_GeodeticToSpherical(in->Ellip, in->CoordGeodetic[i], &CoordSpherical);
+		Sum += CoordSpherical.phig + CoordSpherical.r;
+	}
+	return Sum;
+}
+
+static double run_GetGeoidHeight(BenchInput *in)
+{
+	double Sum = 0, DeltaHeight;
+	size_t i;
+
+	for (i = 0; i < in->NumPoints; i++)
+	{
+		WMM_GetGeoidHeight(in->Latitude[i], in->Longitude[i], &DeltaHeight, in->Geoid);
+		Sum += DeltaHeight;
+	}
+	return Sum;
+}
+
+static double run_GetTransverseMercator(BenchInput *in)
+{
+	WMMtype_UTMParameters UTMParameters;
+	double Sum = 0;
+	size_t i;
+
+	for (i = 0; i < in->NumPoints; i++)
+	{
+		WMM_GetTransverseMercator(in->CoordGeodetic[i], &UTMParameters);
+		Sum += UTMParameters.ConvergenceOfMeridians;
+	}
+	return Sum;
+}
+
+static double run_Geomag(BenchInput *in)
+{
+	WMMtype_GeoMagneticElements GeoMagneticElements;
+	double Sum = 0;
+	size_t i;
+
+	for (i = 0; i < in->NumPoints; i++)
+	{
+		WMM_Geomag(in->Ellip, in->CoordSpherical[i], in->CoordGeodetic[i], in->TimedMagneticModel, &GeoMagneticElements);
+		Sum += GeoMagneticElements.F + GeoMagneticElements.Decldot;
+	}
+	return Sum;
+}
+
+static double run_ContextGeomagBatch(BenchInput *in)
+{
+	WMMtype_GeoMagneticElementsBatch Results;
+
+	memset(&Results, 0, sizeof(Results));
+	Results.X = in->Out[0];
+	Results.Y = in->Out[1];
+	Results.Z = in->Out[2];
+	Results.F = in->Out[3];
+	Results.Decl = in->Out[4];
+	Results.Incl = in->Out[5];
+	Results.Fdot = in->Out[6];
+	WMM_ContextGeomagBatch(in->Context, in->Latitude, in->Longitude, in->Height, in->DecimalYear, in->NumPoints, &Results);
+	return in->Out[3][0] + in->Out[6][in->NumPoints - 1];
+}
+
+static double run_ContextGeomagBatchFloat(BenchInput *in)
+{
+	WMMtype_GeoMagneticElementsBatchFloat Results;
+
+	memset(&Results, 0, sizeof(Results));
+	Results.X = in->FloatOut[0];
+	Results.Y = in->FloatOut[1];
+	Results.Z = in->FloatOut[2];
+	Results.F = in->FloatOut[3];
+	Results.Decl = in->FloatOut[4];
+	Results.Incl = in->FloatOut[5];
+	Results.Fdot = in->FloatOut[6];
+	WMM_ContextGeomagBatchFloat(in->Context, in->FloatLatitude, in->FloatLongitude, in->FloatHeight, in->DecimalYear,
+		in->NumPoints, &Results);
+	return in->FloatOut[3][0] + in->FloatOut[6][in->NumPoints - 1];
+}
+
+static double run_FixedSummation(BenchInput *in)
+{
+	WMMtype_MagneticResultsFixed MagneticResults, MagneticResultsVar;
+	double Sum = 0;
+	size_t i;
+
+	for (i = 0; i < in->NumPoints; i++)
+	{
+		WMM_FixedSummation(in->FixedModel, in->YearOffset, &in->CoordFixed[i], &MagneticResults, &MagneticResultsVar);
+		Sum += (double) MagneticResults.Bz + (double) MagneticResultsVar.Bx;
+	}
+	return Sum;
+}
+
+static BenchStage Stages[] = {
+	{"WMM_PcupLow", run_PcupLow},
+	{"WMM_PcupHigh", run_PcupHigh},
+	{"WMM_ComputeSphericalHarmonicVariables", run_ComputeSphericalHarmonicVariables},
+	{"WMM_Summation", run_Summation},
+	{"WMM_SecVarSummation", run_SecVarSummation},
+	{"WMM_GeodeticToSpherical", run_GeodeticToSpherical},
+	{"WMM_GetGeoidHeight", run_GetGeoidHeight},
+	{"WMM_GetTransverseMercator", run_GetTransverseMercator},
+	{"WMM_Geomag", run_Geomag},
+	{"WMM_ContextGeomagBatch", run_ContextGeomagBatch},
+	{"WMM_ContextGeomagBatchFloat", run_ContextGeomagBatchFloat},
+	{"WMM_FixedSummation", run_FixedSummation},
+};
+
+int main(int argc, char *argv[])
+{
+	WMMtype_MagneticModel *MagneticModel;
+	WMMtype_Ellipsoid Ellip;
+	WMMtype_Geoid Geoid;
+	BenchInput Inputs[2];
+	FILE *json;
+	const char *jsonname = argc > 1 ? argv[1] : "wmm_bench.json";
+	int NumTerms, i, s, First = 1;
+
+	NumTerms = ( ( WMM_MAX_MODEL_DEGREES + 1 ) * ( WMM_MAX_MODEL_DEGREES + 2 ) / 2 );    /* WMM_MAX_MODEL_DEGREES is defined in WMM_Header.h */
+	MagneticModel = WMM_AllocateModelMemory(NumTerms);
+	if(MagneticModel == NULL)
+	{
+		WMM_Error(2);
+		return 1;
+	}
+	WMM_SetDefaults(&Ellip, MagneticModel, &Geoid); /* Set default values and constants */
+	WMM_readMagneticModel(WMM_COF_FILE, MagneticModel);
+	WMM_InitializeGeoidMapped(&Geoid);    /* Read the Geoid file */
+	if (!Geoid.Geoid_Initialized)
+		return 1;
+
+	if (!bench_setup(&Inputs[0], "random", MagneticModel, Ellip, &Geoid, 0) ||
+		!bench_setup(&Inputs[1], "pole", MagneticModel, Ellip, &Geoid, 1))
+	{
+		WMM_Error(2);
+		return 1;
+	}
+
+	json = fopen(jsonname, "w");
+	if (!json)
+	{
+		printf("Error opening %s to write\n", jsonname);
+		return 1;
+	}
+	fprintf(json, "{\n  \"model\": \"%s\",\n  \"epoch\": %.1f,\n  \"nmax\": %d,\n  \"simd_level\": %d,\n  \"points\": %d,\n",
+		MagneticModel->ModelName, MagneticModel->epoch, MagneticModel->nMax, WMM_GetSimdLevel(), BENCH_POINTS);
+	fprintf(json, "  \"cycles\": \"%s\",\n  \"stages\": [", bench_cycles() ? "tsc" : "none");
+
+	printf("%-40s %-7s %12s %14s %12s\n", "stage", "input", "ns/point", "points/s", "cycles/point");
+	for (s = 0; s < (int) (sizeof(Stages) / sizeof(Stages[0])); s++)
+		for (i = 0; i < 2; i++)
+			bench_stage(&Stages[s], &Inputs[i], json, &First);
+
+	fprintf(json, "\n  ]\n}\n");
+	if (fclose(json) != 0)
+		printf("Error writing %s\n", jsonname);
+	else
+		printf("Results written to %s\n", jsonname);
+
+	bench_free(&Inputs[0]);
+	bench_free(&Inputs[1]);
+	WMM_FreeMagneticModelMemory(MagneticModel);
+	WMM_FreeGeoid(&Geoid);
+	return BenchSink == 12345.0;	/* Never true, keeps the checksums alive */
+}
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine bench_stage                             */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Times one stage on one input set. The number of passes over the points  */
+/*     is doubled until a run lasts BENCH_MIN_SECONDS, then the fastest of   */
+/*     BENCH_RUNS runs is reported on the screen and appended to the JSON.   */
+/*                                                                          */
+/*  Input:  Stage, Input                                                    */
+/*          json - JSON file, First - 1 until the first entry is written    */
+/*                                                                          */
+/****************************************************************************/
+
+void bench_stage(BenchStage *Stage, BenchInput *Input, FILE *json, int *First)
+{
+	double Start, Seconds, Best = 0, ns, Cycles = -1;
+	unsigned long long StartCycles, BestCycles = 0;
+	long Passes = 1, p;
+	int r;
+
+	/* Warm up and calibrate */
+	for (;;)
+	{
+		Start = bench_seconds();
+		for (p = 0; p < Passes; p++)
+			BenchSink += Stage->Run(Input);
+		if (bench_seconds() - Start >= BENCH_MIN_SECONDS || Passes >= (1L << 24))
+			break;
+		Passes *= 2;
+	}
+
+	for (r = 0; r < BENCH_RUNS; r++)
+	{
+		StartCycles = bench_cycles();
+		Start = bench_seconds();
+		for (p = 0; p < Passes; p++)
+			BenchSink += Stage->Run(Input);
+		Seconds = bench_seconds() - Start;
+		if (r == 0 || Seconds < Best)
+		{
+			Best = Seconds;
+			BestCycles = bench_cycles() - StartCycles;
+		}
+	}
+
+	ns = Best * 1e9 / ((double) Passes * Input->NumPoints);
+	if (bench_cycles())
+		Cycles = (double) BestCycles / ((double) Passes * Input->NumPoints);
+	printf("%-40s %-7s %12.1f %14.0f %12.1f\n", Stage->Name, Input->Name, ns, 1e9 / ns, Cycles);
+	fprintf(json, "%s\n    {\"stage\": \"%s\", \"input\": \"%s\", \"ns_per_point\": %.3f, \"points_per_second\": %.0f, \"cycles_per_point\": ",
+		*First ? "" : ",", Stage->Name, Input->Name, ns, 1e9 / ns);
+	if (Cycles >= 0)
+		fprintf(json, "%.1f}", Cycles);
+	else
+		fprintf(json, "null}");
+	*First = 0;
+} /* bench_stage */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine bench_setup                             */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Builds an input set of BENCH_POINTS points and precomputes the inputs   */
+/*     of every stage, so that each stage is timed on its own.              */
+/*                                                                          */
+/*  Input:  Name - Name of the set in the report                            */
+/*          MagneticModel, Ellip, Geoid - As read by the program            */
+/*          Poles - 0 for uniformly distributed points, 1 for points at     */
+/*                  the poles and within 1e-6 degrees of them               */
+/*                                                                          */
+/*  Output: Input - The set. Returns 1 on success, 0 if memory ran out      */
+/*                                                                          */
+/****************************************************************************/
+
+int bench_setup(BenchInput *Input, const char *Name, WMMtype_MagneticModel *MagneticModel, WMMtype_Ellipsoid Ellip,
+				WMMtype_Geoid *Geoid, int Poles)
+{
+	unsigned long long State = Poles ? 0x5eed0002ULL : 0x5eed0001ULL;
+	WMMtype_Date Date;
+	size_t i, N = BENCH_POINTS;
+	int k, ok;
+
+	memset(Input, 0, sizeof(BenchInput));
+	Input->Name = Name;
+	Input->NumPoints = N;
+	Input->NumTerms = ( ( MagneticModel->nMax + 1 ) * ( MagneticModel->nMax + 2 ) / 2 );
+	Input->Ellip = Ellip;
+	Input->MagneticModel = MagneticModel;
+	Input->Geoid = Geoid;
+	Input->DecimalYear = MagneticModel->epoch + 2.5;
+	Input->TimedMagneticModel = WMM_AllocateModelMemory(Input->NumTerms);
+	Input->Context = WMM_CreateContext(Ellip, MagneticModel, NULL);
+	Input->Latitude = (double *) malloc(N * sizeof(double));
+	Input->Longitude = (double *) malloc(N * sizeof(double));
+	Input->Height = (double *) malloc(N * sizeof(double));
+	Input->x = (double *) malloc(N * sizeof(double));
+	Input->CoordGeodetic = (WMMtype_CoordGeodetic *) malloc(N * sizeof(WMMtype_CoordGeodetic));
+	Input->CoordSpherical = (WMMtype_CoordSpherical *) malloc(N * sizeof(WMMtype_CoordSpherical));
+	Input->SphVariables = (WMMtype_SphericalHarmonicVariables *) malloc(N * sizeof(WMMtype_SphericalHarmonicVariables));
+	Input->LegendreFunction = (WMMtype_LegendreFunction *) malloc(N * sizeof(WMMtype_LegendreFunction));
+	Input->Pcup = (double *) malloc(N * (Input->NumTerms + 1) * sizeof(double));
+	Input->dPcup = (double *) malloc(N * (Input->NumTerms + 1) * sizeof(double));
+	Input->Scratch = (double *) malloc(2 * (Input->NumTerms + 1) * sizeof(double));
+	ok = Input->TimedMagneticModel && Input->Context && Input->Latitude && Input->Longitude && Input->Height &&
+		Input->x && Input->CoordGeodetic && Input->CoordSpherical && Input->SphVariables && Input->LegendreFunction &&
+		Input->Pcup && Input->dPcup && Input->Scratch;
+	Input->FloatLatitude = (WMMtype_Float *) malloc(N * sizeof(WMMtype_Float));
+	Input->FloatLongitude = (WMMtype_Float *) malloc(N * sizeof(WMMtype_Float));
+	Input->FloatHeight = (WMMtype_Float *) malloc(N * sizeof(WMMtype_Float));
+	ok = ok && Input->FloatLatitude && Input->FloatLongitude && Input->FloatHeight;
+	Input->FixedModel = (WMMtype_FixedModel *) malloc(sizeof(WMMtype_FixedModel));
+	Input->CoordFixed = (WMMtype_CoordSphericalFixed *) malloc(N * sizeof(WMMtype_CoordSphericalFixed));
+	ok = ok && Input->FixedModel && Input->CoordFixed && WMM_FixedModelFromModel(MagneticModel, Input->FixedModel);
+	for (k = 0; k < 7; k++)
+	{
+		Input->Out[k] = (double *) malloc(N * sizeof(double));
+		Input->FloatOut[k] = (WMMtype_Float *) malloc(N * sizeof(WMMtype_Float));
+		ok = ok && Input->Out[k] && Input->FloatOut[k];
+	}
+	if (!ok)
+		return 0;
+
+	Date.DecimalYear = Input->DecimalYear;
+	WMM_TimelyModifyMagneticModel(Date, MagneticModel, Input->TimedMagneticModel);
+	Input->YearOffset = WMM_FIXED_FROM_DOUBLE(Input->DecimalYear - MagneticModel->epoch, WMM_FIXED_YEAR_BITS);
+	for (i = 0; i < N; i++)
+	{
+		if (Poles)
+		{
+			/* Alternately at a pole and up to 1e-6 degrees from it, where the By summation switches to the special case */
+			Input->Latitude[i] = (i & 2 ? -90.0 : 90.0) * (i & 1 ? 1.0 - bench_random(&State) * 1e-8 : 1.0);
+			Input->Longitude[i] = 360.0 * bench_random(&State) - 180.0;
+		}
+		else
+		{
+			Input->Latitude[i] = RAD2DEG(asin(2.0 * bench_random(&State) - 1.0));	/* Uniform over the sphere */
+			Input->Longitude[i] = 360.0 * bench_random(&State) - 180.0;
+		}
+		Input->Height[i] = 100.0 * bench_random(&State);
+		Input->FloatLatitude[i] = (WMMtype_Float) Input->Latitude[i];
+		Input->FloatLongitude[i] = (WMMtype_Float) Input->Longitude[i];
+		Input->FloatHeight[i] = (WMMtype_Float) Input->Height[i];
+		Input->CoordGeodetic[i].phi = Input->Latitude[i];
+		Input->CoordGeodetic[i].lambda = Input->Longitude[i];
+		Input->CoordGeodetic[i].HeightAboveEllipsoid = Input->Height[i];
+		Input->CoordGeodetic[i].HeightAboveGeoid = Input->Height[i];
+		Input->CoordGeodetic[i].UseGeoid = 0;
+		WMM_GeodeticToSpherical(Ellip, Input->CoordGeodetic[i], &Input->CoordSpherical[i]);
+		WMM_ComputeSphericalHarmonicVariables(Ellip, Input->CoordSpherical[i], MagneticModel->nMax, &Input->SphVariables[i]);
+		WMM_FixedFromSpherical(Ellip, Input->CoordSpherical[i], &Input->CoordFixed[i]);
+		Input->x[i] = sin(DEG2RAD(Input->CoordSpherical[i].phig));
+		Input->LegendreFunction[i].Pcup = Input->Pcup + i * (Input->NumTerms + 1);
+		Input->LegendreFunction[i].dPcup = Input->dPcup + i * (Input->NumTerms + 1);
+		WMM_PcupLow(Input->LegendreFunction[i].Pcup, Input->LegendreFunction[i].dPcup, Input->x[i], MagneticModel->nMax);
+	}
+	return 1;
+} /* bench_setup */
+
+void bench_free(BenchInput *Input)
+{
+	int k;
+
+	WMM_FreeMagneticModelMemory(Input->TimedMagneticModel);
+	WMM_FreeContext(Input->Context);
+	free(Input->Latitude);
+	free(Input->Longitude);
+	free(Input->Height);
+	free(Input->x);
+	free(Input->CoordGeodetic);
+	free(Input->CoordSpherical);
+	free(Input->SphVariables);
+	free(Input->LegendreFunction);
+	free(Input->Pcup);
+	free(Input->dPcup);
+	free(Input->Scratch);
+	free(Input->FloatLatitude);
+	free(Input->FloatLongitude);
+	free(Input->FloatHeight);
+	free(Input->FixedModel);
+	free(Input->CoordFixed);
+	for (k = 0; k < 7; k++)
+	{
+		free(Input->Out[k]);
+		free(Input->FloatOut[k]);
+	}
+} /* bench_free */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine bench_random                            */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Uniform pseudo-random number in [0, 1) from a xorshift64* generator, so */
+/*     the inputs are the same on every platform and C library.             */
+/*                                                                          */
+/****************************************************************************/
+
+double bench_random(unsigned long long *State)
+{
+	*State ^= *State >> 12;
+	*State ^= *State << 25;
+	*State ^= *State >> 27;
+	return (double) ((*State * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+} /* bench_random */
+
+double bench_seconds(void)
+{
+	struct timespec Now;
+
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return Now.tv_sec + 1e-9 * Now.tv_nsec;
+} /* bench_seconds */
+
+/* Time stamp counter, 0 where there is none. The counter runs at a constant rate on current
+x86 processors, so its cycles are reference cycles rather than core clock cycles. */
+unsigned long long bench_cycles(void)
+{
+#if WMM_SIMD_X86
+	return __rdtsc();
+#else
+	return 0;
+#endif
+} /* bench_cycles */
@@ -22,6 +22,9 @@ November 15, 2009
  *    ----                 -----------
  *    Nov 15, 2009         0.1
 	Jan 28, 2010	   1.0
+	Oct 17, 2026	   1.1  Streaming input, batched evaluation and buffered output
+	Oct 17, 2026	   1.2  Cached time modified models, optional date rounding (-q)
+	Oct 17, 2026	   1.3  Library stage counters printed when built with WMM_STATS
 
 
 
@@ -35,6 +38,8 @@ November 15, 2009
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include <stdarg.h>
 
 /* The following include file must define a function 'isnan' */
 /* This function, which returns '1' if the number is NaN and 0*/
@@ -98,8 +103,129 @@ November 15, 2009
 /*                                                                          */
 /*   yrmin      Float array of MAXMOD  Min year of model.                   */
 /*                                                                          */
+/*                                                                          */
+/*   FileRecord  Struct                One parsed line of the input file.   */
+/*                                                                          */
+/*   Records     FileRecord array      Lines evaluated together.            */
+/*                                                                          */
 /****************************************************************************/
 
+/* The coordinate file is processed as a stream of chunks of CHUNK_RECORDS lines. The reader reads
+   the file in blocks of READ_BLOCK bytes and copies whole lines into the next free chunk. A chunk is
+   parsed, evaluated by WMM_ContextGeomagBatch (one batch per distinct date and height reference) and
+   formatted on its own, by the reader itself or, with -j N, by one of N worker threads. The chunks
+   form a reorder buffer: they are written, messages included, strictly in input order, so the output
+   does not depend on the number of threads. */
+
+#define READ_BLOCK (4 << 20)		/** Bytes read from the input file at a time **/
+#define CHUNK_RECORDS 16384		/** Lines evaluated together **/
+#define CHUNKS_PER_THREAD 2		/** Size of the reorder buffer per worker thread **/
+#define MAXTHREADS 1024
+#define CHUNK_BYTES (1 << 30)		/** A chunk holds fewer lines if they are this long **/
+#define MAXRESULT 8192			/** Longest formatted result of one line, even with 1e308 elements **/
+#define NUMFIELDS 5			/** Fields of one line: date, reference, altitude, lat, lon **/
+
+#define RECORD_OK 0
+#define RECORD_ARG_ERR 1		/** Line failed validation, processing stops after it **/
+#define RECORD_RANGE 2			/** Date range, which is fatal for the file option **/
+
+typedef struct {
+  double latitude, longitude, alt, sdate;	/* Rounded to float as atof into the float variables of the original loop */
+  int usegeoid;					/* 1 if the height is above MSL, 0 above the WGS-84 ellipsoid */
+  size_t echo, echolen;			/* Input fields as echoed to the output, in the echo buffer */
+  int single;					/* Computed alone by the original sequence: the line with the argument
+								   error, or one outside the domain of WMM_ContextGeomagBatch */
+  size_t result;				/* Index of the results of the line */
+} FileRecord;
+
+typedef struct {
+  double sdate;
+  int usegeoid;
+  size_t index;					/* Line in the chunk */
+} RecordKey;
+
+typedef struct {
+  FILE *file;
+  char *buffer;
+  size_t size, capacity, pos;		/* Valid bytes, allocated bytes and parse position */
+  int eof;						/* No more bytes can be read into the buffer */
+} InputStream;
+
+typedef struct {
+  char *text;
+  size_t len, cap;
+} TextBuffer;
+
+typedef struct {
+  TextBuffer input;				/* The lines, each ended by a '\n' */
+  int nlines;
+  int first_line;				/* Line number of the first line */
+  int usegeoid;					/* Height reference of the line before the first */
+  int at_end;					/* Reading the last line reached the end of the file */
+  char previous[NUMFIELDS][MAXREAD];	/* Fields of the line before the first */
+  TextBuffer output;			/* Echo and results of the lines */
+  TextBuffer messages;			/* Errors and warnings of the lines, for stdout */
+  int status;					/* RECORD_* of the last processed line */
+  int processed;				/* Lines processed, up to the first failing one */
+  int done;						/* Processed and ready to be written */
+} FileChunk;
+
+typedef struct {
+  FileChunk *chunks;			/* Chunk k of the file is chunks[k % NumChunks] */
+  int NumChunks;
+  long NextRead;				/* Chunks filled by the reader */
+  long NextProcess;				/* Chunks taken by the workers */
+  int Finished;					/* No more chunks will be filled */
+  int Cancel;					/* The writer stopped, remaining chunks are not processed */
+#if WMM_THREADS
+  pthread_mutex_t Lock;
+  pthread_cond_t ChunkReady;	/* Signalled when a chunk has been filled */
+  pthread_cond_t ChunkDone;		/* Signalled when a chunk has been processed */
+#endif
+} FilePipeline;
+
+typedef struct {
+  FilePipeline *Pipeline;
+  WMMtype_Context *Context;
+  WMMtype_Geoid Geoid;			/* Copy of the shared geoid, whose UseGeoid the worker sets */
+  float minyr, maxyr;
+  FileRecord *Records;
+  RecordKey *keys;
+  double *latitude, *longitude, *height;
+  WMMtype_GeoMagneticElementsBatch Results;
+  TextBuffer echo;
+} FileWorker;
+
+  /*  Subroutines used  */
+
+int   read_fields(InputStream *in, const char **field, size_t *length, int *at_end);
+int   fill_chunk(InputStream *in, FileChunk *c, int *iline, int *usegeoid, char previous[NUMFIELDS][MAXREAD]);
+int   count_fields(const char *p, const char *end);
+void  process_chunk(FileWorker *w, FileChunk *c);
+void  wait_chunk(FilePipeline *p, FileChunk *c);
+#if WMM_THREADS
+void *file_worker(void *arg);
+#endif
+int   parse_record(char field[NUMFIELDS][MAXREAD], int iline, int first, float minyr, float maxyr, int *usegeoid,
+				   FileRecord *rec, TextBuffer *messages);
+double parse_decimal(const char *token, size_t length);
+int   allocate_worker(FileWorker *w, FilePipeline *p, WMMtype_Ellipsoid Ellip, WMMtype_MagneticModel *MagneticModel,
+					  WMMtype_Geoid *Geoid, float minyr, float maxyr, double resolution);
+void  free_worker(FileWorker *w);
+void  evaluate_records(FileWorker *w, size_t NumRecords);
+void  store_elements(WMMtype_GeoMagneticElementsBatch *Results, size_t i, WMMtype_GeoMagneticElements *GeoMagneticElements);
+void  format_records(TextBuffer *out, const char *echo, FileRecord *Records, size_t NumRecords, WMMtype_GeoMagneticElementsBatch *Results);
+int   format_result(char *out, double d, double i, double h, double x, double y, double z, double f,
+					 double ddot, double idot, double hdot, double xdot, double ydot, double zdot, double fdot);
+char *put_fixed(char *p, double value, int width, int decimals);
+void  text_reserve(TextBuffer *b, size_t n);
+void  text_append(TextBuffer *b, const char *s, size_t n);
+void  text_printf(TextBuffer *b, const char *format, ...);
+double wall_seconds(void);
+float degrees_to_decimal();
+float julday();
+int   safegets(char *buffer,int n);
+
 
 int main(int argv, char**argc)
 {
@@ -108,100 +234,53 @@ int main(int argv, char**argc)
 #endif
   /*  WMM Variable declaration  */
 
-	WMMtype_MagneticModel *MagneticModel, *TimedMagneticModel;
+	WMMtype_MagneticModel *MagneticModel;
 	WMMtype_Ellipsoid Ellip;
-	WMMtype_CoordSpherical CoordSpherical;
-	WMMtype_CoordGeodetic CoordGeodetic;
-	WMMtype_Date UserDate;
-	WMMtype_GeoMagneticElements GeoMagneticElements;
 	WMMtype_Geoid Geoid;
-	double b;
-	char a;
 	char ans[20];
 	char filename[] = "WMM.COF";
-	int NumTerms, Flag = 1;
+	int NumTerms;
 
 
   /* Control variables */
-  int   again = 1;
-  int   decyears = 3;
-  int   units = 4;
-  int   decdeg = 3;
-  int   range = -1;
-  int   counter = 0;
-  int   nmax;
-  int   igdgc=3;
-  int   isyear=-1;
-  int   ismonth=-1;
-  int   isday=-1;
-  int   ieyear=-1;
-  int   iemonth=-1;
-  int   ieday=-1;
-  int   ilat_deg=200;
-  int   ilat_min=200;
-  int   ilat_sec=200;
-  int   ilon_deg=200;
-  int   ilon_min=200;
-  int   ilon_sec=200;
-  int   fileline;
-  int   ddeg, ideg;
-
-
   int  coords_from_file = 0;
   int arg_err = 0;
+  int date_range = 0;
+  int at_end = 0;
+  int usegeoid;
+  int NumThreads = 1;
+  int NumStarted = 0;
+  double resolution = 0;
 
-
-  char  mdfile[PATH];
-  char  inbuff[MAXINBUFF];
-
-  char *begin;
-  char *rest;
   char args[7][MAXREAD];
-  int iarg;
+  char previous[NUMFIELDS][MAXREAD];
+  int iarg, nargs;
 
   char coord_fname[PATH];
   char out_fname[PATH];
-  FILE *coordfile,*outfile;
+  FILE *coordfile = NULL,*outfile = NULL;
   int iline=0;
-  int read_flag;
+  int lines_read=0;
+
+  InputStream Input;
+  FilePipeline Pipeline;
+  FileWorker *Workers = NULL;
+  FileChunk *c;
+  long next_write = 0;
+  double start_time = 0, elapsed;
+#if WMM_THREADS
+  pthread_t *Threads = NULL;
+#endif
 
   float minyr;
   float maxyr;
-  float minalt;
-  float maxalt;
-  float alt=-999999;
-  float sdate=-1;
-  float step=-1;
-  float syr;
-  float edate=-1;
-  float latitude=200;
-  float longitude=200;
-  float dmin, imin;
-
-
-
-  /*  Subroutines used  */
-  
-  void print_result_file(FILE *outf, double d, double i, double h, double x, double y, double z, double f,
-						 double ddot, double idot, double hdot, double xdot, double ydot, double zdot, double fdot);
-  float degrees_to_decimal();
-  float julday();
-  int   safegets(char *buffer,int n);
-  int getshc();
-
-
-  /* Initializations. */
-
-  inbuff[MAXREAD+1]='\0';  /* Just to protect mem. */
-  inbuff[MAXINBUFF-1]='\0';  /* Just to protect mem. */
 
 
  /* Memory allocation */
 	NumTerms = ( ( WMM_MAX_MODEL_DEGREES + 1 ) * ( WMM_MAX_MODEL_DEGREES + 2 ) / 2 );    /* WMM_MAX_MODEL_DEGREES is defined in WMM_Header.h */
 
 	MagneticModel 	   = 	WMM_AllocateModelMemory(NumTerms);  /* For storing the WMM Model parameters */
-	TimedMagneticModel  = 	WMM_AllocateModelMemory(NumTerms);  /* For storing the time modified WMM Model parameters */
-	if(MagneticModel == 	NULL || TimedMagneticModel == NULL)
+	if(MagneticModel == 	NULL)
 	{
 		WMM_Error(2);
 	}
@@ -211,12 +290,36 @@ int main(int argv, char**argc)
 	//WMM_readMagneticModel_Large(filename, MagneticModel); //Uncomment this line when using the 740 model, and comment out the  WMM_readMagneticModel line.
 
 	WMM_readMagneticModel(filename, MagneticModel);
-	WMM_InitializeGeoid(&Geoid);    /* Read the Geoid file */
+	WMM_InitializeGeoidMapped(&Geoid);    /* Read the Geoid file */
 
   maxyr = MagneticModel->epoch + 5.0;
   minyr = MagneticModel->epoch;
 
-  for (iarg=0; iarg<argv; iarg++)
+  /* -j N (or -jN) anywhere on the command line sets the number of threads, -q Y the date resolution */
+  for (iarg=1, nargs=1; iarg<argv; iarg++)
+	{
+	  if (strncmp(argc[iarg], "-j", 2) == 0)
+		{
+		  NumThreads = atoi(argc[iarg][2] ? argc[iarg]+2 : (iarg+1 < argv ? argc[++iarg] : "1"));
+		  continue;
+		}
+	  if (strncmp(argc[iarg], "-q", 2) == 0)
+		{
+		  resolution = atof(argc[iarg][2] ? argc[iarg]+2 : (iarg+1 < argv ? argc[++iarg] : "0"));
+		  if (!(resolution >= 0)) resolution = 0;
+		  continue;
+		}
+	  argc[nargs++] = argc[iarg];
+	}
+  argv = nargs;
+#if WMM_THREADS
+  if (NumThreads <= 0)
+	NumThreads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  if (NumThreads < 1) NumThreads = 1;
+  if (NumThreads > MAXTHREADS) NumThreads = MAXTHREADS;
+
+  for (iarg=0; iarg<argv && iarg<7; iarg++)
 	if (argc[iarg] != NULL)
 	  strncpy(args[iarg],argc[iarg],MAXREAD);
 
@@ -226,9 +329,11 @@ int main(int argv, char**argc)
   if (argv==1 || ((argv==2)&&(*(args[1])=='h')))
 	{
 	  printf("\n\nWorld Magnetic Model - File Processing Utility : USAGE:\n");
-	  printf("coordinate file: wmm_file f input_file output_file\n");
+	  printf("coordinate file: wmm_file f input_file output_file [-j threads] [-q years]\n");
 	  printf("or for help:     wmm_file h \n");
 	  printf("\n");
+	  printf("-j N processes the file on N threads, 0 for one per processor (default 1).\n");
+	  printf("-q Y rounds dates to multiples of Y years, e.g. 0.00274 for one day (default 0, exact).\n");
 	  printf("The input file may have any number of entries but they must follow\n");
 	  printf("the following format\n");
 	  printf("Date and location Formats: \n");
@@ -250,7 +355,7 @@ int main(int argv, char**argc)
 		fgets(ans, 20, stdin);
 	  exit(2);
 	} /* help */
-  
+
   if ((argv==4)&&(*(args[1])=='f'))
     {
 	  printf("\n\n 'f' switch: converting file with multiple locations.\n");
@@ -261,9 +366,14 @@ int main(int argv, char**argc)
       printf("     run in command line or interactive mode.\n\n");
 	  coords_from_file = 1;
 	  strncpy(coord_fname,args[2],MAXREAD);
-	  coordfile=fopen(coord_fname, "rt");
+	  coordfile=fopen(coord_fname, "rb");
       strncpy(out_fname,args[3],MAXREAD);
-      outfile=fopen(out_fname, "w");
+      outfile=fopen(out_fname, "wb");
+	  if (coordfile == NULL || outfile == NULL)
+		{
+		  printf("\n\nERROR: cannot open %s\n", coordfile == NULL ? coord_fname : out_fname);
+		  exit(2);
+		}
       fprintf(outfile,"Date Coord-System Altitude Latitude Longitude D_deg D_min I_deg I_min H_nT X_nT Y_nT Z_nT F_nT dD_min dI_min dH_nT dX_nT dY_nT dZ_nT dF_nT\n");
 	} /* file option */
 
@@ -279,368 +389,920 @@ int main(int argv, char**argc)
 	  exit(2);
 	}
 
+  /* Buffers of the pipeline: one worker per thread, and a reorder buffer of chunks */
+  Input.file = coordfile;
+  Input.capacity = READ_BLOCK;
+  Input.buffer = (char *) malloc(Input.capacity);
+  Input.size = Input.pos = 0;
+  Input.eof = 0;
+  memset(&Pipeline, 0, sizeof(Pipeline));
+  Pipeline.NumChunks = NumThreads > 1 ? CHUNKS_PER_THREAD*NumThreads : 1;
+  Pipeline.chunks = (FileChunk *) calloc(Pipeline.NumChunks, sizeof(FileChunk));
+  Workers = (FileWorker *) calloc(NumThreads, sizeof(FileWorker));
+  if (Input.buffer == NULL || Pipeline.chunks == NULL || Workers == NULL)
+	WMM_Error(2);
+
+  for (iarg=0; iarg<NumThreads; iarg++)
+	if (!allocate_worker(&Workers[iarg], &Pipeline, Ellip, MagneticModel, &Geoid, minyr, maxyr, resolution))
+	  WMM_Error(2);
+
+#if WMM_THREADS
+  if (NumThreads > 1)
+	{
+	  pthread_mutex_init(&Pipeline.Lock, NULL);
+	  pthread_cond_init(&Pipeline.ChunkReady, NULL);
+	  pthread_cond_init(&Pipeline.ChunkDone, NULL);
+	  Threads = (pthread_t *) malloc(NumThreads * sizeof(pthread_t));
+	  for (iarg=0; Threads && iarg<NumThreads; iarg++)
+		{
+		  if (pthread_create(&Threads[iarg], NULL, file_worker, &Workers[iarg]) != 0)
+			break;
+		  NumStarted++;
+		}
+	}
+#endif
+
+  /* A field missing at the end of the file repeats the previous line, as fscanf left it in args */
+  for (iarg=0; iarg<NUMFIELDS; iarg++)
+	strcpy(previous[iarg], iarg+1 < argv ? args[iarg+1] : "");
+  usegeoid = Geoid.UseGeoid;
 
+  start_time = wall_seconds();
 
-   while (again == 1)
+  for (;;)
 	{
-      if (coords_from_file) 
-		{
-		  argv = 6;
-		  read_flag = fscanf(coordfile,"%s%s%s%s%s%*[^\n]",args[1],args[2],args[3],args[4],args[5]);
-		  if (read_flag == EOF) goto reached_EOF;
-          fprintf(outfile,"%s %s %s %s %s ",args[1],args[2],args[3],args[4],args[5]);fflush(outfile);
-		  iline++;
-        } /* coords_from_file */
-      
-      /* Switch on how many arguments are supplied. */
-      /* Note that there are no 'breaks' after the cases, so these are entry points */
-      switch(argv)
+	  /* Write the oldest chunk once the reorder buffer is full or the file has been read */
+	  if (next_write < Pipeline.NextRead && (at_end || Pipeline.NextRead - next_write == Pipeline.NumChunks))
 		{
-		case 6 : strncpy(inbuff, args[5], MAXREAD);
-          if ((rest=strchr(inbuff, ',')))     /* If it contains a comma */
-            {
-			  decdeg=2;                        /* Then not decimal degrees */
-			  begin=inbuff;
-              rest[0]='\0';                    /* Chop into sub string */
-              rest++;                          /* Move to next substring */
-			  ilon_deg=atoi(begin);
-              begin=rest;
-              if ((rest=strchr(begin, ',')))
-                {
-				  rest[0]='\0';
-				  rest++;
-                  ilon_min=atoi(begin);
-                  ilon_sec=atoi(rest);
-                } 
-              else 
-                {
-                  ilon_min=0;
-                  ilon_sec=0;
-                }
-            } 
-          else 
-            {
-              decdeg=1;                        /* Else it's decimal */
-			  longitude=atof(args[5]);
+		  c = &Pipeline.chunks[next_write % Pipeline.NumChunks];
+		  wait_chunk(&Pipeline, c);
+		  if (c->messages.len) fwrite(c->messages.text, 1, c->messages.len, stdout);
+		  if (c->output.len) fwrite(c->output.text, 1, c->output.len, outfile);
+		  iline += c->processed;
+		  next_write++;
+		  if (c->status == RECORD_RANGE)
+			{
+			  date_range = 1;
+			  break;
 			}
-
-        case 5 : strncpy(inbuff, args[4], MAXREAD);
-          if ((rest=strchr(inbuff, ',')))
-            {
-              decdeg=2;
-			  begin=inbuff;
-              rest[0]='\0';
-              rest++;
-              ilat_deg=atoi(begin);
-              begin=rest;
-              if ((rest=strchr(begin, ',')))
-				{
-                  rest[0]='\0';
-                  rest++;
-                  ilat_min=atoi(begin);
-                  ilat_sec=atoi(rest);
-				}
-              else 
-				{
-                  ilat_min=0;
-                  ilat_sec=0;
-                }
-            }
-          else 
-            {
-              decdeg=1;
-			  latitude=atof(args[4]);
-            }
-          
-        case 4 : strncpy(inbuff, args[3], MAXREAD);
-          inbuff[0]=toupper(inbuff[0]);
-          if (inbuff[0]=='K') units=1;
-          else if (inbuff[0]=='M') units=2;
-          else if (inbuff[0]=='F') units=3;
-          if (strlen(inbuff)>1)
+		  if (c->status == RECORD_ARG_ERR)
 			{
-              inbuff[0]='\0';
-              begin=inbuff+1;
-              alt=atof(begin);
-            }
-
-        case 3 : strncpy(inbuff, args[2], MAXREAD);
-          inbuff[0]=toupper(inbuff[0]);
-		  if (inbuff[0]=='M') igdgc=1;    /* height is above  mean sea level*/
-		  else if (inbuff[0]=='E') igdgc=2; /* height is above  WGS 84 ellepsoid */
-
-          
-        case 2 : strncpy(inbuff, args[1], MAXREAD);
-          if ((rest=strchr(inbuff, '-')))   /* If it contains a dash */
-            {
-			  range = 2;                     /* They want a range */
-              rest[0]='\0';                  /* Sep dates */
-              rest++;
-              begin=rest;
-              if ((rest=strchr(begin, '-')))    /* If it contains 2 dashs */
-                {
-                  rest[0]='\0';                  /* Sep step */
-				  rest++;
-				  step=atof(rest);               /* Get step size */
-                }
-			  if ((rest=strchr(begin, ',')))    /* If it contains a comma */
-				{
-                  decyears=2;                    /* It's not decimal years */
-                  rest[0]='\0';
-                  rest++;
-                  ieyear=atoi(begin);
-                  begin=rest;
-                  if ((rest=strchr(begin, ',')))
-                    {
-                      rest[0]='\0';
-                      rest++;
-                      iemonth=atoi(begin);
-                      ieday=atoi(rest);
-                    } 
-                  else 
-                    {
-					  iemonth=0;
-                      ieday=0;
-                    }
-                  if ((rest=strchr(inbuff, ',')))
-                    {
-                      begin=inbuff;
-                      rest[0]='\0';
-                      rest++;
-                      isyear=atoi(begin);
-                      begin=rest;
-					  if ((rest=strchr(begin, ',')))
-                        {
-                          rest[0]='\0';
-						  rest++;
-                          ismonth=atoi(begin);
-                          isday=atoi(rest);
-                        } 
-                      else 
-                        {
-						  ismonth=0;
-                          isday=0;
-                        }
-                    } 
-                  else 
-					{
-                      sdate=atof(inbuff);
-                    }
-                } 
-              else 
-                {
-                  decyears=1;                    /* Else it's decimal years */
-                  sdate=atof(inbuff);
-                  edate=atof(begin);
-                }
-            } 
-          else 
-            {
-              range = 1;
-              if ((rest=strchr(inbuff, ',')))   /* If it contains a comma */
-                {
-                  decyears=2;                    /* It's not decimal years */
-                  begin=inbuff;
-                  rest[0]='\0';
-                  rest++;
-                  isyear=atoi(begin);
-                  begin=rest;
-                  if ((rest=strchr(begin, ',')))
-                    {
-                      rest[0]='\0';
-                      rest++;
-                      ismonth=atoi(begin);
-                      isday=atoi(rest);
-                    } 
-                  else 
-                    {
-                      ismonth=0;
-                      isday=0;
-					}
-                } 
-              else 
-				{
-                  decyears=1;                    /* Else it's decimal years */
-				  sdate=atof(args[1]);
-                }
-            }
-          if (sdate==0)
-            {                        /* If date not valid */
-              decyears=-1;
-              range=-1;
+			  arg_err = 1;
+			  at_end = c->at_end && c->processed == c->nlines;
+			  break;
 			}
-			break;
-
+		  continue;
 		}
-
-	  if (range == 2 && coords_from_file)
+	  if (at_end)
+		break;
+
+	  /* Fill the next chunk and hand it to a worker, or process it here */
+	  c = &Pipeline.chunks[Pipeline.NextRead % Pipeline.NumChunks];
+	  at_end = fill_chunk(&Input, c, &lines_read, &usegeoid, previous);
+	  if (c->nlines == 0)
+		continue;
+	  if (NumStarted == 0)
 		{
-		  printf("Error in line %1d, date = %s: date ranges not allowed for file option\n\n",iline,args[1]);
-		  exit(2);
+		  process_chunk(&Workers[0], c);
+		  c->done = 1;
+		  Pipeline.NextRead++;
 		}
+#if WMM_THREADS
+	  else
+		{
+		  pthread_mutex_lock(&Pipeline.Lock);
+		  Pipeline.NextRead++;
+		  pthread_cond_signal(&Pipeline.ChunkReady);
+		  pthread_mutex_unlock(&Pipeline.Lock);
+		}
+#endif
+	} /* for */
 
-	  /*  Obtain the desired model file and read the data  */
+#if WMM_THREADS
+  /* Stops the workers, skipping the chunks after an error */
+  if (NumStarted > 0)
+	{
+	  pthread_mutex_lock(&Pipeline.Lock);
+	  Pipeline.Finished = 1;
+	  Pipeline.Cancel = 1;
+	  pthread_cond_broadcast(&Pipeline.ChunkReady);
+	  pthread_mutex_unlock(&Pipeline.Lock);
+	  for (iarg=0; iarg<NumStarted; iarg++)
+		pthread_join(Threads[iarg], NULL);
+	}
+  if (NumThreads > 1)
+	{
+	  pthread_mutex_destroy(&Pipeline.Lock);
+	  pthread_cond_destroy(&Pipeline.ChunkReady);
+	  pthread_cond_destroy(&Pipeline.ChunkDone);
+	}
+  free(Threads);
+#endif
 
-	 /* if date specified in command line then warn if past end of validity */
+  if (date_range)
+	{
+	  fflush(stdout);
+	  exit(2);
+	}
+
+  elapsed = wall_seconds() - start_time;
 
-      /*  Take in field data  */
-      
-      /* Get date */
-      
-	  if (coords_from_file && !arg_err && (decyears != 1 && decyears != 2))
-        {printf("\nError: unrecognized date %s in coordinate file line %1d\n\n",args[1],iline); arg_err = 1;}
+  if (coords_from_file) printf("\n Processed %1d lines\n\n",iline);
+  if (coords_from_file && elapsed > 0) printf(" %.2f seconds, %.0f lines per second on %d thread%s\n\n", elapsed, iline/elapsed,
+											  NumStarted > 0 ? NumStarted : 1, NumStarted > 1 ? "s" : "");
+#if WMM_STATS
+  if (coords_from_file) WMM_PrintStats(stdout);	/* Where the time went, per stage of the library */
+#endif
+
+  if (coords_from_file && !at_end && arg_err) printf("Terminated prematurely due to argument error in coordinate file\n\n");
+
+
+fclose(coordfile);
+fclose(outfile);
 
-	  if (coords_from_file && !arg_err && range != 1)
-		{printf("\nError: unrecognized date %s in coordinate file line %1d\n\n",args[1],iline); arg_err = 1;}
+free(Input.buffer);
+for (iarg=0; iarg<Pipeline.NumChunks; iarg++)
+  {
+	free(Pipeline.chunks[iarg].input.text);
+	free(Pipeline.chunks[iarg].output.text);
+	free(Pipeline.chunks[iarg].messages.text);
+  }
+free(Pipeline.chunks);
+for (iarg=0; iarg<NumThreads; iarg++)
+  free_worker(&Workers[iarg]);
+free(Workers);
+WMM_FreeMagneticModelMemory(MagneticModel);
 
-	  if (coords_from_file && !arg_err && (sdate < minyr || sdate >maxyr))
-		{printf("\nWarning:  date out of range in coordinate file line %1d\n\n",iline);
-		printf("\nExpected range = %6.1lf - %6.1lf, entered %6.1lf\n",minyr,maxyr,sdate);}
+WMM_FreeGeoid(&Geoid);
+  return 0;
+}
 
 
-	   /* Get altitude min and max for selected model. */
-	  minalt= -10; /* To be defined */
-	  maxalt= 1000;
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine fill_chunk                              */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Copies the next CHUNK_RECORDS lines of the input into a chunk. A line   */
+/*     with five fields or more is taken whole; any other is delimited by   */
+/*     read_fields. Either way a chunk starts where the original fscanf     */
+/*     loop would start a line, and process_chunk finds the same lines.     */
+/*                                                                          */
+/*  Input:  in - Input stream                                               */
+/*          iline - Lines read before the chunk                             */
+/*          usegeoid - Height reference of the line before the chunk        */
+/*          previous - Fields of the line before the chunk                  */
+/*                                                                          */
+/*  Output: c - The lines and the state before them                         */
+/*          iline, usegeoid, previous - Updated for the next chunk          */
+/*          Returns 1 if the whole file has been read                       */
+/*                                                                          */
+/****************************************************************************/
 
-	  /* Get Coordinate prefs */
+int fill_chunk(InputStream *in, FileChunk *c, int *iline, int *usegeoid, char previous[NUMFIELDS][MAXREAD])
+{
+  InputStream last;
+  const char *p, *end, *nl, *token[NUMFIELDS];
+  size_t length[NUMFIELDS], n, last_start = 0;
+  int nfields, at_end = 0, dummy, iarg;
+
+  c->first_line = *iline + 1;
+  c->usegeoid = *usegeoid;
+  memcpy(c->previous, previous, sizeof(c->previous));
+  c->nlines = 0;
+  c->input.len = 0;
+  c->at_end = 0;
+  c->done = 0;
+
+  while (c->nlines < CHUNK_RECORDS && c->input.len < CHUNK_BYTES && !at_end)
+	{
+	  last_start = c->input.len;
 
-	  if (coords_from_file && !arg_err && (igdgc != 1 && igdgc != 2))
-		  {printf("\nError: Unrecognized height reference. %1d\n\n",args[1],iline); arg_err = 1;}
+	  /* A line of the buffer with all five fields is read whole, without splitting the fields */
+	  p = in->buffer + in->pos;
+	  end = in->buffer + in->size;
+	  nl = (const char *) memchr(p, '\n', end - p);
+	  if (nl != NULL && count_fields(p, nl) >= NUMFIELDS)
+		{
+		  text_append(&c->input, p, nl + 1 - p);
+		  in->pos = nl + 1 - in->buffer;
+		  c->nlines++;
+		  continue;
+		}
 
-	   /* If needed modify height referencing */
-	  if (igdgc==2)
+	  /* Otherwise read_fields finds where the line ends, reading more of the file if needed */
+	  nfields = read_fields(in, token, length, &at_end);
+	  if (nfields == 0)
 		{
-		  Geoid.UseGeoid = 0;     /* height above WGS-84 Ellipsoid */
-		}else if (igdgc==1)
+		  at_end = 1;
+		  break;
+		}
+	  c->at_end = at_end;
+	  text_append(&c->input, token[0], in->buffer + in->pos - token[0]);
+	  text_append(&c->input, "\n", 1);
+	  c->nlines++;
+	}
+  *iline += c->nlines;
+
+  /* The next chunk starts with the fields and the height reference of this last line */
+  if (!at_end && c->nlines > 0)
+	{
+	  last.file = NULL;
+	  last.buffer = c->input.text + last_start;
+	  last.size = last.capacity = c->input.len - last_start;
+	  last.pos = 0;
+	  last.eof = 1;
+	  nfields = read_fields(&last, token, length, &dummy);
+	  for (iarg=0; iarg<nfields; iarg++)
 		{
-		  Geoid.UseGeoid = 1;    /* height above MSL */
+		  n = length[iarg] < MAXREAD-1 ? length[iarg] : MAXREAD-1;
+		  memcpy(previous[iarg], token[iarg], n);
+		  previous[iarg][n] = '\0';
 		}
+	  /* Only a line with an argument error, which is the last one written, inherits the reference */
+	  if (toupper((unsigned char)previous[1][0]) == 'M') *usegeoid = 1;
+	  else if (toupper((unsigned char)previous[1][0]) == 'E') *usegeoid = 0;
+	}
+  return at_end;
+} /* fill_chunk */
+
+
+/* Number of fields separated by white space (the isspace characters of the C locale) in [p, end) */
+
+int count_fields(const char *p, const char *end)
+{
+  static const unsigned char space[256] = {['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1, [' '] = 1};
+  int count = 0, before = 1, is_space;
+
+  for (; p < end; p++)
+	{
+	  is_space = space[(unsigned char) *p];
+	  count += before & !is_space;
+	  before = is_space;
+	}
+  return count;
+} /* count_fields */
 
 
-	  /* Do unit conversions if neccessary */
-	  if (units==2)
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine process_chunk                           */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Parses, evaluates and formats the lines of a chunk, up to and including */
+/*     the first one that fails validation.                                 */
+/*                                                                          */
+/*  Input:  w - Worker doing the work                                       */
+/*          c - Chunk filled by fill_chunk                                  */
+/*                                                                          */
+/*  Output: c - output, messages, status and processed                      */
+/*                                                                          */
+/****************************************************************************/
+
+void process_chunk(FileWorker *w, FileChunk *c)
+{
+  InputStream in;
+  FileRecord *rec = NULL;
+  const char *token[NUMFIELDS];
+  size_t length[NUMFIELDS], n, NumRecords = 0;
+  char field[NUMFIELDS][MAXREAD];
+  int line, nfields, at_end, iarg, usegeoid = c->usegeoid, status = RECORD_OK;
+
+  in.file = NULL;
+  in.buffer = c->input.text;
+  in.size = in.capacity = c->input.len;
+  in.pos = 0;
+  in.eof = 1;
+  memcpy(field, c->previous, sizeof(field));
+  c->output.len = c->messages.len = 0;
+  w->echo.len = 0;
+
+  for (line=0; line<c->nlines && status == RECORD_OK; line++)
+	{
+	  nfields = read_fields(&in, token, length, &at_end);
+
+	  /* Echo the fields as the original "%s %s %s %s %s " */
+	  for (iarg=0; iarg<nfields; iarg++)
 		{
-		  minalt*=1000.0;
-		  maxalt*=1000.0;
+		  n = length[iarg] < MAXREAD-1 ? length[iarg] : MAXREAD-1;
+		  memcpy(field[iarg], token[iarg], n);
+		  field[iarg][n] = '\0';
 		}
-	  else if (units==3)
+	  rec = &w->Records[NumRecords];
+	  rec->echo = w->echo.len;
+	  for (iarg=0; iarg<NUMFIELDS; iarg++)
 		{
-		  minalt*=3280.0839895;
-		  maxalt*=3280.0839895;
+		  n = iarg < nfields ? length[iarg] : strlen(field[iarg]);
+		  text_reserve(&w->echo, n + 1);
+		  memcpy(w->echo.text + w->echo.len, iarg < nfields ? token[iarg] : field[iarg], n);
+		  w->echo.len += n;
+		  w->echo.text[w->echo.len++] = ' ';
 		}
+	  rec->echolen = w->echo.len - rec->echo;
+
+	  status = parse_record(field, c->first_line + line, c->first_line + line == 1, w->minyr, w->maxyr,
+							&usegeoid, rec, &c->messages);
+	  if (status != RECORD_RANGE)
+		NumRecords++;
+	}
+
+  evaluate_records(w, NumRecords);
+  format_records(&c->output, w->echo.text, w->Records, NumRecords, &w->Results);
+  if (status == RECORD_RANGE)
+	{
+	  /* The line is echoed as before, then the program stops */
+	  text_append(&c->output, w->echo.text + rec->echo, rec->echolen);
+	  text_printf(&c->messages, "Error in line %1d, date = %s: date ranges not allowed for file option\n\n",
+				  c->first_line + line - 1, field[0]);
+	}
+  c->status = status;
+  c->processed = line;
+} /* process_chunk */
+
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine file_worker                             */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Thread of -j N: processes the chunks in the order they were filled      */
+/*     until the reader has finished.                                       */
+/*                                                                          */
+/*  Input:  arg - The FileWorker of the thread                              */
+/*                                                                          */
+/****************************************************************************/
+
+#if WMM_THREADS
+void *file_worker(void *arg)
+{
+  FileWorker *w = (FileWorker *) arg;
+  FilePipeline *p = w->Pipeline;
+  FileChunk *c;
+  int cancel;
+
+  for (;;)
+	{
+	  pthread_mutex_lock(&p->Lock);
+	  while (p->NextProcess == p->NextRead && !p->Finished)
+		pthread_cond_wait(&p->ChunkReady, &p->Lock);
+	  if (p->NextProcess == p->NextRead)
+		{
+		  pthread_mutex_unlock(&p->Lock);
+		  break;
+		}
+	  c = &p->chunks[p->NextProcess++ % p->NumChunks];
+	  cancel = p->Cancel;
+	  pthread_mutex_unlock(&p->Lock);
+
+	  if (!cancel)
+		process_chunk(w, c);
+
+	  pthread_mutex_lock(&p->Lock);
+	  c->done = 1;
+	  pthread_cond_broadcast(&p->ChunkDone);
+	  pthread_mutex_unlock(&p->Lock);
+	}
+  return NULL;
+} /* file_worker */
+#endif
+
+
+void wait_chunk(FilePipeline *p, FileChunk *c)
+{
+#if WMM_THREADS
+  if (p->NumChunks > 1)
+	{
+	  pthread_mutex_lock(&p->Lock);
+	  while (!c->done)
+		pthread_cond_wait(&p->ChunkDone, &p->Lock);
+	  pthread_mutex_unlock(&p->Lock);
+	}
+#else
+  (void) p;
+  (void) c;
+#endif
+} /* wait_chunk */
+
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine read_fields                             */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Reads the next line as fscanf "%s%s%s%s%s%*[^\n]": five fields          */
+/*     separated by white space (which may span lines), then the rest of    */
+/*     the line up to, but not including, the '\n'.                         */
+/*                                                                          */
+/*  Input:  in - Input stream, refilled from its file as needed             */
+/*                                                                          */
+/*  Output: field, length - The fields, pointing into the stream buffer     */
+/*              and valid until the next call                               */
+/*          at_end - 1 if the end of the file was reached                   */
+/*          Returns the number of fields read, 0 at the end of the file     */
+/*                                                                          */
+/****************************************************************************/
 
-	  /* Get altitude */
+int read_fields(InputStream *in, const char **field, size_t *length, int *at_end)
+{
+  const char *p, *end;
+  size_t n, pos;
+  int nfields;
 
-	  if (coords_from_file && !arg_err && (alt < minalt || alt > maxalt))
-		{printf("\nError: unrecognized altitude %s in coordinate file line %1d\n\n",args[3],iline); arg_err = 1;}
+  for (;;)
+	{
+	  p = in->buffer + in->pos;
+	  end = in->buffer + in->size;
+	  for (nfields=0; nfields<NUMFIELDS; nfields++)
+		{
+		  while (p < end && isspace((unsigned char)*p)) p++;
+		  if (p == end) break;
+		  field[nfields] = p;
+		  while (p < end && !isspace((unsigned char)*p)) p++;
+		  length[nfields] = p - field[nfields];
+		  if (p == end) { nfields++; break; }
+		}
+	  if (nfields == NUMFIELDS)
+		while (p < end && *p != '\n') p++;
 
-	  /* Convert altitude to km */
-	  if (units==2)
+	  if (p < end || in->eof)
 		{
-		  alt *= 0.001;
+		  /* The line is complete, or the file ended in it */
+		  *at_end = (p == end && in->eof);
+		  in->pos = p - in->buffer;
+		  return nfields;
 		}
-	  else if (units==3)
+
+	  /* Keep the unparsed bytes, growing the buffer if one line fills it, and read the next block */
+	  pos = in->pos;
+	  memmove(in->buffer, in->buffer + pos, in->size - pos);
+	  in->size -= pos;
+	  in->pos = 0;
+	  if (in->size == in->capacity)
 		{
-		  alt /= 3280.0839895;
+		  char *grown = (char *) realloc(in->buffer, 2*in->capacity);
+		  if (grown == NULL) WMM_Error(2);
+		  in->buffer = grown;
+		  in->capacity *= 2;
 		}
+	  n = fread(in->buffer + in->size, 1, in->capacity - in->size, in->file);
+	  in->size += n;
+	  if (n == 0) in->eof = 1;
+	}
+} /* read_fields */
 
 
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine parse_record                            */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Decodes and validates the fields of one line, printing the same errors  */
+/*     and warnings as the original line by line loop.                      */
+/*                                                                          */
+/*  Input:  field - Date, height reference, altitude, latitude, longitude   */
+/*          iline - Line number for the messages                            */
+/*          first - 1 for the first line, whose missing values differ       */
+/*          minyr, maxyr - Valid dates of the model                         */
+/*          usegeoid - Height reference of the previous line                */
+/*                                                                          */
+/*  Output: rec - The decoded line                                          */
+/*          messages - The errors and warnings of the line                  */
+/*          usegeoid - Height reference of this line                        */
+/*          Returns RECORD_OK, RECORD_ARG_ERR or RECORD_RANGE               */
+/*                                                                          */
+/****************************************************************************/
 
-	  /* Get lat/long prefs */
+int parse_record(char field[NUMFIELDS][MAXREAD], int iline, int first, float minyr, float maxyr, int *usegeoid,
+				 FileRecord *rec, TextBuffer *messages)
+{
+  int   arg_err = 0;
+  int   igdgc = first ? 3 : -1;
+  int   units = first ? 4 : -1;
+  int   decyears;
+  float minalt = -10; /* To be defined */
+  float maxalt = 1000;
+  float alt = first ? -999999 : -9999999;
+  float sdate = -1;
+  float latitude = 200;
+  float longitude = 200;
+  size_t n;
+
+  /* Date */
+  if (strchr(field[0], '-'))
+	return RECORD_RANGE;
+  if (strchr(field[0], ','))
+	decyears = 2;                    /* It's not decimal years, only the year is kept */
+  else
+	{
+	  decyears = 1;                  /* Else it's decimal years */
+	  sdate = parse_decimal(field[0], strlen(field[0]));
+	}
+  if (sdate == 0)
+	decyears = -1;                   /* If date not valid */
+
+  /* Height reference */
+  if (toupper((unsigned char)field[1][0]) == 'M') igdgc = 1;      /* height is above  mean sea level*/
+  else if (toupper((unsigned char)field[1][0]) == 'E') igdgc = 2; /* height is above  WGS 84 ellepsoid */
+
+  /* Altitude */
+  if (toupper((unsigned char)field[2][0]) == 'K') units = 1;
+  else if (toupper((unsigned char)field[2][0]) == 'M') units = 2;
+  else if (toupper((unsigned char)field[2][0]) == 'F') units = 3;
+  n = strlen(field[2]);
+  if (n > 1)
+	alt = parse_decimal(field[2]+1, n-1);
+
+  /* Lat/lon; only the latitude decides whether they are decimal */
+  if (!strchr(field[4], ','))
+	longitude = parse_decimal(field[4], strlen(field[4]));
+  if (!strchr(field[3], ','))
+	latitude = parse_decimal(field[3], strlen(field[3]));
+
+  if (!arg_err && (decyears != 1 && decyears != 2))
+	{text_printf(messages,"\nError: unrecognized date %s in coordinate file line %1d\n\n",field[0],iline); arg_err = 1;}
+
+  if (!arg_err && (sdate < minyr || sdate >maxyr))
+	{text_printf(messages,"\nWarning:  date out of range in coordinate file line %1d\n\n",iline);
+	text_printf(messages,"\nExpected range = %6.1lf - %6.1lf, entered %6.1lf\n",minyr,maxyr,sdate);}
+
+  if (!arg_err && (igdgc != 1 && igdgc != 2))
+	{text_printf(messages,"\nError: Unrecognized height reference %s in coordinate file line %1d\n\n",field[1],iline); arg_err = 1;}
+
+  /* If needed modify height referencing */
+  if (igdgc==2)
+	*usegeoid = 0;     /* height above WGS-84 Ellipsoid */
+  else if (igdgc==1)
+	*usegeoid = 1;     /* height above MSL */
+
+  /* Do unit conversions if neccessary */
+  if (units==2)
+	{
+	  minalt*=1000.0;
+	  maxalt*=1000.0;
+	}
+  else if (units==3)
+	{
+	  minalt*=3280.0839895;
+	  maxalt*=3280.0839895;
+	}
 
-	  if (coords_from_file && !arg_err && decdeg != 1 )
-		{printf("\nError: unrecognized lat %s or lon %s in coordinate file line %1d\n\n",args[4],args[5],iline); arg_err = 1;}
+  if (!arg_err && (alt < minalt || alt > maxalt))
+	{text_printf(messages,"\nError: unrecognized altitude %s in coordinate file line %1d\n\n",field[2],iline); arg_err = 1;}
 
+  /* Convert altitude to km */
+  if (units==2)
+	alt *= 0.001;
+  else if (units==3)
+	alt /= 3280.0839895;
 
+  if (!arg_err && strchr(field[3], ','))
+	{text_printf(messages,"\nError: unrecognized lat %s or lon %s in coordinate file line %1d\n\n",field[3],field[4],iline); arg_err = 1;}
 
-	  /* Get lat/lon */
+  rec->latitude = latitude;
+  rec->longitude = longitude;
+  rec->alt = alt;
+  rec->sdate = sdate;
+  rec->usegeoid = *usegeoid;
+  rec->single = arg_err || !(latitude >= -90 && latitude <= 90 && longitude >= -180 && longitude <= 360 && isfinite(alt));
+  return arg_err ? RECORD_ARG_ERR : RECORD_OK;
+} /* parse_record */
 
 
-	  /** This will compute everything needed for 1 point in time. **/
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine parse_decimal                           */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Converts a decimal number to double, returning what atof returns.       */
+/*     Plain decimals of up to 19 significant digits, which is what the     */
+/*     coordinate files hold, are converted exactly: an integer mantissa    */
+/*     below 2^53 divided by an exactly representable power of ten is       */
+/*     correctly rounded. Anything else is passed to strtod.                */
+/*                                                                          */
+/*  Input:  token, length - The characters, not necessarily terminated      */
+/*                                                                          */
+/*  Output: The value                                                       */
+/*                                                                          */
+/****************************************************************************/
 
-			CoordGeodetic.lambda = longitude;
-			CoordGeodetic.phi	 = latitude;
-			CoordGeodetic.HeightAboveGeoid = alt;
-			UserDate.DecimalYear = sdate;
+double parse_decimal(const char *token, size_t length)
+{
+  static const double power10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+								   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+  const char *p = token, *end = token + length;
+  unsigned long long mantissa = 0;
+  int digits = 0, exponent = 0, negative = 0, any = 0;
+  char copy[MAXREAD];
+  double value;
+
+  if (p < end && (*p == '+' || *p == '-'))
+	negative = (*p++ == '-');
+  for (; p < end && *p == '0'; p++)
+	any = 1;
+  for (; p < end && *p >= '0' && *p <= '9' && digits < 19; p++, digits++, any = 1)
+	mantissa = 10*mantissa + (*p - '0');
+  if (p < end && *p == '.')
+	{
+	  p++;
+	  if (digits == 0)
+		for (; p < end && *p == '0'; p++, exponent--)
+		  any = 1;
+	  for (; p < end && *p >= '0' && *p <= '9' && digits < 19; p++, digits++, exponent--, any = 1)
+		mantissa = 10*mantissa + (*p - '0');
+	}
 
+  if (p == end && any && mantissa <= (1ULL << 53) && exponent >= -22)
+	{
+	  value = (double) mantissa / power10[-exponent];
+	  return negative ? -value : value;
+	}
 
-			WMM_ConvertGeoidToEllipsoidHeight(&CoordGeodetic, &Geoid);   /*This converts the height above mean sea level to height above the WGS-84 ellipsoid*/
-			WMM_GeodeticToSpherical(Ellip, CoordGeodetic, &CoordSpherical);    /*Convert from geodeitic to Spherical Equations: 17-18, WMM Technical report*/
-			WMM_TimelyModifyMagneticModel(UserDate, MagneticModel, TimedMagneticModel); /* Time adjust the coefficients, Equation 19, WMM Technical report */
-			WMM_Geomag(Ellip, CoordSpherical, CoordGeodetic, TimedMagneticModel, &GeoMagneticElements);   /* Computes the geoMagnetic field elements and their time change*/
-			WMM_CalculateGridVariation(CoordGeodetic,&GeoMagneticElements);
+  /* Exponents, more digits, inf, nan, hexadecimal or trailing characters */
+  if (length >= MAXREAD) length = MAXREAD-1;
+  memcpy(copy, token, length);
+  copy[length] = '\0';
+  return strtod(copy, NULL);
+} /* parse_decimal */
 
 
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine evaluate_records                        */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Computes the magnetic elements of the first NumRecords lines of         */
+/*     w->Records. The lines are sorted by date and height reference, and   */
+/*     each run of equal ones is one call of WMM_ContextGeomagBatch. The    */
+/*     workspace caches the time modified models (WMM_SetWorkspaceDate),    */
+/*     so a date seen in an earlier chunk is not modified again. Single     */
+/*     lines are computed one by one as the original loop did, messages    */
+/*     included.                                                            */
+/*                                                                          */
+/*  Input:  w - Worker, with its context, geoid and lines                   */
+/*          NumRecords - Number of lines                                    */
+/*                                                                          */
+/*  Output: w->Results - The elements, line i at w->Records[i].result       */
+/*                                                                          */
+/****************************************************************************/
 
+static int compare_keys(const void *a, const void *b)
+{
+  const RecordKey *ka = (const RecordKey *) a, *kb = (const RecordKey *) b;
 
-	  /** Above will compute everything for 1 point in time.  **/
+  if (ka->sdate != kb->sdate) return ka->sdate < kb->sdate ? -1 : 1;
+  if (ka->usegeoid != kb->usegeoid) return ka->usegeoid - kb->usegeoid;
+  return ka->index < kb->index ? -1 : 1;
+}
 
+void evaluate_records(FileWorker *w, size_t NumRecords)
+{
+  WMMtype_GeoMagneticElementsBatch Run;
+  WMMtype_CoordSpherical CoordSpherical;
+  WMMtype_CoordGeodetic CoordGeodetic;
+  WMMtype_GeoMagneticElements GeoMagneticElements;
+  FileRecord *rec;
+  RecordKey *keys = w->keys;
+  size_t i, start, end, NumBatch = 0;
+  int sorted = 1;
+
+  for (i=0, rec=w->Records; i<NumRecords; i++, rec++)
+	if (!rec->single)
+	  {
+		keys[NumBatch].sdate = rec->sdate;
+		keys[NumBatch].usegeoid = rec->usegeoid;
+		keys[NumBatch].index = i;
+		if (NumBatch > 0 && (rec->sdate != keys[0].sdate || rec->usegeoid != keys[0].usegeoid))
+		  sorted = 0;
+		NumBatch++;
+	  }
+  if (!sorted)
+	qsort(keys, NumBatch, sizeof(RecordKey), compare_keys);
+  for (i=0; i<NumBatch; i++)
+	{
+	  rec = &w->Records[keys[i].index];
+	  rec->result = i;
+	  w->latitude[i] = rec->latitude;
+	  w->longitude[i] = rec->longitude;
+	  w->height[i] = rec->alt;
+	}
 
-	  /*  Output the final results. */
+  w->Geoid.UseGeoid = 1;
+  for (start=0; start<NumBatch; start=end)
+	{
+	  for (end=start+1; end<NumBatch; end++)
+		if (keys[end].sdate != keys[start].sdate || keys[end].usegeoid != keys[start].usegeoid)
+		  break;
+
+	  Run.X = w->Results.X + start;
+	  Run.Y = w->Results.Y + start;
+	  Run.Z = w->Results.Z + start;
+	  Run.F = w->Results.F + start;
+	  Run.H = w->Results.H + start;
+	  Run.Decl = w->Results.Decl + start;
+	  Run.Incl = w->Results.Incl + start;
+	  Run.Xdot = w->Results.Xdot + start;
+	  Run.Ydot = w->Results.Ydot + start;
+	  Run.Zdot = w->Results.Zdot + start;
+	  Run.Fdot = w->Results.Fdot + start;
+	  Run.Hdot = w->Results.Hdot + start;
+	  Run.Decldot = w->Results.Decldot + start;
+	  Run.Incldot = w->Results.Incldot + start;
+
+	  w->Context->Geoid = keys[start].usegeoid ? &w->Geoid : NULL;
+	  WMM_ContextGeomagBatch(w->Context, w->latitude+start, w->longitude+start, w->height+start,
+							 keys[start].sdate, end-start, &Run);
+	}
 
+  for (i=0, rec=w->Records; i<NumRecords; i++, rec++)
+	if (rec->single)
+	  {
+		CoordGeodetic.lambda = rec->longitude;
+		CoordGeodetic.phi	 = rec->latitude;
+		CoordGeodetic.HeightAboveGeoid = rec->alt;
+		w->Geoid.UseGeoid = rec->usegeoid;
+
+		WMM_ConvertGeoidToEllipsoidHeight(&CoordGeodetic, &w->Geoid);   /*This converts the height above mean sea level to height above the WGS-84 ellipsoid*/
+		WMM_GeodeticToSpherical(w->Context->Ellip, CoordGeodetic, &CoordSpherical);    /*Convert from geodeitic to Spherical Equations: 17-18, WMM Technical report*/
+		WMM_SetWorkspaceDate(w->Context->Workspace, w->Context->MagneticModel, rec->sdate); /* Time adjust the coefficients, Equation 19, WMM Technical report */
+		WMM_Geomag(w->Context->Ellip, CoordSpherical, CoordGeodetic, w->Context->Workspace->TimedMagneticModel, &GeoMagneticElements);   /* Computes the geoMagnetic field elements and their time change*/
+
+		rec->result = NumBatch++;
+		store_elements(&w->Results, rec->result, &GeoMagneticElements);
+	  }
+  WMM_ContextClearError(w->Context);
+} /* evaluate_records */
 
-    if (coords_from_file)
-		{
-	print_result_file(outfile,
-			GeoMagneticElements.Decl,
-			GeoMagneticElements.Incl,
-			GeoMagneticElements.H,
-			GeoMagneticElements.X,
-			GeoMagneticElements.Y,
-			GeoMagneticElements.Z,
-			GeoMagneticElements.F,
-			60 * GeoMagneticElements.Decldot,
-			60 * GeoMagneticElements.Incldot,
-			GeoMagneticElements.Hdot,
-			GeoMagneticElements.Xdot,
-			GeoMagneticElements.Ydot,
-			GeoMagneticElements.Zdot,
-			GeoMagneticElements.Fdot);
-		}
 
-	  if (coords_from_file)
-		again = !feof(coordfile) && !arg_err;
+void store_elements(WMMtype_GeoMagneticElementsBatch *Results, size_t i, WMMtype_GeoMagneticElements *GeoMagneticElements)
+{
+  Results->X[i] = GeoMagneticElements->X;
+  Results->Y[i] = GeoMagneticElements->Y;
+  Results->Z[i] = GeoMagneticElements->Z;
+  Results->F[i] = GeoMagneticElements->F;
+  Results->H[i] = GeoMagneticElements->H;
+  Results->Decl[i] = GeoMagneticElements->Decl;
+  Results->Incl[i] = GeoMagneticElements->Incl;
+  Results->Xdot[i] = GeoMagneticElements->Xdot;
+  Results->Ydot[i] = GeoMagneticElements->Ydot;
+  Results->Zdot[i] = GeoMagneticElements->Zdot;
+  Results->Fdot[i] = GeoMagneticElements->Fdot;
+  Results->Hdot[i] = GeoMagneticElements->Hdot;
+  Results->Decldot[i] = GeoMagneticElements->Decldot;
+  Results->Incldot[i] = GeoMagneticElements->Incldot;
+} /* store_elements */
 
-	  if (again == 1)
-		{
-		  /* Reset defaults to catch on all while loops */
-		  igdgc=decyears=units=decdeg=-1;
-		  ismonth=isday=isyear=sdate=edate=range=step=-1;
-		  latitude=ilat_deg=ilat_min=ilat_sec=200;
-		  longitude=ilon_deg=ilon_min=ilon_sec=200;
-		  alt=-9999999;
-		  argv = 1;
-		}
-	} /* while (again == 1) */
 
- reached_EOF:
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine allocate_worker                         */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Allocates the context and the buffers of one worker. The magnetic       */
+/*     model and the geoid data are shared, only read, by all workers.      */
+/*                                                                          */
+/*  Input:  p - Pipeline of the worker                                      */
+/*          Ellip, MagneticModel, Geoid - As read by the program            */
+/*          minyr, maxyr - Valid dates of the model                         */
+/*          resolution - Dates are rounded to multiples of it, 0 for none   */
+/*                                                                          */
+/*  Output: w - The worker                                                  */
+/*          Returns 1 on success, 0 if memory ran out                       */
+/*                                                                          */
+/****************************************************************************/
 
-  if (coords_from_file) printf("\n Processed %1d lines\n\n",iline);
+int allocate_worker(FileWorker *w, FilePipeline *p, WMMtype_Ellipsoid Ellip, WMMtype_MagneticModel *MagneticModel,
+					WMMtype_Geoid *Geoid, float minyr, float maxyr, double resolution)
+{
+  double **arrays[] = {&w->latitude, &w->longitude, &w->height,
+					   &w->Results.X, &w->Results.Y, &w->Results.Z, &w->Results.F, &w->Results.H,
+					   &w->Results.Decl, &w->Results.Incl, &w->Results.Xdot, &w->Results.Ydot,
+					   &w->Results.Zdot, &w->Results.Fdot, &w->Results.Hdot,
+					   &w->Results.Decldot, &w->Results.Incldot};
+  size_t i;
+  int ok;
+
+  memset(w, 0, sizeof(FileWorker));
+  w->Pipeline = p;
+  w->Geoid = *Geoid;
+  w->minyr = minyr;
+  w->maxyr = maxyr;
+  w->Context = WMM_CreateContext(Ellip, MagneticModel, &w->Geoid);
+  w->Records = (FileRecord *) malloc(CHUNK_RECORDS * sizeof(FileRecord));
+  w->keys = (RecordKey *) malloc(CHUNK_RECORDS * sizeof(RecordKey));
+  ok = w->Context != NULL && w->Records != NULL && w->keys != NULL;
+  if (w->Context)
+	WMM_SetDateResolution(w->Context->Workspace, resolution);
+  for (i=0; i<sizeof(arrays)/sizeof(arrays[0]); i++)
+	{
+	  *arrays[i] = (double *) malloc(CHUNK_RECORDS * sizeof(double));
+	  ok = ok && *arrays[i] != NULL;
+	}
+  return ok;
+} /* allocate_worker */
 
-  if (coords_from_file && !feof(coordfile) && arg_err) printf("Terminated prematurely due to argument error in coordinate file\n\n");
 
+void free_worker(FileWorker *w)
+{
+  WMM_FreeContext(w->Context);
+  free(w->Records);
+  free(w->keys);
+  free(w->latitude);
+  free(w->longitude);
+  free(w->height);
+  free(w->Results.X);
+  free(w->Results.Y);
+  free(w->Results.Z);
+  free(w->Results.F);
+  free(w->Results.H);
+  free(w->Results.Decl);
+  free(w->Results.Incl);
+  free(w->Results.Xdot);
+  free(w->Results.Ydot);
+  free(w->Results.Zdot);
+  free(w->Results.Fdot);
+  free(w->Results.Hdot);
+  free(w->Results.Decldot);
+  free(w->Results.Incldot);
+  free(w->echo.text);
+} /* free_worker */
 
-fclose(coordfile);
-fclose(outfile);
 
-WMM_FreeMagneticModelMemory(MagneticModel);
-WMM_FreeMagneticModelMemory(TimedMagneticModel);     
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine format_records                          */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Appends the echo and results of NumRecords lines to an output buffer.   */
+/*                                                                          */
+/*  Input:  echo - Echo buffer of the lines                                 */
+/*          Records, NumRecords, Results - The lines and their elements     */
+/*                                                                          */
+/*  Output: out - The formatted lines                                       */
+/*                                                                          */
+/****************************************************************************/
+
+void format_records(TextBuffer *out, const char *echo, FileRecord *Records, size_t NumRecords, WMMtype_GeoMagneticElementsBatch *Results)
+{
+  size_t r, i;
 
-if (Geoid.GeoidHeightBuffer)
+  for (r=0; r<NumRecords; r++)
 	{
-	free(Geoid.GeoidHeightBuffer);
-	Geoid.GeoidHeightBuffer = NULL;
+	  text_reserve(out, Records[r].echolen + MAXRESULT);
+	  memcpy(out->text + out->len, echo + Records[r].echo, Records[r].echolen);
+	  out->len += Records[r].echolen;
+	  i = Records[r].result;
+	  out->len += format_result(out->text + out->len,
+			Results->Decl[i],
+			Results->Incl[i],
+			Results->H[i],
+			Results->X[i],
+			Results->Y[i],
+			Results->Z[i],
+			Results->F[i],
+			60 * Results->Decldot[i],
+			60 * Results->Incldot[i],
+			Results->Hdot[i],
+			Results->Xdot[i],
+			Results->Ydot[i],
+			Results->Zdot[i],
+			Results->Fdot[i]);
 	}
-  return 0;
-}
+} /* format_records */
 
 
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine format_result                           */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Formats the results of one line as the original print_result_file.      */
+/*     Lines without NaN elements, all of them in practice, are formatted   */
+/*     by hand with put_fixed instead of snprintf.                          */
+/*                                                                          */
+/*  Input:  d ... fdot - The elements, ddot and idot in minutes             */
+/*                                                                          */
+/*  Output: out - At least MAXRESULT characters, not terminated             */
+/*          Returns the number of characters written                        */
+/*                                                                          */
+/****************************************************************************/
 
-void print_result_file(FILE *outf, double d, double i, double h, double x, double y, double z, double f,
-					   double ddot, double idot, double hdot, double xdot, double ydot, double zdot, double fdot)
+int format_result(char *out, double d, double i, double h, double x, double y, double z, double f,
+				  double ddot, double idot, double hdot, double xdot, double ydot, double zdot, double fdot)
 {
   int   ddeg,ideg;
   float dmin,imin;
+  int   n;
+  char  *p = out;
 
   /* Change d and i to deg and min */
 
@@ -651,27 +1313,189 @@ void print_result_file(FILE *outf, double d, double i, double h, double x, doubl
   imin=(i-(float)ideg)*60;
   if (ideg!=0) imin=fabs(imin);
 
+  if (!isnan(d) && !isnan(ddot))
+	{
+	  /* " %4dd %2.0fm  %4dd %2.0fm  %8.1f %8.1f %8.1f %8.1f %8.1f" */
+	  *p++ = ' ';
+	  p = put_fixed(p, ddeg, 4, 0);
+	  *p++ = 'd'; *p++ = ' ';
+	  p = put_fixed(p, dmin, 2, 0);
+	  *p++ = 'm'; *p++ = ' '; *p++ = ' ';
+	  p = put_fixed(p, ideg, 4, 0);
+	  *p++ = 'd'; *p++ = ' ';
+	  p = put_fixed(p, imin, 2, 0);
+	  *p++ = 'm'; *p++ = ' ';
+	  *p++ = ' '; p = put_fixed(p, h, 8, 1);
+	  *p++ = ' '; p = put_fixed(p, x, 8, 1);
+	  *p++ = ' '; p = put_fixed(p, y, 8, 1);
+	  *p++ = ' '; p = put_fixed(p, z, 8, 1);
+	  *p++ = ' '; p = put_fixed(p, f, 8, 1);
+
+	  /* " %7.1f   %7.1f     %8.1f %8.1f %8.1f %8.1f %8.1f\n" */
+	  *p++ = ' '; p = put_fixed(p, ddot, 7, 1);
+	  *p++ = ' '; *p++ = ' '; *p++ = ' '; p = put_fixed(p, idot, 7, 1);
+	  *p++ = ' '; *p++ = ' '; *p++ = ' '; *p++ = ' ';
+	  *p++ = ' '; p = put_fixed(p, hdot, 8, 1);
+	  *p++ = ' '; p = put_fixed(p, xdot, 8, 1);
+	  *p++ = ' '; p = put_fixed(p, ydot, 8, 1);
+	  *p++ = ' '; p = put_fixed(p, zdot, 8, 1);
+	  *p++ = ' '; p = put_fixed(p, fdot, 8, 1);
+	  *p++ = '\n';
+	  return p - out;
+	}
+
   if (isnan(d))
 	{
 	  if (isnan(x))
-		fprintf(outf," NaN        %4dd %2.0fm  %8.1f      NaN      NaN %8.1f %8.1f",ideg,imin,h,z,f);
+		n = sprintf(out," NaN        %4dd %2.0fm  %8.1f      NaN      NaN %8.1f %8.1f",ideg,imin,h,z,f);
 	  else
-		fprintf(outf," NaN        %4dd %2.0fm  %8.1f %8.1f %8.1f %8.1f %8.1f",ideg,imin,h,x,y,z,f);
+		n = sprintf(out," NaN        %4dd %2.0fm  %8.1f %8.1f %8.1f %8.1f %8.1f",ideg,imin,h,x,y,z,f);
 	}
   else
-	fprintf(outf," %4dd %2.0fm  %4dd %2.0fm  %8.1f %8.1f %8.1f %8.1f %8.1f",ddeg,dmin,ideg,imin,h,x,y,z,f);
+	n = sprintf(out," %4dd %2.0fm  %4dd %2.0fm  %8.1f %8.1f %8.1f %8.1f %8.1f",ddeg,dmin,ideg,imin,h,x,y,z,f);
 
   if (isnan(ddot))
 	{
 	  if (isnan(xdot))
-		fprintf(outf,"      NaN  %7.1f     %8.1f      NaN      NaN %8.1f %8.1f\n",idot,hdot,zdot,fdot);
+		n += sprintf(out+n,"      NaN  %7.1f     %8.1f      NaN      NaN %8.1f %8.1f\n",idot,hdot,zdot,fdot);
 	  else
-		fprintf(outf,"      NaN  %7.1f     %8.1f %8.1f %8.1f %8.1f %8.1f\n",idot,hdot,xdot,ydot,zdot,fdot);
+		n += sprintf(out+n,"      NaN  %7.1f     %8.1f %8.1f %8.1f %8.1f %8.1f\n",idot,hdot,xdot,ydot,zdot,fdot);
 	}
   else
-	fprintf(outf," %7.1f   %7.1f     %8.1f %8.1f %8.1f %8.1f %8.1f\n",ddot,idot,hdot,xdot,ydot,zdot,fdot);
-  return;
-} /* print_result_file */
+	n += sprintf(out+n," %7.1f   %7.1f     %8.1f %8.1f %8.1f %8.1f %8.1f\n",ddot,idot,hdot,xdot,ydot,zdot,fdot);
+  return n;
+} /* format_result */
+
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine put_fixed                               */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Writes value as printf "%*.0f" or "%*.1f", with the same rounding: the  */
+/*     exact binary value is rounded half to even. For one decimal the      */
+/*     product by ten is carried exactly as the sum s + e of 8*value and    */
+/*     2*value, so a value just below or above a tie rounds as in printf.   */
+/*     Values that are not finite or above 1e15 go to sprintf.              */
+/*                                                                          */
+/*  Input:  value, width - As the printf arguments                          */
+/*          decimals - 0 or 1                                               */
+/*                                                                          */
+/*  Output: p - The characters, not terminated                              */
+/*          Returns the end of the characters                               */
+/*                                                                          */
+/****************************************************************************/
+
+char *put_fixed(char *p, double value, int width, int decimals)
+{
+  char digits[24];
+  double a, a8, a2, s, bb, e, frac;
+  long long n;
+  int len = 0, neg;
+
+  if (!(fabs(value) < 1e15))
+	return p + sprintf(p, decimals ? "%*.1f" : "%*.0f", width, value);
+  neg = signbit(value);
+  a = fabs(value);
+  if (decimals)
+	{
+	  a8 = 8*a;                  /* exact */
+	  a2 = 2*a;                  /* exact */
+	  s = a8 + a2;
+	  bb = s - a8;
+	  e = (a8 - (s - bb)) + (a2 - bb);   /* 10*a == s + e exactly */
+	}
+  else
+	{
+	  s = a;
+	  e = 0;
+	}
+  n = (long long) s;
+  frac = s - n;
+  if (frac > 0.5 || (frac == 0.5 && (e > 0 || (e == 0 && (n & 1)))))
+	n++;
+
+  if (decimals)
+	{
+	  digits[len++] = '0' + n % 10;
+	  digits[len++] = '.';
+	  n /= 10;
+	}
+  do
+	{
+	  digits[len++] = '0' + n % 10;
+	  n /= 10;
+	} while (n);
+  if (neg) digits[len++] = '-';
+  while (width-- > len) *p++ = ' ';
+  while (len) *p++ = digits[--len];
+  return p;
+} /* put_fixed */
+
+
+double wall_seconds(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + 1e-9*now.tv_nsec;
+} /* wall_seconds */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutines text_*                                 */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Growable character buffers. text_reserve makes room for n more          */
+/*     characters, text_append and text_printf add characters without a     */
+/*     terminating '\0'. Running out of memory stops the program.           */
+/*                                                                          */
+/****************************************************************************/
+
+void text_reserve(TextBuffer *b, size_t n)
+{
+  char *grown;
+
+  if (b->len + n <= b->cap)
+	return;
+  b->cap = 2*(b->len + n) + 4096;
+  grown = (char *) realloc(b->text, b->cap);
+  if (grown == NULL)
+	WMM_Error(2);
+  b->text = grown;
+} /* text_reserve */
+
+
+void text_append(TextBuffer *b, const char *s, size_t n)
+{
+  text_reserve(b, n);
+  memcpy(b->text + b->len, s, n);
+  b->len += n;
+} /* text_append */
+
+
+void text_printf(TextBuffer *b, const char *format, ...)
+{
+  va_list ap;
+  int n;
+
+  text_reserve(b, 256);
+  va_start(ap, format);
+  n = vsnprintf(b->text + b->len, b->cap - b->len, format, ap);
+  va_end(ap);
+  if (n >= 0 && (size_t) n >= b->cap - b->len)
+	{
+	  text_reserve(b, n + 1);
+	  va_start(ap, format);
+	  n = vsnprintf(b->text + b->len, b->cap - b->len, format, ap);
+	  va_end(ap);
+	}
+  if (n > 0)
+	b->len += n;
+} /* text_printf */
+
 
 
 /****************************************************************************/
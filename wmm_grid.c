@@ -50,7 +50,7 @@ int main()
 
 	WMM_SetDefaults(&Ellip, MagneticModel, &Geoid);
 	WMM_readMagneticModel(filename, MagneticModel);
-   	WMM_InitializeGeoid(&Geoid);
+   	WMM_InitializeGeoidMapped(&Geoid);
 	WMM_GeomagIntroduction(MagneticModel);  /* Print out the WMM introduction */
 	printf("\n\n This program may be used to generate a grid / volume of magnetic field values over\nlatitude, longitude, altitude and time axes. To skip an axis, keep the start and end values the same\nand enter zero for the step size.\n");
   //	This program
@@ -149,11 +149,7 @@ int main()
 
 WMM_FreeMagneticModelMemory(MagneticModel);
 
-if (Geoid.GeoidHeightBuffer)
-	{
-	free(Geoid.GeoidHeightBuffer);
-	Geoid.GeoidHeightBuffer = NULL;
-	}
+WMM_FreeGeoid(&Geoid);
 
 
 
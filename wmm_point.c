@@ -59,7 +59,7 @@ int main()
 	//WMM_readMagneticModel_Large(filename, MagneticModel); //Uncomment this line when using the 740 model, and comment out the  WMM_readMagneticModel line.
 
 	WMM_readMagneticModel(filename, MagneticModel);
-	WMM_InitializeGeoid(&Geoid);    /* Read the Geoid file */
+	WMM_InitializeGeoidMapped(&Geoid);    /* Read the Geoid file */
 	WMM_GeomagIntroduction(MagneticModel);  /* Print out the WMM introduction */
 
 
@@ -96,11 +96,7 @@ int main()
 WMM_FreeMagneticModelMemory(MagneticModel);
 WMM_FreeMagneticModelMemory(TimedMagneticModel);     
 
-if (Geoid.GeoidHeightBuffer)
-	{
-	free(Geoid.GeoidHeightBuffer);
-	Geoid.GeoidHeightBuffer = NULL;
-	}
+WMM_FreeGeoid(&Geoid);
 
 
 return 0;
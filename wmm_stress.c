@@ -0,0 +1,410 @@
+//---------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "WMMHeader.h"
+#include "WMM_SubLibrary.c"
+
+//---------------------------------------------------------------------------
+
+/* WMM sublibrary is used to make a thread stress program. Worker threads, each with its own
+context, evaluate the same batches of points through the reentrant API at the same time, over
+one model and one mapped geoid that they share. The workers with an even number use heights
+above MSL, the others heights above the ellipsoid, and the dates they evaluate rotate from
+round to round, so the time modified models of the workspaces change while other threads
+compute. Every batch contains a few out of range points. A worker fails if a result differs
+from the single threaded reference in any bit, or if the failures its context records are not
+exactly the bad points of the batch. The program then writes the same grid with one thread
+and with worker threads of WMM_GridParallel and compares the two files byte for byte.
+It is meant to run under ThreadSanitizer ("make tsan"), which reports any data race between
+the threads; it also runs as an ordinary program. The program expects WMM.COF and
+EGM9615.BIN in the current directory, as the other programs do.
+
+Usage: wmm_stress [-t threads] [-n rounds]	(default 8 threads, 20 rounds)
+Returns 0 if every result matches and ThreadSanitizer is silent, 1 otherwise.
+
+ *
+ * MODIFICATIONS
+ *
+ *    Date                 Version
+ *    ----                 -----------
+ *    Oct 17, 2026         1.0
+
+
+*/
+
+#define STRESS_THREADS	8		/* Default number of worker threads */
+#define STRESS_ROUNDS	20		/* Default batches of each kind per worker */
+#define STRESS_POINTS	300		/* Points of a batch, not a multiple of WMM_BATCH_BLOCK_SIZE */
+#define STRESS_BAD_POINTS	3	/* The first points of every batch are out of range */
+#define STRESS_DATES	3
+#define STRESS_ELEMENTS	14		/* X to Incldot */
+#define STRESS_GRID_THREADS	4
+#define STRESS_GRID_FILE_1	"wmm_stress1.tmp"	/* Grid written by one thread */
+#define STRESS_GRID_FILE_N	"wmm_stress2.tmp"	/* Same grid, written by STRESS_GRID_THREADS threads */
+
+typedef struct {
+	WMMtype_MagneticModel *MagneticModel;	/* Shared by the workers, only read */
+	WMMtype_Ellipsoid Ellip;
+	WMMtype_Geoid *Geoid;	/* Shared by the workers, only read */
+	double Latitude[STRESS_POINTS], Longitude[STRESS_POINTS], Height[STRESS_POINTS];
+	WMMtype_Float FloatLatitude[STRESS_POINTS], FloatLongitude[STRESS_POINTS], FloatHeight[STRESS_POINTS];
+	double Dates[STRESS_DATES];
+	double *Reference[2][STRESS_DATES];	/* Single threaded results, [UseGeoid][date] */
+	WMMtype_Float *FloatReference[2][STRESS_DATES];
+	int NumRounds;
+} StressInput;
+
+typedef struct {
+	StressInput *Input;
+	int Index;
+	int Failed;
+	const char *Failure;	/* First check that failed */
+} StressWorker;
+
+void *stress_worker(void *WorkerPointer);
+int stress_batch(WMMtype_Context *Context, StressInput *Input, double DecimalYear, double *Out);
+int stress_batch_float(WMMtype_Context *Context, StressInput *Input, double DecimalYear, WMMtype_Float *Out);
+int stress_grid(StressInput *Input);
+double stress_random(unsigned long long *State);
+
+int main(int argc, char *argv[])
+{
+	WMMtype_MagneticModel *MagneticModel;
+	WMMtype_Ellipsoid Ellip;
+	WMMtype_Geoid Geoid;
+	WMMtype_Context *Context[2];
+	StressInput Input;
+	StressWorker *Workers;
+	pthread_t *Threads;
+	unsigned long long State = 0x5eed0016ULL;
+	int NumThreads = STRESS_THREADS, NumStarted, NumTerms, iarg, i, d, g, Failed = 0;
+
+	memset(&Input, 0, sizeof(Input));
+	Input.NumRounds = STRESS_ROUNDS;
+	for (iarg = 1; iarg < argc; iarg++)
+	{
+		if (argv[iarg][0] == '-' && (argv[iarg][1] == 't' || argv[iarg][1] == 'n') && iarg + 1 < argc)
+		{
+			if (argv[iarg][1] == 't')
+				NumThreads = atoi(argv[++iarg]);
+			else
+				Input.NumRounds = atoi(argv[++iarg]);
+		}
+		else
+			NumThreads = 0;
+	}
+	if (NumThreads < 1 || Input.NumRounds < 1)
+	{
+		printf("Usage: wmm_stress [-t threads] [-n rounds]\n");
+		return 1;
+	}
+
+	NumTerms = ( ( WMM_MAX_MODEL_DEGREES + 1 ) * ( WMM_MAX_MODEL_DEGREES + 2 ) / 2 );    /* WMM_MAX_MODEL_DEGREES is defined in WMM_Header.h */
+	MagneticModel = WMM_AllocateModelMemory(NumTerms);
+	if(MagneticModel == NULL)
+	{
+		WMM_Error(2);
+		return 1;
+	}
+	WMM_SetDefaults(&Ellip, MagneticModel, &Geoid); /* Set default values and constants */
+	if (!WMM_readMagneticModel(WMM_COF_FILE, MagneticModel))
+		return 1;
+	WMM_InitializeGeoidMapped(&Geoid);    /* Read the Geoid file */
+	if (!Geoid.Geoid_Initialized)
+		return 1;
+	Geoid.UseGeoid = 1;
+	Input.MagneticModel = MagneticModel;
+	Input.Ellip = Ellip;
+	Input.Geoid = &Geoid;
+
+	/* Pseudo-random points up to 850 km, the first ones out of range */
+	for (i = 0; i < STRESS_POINTS; i++)
+	{
+		Input.Latitude[i] = RAD2DEG(asin(2.0 * stress_random(&State) - 1.0));
+		Input.Longitude[i] = 360.0 * stress_random(&State) - 180.0;
+		Input.Height[i] = 851.0 * stress_random(&State) - 1.0;
+	}
+	Input.Latitude[0] = 91.0;
+	Input.Longitude[1] = 400.0;
+	Input.Height[2] = NAN;
+	for (i = 0; i < STRESS_POINTS; i++)
+	{
+		Input.FloatLatitude[i] = (WMMtype_Float) Input.Latitude[i];
+		Input.FloatLongitude[i] = (WMMtype_Float) Input.Longitude[i];
+		Input.FloatHeight[i] = (WMMtype_Float) Input.Height[i];
+	}
+	for (d = 0; d < STRESS_DATES; d++)
+		Input.Dates[d] = MagneticModel->epoch + 1.7 * d + 0.25;
+
+	/* Single threaded reference, with one context per height reference */
+	Context[0] = WMM_CreateContext(Ellip, MagneticModel, NULL);
+	Context[1] = WMM_CreateContext(Ellip, MagneticModel, &Geoid);
+	for (g = 0; g < 2; g++)
+		for (d = 0; d < STRESS_DATES; d++)
+		{
+			Input.Reference[g][d] = (double *) malloc(STRESS_ELEMENTS * STRESS_POINTS * sizeof(double));
+			Input.FloatReference[g][d] = (WMMtype_Float *) malloc(STRESS_ELEMENTS * STRESS_POINTS * sizeof(WMMtype_Float));
+			if (!Context[g] || !Input.Reference[g][d] || !Input.FloatReference[g][d] ||
+				!stress_batch(Context[g], &Input, Input.Dates[d], Input.Reference[g][d]) ||
+				!stress_batch_float(Context[g], &Input, Input.Dates[d], Input.FloatReference[g][d]))
+			{
+				printf("Reference batch failed\n");
+				return 1;
+			}
+		}
+	WMM_FreeContext(Context[0]);
+	WMM_FreeContext(Context[1]);
+
+	Workers = (StressWorker *) calloc(NumThreads, sizeof(StressWorker));
+	Threads = (pthread_t *) malloc(NumThreads * sizeof(pthread_t));
+	if (!Workers || !Threads)
+	{
+		WMM_Error(2);
+		return 1;
+	}
+	for (NumStarted = 0; NumStarted < NumThreads; NumStarted++)
+	{
+		Workers[NumStarted].Input = &Input;
+		Workers[NumStarted].Index = NumStarted;
+		if (pthread_create(&Threads[NumStarted], NULL, stress_worker, &Workers[NumStarted]) != 0)
+			break;
+	}
+	for (i = 0; i < NumStarted; i++)
+		pthread_join(Threads[i], NULL);
+	if (NumStarted < NumThreads)
+	{
+		printf("Started %d of %d threads\n", NumStarted, NumThreads);
+		Failed = 1;
+	}
+	for (i = 0; i < NumStarted; i++)
+		if (Workers[i].Failed)
+		{
+			printf("Thread %d: %s\n", i, Workers[i].Failure);
+			Failed = 1;
+		}
+	printf("%d threads x %d rounds of %d points: %s\n", NumStarted, Input.NumRounds, STRESS_POINTS, Failed ? "FAILED" : "identical to one thread");
+
+	if (!stress_grid(&Input))
+	{
+		printf("WMM_GridParallel: %d threads differ from one thread\n", STRESS_GRID_THREADS);
+		Failed = 1;
+	}
+	else
+		printf("WMM_GridParallel: %d threads identical to one thread\n", STRESS_GRID_THREADS);
+	printf("%s\n", Failed ? "FAILED" : "PASSED");
+
+	for (g = 0; g < 2; g++)
+		for (d = 0; d < STRESS_DATES; d++)
+		{
+			free(Input.Reference[g][d]);
+			free(Input.FloatReference[g][d]);
+		}
+	free(Workers);
+	free(Threads);
+	WMM_FreeMagneticModelMemory(MagneticModel);
+	WMM_FreeGeoid(&Geoid);
+	return Failed ? 1 : 0;
+}
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine stress_worker                           */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Thread routine. Evaluates the batches of the input with a context of    */
+/*     its own, in double and in single precision, at a date that changes   */
+/*     every round, and compares them with the reference.                   */
+/*                                                                          */
+/*  Input:  WorkerPointer - StressWorker of the thread                      */
+/*                                                                          */
+/*  Output: Failed and Failure of the worker                                */
+/*                                                                          */
+/****************************************************************************/
+
+void *stress_worker(void *WorkerPointer)
+{
+	StressWorker *Worker = (StressWorker *) WorkerPointer;
+	StressInput *Input = Worker->Input;
+	WMMtype_Context *Context;
+	WMMtype_GeoMagneticElements GeoMagneticElements;
+	double *Out;
+	WMMtype_Float *FloatOut;
+	int UseGeoid = Worker->Index % 2 == 0, Round, d, k;
+
+	Context = WMM_CreateContext(Input->Ellip, Input->MagneticModel, UseGeoid ? Input->Geoid : NULL);
+	Out = (double *) malloc(STRESS_ELEMENTS * STRESS_POINTS * sizeof(double));
+	FloatOut = (WMMtype_Float *) malloc(STRESS_ELEMENTS * STRESS_POINTS * sizeof(WMMtype_Float));
+	if (!Context || !Out || !FloatOut)
+	{
+		Worker->Failed = 1;
+		Worker->Failure = "out of memory";
+	}
+	for (Round = 0; !Worker->Failed && Round < Input->NumRounds; Round++)
+	{
+		d = (Worker->Index + Round) % STRESS_DATES;
+		if (!stress_batch(Context, Input, Input->Dates[d], Out))
+			Worker->Failure = "WMM_ContextGeomagBatch errors are not the bad points";
+		else if (memcmp(Out, Input->Reference[UseGeoid][d], STRESS_ELEMENTS * STRESS_POINTS * sizeof(double)) != 0)
+			Worker->Failure = "WMM_ContextGeomagBatch results differ";
+		else if (!stress_batch_float(Context, Input, Input->Dates[d], FloatOut))
+			Worker->Failure = "WMM_ContextGeomagBatchFloat errors are not the bad points";
+		else if (memcmp(FloatOut, Input->FloatReference[UseGeoid][d], STRESS_ELEMENTS * STRESS_POINTS * sizeof(WMMtype_Float)) != 0)
+			Worker->Failure = "WMM_ContextGeomagBatchFloat results differ";
+		else
+		{
+			/* One point through WMM_ContextGeomag, whose results are those of a batch of one */
+			k = STRESS_BAD_POINTS + Round % (STRESS_POINTS - STRESS_BAD_POINTS);
+			if (WMM_ContextGeomag(Context, Input->Latitude[k], Input->Longitude[k], Input->Height[k], Input->Dates[d], &GeoMagneticElements) != WMM_ERR_NONE ||
+				GeoMagneticElements.X != Input->Reference[UseGeoid][d][k] || GeoMagneticElements.Incldot != Input->Reference[UseGeoid][d][13 * STRESS_POINTS + k])
+				Worker->Failure = "WMM_ContextGeomag results differ";
+		}
+		Worker->Failed = Worker->Failure != NULL;
+	}
+	free(Out);
+	free(FloatOut);
+	WMM_FreeContext(Context);
+	return NULL;
+} /* stress_worker */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine stress_batch                            */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Evaluates the points of the input through WMM_ContextGeomagBatch and    */
+/*     checks that exactly the bad points failed.                           */
+/*                                                                          */
+/*  Input:  Context, Input, DecimalYear                                     */
+/*                                                                          */
+/*  Output: Out - STRESS_ELEMENTS arrays of STRESS_POINTS values, X to      */
+/*          Incldot. Returns 1 if the failures are as expected, 0 otherwise */
+/*                                                                          */
+/****************************************************************************/
+
+int stress_batch(WMMtype_Context *Context, StressInput *Input, double DecimalYear, double *Out)
+{
+	WMMtype_GeoMagneticElementsBatch Results;
+	int Code;
+
+	memset(&Results, 0, sizeof(Results));
+	Results.X = Out; Results.Y = Out + STRESS_POINTS; Results.Z = Out + 2 * STRESS_POINTS;
+	Results.F = Out + 3 * STRESS_POINTS; Results.H = Out + 4 * STRESS_POINTS;
+	Results.Decl = Out + 5 * STRESS_POINTS; Results.Incl = Out + 6 * STRESS_POINTS;
+	Results.Xdot = Out + 7 * STRESS_POINTS; Results.Ydot = Out + 8 * STRESS_POINTS; Results.Zdot = Out + 9 * STRESS_POINTS;
+	Results.Fdot = Out + 10 * STRESS_POINTS; Results.Hdot = Out + 11 * STRESS_POINTS;
+	Results.Decldot = Out + 12 * STRESS_POINTS; Results.Incldot = Out + 13 * STRESS_POINTS;
+	WMM_ContextClearError(Context);
+	Code = WMM_ContextGeomagBatch(Context, Input->Latitude, Input->Longitude, Input->Height, DecimalYear, STRESS_POINTS, &Results);
+	return Code == WMM_ERR_RANGE && Context->Error == WMM_ERR_RANGE && Context->ErrorIndex == 0 &&
+		Context->NumErrors == STRESS_BAD_POINTS;
+} /* stress_batch */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine stress_batch_float                      */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Same as stress_batch, through WMM_ContextGeomagBatchFloat.              */
+/*                                                                          */
+/****************************************************************************/
+
+int stress_batch_float(WMMtype_Context *Context, StressInput *Input, double DecimalYear, WMMtype_Float *Out)
+{
+	WMMtype_GeoMagneticElementsBatchFloat Results;
+	int Code;
+
+	memset(&Results, 0, sizeof(Results));
+	Results.X = Out; Results.Y = Out + STRESS_POINTS; Results.Z = Out + 2 * STRESS_POINTS;
+	Results.F = Out + 3 * STRESS_POINTS; Results.H = Out + 4 * STRESS_POINTS;
+	Results.Decl = Out + 5 * STRESS_POINTS; Results.Incl = Out + 6 * STRESS_POINTS;
+	Results.Xdot = Out + 7 * STRESS_POINTS; Results.Ydot = Out + 8 * STRESS_POINTS; Results.Zdot = Out + 9 * STRESS_POINTS;
+	Results.Fdot = Out + 10 * STRESS_POINTS; Results.Hdot = Out + 11 * STRESS_POINTS;
+	Results.Decldot = Out + 12 * STRESS_POINTS; Results.Incldot = Out + 13 * STRESS_POINTS;
+	WMM_ContextClearError(Context);
+	Code = WMM_ContextGeomagBatchFloat(Context, Input->FloatLatitude, Input->FloatLongitude, Input->FloatHeight, DecimalYear, STRESS_POINTS, &Results);
+	return Code == WMM_ERR_RANGE && Context->Error == WMM_ERR_RANGE && Context->ErrorIndex == 0 &&
+		Context->NumErrors == STRESS_BAD_POINTS;
+} /* stress_batch_float */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine stress_grid                             */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Writes a binary grid of every element, heights above MSL, with one      */
+/*     thread and with STRESS_GRID_THREADS threads, and compares the files. */
+/*                                                                          */
+/*  Input:  Input - Model and geoid                                         */
+/*                                                                          */
+/*  Output: Returns 1 if the files are identical, 0 otherwise               */
+/*                                                                          */
+/****************************************************************************/
+
+int stress_grid(StressInput *Input)
+{
+	WMMtype_CoordGeodetic Minimum, Maximum;
+	WMMtype_Date StartDate, EndDate;
+	FILE *File1, *FileN;
+	int c1, cN, Identical;
+
+	memset(&Minimum, 0, sizeof(Minimum));
+	memset(&Maximum, 0, sizeof(Maximum));
+	memset(&StartDate, 0, sizeof(StartDate));
+	memset(&EndDate, 0, sizeof(EndDate));
+	Minimum.phi = -89.0; Maximum.phi = 89.0;
+	Minimum.lambda = -180.0; Maximum.lambda = 180.0;
+	Minimum.HeightAboveGeoid = 0.0; Maximum.HeightAboveGeoid = 400.0;
+	StartDate.DecimalYear = Input->Dates[0];
+	EndDate.DecimalYear = Input->Dates[STRESS_DATES - 1];
+	if (!WMM_GridParallel(Minimum, Maximum, 7.0, 200.0, 1.0, Input->MagneticModel, Input->Geoid, Input->Ellip,
+			StartDate, EndDate, WMM_GRID_ELEMENT(WMM_GRID_MAX_ELEMENTS + 1) - 1, 1, STRESS_GRID_FILE_1, WMM_GRID_FLOAT64, 1) ||
+		!WMM_GridParallel(Minimum, Maximum, 7.0, 200.0, 1.0, Input->MagneticModel, Input->Geoid, Input->Ellip,
+			StartDate, EndDate, WMM_GRID_ELEMENT(WMM_GRID_MAX_ELEMENTS + 1) - 1, 1, STRESS_GRID_FILE_N, WMM_GRID_FLOAT64, STRESS_GRID_THREADS))
+		return 0;
+
+	File1 = fopen(STRESS_GRID_FILE_1, "rb");
+	FileN = fopen(STRESS_GRID_FILE_N, "rb");
+	Identical = File1 && FileN;
+	while (Identical)
+	{
+		c1 = fgetc(File1);
+		cN = fgetc(FileN);
+		Identical = c1 == cN;
+		if (c1 == EOF)
+			break;
+	}
+	if (File1)
+		fclose(File1);
+	if (FileN)
+		fclose(FileN);
+	remove(STRESS_GRID_FILE_1);
+	remove(STRESS_GRID_FILE_N);
+	return Identical;
+} /* stress_grid */
+
+/****************************************************************************/
+/*                                                                          */
+/*                       Subroutine stress_random                           */
+/*                                                                          */
+/****************************************************************************/
+/*                                                                          */
+/*  Uniform pseudo-random number in [0, 1) from a xorshift64* generator, so */
+/*     the points are the same on every platform and C library.             */
+/*                                                                          */
+/****************************************************************************/
+
+double stress_random(unsigned long long *State)
+{
+	*State ^= *State >> 12;
+	*State ^= *State << 25;
+	*State ^= *State >> 27;
+	return (double) ((*State * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+} /* stress_random */